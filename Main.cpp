@@ -1,8 +1,14 @@
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <pytorch/pytorch.hpp>
 
 #include "util/FileUtil.h"
 #include "util/ArgParser.h"
+#include "util/AssetCache.h"
+#include "util/TripleBuffer.h"
 #include "scenarios/DrawScenarioSimChar.h"
 #include "scenarios/DrawScenarioExp.h"
 #include "scenarios/DrawScenarioExpCacla.h"
@@ -15,6 +21,9 @@
 #include "render/Camera.h"
 #include "render/DrawUtil.h"
 #include "render/TextureDesc.h"
+#include "render/OffscreenContext.h"
+#include "render/FrameCapture.h"
+#include "render/SceneSnapshot.h"
 
 // Dimensions of the window we are drawing into.
 int gWinWidth = 800;
@@ -40,6 +49,8 @@ tVector gCameraFocus = tVector(gCameraPosition[0], gCameraPosition[1], 0.0, 0.0)
 tVector gCameraUp = tVector(0, 1, 0, 0);
 
 cCamera gCamera;
+// camera the current frame is drawn with, blended between snapshots when the sim is threaded
+cCamera gDrawCamera;
 
 // anim
 const double gFPS = 30.0;
@@ -50,7 +61,7 @@ bool gAnimate = true;
 int gPrevTime = 0;
 int gNextTime = 0;
 int gDispalyPrevTime = 0;
-double gUpdatesPerSec = 0;
+std::atomic<double> gUpdatesPerSec(0);
 
 double gPlaybackSpeed = 1.0;
 const double gPlaybackDelta = 0.05;
@@ -60,6 +71,32 @@ bool gRenderFilmStrip = false;
 const double gFilmStripPeriod = 0.5;
 tVector gPrevCamPos = tVector::Zero();
 
+// offscreen batch rendering, a frame is drawn every gCaptureSteps sim steps
+// of gAnimStep regardless of wall clock time, so runs are reproducible
+bool gOffscreen = false;
+int gCaptureSteps = 1;
+int gCaptureMaxFrames = 0;
+int gCaptureBuffers = 8;
+std::string gCapturePath = "";
+std::string gCaptureFormat = "png";
+cOffscreenContext gOffscreenContext;
+cFrameCapture gFrameCapture;
+
+// threaded simulation, the scenario is stepped on its own thread once every gAnimStep
+// and each step is published as a snapshot, the display only blends and draws the latest two,
+// gSimMutex guards the scenario and gCamera while the sim thread is running
+bool gThreadedSim = true;
+bool gCheckArgs = false;
+const double gDisplayFPS = 60.0;
+const int gDisplayFrameTime = static_cast<int>(1000 / gDisplayFPS);
+std::thread gSimThread;
+std::mutex gSimMutex;
+std::atomic<bool> gSimRunning(false);
+std::atomic<bool> gSimDone(false);
+int gSimStepCount = 0;
+cTripleBuffer<cSceneSnapshot> gSnapshots;
+cSceneSnapshot gPrevSnapshot;
+
 // arg parser
 cArgParser gArgParser;
 std::shared_ptr<cDrawScenario> gScenario = NULL;
@@ -67,9 +104,9 @@ int gArgc = 0;
 char** gArgv = NULL;
 
 
-void SetupCamProjection()
+void SetupCamProjection(const cCamera& cam)
 {
-	gCamera.SetupGLProj();
+	cam.SetupGLProj();
 }
 
 void ResizeCamera()
@@ -138,6 +175,11 @@ void SetupScenario()
 		gScenario->ParseArgs(gArgParser);
 		gScenario->Init();
 		printf("Loaded scenario: %s\n", gScenario->GetName().c_str());
+
+		if (gCheckArgs)
+		{
+			gArgParser.CheckArgs();
+		}
 	}
 }
 
@@ -158,9 +200,160 @@ void UpdateScenario(double time_step)
 	}
 }
 
+double GetWallTime()
+{
+	std::chrono::duration<double> time = std::chrono::steady_clock::now().time_since_epoch();
+	return time.count();
+}
+
+bool IsSimThreaded()
+{
+	return gSimThread.joinable();
+}
+
+// the caller has to hold gSimMutex, which also serializes publishing between threads
+void PublishSnapshot()
+{
+	cSceneSnapshot& snapshot = gSnapshots.GetBack();
+	snapshot.Clear();
+	if (gScenario != nullptr)
+	{
+		gScenario->BuildSnapshot(snapshot);
+	}
+	snapshot.mStepCount = gSimStepCount;
+	snapshot.mWallTime = GetWallTime();
+	gSnapshots.Publish();
+}
+
+void SimLoop()
+{
+	double next_tick = GetWallTime();
+	double step_carry = 0;
+	double rate_time = next_tick;
+	int rate_steps = 0;
+
+	while (gSimRunning)
+	{
+		double tick_beg = GetWallTime();
+		int num_steps = 0;
+		double timestep = gAnimStep;
+		{
+			std::lock_guard<std::mutex> lock(gSimMutex);
+			if (gAnimate)
+			{
+				// fractional speeds carry over, so playback runs at exactly gPlaybackSpeed
+				step_carry += std::abs(gPlaybackSpeed);
+				num_steps = static_cast<int>(step_carry);
+				step_carry -= num_steps;
+				timestep = (gPlaybackSpeed < 0) ? -gAnimStep : gAnimStep;
+			}
+		}
+
+		for (int i = 0; i < num_steps; ++i)
+		{
+			// the lock is released between steps, so input never waits longer than one step
+			std::lock_guard<std::mutex> lock(gSimMutex);
+			UpdateScenario(timestep);
+			++gSimStepCount;
+			++rate_steps;
+
+			// steps that do not fit in a tick are dropped instead of queued,
+			// so snapshots keep coming at the tick rate when the sim cannot keep up
+			if (GetWallTime() - tick_beg > gAnimStep)
+			{
+				break;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(gSimMutex);
+			PublishSnapshot();
+			if (gScenario != nullptr && gScenario->IsDone())
+			{
+				gSimDone = true;
+				gSimRunning = false;
+			}
+		}
+
+		double curr_time = GetWallTime();
+		if (curr_time - rate_time > 0.5)
+		{
+			gUpdatesPerSec = rate_steps / (curr_time - rate_time);
+			rate_time = curr_time;
+			rate_steps = 0;
+		}
+
+		next_tick += gAnimStep;
+		if (next_tick < curr_time)
+		{
+			next_tick = curr_time;
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(next_tick - curr_time));
+		}
+	}
+}
+
+void StartSimThread()
+{
+	if (!IsSimThreaded())
+	{
+		// the display always has a valid snapshot to draw
+		{
+			std::lock_guard<std::mutex> lock(gSimMutex);
+			gPrevSnapshot.Clear();
+			PublishSnapshot();
+		}
+		gSnapshots.Acquire();
+
+		gSimDone = false;
+		gSimRunning = true;
+		gSimThread = std::thread(SimLoop);
+	}
+}
+
+void StopSimThread()
+{
+	if (IsSimThreaded())
+	{
+		gSimRunning = false;
+		gSimThread.join();
+	}
+}
+
+void AcquireSnapshot()
+{
+	if (gSnapshots.HasUpdate())
+	{
+		// the old front goes back to the sim thread, so its contents are kept to blend from
+		gPrevSnapshot = gSnapshots.GetFront();
+		gSnapshots.Acquire();
+	}
+}
+
+double CalcSnapshotLerp()
+{
+	// frames are drawn up to one tick behind the sim, blending from the previous snapshot
+	// to the current one over the time it took the current one to arrive
+	const cSceneSnapshot& curr = gSnapshots.GetFront();
+	double lerp = 1;
+	if (gPrevSnapshot.IsValid())
+	{
+		double period = curr.mWallTime - gPrevSnapshot.mWallTime;
+		if (period > 0)
+		{
+			lerp = (GetWallTime() - curr.mWallTime) / period;
+		}
+	}
+	lerp = cMathUtil::Clamp(lerp, 0.0, 1.0);
+	return lerp;
+}
+
 void DrawInfo()
 {
-	if (!gRenderFilmStrip)
+	// stroke fonts are part of glut, which is not initialized offscreen
+	if (!gRenderFilmStrip && !gOffscreen)
 	{
 		glMatrixMode(GL_PROJECTION);
 		glPushMatrix();
@@ -170,7 +363,7 @@ void DrawInfo()
 		glPushMatrix();
 		glLoadIdentity();
 
-		const double aspect = gCamera.GetAspectRatio();
+		const double aspect = gDrawCamera.GetAspectRatio();
 		const double text_size = 0.09;
 		const tVector scale = tVector(text_size / aspect, text_size, 1, 0);
 		const double line_offset = text_size;
@@ -185,7 +378,11 @@ void DrawInfo()
 		sprintf(buffer, "FPS: %.2f\nPlayback Speed: %.2fx\n", curr_fps, gPlaybackSpeed);
 
 		std::string text_info = std::string(buffer);
-		if (gScenario != nullptr)
+		if (IsSimThreaded())
+		{
+			text_info += gSnapshots.GetFront().mTextInfo;
+		}
+		else if (gScenario != nullptr)
 		{
 			text_info += gScenario->BuildTextInfoStr();
 		}
@@ -206,7 +403,7 @@ void ClearFrame()
 
 	if (gRenderFilmStrip && !gForceClear)
 	{
-		const tVector& cam_pos = gCamera.GetPosition();
+		const tVector& cam_pos = gDrawCamera.GetPosition();
 		if (cam_pos != gPrevCamPos)
 		{
 			gPrevCamPos = cam_pos;
@@ -226,11 +423,24 @@ void ClearFrame()
 	gForceClear = false;
 }
 
-void DrawScene()
+void DrawScene(double lerp)
 {
 	if (gScenario != NULL)
 	{
-		gScenario->Draw();
+		if (IsSimThreaded())
+		{
+			gScenario->DrawSnapshot(gPrevSnapshot, gSnapshots.GetFront(), lerp);
+			if (gScenario->HasOverlays())
+			{
+				// overlays read the controllers directly, so the sim waits while they are drawn
+				std::lock_guard<std::mutex> lock(gSimMutex);
+				gScenario->DrawOverlays(gDrawCamera);
+			}
+		}
+		else
+		{
+			gScenario->Draw();
+		}
 	}
 }
 
@@ -247,27 +457,45 @@ void UpdateIntermediateBuffer()
 			|| gWinHeight != gIntermediateFrameBuffer->GetHeight())
 		{
 			gIntermediateFrameBuffer->Reshape(gWinWidth, gWinHeight);
+
+			std::lock_guard<std::mutex> lock(gSimMutex);
 			gScenario->Reshape(gWinWidth, gWinHeight);
 		}
 	}
 }
 
-void Display(void)
+void DrawFrame()
 {
 	UpdateIntermediateBuffer();
 
+	double lerp = 1;
+	if (IsSimThreaded())
+	{
+		AcquireSnapshot();
+		lerp = CalcSnapshotLerp();
+		cSceneSnapshot::LerpCamera(gPrevSnapshot, gSnapshots.GetFront(), lerp, gDrawCamera);
+	}
+	else
+	{
+		gDrawCamera = gCamera;
+	}
+
 	glMatrixMode(GL_PROJECTION);
-	SetupCamProjection();
+	SetupCamProjection(gDrawCamera);
 
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
 	gIntermediateFrameBuffer->BindBuffer();
 	ClearFrame();
-	DrawScene();
+	DrawScene(lerp);
 	DrawInfo();
 	gIntermediateFrameBuffer->UnbindBuffer();
+}
 
+void Display(void)
+{
+	DrawFrame();
 	CopyFrame();
 
 	glutSwapBuffers();
@@ -276,22 +504,26 @@ void Display(void)
 	gReshaping = false;
 }
 
-void Reshape(int w, int h)
+void ResizeViewport(int w, int h)
 {
-	gReshaping = true;
-
 	gWinWidth = w;
 	gWinHeight = h;
 
 	glViewport(0, 0, gWinWidth, gWinHeight);
 	gDefaultFrameBuffer->Reshape(w, h);
 
+	std::lock_guard<std::mutex> lock(gSimMutex);
 	UpdateScenario(0);
 	ResizeCamera();
 
 	glMatrixMode(GL_PROJECTION);
-	SetupCamProjection();
+	SetupCamProjection(gCamera);
+}
 
+void Reshape(int w, int h)
+{
+	gReshaping = true;
+	ResizeViewport(w, h);
 	glutPostRedisplay();
 }
 
@@ -314,6 +546,26 @@ void ParseArgs(int argc, char** argv)
 		// this allows the cmd args to overwrite the file args
 		gArgParser.AppendArgs(arg_file);
 	}
+
+	std::string asset_cache_dir = "";
+	gArgParser.ParseString("asset_cache_dir", asset_cache_dir);
+	cAssetCache::SetCacheDir(asset_cache_dir);
+
+	gArgParser.ParseBool("threaded_sim", gThreadedSim);
+	gArgParser.ParseBool("check_args", gCheckArgs);
+	gArgParser.ParseBool("offscreen", gOffscreen);
+	gArgParser.ParseString("capture_path", gCapturePath);
+	gArgParser.ParseString("capture_format", gCaptureFormat);
+	gArgParser.ParseInt("capture_steps", gCaptureSteps);
+	gArgParser.ParseInt("capture_max_frames", gCaptureMaxFrames);
+	gArgParser.ParseInt("capture_buffers", gCaptureBuffers);
+	gCaptureSteps = std::max(1, gCaptureSteps);
+
+	if (gOffscreen)
+	{
+		gArgParser.ParseInt("capture_width", gWinWidth);
+		gArgParser.ParseInt("capture_height", gWinHeight);
+	}
 }
 
 void InitTime()
@@ -326,10 +578,19 @@ void InitTime()
 
 void Reload()
 {
+	// the threading mode is kept from startup
+	bool threaded = IsSimThreaded();
+	StopSimThread();
+
 	ParseArgs(gArgc, gArgv);
 	SetupScenario();
 	InitTime();
 	gForceClear = true;
+
+	if (threaded)
+	{
+		StartSimThread();
+	}
 }
 
 void Reset()
@@ -366,6 +627,13 @@ int CalcDisplayAnimTime()
 
 void Shutdown()
 {
+	StopSimThread();
+
+	if (gFrameCapture.IsValid())
+	{
+		gFrameCapture.Clear();
+	}
+
 	if (gScenario != nullptr)
 	{
 		gScenario->Shutdown();
@@ -405,10 +673,24 @@ void Animate(int callback_val)
 	}
 }
 
+void DisplayTimer(int callback_val)
+{
+	if (IsSimThreaded())
+	{
+		glutTimerFunc(gDisplayFrameTime, DisplayTimer, 0);
+		glutPostRedisplay();
+	}
+
+	if (gSimDone)
+	{
+		Shutdown();
+	}
+}
+
 void ToggleAnimate()
 {
 	gAnimate = !gAnimate;
-	if (gAnimate)
+	if (gAnimate && !IsSimThreaded())
 	{
 		glutTimerFunc(gDisplayAnimTime, Animate, 0);
 	}
@@ -419,7 +701,8 @@ void ChangePlaybackSpeed(double delta)
 	double prev_playback = gPlaybackSpeed;
 	gPlaybackSpeed += delta;
 
-	if (std::abs(prev_playback) < 0.0001 && std::abs(gPlaybackSpeed) > 0.0001)
+	if (std::abs(prev_playback) < 0.0001 && std::abs(gPlaybackSpeed) > 0.0001
+		&& !IsSimThreaded())
 	{
 		glutTimerFunc(gDisplayAnimTime, Animate, 0);
 	}
@@ -442,6 +725,7 @@ void ToogleFilmStrip()
 
 void Keyboard(unsigned char key, int x, int y) {
 
+	std::unique_lock<std::mutex> lock(gSimMutex);
 	if (gScenario != NULL)
 	{
 		gScenario->Keyboard(key, x, y);
@@ -455,6 +739,7 @@ void Keyboard(unsigned char key, int x, int y) {
 	case CTRL_C_EVENT:
 #endif
 	case 27: // escape
+		lock.unlock();
 		Shutdown();
 		break;
 	case 13: // enter
@@ -478,6 +763,7 @@ void Keyboard(unsigned char key, int x, int y) {
 		ChangePlaybackSpeed(-gPlaybackSpeed + 1);
 		break;
 	case 'l':
+		lock.unlock();
 		Reload();
 		break;
 	case 'q':
@@ -501,6 +787,7 @@ void MouseClick(int button, int state, int x, int y)
 
 	if (gScenario != NULL)
 	{
+		std::lock_guard<std::mutex> lock(gSimMutex);
 		gScenario->MouseClick(button, state, screen_x, screen_y);
 	}
 	glutPostRedisplay();
@@ -516,18 +803,33 @@ void MouseMove(int x, int y)
 
 	if (gScenario != NULL)
 	{
+		std::lock_guard<std::mutex> lock(gSimMutex);
 		gScenario->MouseMove(screen_x, screen_y);
 	}
 	glutPostRedisplay();
 }
 
-void InitOpenGl(void)
+bool InitOpenGl(void)
 {
 	cDrawUtil::InitDrawUtil();
-	glewInit();
+	GLenum glew_err = glewInit();
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+	// glew builds without egl support still load the gl entry points for an egl context,
+	// they only fail to find a glx display afterwards
+	if (gOffscreen && glew_err == GLEW_ERROR_NO_GLX_DISPLAY)
+	{
+		glew_err = GLEW_OK;
+	}
+#endif
+	if (glew_err != GLEW_OK)
+	{
+		printf("Failed to initialize GLEW: %s\n", reinterpret_cast<const char*>(glewGetErrorString(glew_err)));
+		return false;
+	}
 
 	gDefaultFrameBuffer = std::unique_ptr<cTextureDesc>(new cTextureDesc(0, 0, 0, gWinWidth, gWinHeight, 1, GL_RGBA, GL_RGBA));
 	gIntermediateFrameBuffer = std::shared_ptr<cTextureDesc>(new cTextureDesc(gWinWidth, gWinHeight, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, false));
+	return true;
 }
 
 void InitPyTorch()
@@ -537,6 +839,73 @@ void InitPyTorch()
 	pytorch::GlobalInit(&pytorch_argc, &gArgv);
 }
 
+bool InitFrameCapture()
+{
+	bool succ = true;
+	if (gCapturePath != "")
+	{
+		cFrameEncoder::eFormat format = cFrameEncoder::eFormatPNG;
+		succ = cFrameEncoder::ParseFormat(gCaptureFormat, format);
+		if (succ)
+		{
+			succ = gFrameCapture.Init(gWinWidth, gWinHeight, gCapturePath, format, gCaptureBuffers);
+		}
+	}
+	return succ;
+}
+
+int RunOffscreen()
+{
+	bool succ = gOffscreenContext.Init(gWinWidth, gWinHeight);
+	if (!succ)
+	{
+		printf("Failed to create offscreen context\n");
+		return EXIT_FAILURE;
+	}
+
+	succ = InitOpenGl();
+	if (!succ)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SetupScenario();
+	ResizeViewport(gWinWidth, gWinHeight);
+
+	succ = InitFrameCapture();
+	if (!succ)
+	{
+		printf("Failed to initialize frame capture\n");
+		return EXIT_FAILURE;
+	}
+
+	if (gCaptureMaxFrames <= 0)
+	{
+		printf("No capture_max_frames specified, running until the scenario is done\n");
+	}
+
+	int num_frames = 0;
+	while (gScenario != nullptr && !gScenario->IsDone()
+		&& (gCaptureMaxFrames <= 0 || num_frames < gCaptureMaxFrames))
+	{
+		for (int i = 0; i < gCaptureSteps; ++i)
+		{
+			Update(gAnimStep);
+		}
+
+		DrawFrame();
+		if (gFrameCapture.IsValid())
+		{
+			gFrameCapture.Capture(*gIntermediateFrameBuffer);
+		}
+		++num_frames;
+	}
+
+	printf("Rendered %i frames\n", num_frames);
+	Shutdown();
+	return EXIT_SUCCESS;
+}
+
 int main(int argc, char** argv)
 {
 	gArgc = argc;
@@ -545,12 +914,22 @@ int main(int argc, char** argv)
 
 	InitPyTorch();
 
+	if (gOffscreen)
+	{
+		return RunOffscreen();
+	}
+
 	glutInit(&gArgc, gArgv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
 	glutInitWindowSize(gWinWidth, gWinHeight);
 	glutCreateWindow("Terrain RL");
 
-	InitOpenGl();
+	bool succ = InitOpenGl();
+	if (!succ)
+	{
+		return EXIT_FAILURE;
+	}
+
 	SetupScenario();
 
 	Reshape(gWinWidth, gWinHeight);
@@ -559,9 +938,17 @@ int main(int argc, char** argv)
 	glutKeyboardFunc(Keyboard);
 	glutMouseFunc(MouseClick);
 	glutMotionFunc(MouseMove);
-	glutTimerFunc(gDisplayAnimTime, Animate, 0);
 
 	InitTime();
+	if (gThreadedSim)
+	{
+		StartSimThread();
+		glutTimerFunc(gDisplayFrameTime, DisplayTimer, 0);
+	}
+	else
+	{
+		glutTimerFunc(gDisplayAnimTime, Animate, 0);
+	}
 	glutMainLoop();
 
 	return EXIT_SUCCESS;
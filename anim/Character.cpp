@@ -3,6 +3,7 @@
 #include <json/json.h>
 
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 #include "util/JsonUtil.h"
 
 // Json keys
@@ -27,11 +28,8 @@ bool cCharacter::Init(const std::string& char_file)
 	bool succ = true;
 	if (char_file != "")
 	{
-		std::ifstream f_stream(char_file);
-		Json::Reader reader;
 		Json::Value root;
-		succ = reader.parse(f_stream, root);
-		f_stream.close();
+		succ = cAssetCache::LoadJson(char_file, root);
 
 		if (succ)
 		{
@@ -66,6 +64,7 @@ void cCharacter::Clear()
 	mVel.resize(0);
 	mPose0.resize(0);
 	mVel0.resize(0);
+	mFKCache.Clear();
 }
 
 void cCharacter::Update(double time_step)
@@ -162,7 +161,8 @@ int cCharacter::GetParamSize(int joint_id) const
 
 tVector cCharacter::CalcJointPos(int joint_id) const
 {
-	tVector pos = cKinTree::CalcJointWorldPos(mJointMat, mPose, joint_id);
+	cKinTree::UpdateFKCache(mJointMat, mPose, mFKCache);
+	tVector pos = cKinTree::CalcJointWorldPos(mFKCache, joint_id);
 	return pos;
 }
 
@@ -191,12 +191,14 @@ double cCharacter::CalcJointChainLength(int joint_id)
 
 tMatrix cCharacter::BuildJointWorldTrans(int joint_id) const
 {
-	return cKinTree::JointWorldTrans(mJointMat, mPose, joint_id);
+	cKinTree::UpdateFKCache(mJointMat, mPose, mFKCache);
+	return cKinTree::JointWorldTrans(mFKCache, joint_id);
 }
 
 void cCharacter::CalcAABB(tVector& out_min, tVector& out_max) const
 {
-	cKinTree::CalcAABB(mJointMat, mPose, out_min, out_max);
+	cKinTree::UpdateFKCache(mJointMat, mPose, mFKCache);
+	cKinTree::CalcAABB(mFKCache, out_min, out_max);
 }
 
 void cCharacter::BuildPose0(Eigen::VectorXd& out_pose) const
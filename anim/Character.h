@@ -52,6 +52,9 @@ protected:
 	Eigen::VectorXd mPose0;
 	Eigen::VectorXd mVel0;
 
+	// lazily rebuilt whenever mPose changes
+	mutable cKinTree::tFKCache mFKCache;
+
 	cCharacter();
 
 	virtual bool LoadSkeleton(const Json::Value& root);
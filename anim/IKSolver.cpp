@@ -1,6 +1,6 @@
 #include "IKSolver.h"
 #include <iostream>
-#include "anim/KinTree.h"
+#include <ctime>
 
 const int gPosDims = 2;
 
@@ -17,6 +17,20 @@ cIKSolver::tProblem::~tProblem()
 {
 }
 
+cIKSolver::tSolveStats::tSolveStats()
+{
+	Clear();
+}
+
+void cIKSolver::tSolveStats::Clear()
+{
+	mIters = 0;
+	mTime = 0;
+	mObjVal = 0;
+	mConverged = false;
+	mWarmStarted = false;
+}
+
 std::default_random_engine cIKSolver::gRandGen(static_cast<unsigned long int>(time(NULL)));
 std::uniform_real_distribution<double> cIKSolver::gRandDoubleDist(0, 1);
 
@@ -27,143 +41,234 @@ void cIKSolver::PrintMatrix(const Eigen::MatrixXd& mat)
 	std::cout << mat << std::endl;
 }
 
+cIKSolver::cIKSolver()
+{
+	mEnableWarmStart = true;
+	Reset();
+}
+
+cIKSolver::~cIKSolver()
+{
+}
+
+void cIKSolver::Reset()
+{
+	mHasPrevSoln = false;
+	mFKCache.Clear();
+	mStats.Clear();
+}
+
+void cIKSolver::EnableWarmStart(bool enable)
+{
+	mEnableWarmStart = enable;
+}
+
+bool cIKSolver::EnabledWarmStart() const
+{
+	return mEnableWarmStart;
+}
+
+const cIKSolver::tSolveStats& cIKSolver::GetStats() const
+{
+	return mStats;
+}
+
 void cIKSolver::Solve(const tProblem& prob, tSolution& out_soln)
 {
-	Eigen::MatrixXd joint_desc = prob.mJointDesc;
-	const Eigen::MatrixXd& cons_desc = prob.mConsDesc;
+	std::clock_t time_beg = std::clock();
+	mStats.Clear();
 
-	assert(joint_desc.cols() == cKinTree::eJointDescMax);
+	const Eigen::MatrixXd& cons_desc = prob.mConsDesc;
+	assert(prob.mJointDesc.cols() == cKinTree::eJointDescMax);
 	assert(cons_desc.cols() == eConsDescMax);
 
-	int root_id = cKinTree::GetRoot(joint_desc);
+	int root_id = cKinTree::GetRoot(prob.mJointDesc);
 	if (root_id == cKinTree::gInvalidJointID)
 	{
 		printf("Failed to find root in joint tree description.\n");
 		return;
 	}
 
-	Eigen::VectorXd curr_pose = prob.mPose;
-	double prev_obj = 0;
+	bool warm_start = CanWarmStart(prob);
+	InitWorkspace(prob);
+	mPose = (warm_start) ? mPrevSoln : prob.mPose;
+	mStats.mWarmStarted = warm_start;
+
+	double tol = std::abs(prob.mTol);
+	double prev_obj = CalcObjVal(cons_desc);
+	bool converged = prev_obj < tol;
 
 	int i = 0;
 	const double discount = 0.5;
 	double delta_obj_acc = 0;
-	for (i = 0; i < prob.mMaxIter; ++i)
+	for (i = 0; i < prob.mMaxIter && !converged; ++i)
 	{
-		//StepWeighted(cons_desc, prob, joint_desc, curr_pose, curr_pose);
-		StepHybrid(cons_desc, prob, joint_desc, curr_pose);
+		//StepWeighted(cons_desc, prob);
+		StepHybrid(cons_desc, prob);
 
 		// measure change in objective function using the cumulative discounted change
-		double curr_obj = CalcObjVal(joint_desc, curr_pose, cons_desc);
+		double curr_obj = CalcObjVal(cons_desc);
 		double delta_obj = curr_obj - prev_obj;
 		delta_obj = std::abs(delta_obj);
 		if (i == 0)
 		{
 			delta_obj_acc = delta_obj;
 		}
-		else 
+		else
 		{
 			delta_obj_acc = delta_obj + discount * delta_obj_acc;
-
-			if (delta_obj_acc < std::abs(prob.mTol))
-			{
-				break;
-			}
+			converged = delta_obj_acc < tol;
 		}
 
+		// constraints already satisfied, no point in iterating further
+		converged |= curr_obj < tol;
 		prev_obj = curr_obj;
 	}
 
-	//printf("Iter: %i\n", i);
-	out_soln.mState = curr_pose;
+	out_soln.mState = mPose;
+	mPrevSoln = mPose;
+	mHasPrevSoln = true;
+
+	mStats.mIters = i;
+	mStats.mObjVal = prev_obj;
+	mStats.mConverged = converged;
+	mStats.mTime = static_cast<double>(std::clock() - time_beg) / CLOCKS_PER_SEC;
 }
 
-double cIKSolver::CalcObjVal(const Eigen::MatrixXd &joint_desc, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_desc)
+void cIKSolver::InitWorkspace(const tProblem& prob)
+{
+	// assignments and resizes are no-ops when the dimensions match the previous solve
+	mJointDesc = prob.mJointDesc;
+
+	int num_dof = cKinTree::GetNumDof(mJointDesc);
+	int num_joints = static_cast<int>(mJointDesc.rows());
+	int cons_dim = CountConsDim(prob.mConsDesc);
+
+	mErr.resize(cons_dim);
+	mJ.resize(cons_dim, num_dof);
+	mJN.resize(cons_dim, num_dof);
+	mJtJ.resize(num_dof, num_dof);
+	mJtErr.resize(num_dof);
+	mN.resize(num_dof, num_dof);
+	mNTemp.resize(num_dof, num_dof);
+	mY.resize(num_dof);
+	mX.resize(num_dof);
+	mChainJoints.resize(num_joints);
+}
+
+bool cIKSolver::CanWarmStart(const tProblem& prob) const
+{
+	return mEnableWarmStart && mHasPrevSoln
+		&& mPrevSoln.size() == prob.mPose.size()
+		&& mJointDesc.rows() == prob.mJointDesc.rows();
+}
+
+double cIKSolver::CalcObjVal(const Eigen::MatrixXd& cons_desc)
 {
 	// objective function is the 2-norm of the constraint violations
+	const double clamp_dist = std::numeric_limits<double>::infinity();
+	cKinTree::UpdateFKCache(mJointDesc, mPose, mFKCache);
+
 	double obj_val = 0;
-	Eigen::VectorXd err;
 	for (int c = 0; c < cons_desc.rows(); ++c)
 	{
 		const tConsDesc& curr_cons = cons_desc.row(c);
-		double weight = curr_cons(eConsDesc::eConsDescWeight);
-		err = BuildErr(joint_desc, pose, curr_cons);
-		obj_val += weight * err.squaredNorm();
+		double weight = curr_cons(eConsDescWeight);
+		int curr_dim = GetConsDim(curr_cons);
+		BuildErr(mJointDesc, mPose, mFKCache, curr_cons, clamp_dist, 0, mErr);
+		obj_val += weight * mErr.head(curr_dim).squaredNorm();
 	}
 	return obj_val;
 }
 
-void cIKSolver::StepWeighted(const Eigen::MatrixXd& cons_desc, const tProblem& prob, Eigen::MatrixXd& joint_desc,
-							Eigen::VectorXd& out_pose)
+double cIKSolver::CalcObjVal(const Eigen::MatrixXd &joint_desc, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_desc)
 {
-	const double priority_decay = 0.5f;
-	int num_dof = cKinTree::GetNumDof(joint_desc);
-	Eigen::VectorXd err;
-	Eigen::MatrixXd J;
-	Eigen::MatrixXd J_weighted = Eigen::MatrixXd::Zero(num_dof, num_dof);
-	Eigen::VectorXd Jt_err_weighted = Eigen::VectorXd::Zero(num_dof);
+	const double clamp_dist = std::numeric_limits<double>::infinity();
+	cKinTree::tFKCache fk_cache;
+	cKinTree::BuildFKCache(joint_desc, pose, fk_cache);
+
+	double obj_val = 0;
+	Eigen::VectorXd err(gPosDims);
+	for (int c = 0; c < cons_desc.rows(); ++c)
+	{
+		const tConsDesc& curr_cons = cons_desc.row(c);
+		double weight = curr_cons(eConsDescWeight);
+		int curr_dim = GetConsDim(curr_cons);
+		BuildErr(joint_desc, pose, fk_cache, curr_cons, clamp_dist, 0, err);
+		obj_val += weight * err.head(curr_dim).squaredNorm();
+	}
+	return obj_val;
+}
 
-	int num_joints = static_cast<int>(joint_desc.rows());
+void cIKSolver::StepWeighted(const Eigen::MatrixXd& cons_desc, const tProblem& prob)
+{
+	const double priority_decay = 0.5f;
+	int num_dof = cKinTree::GetNumDof(mJointDesc);
+	int num_joints = static_cast<int>(mJointDesc.rows());
 	int num_cons = static_cast<int>(cons_desc.rows());
 
 	double clamp_dist = prob.mClampDist;
 	double damp = prob.mDamp;
 
+	mJtJ.setZero();
+	mJtErr.setZero();
+	cKinTree::UpdateFKCache(mJointDesc, mPose, mFKCache);
+
 	for (int c = 0; c < num_cons; ++c)
 	{
 		const tConsDesc& curr_cons = cons_desc.row(c);
-		err = BuildErr(joint_desc, out_pose, curr_cons, clamp_dist);
-		J = BuildJacob(joint_desc, out_pose, curr_cons);
+		int curr_dim = GetConsDim(curr_cons);
+		BuildErr(mJointDesc, mPose, mFKCache, curr_cons, clamp_dist, 0, mErr);
+		BuildJacob(mJointDesc, mFKCache, curr_cons, 0, mJ);
 
 		double curr_priority = cons_desc(c, eConsDescPriority);
 		double weight = curr_cons(eConsDescWeight);
 		weight *= std::pow(priority_decay, curr_priority);
 
-		J_weighted += weight * J.transpose() * J;
-		Jt_err_weighted += weight * J.transpose() * err;
+		auto J = mJ.topRows(curr_dim);
+		mJtJ.noalias() += weight * J.transpose() * J;
+		mJtErr.noalias() += weight * J.transpose() * mErr.head(curr_dim);
 	}
-	
+
 	// link scaling is damped separately according to stiffness
 	for (int i = 0; i < gPosDims + num_joints; ++i)
 	{
-		J_weighted(i, i) += damp;
+		mJtJ(i, i) += damp;
 	}
 
 #if !defined(DISABLE_LINK_SCALE)
 	// damp link scaling according to stiffness
 	for (int i = 0; i < num_joints; ++i)
 	{
-		double d_scale = 1.f - joint_desc(i, cKinTree::eJointDescScale);
-		double link_stiffness = joint_desc(i, cKinTree::eJointDescLinkStiffness);
+		double d_scale = 1.f - mJointDesc(i, cKinTree::eJointDescScale);
+		double link_stiffness = mJointDesc(i, cKinTree::eJointDescLinkStiffness);
 
 		int idx = gPosDims + num_joints + i;
-		Jt_err_weighted(idx) += link_stiffness * d_scale;
-		J_weighted(idx, idx) += link_stiffness;
+		mJtErr(idx) += link_stiffness * d_scale;
+		mJtJ(idx, idx) += link_stiffness;
 	}
 #endif
-	
-	Eigen::VectorXd x = J_weighted.lu().solve(Jt_err_weighted);
-	cKinTree::ApplyStep(joint_desc, x, out_pose);
-}
 
+	SolveNormalEqn(num_dof);
+	mX = mY;
+	cKinTree::ApplyStep(mJointDesc, mX, mPose);
+}
 
-void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& prob, Eigen::MatrixXd& joint_desc,
-							Eigen::VectorXd& out_pose)
+void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& prob)
 {
-	const int num_dof = cKinTree::GetNumDof(joint_desc);
-	const int num_joints = static_cast<int>(joint_desc.rows());
+	const int num_dof = cKinTree::GetNumDof(mJointDesc);
+#if !defined(DISABLE_LINK_SCALE)
+	const int num_joints = static_cast<int>(mJointDesc.rows());
+#endif
 	const int num_cons = static_cast<int>(cons_desc.rows());
 
-	Eigen::VectorXd err;
-	Eigen::MatrixXd J;
-	Eigen::MatrixXd J_weighted_buff = Eigen::MatrixXd::Zero(num_dof, num_dof);
-	Eigen::VectorXd Jt_err_weighted_buff = Eigen::VectorXd::Zero(num_dof);
-	Eigen::MatrixXd N = Eigen::MatrixXd::Identity(num_dof, num_dof);
-	Eigen::VectorXi chain_joints(num_joints); // keeps track of joints in Ik chain
-
 	double clamp_dist = prob.mClampDist;
 	double damp = prob.mDamp;
 
+	// the null space basis is kept in the leading columns of mN
+	int null_dim = num_dof;
+	mN.setIdentity();
+
 	int min_priority = std::numeric_limits<int>::max();
 	int max_priority = std::numeric_limits<int>::min();
 
@@ -176,16 +281,17 @@ void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& pro
 
 	for (int p = min_priority; p <= max_priority; ++p)
 	{
-		int curr_num_dof = static_cast<int>(N.cols());
-		auto J_weighted = J_weighted_buff.block(0, 0, curr_num_dof, curr_num_dof);
-		auto Jt_err_weighted = Jt_err_weighted_buff.block(0, 0, curr_num_dof, 1);
+		auto N = mN.leftCols(null_dim);
+		auto J_weighted = mJtJ.topLeftCorner(null_dim, null_dim);
+		auto Jt_err_weighted = mJtErr.head(null_dim);
 
 		J_weighted.setZero();
 		Jt_err_weighted.setZero();
+		mChainJoints.setZero();
+		cKinTree::UpdateFKCache(mJointDesc, mPose, mFKCache);
 
-		chain_joints.setZero();
-		
 		int num_valid_cons = 0;
+		int r = 0;
 		for (int c = 0; c < num_cons; ++c)
 		{
 			const tConsDesc& curr_cons = cons_desc.row(c);
@@ -194,9 +300,11 @@ void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& pro
 			if (curr_priority == p)
 			{
 				++num_valid_cons;
-				err = BuildErr(joint_desc, out_pose, curr_cons, clamp_dist);
-				J = BuildJacob(joint_desc, out_pose, curr_cons);
+				int curr_dim = GetConsDim(curr_cons);
+				BuildErr(mJointDesc, mPose, mFKCache, curr_cons, clamp_dist, r, mErr);
+				BuildJacob(mJointDesc, mFKCache, curr_cons, r, mJ);
 
+				auto J = mJ.middleRows(r, curr_dim);
 #if !defined(DISABLE_LINK_SCALE)
 				for (int i = 0; i < num_joints; ++i)
 				{
@@ -204,19 +312,20 @@ void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& pro
 					// link chain from the root to the constrained end effectors
 					// this ignores the root which should not have any scaling
 					int scale_idx = gPosDims + num_joints + i;
-					int theta_idx = gPosDims + i;
 					double scaling = J.col(scale_idx).squaredNorm();
 					if (scaling > 0)
 					{
-						chain_joints(i) = 1;
+						mChainJoints(i) = 1;
 					}
 				}
 #endif
-				J = J * N;
+				auto JN = mJN.block(r, 0, curr_dim, null_dim);
+				JN.noalias() = J * N;
 
 				double weight = curr_cons(eConsDescWeight);
-				J_weighted += weight * J.transpose() * J;
-				Jt_err_weighted += weight * J.transpose() * err;
+				J_weighted.noalias() += weight * JN.transpose() * JN;
+				Jt_err_weighted.noalias() += weight * JN.transpose() * mErr.segment(r, curr_dim);
+				r += curr_dim;
 			}
 		}
 
@@ -224,188 +333,177 @@ void cIKSolver::StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& pro
 		{
 			// apply damping
 			// a little more tricky with the null space
-
-			auto N_block = N.block(0, 0, gPosDims + num_joints, N.cols());
-			J_weighted += damp * N.transpose() * N;
+			J_weighted.noalias() += damp * N.transpose() * N;
 
 #if !defined(DISABLE_LINK_SCALE)
 			// damp link scaling according to stiffness
 			for (int i = 0; i < num_joints; ++i)
 			{
 				// only scale links that are part of the IK chain
-				if (chain_joints(i) == 1)
+				if (mChainJoints(i) == 1)
 				{
 					int idx = gPosDims + num_joints + i;
-					const Eigen::VectorXd& N_row = N.row(idx);
+					auto N_row = N.row(idx);
 
-					double d_scale = 1.f - joint_desc(i, cKinTree::eJointDescScale);
-					double link_stiffness = joint_desc(i, cKinTree::eJointDescLinkStiffness);
-					J_weighted += link_stiffness * N_row * N_row.transpose();
-					Jt_err_weighted += link_stiffness * d_scale * N_row;
+					double d_scale = 1.f - mJointDesc(i, cKinTree::eJointDescScale);
+					double link_stiffness = mJointDesc(i, cKinTree::eJointDescLinkStiffness);
+					J_weighted.noalias() += link_stiffness * N_row.transpose() * N_row;
+					Jt_err_weighted += link_stiffness * d_scale * N_row.transpose();
 				}
 			}
 #endif
 
-			Eigen::VectorXd y = J_weighted.lu().solve(Jt_err_weighted);
-			Eigen::VectorXd x = N * y;
-			cKinTree::ApplyStep(joint_desc, x, out_pose);
-			
-			bool is_last = p == max_priority;
+			SolveNormalEqn(null_dim);
+			mX.noalias() = N * mY.head(null_dim);
+			cKinTree::ApplyStep(mJointDesc, mX, mPose);
 
+			bool is_last = p == max_priority;
 			if (!is_last)
 			{
-				Eigen::MatrixXd cons_mat = Eigen::MatrixXd(num_valid_cons, cons_desc.cols());
-				int r = 0;
+				// rebuild the jacobian of this priority level at the updated pose
+				// and restrict the remaining levels to its null space
+				cKinTree::UpdateFKCache(mJointDesc, mPose, mFKCache);
+				int level_dim = 0;
 				for (int c = 0; c < num_cons; ++c)
 				{
 					const tConsDesc& curr_cons = cons_desc.row(c);
 					int curr_priority = static_cast<int>(curr_cons(eConsDescPriority));
-
 					if (curr_priority == p)
 					{
-						cons_mat.row(r) = curr_cons;
-						++r;
+						BuildJacob(mJointDesc, mFKCache, curr_cons, level_dim, mJ);
+						level_dim += GetConsDim(curr_cons);
 					}
 				}
 
-				J = BuildJacob(joint_desc, out_pose, cons_mat);
-				J = J * N;
+				mJN.topLeftCorner(level_dim, null_dim).noalias() = mJ.topRows(level_dim) * N;
 
-				Eigen::MatrixXd curr_N = BuildKernel(J);
-				if (curr_N.cols() == 0)
+				int kernel_dim = BuildKernel(level_dim, null_dim);
+				if (kernel_dim == 0)
 				{
 					break;
 				}
 
-				N = N * curr_N;
+				const auto& V = mSVD.matrixV();
+				mNTemp.leftCols(kernel_dim).noalias() = N * V.rightCols(kernel_dim);
+				mN.swap(mNTemp);
+				null_dim = kernel_dim;
 			}
 		}
 	}
 }
 
+void cIKSolver::SolveNormalEqn(int num_dof)
+{
+	// solves the system stored in the leading block of mJtJ and mJtErr, result in mY
+	mLU.compute(mJtJ.topLeftCorner(num_dof, num_dof));
+	mY.head(num_dof).noalias() = mLU.solve(mJtErr.head(num_dof));
+}
+
+int cIKSolver::BuildKernel(int rows, int cols)
+{
+	// kernel of the leading block of mJN, the basis is the last columns of mSVD.matrixV()
+	const double threshold = 0.0001f;
+	mSVD.compute(mJN.topLeftCorner(rows, cols), Eigen::ComputeFullV);
+	const auto& s = mSVD.singularValues();
+
+	int start_null = 0;
+	for (int i = 0; i < s.size(); ++i)
+	{
+		double val = s(i);
+		if (std::abs(val) > threshold)
+		{
+			++start_null;
+		}
+	}
+	return cols - start_null;
+}
+
 Eigen::VectorXd cIKSolver::BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_mat)
 {
+	const double clamp_dist = std::numeric_limits<double>::infinity();
 	int cons_dim = CountConsDim(cons_mat);
 	int num_cons = static_cast<int>(cons_mat.rows());
 	Eigen::VectorXd err(cons_dim);
 
+	cKinTree::tFKCache fk_cache;
+	cKinTree::BuildFKCache(joint_mat, pose, fk_cache);
+
 	int r = 0;
 	for (int c = 0; c < num_cons; ++c)
 	{
 		const tConsDesc& cons_desc = cons_mat.row(c);
-
-		Eigen::VectorXd curr_err = BuildErr(joint_mat, pose, cons_desc);
-		int curr_dim = static_cast<int>(curr_err.rows());
-
-		err.block(r, 0, curr_dim, 1) = curr_err;
-		r += curr_dim;
+		BuildErr(joint_mat, pose, fk_cache, cons_desc, clamp_dist, r, err);
+		r += GetConsDim(cons_desc);
 	}
 
 	return err;
 }
 
-Eigen::VectorXd cIKSolver::BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
-{
-	const double clamp_dist = std::numeric_limits<double>::infinity();
-	return BuildErr(joint_mat, pose, cons_desc, clamp_dist);
-}
-
-Eigen::VectorXd cIKSolver::BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist)
+void cIKSolver::BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const cKinTree::tFKCache& fk_cache,
+						const tConsDesc& cons_desc, double clamp_dist, int row, Eigen::VectorXd& out_err)
 {
-	Eigen::VectorXd err;
 	int cons_type = static_cast<int>(cons_desc(eConsDescType));
 	switch (cons_type)
 	{
 		case eConsTypePos:
-			err = BuildConsPosErr(joint_mat, pose, cons_desc, clamp_dist);
-			break;
 		case eConsTypePosX:
-			err = BuildConsPosXErr(joint_mat, pose, cons_desc, clamp_dist);
-			break;
 		case eConsTypePosY:
-			err = BuildConsPosYErr(joint_mat, pose, cons_desc, clamp_dist);
+			BuildConsPosErr(fk_cache, cons_desc, clamp_dist, row, out_err);
 			break;
 		case eConsTypeTheta:
-			err = BuildConsThetaErr(joint_mat, pose, cons_desc);
+			BuildConsThetaErr(joint_mat, pose, cons_desc, row, out_err);
 			break;
 		case eConsTypeThetaWorld:
-			err = BuildConsThetaWorldErr(joint_mat, pose, cons_desc);
+			BuildConsThetaWorldErr(joint_mat, pose, cons_desc, row, out_err);
 			break;
 		default:
 			assert(false); // unsupported constraint
 			break;
 	}
-	return err;
 }
 
-Eigen::VectorXd cIKSolver::BuildConsPosErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist)
+void cIKSolver::BuildConsPosErr(const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc, double clamp_dist, int row, Eigen::VectorXd& out_err)
 {
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePos);
-
-	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
-	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
-	tVector target_pos = tVector(cons_desc(eConsDescParam3), cons_desc(eConsDescParam4), 0.f, 0.f);
-
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
-	tVector delta = target_pos - end_pos;
-
-	ClampMag(delta, clamp_dist);
-
-	Eigen::Vector2d err = Eigen::Vector2d(delta[0], delta[1]);
-	return err;
-}
-
-Eigen::VectorXd cIKSolver::BuildConsPosXErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist)
-{
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePosX);
-
-	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
-	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
-	tVector target_pos = tVector(cons_desc(eConsDescParam3), cons_desc(eConsDescParam4), 0.f, 0.f);
-
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
-	tVector delta = target_pos - end_pos;
-
-	ClampMag(delta, clamp_dist);
-
-	Eigen::VectorXd err = Eigen::VectorXd(1);
-	err(0) = delta[0];
-	return err;
-}
-
-Eigen::VectorXd cIKSolver::BuildConsPosYErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist)
-{
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePosY);
+	int cons_type = static_cast<int>(cons_desc(eConsDescType));
+	assert(cons_type == eConsTypePos || cons_type == eConsTypePosX || cons_type == eConsTypePosY);
 
 	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
 	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
 	tVector target_pos = tVector(cons_desc(eConsDescParam3), cons_desc(eConsDescParam4), 0.f, 0.f);
 
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
+	tVector end_pos = cKinTree::LocalToWorldPos(fk_cache, parent_id, attach_pt);
 	tVector delta = target_pos - end_pos;
 
 	ClampMag(delta, clamp_dist);
 
-	Eigen::VectorXd err = Eigen::VectorXd(1);
-	err(0) = delta[1];
-	return err;
+	switch (cons_type)
+	{
+		case eConsTypePos:
+			out_err(row) = delta[0];
+			out_err(row + 1) = delta[1];
+			break;
+		case eConsTypePosX:
+			out_err(row) = delta[0];
+			break;
+		case eConsTypePosY:
+			out_err(row) = delta[1];
+			break;
+		default:
+			break;
+	}
 }
 
-Eigen::VectorXd cIKSolver::BuildConsThetaErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
+void cIKSolver::BuildConsThetaErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, int row, Eigen::VectorXd& out_err)
 {
 	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypeTheta);
 
 	int joint_id = static_cast<int>(cons_desc(eConsDescParam0));
 	double tar_theta = cons_desc(eConsDescParam1);
 	double theta = cKinTree::GetJointTheta(joint_mat, pose, joint_id);
-	double delta = tar_theta - theta;
-
-	Eigen::VectorXd err = Eigen::VectorXd(1);
-	err(0) = delta;
-	return err;
+	out_err(row) = tar_theta - theta;
 }
 
-Eigen::VectorXd cIKSolver::BuildConsThetaWorldErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
+void cIKSolver::BuildConsThetaWorldErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, int row, Eigen::VectorXd& out_err)
 {
 	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypeThetaWorld);
 
@@ -415,34 +513,7 @@ Eigen::VectorXd cIKSolver::BuildConsThetaWorldErr(const Eigen::MatrixXd& joint_m
 	double theta;
 	tVector axis;
 	cKinTree::CalcJointWorldTheta(joint_mat, pose, joint_id, axis, theta);
-
-	double delta = tar_theta - theta;
-
-	Eigen::VectorXd err = Eigen::VectorXd(1);
-	err(0) = delta;
-	return err;
-}
-
-
-Eigen::MatrixXd cIKSolver::BuildKernel(const Eigen::MatrixXd& mat)
-{
-	const double threshold = 0.0001f;
-	Eigen::JacobiSVD<Eigen::MatrixXd> svd_new(mat, Eigen::ComputeFullV | Eigen::ComputeFullU);
-	const auto& V_new = svd_new.matrixV();
-	const auto& s_new = svd_new.singularValues();
-
-	int start_null = 0;
-	for (int i = 0; i < s_new.size(); ++i)
-	{
-		double val = s_new(i);
-		if (std::abs(val) > threshold)
-		{
-			++start_null;
-		}
-	}
-	Eigen::MatrixXd N = V_new.block(0, start_null, V_new.rows(), V_new.cols() - start_null);
-	//Eigen::MatrixXd N = mat.fullPivLu().kernel();
-	return N;
+	out_err(row) = tar_theta - theta;
 }
 
 Eigen::MatrixXd cIKSolver::BuildJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_mat)
@@ -451,246 +522,119 @@ Eigen::MatrixXd cIKSolver::BuildJacob(const Eigen::MatrixXd& joint_mat, const Ei
 	int cons_dim = CountConsDim(cons_mat);
 	int num_cons = static_cast<int>(cons_mat.rows());
 
+	cKinTree::tFKCache fk_cache;
+	cKinTree::BuildFKCache(joint_mat, pose, fk_cache);
+
 	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
 	int r = 0;
 	for (int c = 0; c < num_cons; ++c)
 	{
 		const tConsDesc& curr_cons = cons_mat.row(c);
-		Eigen::MatrixXd curr_J = BuildJacob(joint_mat, pose, curr_cons);
-		int curr_dim = static_cast<int>(curr_J.rows());
-		J.block(r, 0, curr_dim, num_dof) = curr_J;
-		r += curr_dim;
+		BuildJacob(joint_mat, fk_cache, curr_cons, r, J);
+		r += GetConsDim(curr_cons);
 	}
 	return J;
 }
 
 Eigen::MatrixXd cIKSolver::BuildJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
 {
-	Eigen::MatrixXd J;
-	eConsDesc cons_type = static_cast<eConsDesc>(static_cast<int>(cons_desc(eConsDescType)));
+	int num_dof = cKinTree::GetNumDof(joint_mat);
+	int cons_dim = GetConsDim(cons_desc);
+
+	cKinTree::tFKCache fk_cache;
+	cKinTree::BuildFKCache(joint_mat, pose, fk_cache);
+
+	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
+	BuildJacob(joint_mat, fk_cache, cons_desc, 0, J);
+	return J;
+}
+
+void cIKSolver::BuildJacob(const Eigen::MatrixXd& joint_mat, const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc,
+							int row, Eigen::MatrixXd& out_J)
+{
+	int cons_dim = GetConsDim(cons_desc);
+	out_J.middleRows(row, cons_dim).setZero();
+
+	int cons_type = static_cast<int>(cons_desc(eConsDescType));
 	switch (cons_type)
 	{
 		case eConsTypePos:
-			J = BuildConsPosJacob(joint_mat, pose, cons_desc);
-			break;
 		case eConsTypePosX:
-			J = BuildConsPosXJacob(joint_mat, pose, cons_desc);
-			break;
 		case eConsTypePosY:
-			J = BuildConsPosYJacob(joint_mat, pose, cons_desc);
+			BuildConsPosJacob(joint_mat, fk_cache, cons_desc, row, out_J);
 			break;
 		case eConsTypeTheta:
-			J = BuildConsThetaJacob(joint_mat, pose, cons_desc);
+			BuildConsThetaJacob(cons_desc, row, out_J);
 			break;
 		case eConsTypeThetaWorld:
-			J = BuildConsThetaWorldJacob(joint_mat, pose, cons_desc);
+			BuildConsThetaWorldJacob(joint_mat, cons_desc, row, out_J);
 			break;
 		default:
 			assert(false); // unsupported constraint
 			break;
 	}
-	return J;
 }
 
-Eigen::MatrixXd cIKSolver::BuildConsPosJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
+void cIKSolver::BuildConsPosJacob(const Eigen::MatrixXd& joint_mat, const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc,
+								int row, Eigen::MatrixXd& out_J)
 {
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePos);
+	int cons_type = static_cast<int>(cons_desc(eConsDescType));
+	assert(cons_type == eConsTypePos || cons_type == eConsTypePosX || cons_type == eConsTypePosY);
+
+	// position dimensions covered by the constraint
+	int dim_beg = (cons_type == eConsTypePosY) ? 1 : 0;
+	int dim_end = (cons_type == eConsTypePosX) ? 1 : gPosDims;
 
-	int num_joints = static_cast<int>(joint_mat.rows());
 	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
 	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
+	tVector end_pos = cKinTree::LocalToWorldPos(fk_cache, parent_id, attach_pt);
 
 	const Eigen::Vector3d rot_axis = Eigen::Vector3d(0, 0, 1);
 
-	int num_dof = cKinTree::GetNumDof(joint_mat);
-	Eigen::MatrixXd J = Eigen::MatrixXd(gPosDims, num_dof);
-	J.setZero();
-
-	for (int i = 0; i < gPosDims; ++i)
+	for (int i = dim_beg; i < dim_end; ++i)
 	{
-		J(i, i) = 1;
+		out_J(row + i - dim_beg, i) = 1;
 	}
-	 
-	int curr_id = parent_id;
-	while (true)
-	{
-		tVector joint_pos = cKinTree::CalcJointWorldPos(joint_mat, pose, curr_id);
-		tVector delta = end_pos - joint_pos;
-
-		Eigen::Vector3d tangent = rot_axis.cross(Eigen::Vector3d(delta(0), delta(1), delta(2)));
-		int curr_parent_id = cKinTree::GetParent(joint_mat, curr_id);
-
-		for (int i = 0; i < gPosDims; ++i)
-		{
-			J(i, gPosDims + curr_id) = tangent(i);
-		}
-		if (curr_parent_id == cKinTree::gInvalidJointID)
-		{
-			// no scaling for root
-			break;
-		}
-		else
-		{
-#if !defined(DISABLE_LINK_SCALE)
-			double attach_x = joint_desc(curr_id, cKinTree::eJointDescAttachX);
-			double attach_y = joint_desc(curr_id, cKinTree::eJointDescAttachY);
-			double attach_z = joint_desc(curr_id, cKinTree::eJointDescAttachZ);
-
-			double parent_world_theta = cKinTree::CalcJointWorldTheta(joint_desc, curr_parent_id);
-			double world_attach_x = std::cos(parent_world_theta) * attach_x - std::sin(parent_world_theta) * attach_y;
-			double world_attach_y = std::sin(parent_world_theta) * attach_x + std::cos(parent_world_theta) * attach_y;
-			double world_attach_z = attach_z; // hack ignoring z, do this properly
-
-			J(0, gPosDims + num_joints + curr_id) = world_attach_x;
-			J(1, gPosDims + num_joints + curr_id) = world_attach_y;
-#endif
-			curr_id = curr_parent_id;
-		}
-	}
-
-	return J;
-}
-
-Eigen::MatrixXd cIKSolver::BuildConsPosXJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
-{
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePosX);
-
-	int num_joints = static_cast<int>(joint_mat.rows());
-	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
-	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
-
-	const Eigen::Vector3d rot_axis = Eigen::Vector3d(0, 0, 1);
-
-	int num_dof = cKinTree::GetNumDof(joint_mat);
-	int cons_dim = GetConsDim(cons_desc);
-	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
-	J.setZero();
-
-	J(0, 0) = 1;
 
 	int curr_id = parent_id;
 	while (true)
 	{
-		tVector joint_pos = cKinTree::CalcJointWorldPos(joint_mat, pose, curr_id);
+		tVector joint_pos = cKinTree::CalcJointWorldPos(fk_cache, curr_id);
 		tVector delta = end_pos - joint_pos;
 
 		Eigen::Vector3d tangent = rot_axis.cross(Eigen::Vector3d(delta(0), delta(1), delta(2)));
-		int curr_parent_id = cKinTree::GetParent(joint_mat, curr_id);
-
-		J(0, gPosDims + curr_id) = tangent(0);
-
-		if (curr_parent_id == cKinTree::gInvalidJointID)
-		{
-			// no scaling for root
-			break;
-		}
-		else
+		for (int i = dim_beg; i < dim_end; ++i)
 		{
-#if !defined(DISABLE_LINK_SCALE)
-			double attach_x = joint_desc(curr_id, cKinTree::eJointDescAttachX);
-			double attach_y = joint_desc(curr_id, cKinTree::eJointDescAttachY);
-			double attach_z = joint_desc(curr_id, cKinTree::eJointDescAttachZ);
-
-			double parent_world_theta = cKinTree::CalcJointWorldTheta(joint_desc, curr_parent_id);
-			double world_attach_x = std::cos(parent_world_theta) * attach_x - std::sin(parent_world_theta) * attach_y;
-			
-			J(0, gPosDims + num_joints + curr_id) = world_attach_x;
-#endif
-			curr_id = curr_parent_id;
+			out_J(row + i - dim_beg, gPosDims + curr_id) = tangent(i);
 		}
-	}
-
-	return J;
-}
-
-Eigen::MatrixXd cIKSolver::BuildConsPosYJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
-{
-	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypePosY);
-
-	int num_joints = static_cast<int>(joint_mat.rows());
-	int parent_id = static_cast<int>(cons_desc(eConsDescParam0));
-	tVector attach_pt = tVector(cons_desc(eConsDescParam1), cons_desc(eConsDescParam2), 0.f, 0.f);
-	tVector end_pos = cKinTree::LocalToWorldPos(joint_mat, pose, parent_id, attach_pt);
-
-	const Eigen::Vector3d rot_axis = Eigen::Vector3d(0, 0, 1);
-
-	int num_dof = cKinTree::GetNumDof(joint_mat);
-	int cons_dim = GetConsDim(cons_desc);
-	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
-	J.setZero();
 
-	J(0, 1) = 1;
-
-	int curr_id = parent_id;
-	while (true)
-	{
-		tVector joint_pos = cKinTree::CalcJointWorldPos(joint_mat, pose, curr_id);
-		tVector delta = end_pos - joint_pos;
-
-		Eigen::Vector3d tangent = rot_axis.cross(Eigen::Vector3d(delta(0), delta(1), delta(2)));
+		// no scaling for root, link scaling is disabled in cKinTree
 		int curr_parent_id = cKinTree::GetParent(joint_mat, curr_id);
-
-		J(0, gPosDims + curr_id) = tangent(1);
-
 		if (curr_parent_id == cKinTree::gInvalidJointID)
 		{
-			// no scaling for root
 			break;
 		}
-		else
-		{
-#if !defined(DISABLE_LINK_SCALE)
-			double attach_x = joint_desc(curr_id, cKinTree::eJointDescAttachX);
-			double attach_y = joint_desc(curr_id, cKinTree::eJointDescAttachY);
-			double attach_z = joint_desc(curr_id, cKinTree::eJointDescAttachZ);
-
-			double parent_world_theta = cKinTree::CalcJointWorldTheta(joint_desc, curr_parent_id);
-			double world_attach_y = std::sin(parent_world_theta) * attach_x + std::cos(parent_world_theta) * attach_y;
-
-			J(0, gPosDims + num_joints + curr_id) = world_attach_y;
-#endif
-			curr_id = curr_parent_id;
-		}
+		curr_id = curr_parent_id;
 	}
-
-	return J;
 }
 
-Eigen::MatrixXd cIKSolver::BuildConsThetaJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
+void cIKSolver::BuildConsThetaJacob(const tConsDesc& cons_desc, int row, Eigen::MatrixXd& out_J)
 {
 	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypeTheta);
 
-	int num_joints = static_cast<int>(joint_mat.rows());
 	int joint_id = static_cast<int>(cons_desc(eConsDescParam0));
-
-	int num_dof = cKinTree::GetNumDof(joint_mat);
-	int cons_dim = GetConsDim(cons_desc);
-	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
-	J.setZero();
-
-	J(0, gPosDims + joint_id) = 1;
-
-	return J;
+	out_J(row, gPosDims + joint_id) = 1;
 }
 
-Eigen::MatrixXd cIKSolver::BuildConsThetaWorldJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc)
+void cIKSolver::BuildConsThetaWorldJacob(const Eigen::MatrixXd& joint_mat, const tConsDesc& cons_desc, int row, Eigen::MatrixXd& out_J)
 {
 	assert(static_cast<int>(cons_desc(eConsDescType)) == eConsTypeThetaWorld);
 
-	int num_joints = static_cast<int>(joint_mat.rows());
 	int joint_id = static_cast<int>(cons_desc(eConsDescParam0));
-
-	int num_dof = cKinTree::GetNumDof(joint_mat);
-	int cons_dim = GetConsDim(cons_desc);
-	Eigen::MatrixXd J = Eigen::MatrixXd(cons_dim, num_dof);
-	J.setZero();
-
 	int curr_id = joint_id;
 	while (true)
 	{
-		J(0, gPosDims + curr_id) = 1;
+		out_J(row, gPosDims + curr_id) = 1;
 
 		int curr_parent_id = cKinTree::GetParent(joint_mat, curr_id);
 		if (curr_parent_id == cKinTree::gInvalidJointID)
@@ -699,8 +643,6 @@ Eigen::MatrixXd cIKSolver::BuildConsThetaWorldJacob(const Eigen::MatrixXd& joint
 		}
 		curr_id = curr_parent_id;
 	}
-
-	return J;
 }
 
 int cIKSolver::CountConsDim(const Eigen::MatrixXd& cons_mat)
@@ -4,10 +4,13 @@
 #include <random>
 #include <time.h>
 #include "util/MathUtil.h"
+#include "anim/KinTree.h"
 
 class cIKSolver
 {
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
 	struct tProblem
 	{
 	public:
@@ -33,6 +36,18 @@ public:
 			Eigen::VectorXd mState;
 	};
 
+	struct tSolveStats
+	{
+		tSolveStats();
+		void Clear();
+
+		int mIters;
+		double mTime; // seconds
+		double mObjVal;
+		bool mConverged;
+		bool mWarmStarted;
+	};
+
 	// constraint types
 	enum eConsType
 	{
@@ -61,7 +76,18 @@ public:
 
 	static void PrintMatrix(const Eigen::MatrixXd& mat);
 	static const int gInvalidJointID;
-	static void Solve(const tProblem& prob, tSolution& out_soln);
+
+	cIKSolver();
+	virtual ~cIKSolver();
+
+	// solves starting from the previous solution when warm start is enabled and
+	// the problem has the same dimensions, otherwise from prob.mPose
+	virtual void Solve(const tProblem& prob, tSolution& out_soln);
+	virtual void Reset();
+
+	virtual void EnableWarmStart(bool enable);
+	virtual bool EnabledWarmStart() const;
+	virtual const tSolveStats& GetStats() const;
 
 	static Eigen::MatrixXd BuildJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_mat);
 	static Eigen::MatrixXd BuildJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
@@ -69,35 +95,57 @@ public:
 
 	static double CalcObjVal(const Eigen::MatrixXd &joint_desc, const Eigen::VectorXd& pose, const Eigen::MatrixXd& cons_desc);
 
-private:
+protected:
 	static std::default_random_engine gRandGen;
 	static std::uniform_real_distribution<double> gRandDoubleDist;
 
-
-	static void StepWeighted(const Eigen::MatrixXd& cons_desc, const tProblem& prob, Eigen::MatrixXd& joint_desc,
-		Eigen::VectorXd& out_pose);
-	static void StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& prob, Eigen::MatrixXd& joint_desc,
-		Eigen::VectorXd& out_pose);
-
-	static Eigen::VectorXd BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::VectorXd BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist);
-	static Eigen::VectorXd BuildConsPosErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist);
-	static Eigen::VectorXd BuildConsPosXErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist);
-	static Eigen::VectorXd BuildConsPosYErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, double clamp_dist);
-	static Eigen::VectorXd BuildConsThetaErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::VectorXd BuildConsThetaWorldErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-
-	static Eigen::MatrixXd BuildKernel(const Eigen::MatrixXd& mat);
-
-	static Eigen::MatrixXd BuildConsPosJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::MatrixXd BuildConsPosXJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::MatrixXd BuildConsPosYJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::MatrixXd BuildConsThetaJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
-	static Eigen::MatrixXd BuildConsThetaWorldJacob(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc);
+	bool mEnableWarmStart;
+	bool mHasPrevSoln;
+	Eigen::VectorXd mPrevSoln;
+	tSolveStats mStats;
+
+	// workspace, sized to the tree and constraint count and reused across solves
+	Eigen::MatrixXd mJointDesc;
+	Eigen::VectorXd mPose;
+	cKinTree::tFKCache mFKCache;
+	Eigen::VectorXd mErr;
+	Eigen::MatrixXd mJ;
+	Eigen::MatrixXd mJN;
+	Eigen::MatrixXd mJtJ;
+	Eigen::VectorXd mJtErr;
+	Eigen::MatrixXd mN;
+	Eigen::MatrixXd mNTemp;
+	Eigen::VectorXd mY;
+	Eigen::VectorXd mX;
+	Eigen::VectorXi mChainJoints;
+	Eigen::PartialPivLU<Eigen::MatrixXd> mLU;
+	Eigen::JacobiSVD<Eigen::MatrixXd> mSVD;
+
+	virtual void InitWorkspace(const tProblem& prob);
+	virtual bool CanWarmStart(const tProblem& prob) const;
+	virtual double CalcObjVal(const Eigen::MatrixXd& cons_desc);
+
+	virtual void StepWeighted(const Eigen::MatrixXd& cons_desc, const tProblem& prob);
+	virtual void StepHybrid(const Eigen::MatrixXd& cons_desc, const tProblem& prob);
+	virtual void SolveNormalEqn(int num_dof);
+	virtual int BuildKernel(int rows, int cols);
+
+	static void BuildErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const cKinTree::tFKCache& fk_cache,
+						const tConsDesc& cons_desc, double clamp_dist, int row, Eigen::VectorXd& out_err);
+	static void BuildConsPosErr(const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc, double clamp_dist, int row, Eigen::VectorXd& out_err);
+	static void BuildConsThetaErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, int row, Eigen::VectorXd& out_err);
+	static void BuildConsThetaWorldErr(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& pose, const tConsDesc& cons_desc, int row, Eigen::VectorXd& out_err);
+
+	// jacobian rows are written into out_J starting at row, only entries along the joint chain are touched
+	static void BuildJacob(const Eigen::MatrixXd& joint_mat, const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc,
+							int row, Eigen::MatrixXd& out_J);
+	static void BuildConsPosJacob(const Eigen::MatrixXd& joint_mat, const cKinTree::tFKCache& fk_cache, const tConsDesc& cons_desc,
+							int row, Eigen::MatrixXd& out_J);
+	static void BuildConsThetaJacob(const tConsDesc& cons_desc, int row, Eigen::MatrixXd& out_J);
+	static void BuildConsThetaWorldJacob(const Eigen::MatrixXd& joint_mat, const tConsDesc& cons_desc, int row, Eigen::MatrixXd& out_J);
 
 	static int CountConsDim(const Eigen::MatrixXd& cons_mat);
 	static int GetConsDim(const tConsDesc& cons_desc);
 
 	static void ClampMag(tVector& vec, double max_d);
-
-};
\ No newline at end of file
+};
@@ -40,6 +40,7 @@ void cKinCharacter::Clear()
 {
 	cCharacter::Clear();
 	mMotion.Clear();
+	mPoseBuffer.resize(0);
 }
 
 void cKinCharacter::Update(double time_step)
@@ -84,9 +85,16 @@ double cKinCharacter::GetTime() const
 
 void cKinCharacter::Pose(double time)
 {
-	Eigen::VectorXd pose;
-	CalcPose(time, pose);
-	SetPose(pose);
+	CalcPose(time, mPoseBuffer);
+	SetPose(mPoseBuffer);
+}
+
+void cKinCharacter::BuildMotionCache(double timestep)
+{
+	if (mMotion.IsValid())
+	{
+		mMotion.BuildSampleCache(timestep);
+	}
 }
 
 void cKinCharacter::BuildPose(Eigen::VectorXd& out_pose) const
@@ -130,12 +138,12 @@ void cKinCharacter::BuildAcc(Eigen::VectorXd& out_acc) const
 
 void cKinCharacter::SetPose(const Eigen::VectorXd& pose)
 {
-	Eigen::VectorXd offset_pose = pose;
+	// offset the root in place to avoid a temporary copy of the pose
+	cCharacter::SetPose(pose);
 	const Eigen::MatrixXd& joint_desc = GetJointMat();
-	tVector root_pos = cKinTree::GetRootPos(joint_desc, offset_pose);
+	tVector root_pos = cKinTree::GetRootPos(joint_desc, mPose);
 	root_pos -= GetOrigin();
-	cKinTree::SetRootPos(joint_desc, root_pos, offset_pose);
-	cCharacter::SetPose(offset_pose);
+	cKinTree::SetRootPos(joint_desc, root_pos, mPose);
 }
 
 void cKinCharacter::BuildPose0(Eigen::VectorXd& out_pose) const
@@ -231,7 +239,7 @@ tVector cKinCharacter::CalcCycleRootDelta() const
 
 void cKinCharacter::CalcPose(double time, Eigen::VectorXd& out_pose) const
 {
-	out_pose = mMotion.CalcFrame(time);
+	mMotion.CalcFrame(time, out_pose);
 	int cycle_count = mMotion.CalcCycleCount(time);
 	tVector root_delta = cycle_count * mCycleRootDelta;
 	root_delta += mOrigin;
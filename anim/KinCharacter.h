@@ -23,6 +23,7 @@ public:
 	virtual double GetTime() const;
 
 	virtual void Pose(double time);
+	virtual void BuildMotionCache(double timestep);
 	virtual void BuildPose(Eigen::VectorXd& out_pose) const;
 	virtual void BuildVel(Eigen::VectorXd& out_vel) const;
 	virtual void BuildAcc(Eigen::VectorXd& out_acc) const;
@@ -42,6 +43,7 @@ public:
 protected:
 	double mTime;
 	cMotion mMotion;
+	Eigen::VectorXd mPoseBuffer;
 
 	tVector mCycleRootDelta;
 	tVector mOrigin;
@@ -3,11 +3,27 @@
 #include <iostream>
 
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 #include "sim/RBDUtil.h"
 
 const int cKinTree::gPosDims = 2;
 const int cKinTree::gInvalidJointID = -1;
 
+cKinTree::tFKCache::tFKCache()
+{
+	Clear();
+}
+
+void cKinTree::tFKCache::Clear()
+{
+	mValid = false;
+}
+
+bool cKinTree::tFKCache::IsValid(const Eigen::VectorXd& state) const
+{
+	return mValid && mPose.size() == state.size() && mPose == state;
+}
+
 // Json keys
 const std::string gJointsKey = "Joints";
 const std::string gJointDescKeys[cKinTree::eJointDescMax] = 
@@ -114,11 +130,8 @@ bool cKinTree::LoadBodyDefs(const std::string& char_file, Eigen::MatrixXd& out_b
 	bool succ = true;
 	std::string str;
 	
-	std::ifstream f_stream(char_file.c_str());
 	Json::Value root;
-	Json::Reader reader;
-	succ = reader.parse(f_stream, root);
-	f_stream.close();
+	succ = cAssetCache::LoadJson(char_file, root);
 
 	if (succ)
 	{
@@ -213,11 +226,8 @@ bool cKinTree::LoadDrawShapeDefs(const std::string& char_file, Eigen::MatrixXd&
 	bool succ = true;
 	std::string str;
 
-	std::ifstream f_stream(char_file.c_str());
 	Json::Value root;
-	Json::Reader reader;
-	succ = reader.parse(f_stream, root);
-	f_stream.close();
+	succ = cAssetCache::LoadJson(char_file, root);
 
 	if (succ)
 	{
@@ -707,20 +717,9 @@ double cKinTree::CalcChainLength(const Eigen::MatrixXd& joint_mat, const Eigen::
 
 void cKinTree::CalcAABB(const Eigen::MatrixXd& joint_desc, const Eigen::VectorXd& state, tVector& out_min, tVector& out_max)
 {
-	out_min[0] = std::numeric_limits<double>::infinity();
-	out_min[1] = std::numeric_limits<double>::infinity();
-	out_min[2] = std::numeric_limits<double>::infinity();
-
-	out_max[0] = -std::numeric_limits<double>::infinity();
-	out_max[1] = -std::numeric_limits<double>::infinity();
-	out_max[2] = -std::numeric_limits<double>::infinity();
-
-	for (int i = 0; i < GetNumJoints(joint_desc); ++i)
-	{
-		tVector pos = CalcJointWorldPos(joint_desc, state, i);
-		out_min = out_min.cwiseMin(pos);
-		out_max = out_max.cwiseMax(pos);
-	}
+	tFKCache cache;
+	BuildFKCache(joint_desc, state, cache);
+	CalcAABB(cache, out_min, out_max);
 }
 
 int cKinTree::GetParamOffset(const Eigen::MatrixXd& joint_mat, int joint_id)
@@ -1075,6 +1074,101 @@ tMatrix cKinTree::WorldJointTrans(const Eigen::MatrixXd& joint_mat, const Eigen:
 	return m;
 }
 
+void cKinTree::BuildFKCache(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, tFKCache& out_cache)
+{
+	int num_joints = GetNumJoints(joint_mat);
+	out_cache.mJointWorldTrans.resize(num_joints);
+
+	for (int j = 0; j < num_joints; ++j)
+	{
+		int parent_id = GetParent(joint_mat, j);
+		tMatrix& world_trans = out_cache.mJointWorldTrans[j];
+		if (parent_id == gInvalidJointID)
+		{
+			world_trans = ChildParentTrans(joint_mat, state, j);
+		}
+		else if (parent_id < j)
+		{
+			world_trans = out_cache.mJointWorldTrans[parent_id] * ChildParentTrans(joint_mat, state, j);
+		}
+		else
+		{
+			// joints are normally listed after their parents, fall back to walking the chain if not
+			world_trans = JointWorldTrans(joint_mat, state, j);
+		}
+	}
+
+	out_cache.mPose = state;
+	out_cache.mValid = true;
+}
+
+void cKinTree::UpdateFKCache(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, tFKCache& out_cache)
+{
+	if (!out_cache.IsValid(state))
+	{
+		BuildFKCache(joint_mat, state, out_cache);
+	}
+}
+
+const tMatrix& cKinTree::JointWorldTrans(const tFKCache& cache, int joint_id)
+{
+	assert(cache.mValid);
+	return cache.mJointWorldTrans[joint_id];
+}
+
+tVector cKinTree::CalcJointWorldPos(const tFKCache& cache, int joint_id)
+{
+	return LocalToWorldPos(cache, joint_id, tVector::Zero());
+}
+
+tVector cKinTree::LocalToWorldPos(const tFKCache& cache, int parent_id, const tVector& attach_pt)
+{
+	const tMatrix& local_to_world_trans = JointWorldTrans(cache, parent_id);
+	tVector pos = attach_pt;
+	pos[3] = 1;
+	pos = local_to_world_trans * pos;
+	pos[3] = 0;
+
+	return pos;
+}
+
+tVector cKinTree::CalcBodyPartPos(const tFKCache& cache, const Eigen::MatrixXd& body_defs, int part_id)
+{
+	assert(IsValidBody(body_defs, part_id));
+	tMatrix body_joint_trans = BodyJointTrans(body_defs, part_id);
+	const tMatrix& joint_to_world_trans = JointWorldTrans(cache, part_id);
+
+	tVector attach_pt = tVector(0, 0, 0, 1);
+	attach_pt = joint_to_world_trans * (body_joint_trans * attach_pt);
+	return attach_pt;
+}
+
+tMatrix cKinTree::BodyWorldTrans(const tFKCache& cache, const Eigen::MatrixXd& body_defs, int part_id)
+{
+	tMatrix body_trans = BodyJointTrans(body_defs, part_id);
+	body_trans = JointWorldTrans(cache, part_id) * body_trans;
+	return body_trans;
+}
+
+void cKinTree::CalcAABB(const tFKCache& cache, tVector& out_min, tVector& out_max)
+{
+	out_min[0] = std::numeric_limits<double>::infinity();
+	out_min[1] = std::numeric_limits<double>::infinity();
+	out_min[2] = std::numeric_limits<double>::infinity();
+
+	out_max[0] = -std::numeric_limits<double>::infinity();
+	out_max[1] = -std::numeric_limits<double>::infinity();
+	out_max[2] = -std::numeric_limits<double>::infinity();
+
+	int num_joints = static_cast<int>(cache.mJointWorldTrans.size());
+	for (int i = 0; i < num_joints; ++i)
+	{
+		tVector pos = CalcJointWorldPos(cache, i);
+		out_min = out_min.cwiseMin(pos);
+		out_max = out_max.cwiseMax(pos);
+	}
+}
+
 tMatrix cKinTree::BodyWorldTrans(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, const Eigen::MatrixXd& body_defs, int part_id)
 {
 	tMatrix body_trans = BodyJointTrans(body_defs, part_id);
@@ -82,6 +82,21 @@ public:
 	};
 	typedef Eigen::Matrix<double, 1, eDrawShapeParamMax> tDrawShapeDef;
 
+	// world transforms of every joint for a particular pose, computed in a single pass
+	// from the root so that repeated queries on the same pose do not re-walk the tree
+	struct tFKCache
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		tFKCache();
+		void Clear();
+		bool IsValid(const Eigen::VectorXd& state) const;
+
+		bool mValid;
+		Eigen::VectorXd mPose;
+		std::vector<tMatrix, Eigen::aligned_allocator<tMatrix>> mJointWorldTrans;
+	};
+
 	static const int gInvalidJointID;
 	static const int gPosDims;
 
@@ -137,6 +152,16 @@ public:
 	static tMatrix ParentChildTrans(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, int joint_id);
 	static tMatrix JointWorldTrans(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, int joint_id);
 	static tMatrix WorldJointTrans(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, int joint_id);
+
+	// cached forward kinematics, UpdateFKCache only recomputes the transforms when the pose has changed
+	static void BuildFKCache(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, tFKCache& out_cache);
+	static void UpdateFKCache(const Eigen::MatrixXd& joint_mat, const Eigen::VectorXd& state, tFKCache& out_cache);
+	static const tMatrix& JointWorldTrans(const tFKCache& cache, int joint_id);
+	static tVector CalcJointWorldPos(const tFKCache& cache, int joint_id);
+	static tVector LocalToWorldPos(const tFKCache& cache, int parent_id, const tVector& attach_pt);
+	static tVector CalcBodyPartPos(const tFKCache& cache, const Eigen::MatrixXd& body_defs, int part_id);
+	static tMatrix BodyWorldTrans(const tFKCache& cache, const Eigen::MatrixXd& body_defs, int part_id);
+	static void CalcAABB(const tFKCache& cache, tVector& out_min, tVector& out_max);
 	
 	static bool Load(const Json::Value& root, Eigen::MatrixXd& out_joint_mat);
 	static int GetNumJoints(const Eigen::MatrixXd& joint_mat);
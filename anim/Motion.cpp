@@ -1,10 +1,14 @@
 #include "Motion.h"
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
 
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 
 const double gMinTime = 0;
+// relative tolerance when deciding if frames are uniformly spaced
+const double gUniformFrameTol = 1e-6;
 
 // Json keys
 const std::string gMotionKey = "Motion";
@@ -25,17 +29,19 @@ cMotion::~cMotion()
 void cMotion::Clear()
 {
 	mFrames.resize(0, 0);
+	mFrameData.resize(0, 0);
+	mFrameTimes.resize(0);
+	mUniform = false;
+	mFrameDuration = 0;
+	ClearSampleCache();
 }
 
 bool cMotion::Load(const std::string& file)
 {
 	Clear();
 	
-	std::ifstream f_stream(file);
 	Json::Value root;
-	Json::Reader reader;
-	bool succ = reader.parse(f_stream, root);
-	f_stream.close();
+	bool succ = cAssetCache::LoadJson(file, root);
 
 	if (succ)
 	{
@@ -43,6 +49,7 @@ bool cMotion::Load(const std::string& file)
 		if (succ)
 		{
 			PostProcessFrames(mFrames);
+			BuildFrameTables();
 		}
 		else
 		{
@@ -80,32 +87,55 @@ int cMotion::GetFrameSize() const
 
 cMotion::tFrame cMotion::GetFrame(int i) const
 {
-	int frame_size = GetFrameSize();
-	return mFrames.row(i).segment(1, frame_size - 1);
+	tFrame frame;
+	GetFrame(i, frame);
+	return frame;
 }
 
-cMotion::tFrame cMotion::BlendFrames(int a, int b, double lerp) const
+void cMotion::GetFrame(int i, tFrame& out_frame) const
 {
-	lerp = cMathUtil::Saturate(lerp);
-
-	// remove time params
-	tFrame frame0 = GetFrame(a); 
-	tFrame frame1 = GetFrame(b);
+	out_frame = mFrameData.col(i);
+}
 
-	tFrame frame = (1 - lerp) * frame0 + lerp * frame1;
+cMotion::tFrame cMotion::BlendFrames(int a, int b, double lerp) const
+{
+	tFrame frame;
+	BlendFrames(a, b, lerp, frame);
 	return frame;
 }
 
-cMotion::tFrame cMotion::CalcFrame(double time) const
+void cMotion::BlendFrames(int a, int b, double lerp, tFrame& out_frame) const
 {
-	int idx;
-	double phase;
-	CalcIndexPhase(time, idx, phase);
+	lerp = cMathUtil::Saturate(lerp);
+	out_frame = (1 - lerp) * mFrameData.col(a) + lerp * mFrameData.col(b);
+}
 
-	tFrame frame = BlendFrames(idx, idx + 1, phase);
+cMotion::tFrame cMotion::CalcFrame(double time) const
+{
+	tFrame frame;
+	CalcFrame(time, frame);
 	return frame;
 }
 
+void cMotion::CalcFrame(double time, tFrame& out_frame) const
+{
+	if (HasSampleCache())
+	{
+		int num_samples = static_cast<int>(mSampleCache.cols());
+		int idx;
+		double phase;
+		CalcUniformIndexPhase(WrapTime(time), mSampleCacheTimestep, num_samples, idx, phase);
+		out_frame = (1 - phase) * mSampleCache.col(idx) + phase * mSampleCache.col(idx + 1);
+	}
+	else
+	{
+		int idx;
+		double phase;
+		CalcIndexPhase(time, idx, phase);
+		BlendFrames(idx, idx + 1, phase, out_frame);
+	}
+}
+
 bool cMotion::LoadJson(const Json::Value& root)
 {
 	bool succ = true;
@@ -207,35 +237,138 @@ int cMotion::CalcCycleCount(double time) const
 
 void cMotion::CalcIndexPhase(double time, int& out_idx, double& out_phase) const
 {
-	double max_time = GetDuration();
+	int num_frames = GetNumFrames();
+	time = WrapTime(time);
 
-	if (!mLoop)
+	if (mUniform)
 	{
-		if (time <= gMinTime)
+		// initial guess from the nominal frame duration, then correct against
+		// the actual frame times so results match the search exactly
+		CalcUniformIndexPhase(time, mFrameDuration, num_frames, out_idx, out_phase);
+		if (out_idx > 0 && time < mFrameTimes[out_idx])
 		{
-			out_idx = 0;
-			out_phase = 0;
-			return;
+			--out_idx;
 		}
-		else if (time >= max_time)
+		else if (out_idx < num_frames - 2 && time >= mFrameTimes[out_idx + 1])
+		{
+			++out_idx;
+		}
+	}
+	else
+	{
+		const double* times_beg = mFrameTimes.data();
+		const double* it = std::upper_bound(times_beg, times_beg + num_frames, time);
+		out_idx = static_cast<int>(it - times_beg - 1);
+		out_idx = cMathUtil::Clamp(out_idx, 0, num_frames - 2);
+	}
+
+	double time0 = mFrameTimes[out_idx];
+	double time1 = mFrameTimes[out_idx + 1];
+	double dur = time1 - time0;
+	out_phase = (dur > 0) ? ((time - time0) / dur) : 0;
+	out_phase = cMathUtil::Saturate(out_phase);
+}
+
+bool cMotion::IsUniform() const
+{
+	return mUniform;
+}
+
+void cMotion::BuildSampleCache(double timestep)
+{
+	ClearSampleCache();
+
+	double dur = GetDuration();
+	if (IsValid() && timestep > 0 && dur > 0)
+	{
+		// round the step so the samples land exactly on both ends of the clip
+		int num_intervals = static_cast<int>(std::ceil(dur / timestep - gUniformFrameTol));
+		num_intervals = std::max(1, num_intervals);
+		double sample_step = dur / num_intervals;
+
+		Eigen::MatrixXd cache(GetNumDof(), num_intervals + 1);
+		tFrame frame;
+		for (int i = 0; i < num_intervals; ++i)
 		{
-			out_idx = GetNumFrames() - 2;
-			out_phase = 1;
-			return;
+			CalcFrame(i * sample_step, frame);
+			cache.col(i) = frame;
 		}
+		// sample the end explicitly, looping clips would otherwise wrap back to the first frame
+		cache.col(num_intervals) = mFrameData.col(GetNumFrames() - 1);
+
+		mSampleCache = cache;
+		mSampleCacheTimestep = sample_step;
 	}
+}
+
+void cMotion::ClearSampleCache()
+{
+	mSampleCache.resize(0, 0);
+	mSampleCacheTimestep = 0;
+}
+
+bool cMotion::HasSampleCache() const
+{
+	return mSampleCache.cols() > 0;
+}
+
+double cMotion::GetSampleCacheTimestep() const
+{
+	return mSampleCacheTimestep;
+}
+
+void cMotion::BuildFrameTables()
+{
+	int num_frames = GetNumFrames();
+	int frame_size = GetFrameSize();
+
+	mFrameTimes = mFrames.col(eFrameTime);
+	mFrameData = mFrames.block(0, eFrameMax, num_frames, frame_size - eFrameMax).transpose();
 
-	time = std::fmod(time, max_time);
-	if (time < 0)
+	mUniform = false;
+	mFrameDuration = 0;
+	if (num_frames > 1)
 	{
-		time += max_time;
+		double dur = mFrameTimes[num_frames - 1] - mFrameTimes[0];
+		double avg_dur = dur / (num_frames - 1);
+		bool uniform = avg_dur > 0;
+		for (int f = 0; f < num_frames - 1 && uniform; ++f)
+		{
+			double curr_dur = mFrameTimes[f + 1] - mFrameTimes[f];
+			uniform = std::abs(curr_dur - avg_dur) <= gUniformFrameTol * avg_dur;
+		}
+
+		mUniform = uniform;
+		mFrameDuration = (uniform) ? avg_dur : 0;
 	}
+}
 
-	const Eigen::VectorXd& frame_times = mFrames.col(eFrameTime);
-	auto it = std::upper_bound(frame_times.data(), frame_times.data() + frame_times.size(), time);
-	out_idx = static_cast<int>(it - frame_times.data() - 1);
+double cMotion::WrapTime(double time) const
+{
+	double max_time = GetDuration();
+	if (!mLoop)
+	{
+		time = cMathUtil::Clamp(time, gMinTime, max_time);
+	}
+	else if (max_time > 0)
+	{
+		time = std::fmod(time, max_time);
+		if (time < 0)
+		{
+			time += max_time;
+		}
+	}
+	else
+	{
+		time = gMinTime;
+	}
+	return time;
+}
 
-	double time0 = frame_times(out_idx);
-	double time1 = frame_times(out_idx + 1);
-	out_phase = (time - time0) / (time1 - time0);
+void cMotion::CalcUniformIndexPhase(double time, double frame_dur, int num_frames, int& out_idx, double& out_phase) const
+{
+	double norm_time = (time - gMinTime) / frame_dur;
+	out_idx = static_cast<int>(norm_time);
+	out_idx = cMathUtil::Clamp(out_idx, 0, num_frames - 2);
+	out_phase = cMathUtil::Saturate(norm_time - out_idx);
 }
@@ -24,22 +24,46 @@ public:
 	virtual int GetNumFrames() const;
 	virtual int GetNumDof() const;
 	virtual tFrame GetFrame(int i) const;
+	virtual void GetFrame(int i, tFrame& out_frame) const;
 	virtual tFrame BlendFrames(int a, int b, double lerp) const;
+	virtual void BlendFrames(int a, int b, double lerp, tFrame& out_frame) const;
 
 	virtual tFrame CalcFrame(double time) const;
+	virtual void CalcFrame(double time, tFrame& out_frame) const;
 	virtual double GetDuration() const;
 
 	virtual int CalcCycleCount(double time) const;
 	virtual void CalcIndexPhase(double time, int& out_idx, double& out_phase) const;
+	virtual bool IsUniform() const;
+
+	// dense resampling of the clip, sampled at roughly the given timestep
+	virtual void BuildSampleCache(double timestep);
+	virtual void ClearSampleCache();
+	virtual bool HasSampleCache() const;
+	virtual double GetSampleCacheTimestep() const;
 
 protected:
 	bool mLoop;
 	Eigen::MatrixXd mFrames;
 
+	// one column per frame, time params stripped, so each frame is contiguous
+	Eigen::MatrixXd mFrameData;
+	// cumulative start time of each frame
+	Eigen::VectorXd mFrameTimes;
+	bool mUniform;
+	double mFrameDuration;
+
+	Eigen::MatrixXd mSampleCache;
+	double mSampleCacheTimestep;
+
 	virtual bool LoadJson(const Json::Value& root);
 	virtual bool ParseFrameJson(const Json::Value& root, Eigen::VectorXd& out_frame) const;
 
 	virtual double GetFrameTime(int i) const;
 	virtual void PostProcessFrames(Eigen::MatrixXd& frames) const;
 	virtual int GetFrameSize() const;
+
+	virtual void BuildFrameTables();
+	virtual double WrapTime(double time) const;
+	virtual void CalcUniformIndexPhase(double time, double frame_dur, int num_frames, int& out_idx, double& out_phase) const;
 };
@@ -5,6 +5,7 @@ from pathlib import Path
 import csv
 import json
 import re
+import struct
 from statistics import mean, pstdev
 from typing import Dict, Iterable, List
 
@@ -13,6 +14,14 @@ REWARD_RE = re.compile(r"^Avg\s+Tuple\s+Reward:\s+(?P<reward>-?\d+(?:\.\d+)?)")
 LOSS_RE = re.compile(r"loss[:=]\s*(?P<loss>-?\d+(?:\.\d+)?)", re.IGNORECASE)
 GRAD_RE = re.compile(r"grad(?:ient)?(?:_norm| norm)?[:=]\s*(?P<grad>-?\d+(?:\.\d+)?)", re.IGNORECASE)
 
+# binary metrics stream written by cMetrics (util/Metrics.cpp)
+METRICS_MAGIC = b"TRLMETR1"
+METRICS_TYPES = ("counter", "gauge", "hist")
+_METRICS_HEADER = struct.Struct("<8sid")
+_METRICS_DEF = struct.Struct("<BHiddi")
+_METRICS_VALUE = struct.Struct("<iqdd")
+_METRICS_HIST = struct.Struct("<iqdQdddi")
+
 
 @dataclass
 class TrainingPoint:
@@ -28,6 +37,102 @@ class EvalSummary:
     success_rate: float
 
 
+@dataclass
+class MetricRecord:
+    name: str
+    type: str
+    time: float
+    step: int
+    value: float
+    # histogram records only, value holds the mean
+    count: int = 0
+    min: float = 0.0
+    max: float = 0.0
+    bins: List[int] | None = None
+    bin_range: tuple[float, float] | None = None
+
+
+def read_metrics(path: str | Path) -> List[MetricRecord]:
+    """Reads a binary or ndjson metrics stream, counters hold running totals and times are seconds since start."""
+    data = Path(path).read_bytes()
+    if data.startswith(METRICS_MAGIC):
+        return _read_binary_metrics(data)
+    return _read_ndjson_metrics(data.decode("utf-8", errors="ignore"))
+
+
+def _read_binary_metrics(data: bytes) -> List[MetricRecord]:
+    records: List[MetricRecord] = []
+    defs: Dict[int, tuple[str, str, float, float]] = {}
+    offset = _METRICS_HEADER.size
+    # the stream is append-only, a partially flushed record at the end is ignored
+    while offset < len(data):
+        kind = data[offset]
+        offset += 1
+        try:
+            if kind == 0:
+                type_id, name_len, metric_id, min_val, max_val, _ = _METRICS_DEF.unpack_from(data, offset)
+                offset += _METRICS_DEF.size
+                name = data[offset:offset + name_len].decode("utf-8")
+                if len(name) != name_len:
+                    break
+                offset += name_len
+                defs[metric_id] = (name, METRICS_TYPES[type_id], min_val, max_val)
+            elif kind == 1:
+                metric_id, step, time, value = _METRICS_VALUE.unpack_from(data, offset)
+                offset += _METRICS_VALUE.size
+                name, type_name, _, _ = defs[metric_id]
+                records.append(MetricRecord(name=name, type=type_name, time=time, step=step, value=value))
+            elif kind == 2:
+                metric_id, step, time, count, total, min_val, max_val, num_bins = _METRICS_HIST.unpack_from(data, offset)
+                offset += _METRICS_HIST.size
+                bins = list(struct.unpack_from(f"<{num_bins}Q", data, offset))
+                offset += 8 * num_bins
+                name, type_name, bin_min, bin_max = defs[metric_id]
+                records.append(MetricRecord(name=name, type=type_name, time=time, step=step, value=total / max(count, 1),
+                                            count=count, min=min_val, max=max_val, bins=bins, bin_range=(bin_min, bin_max)))
+            else:
+                raise ValueError(f"unknown metrics record {kind} at byte {offset - 1}")
+        except struct.error:
+            break
+    return records
+
+
+def _read_ndjson_metrics(text: str) -> List[MetricRecord]:
+    records: List[MetricRecord] = []
+    defs: Dict[int, Dict] = {}
+    for line in text.splitlines():
+        try:
+            entry = json.loads(line)
+        except json.JSONDecodeError:
+            continue
+        if "def" in entry:
+            defs[entry["def"]] = entry
+        elif "id" in entry:
+            metric_def = defs[entry["id"]]
+            if metric_def["type"] == "hist":
+                count = entry["count"]
+                records.append(MetricRecord(name=entry["name"], type="hist", time=entry["t"], step=entry["step"],
+                                            value=entry["sum"] / max(count, 1), count=count, min=entry["min"],
+                                            max=entry["max"], bins=entry["bins"],
+                                            bin_range=(metric_def["min"], metric_def["max"])))
+            else:
+                records.append(MetricRecord(name=entry["name"], type=metric_def["type"], time=entry["t"],
+                                            step=entry["step"], value=entry["value"]))
+    return records
+
+
+def metric_series(records: Iterable[MetricRecord], name: str) -> List[MetricRecord]:
+    return [r for r in records if r.name == name]
+
+
+def training_points_from_metrics(records: Iterable[MetricRecord]) -> List[TrainingPoint]:
+    return [TrainingPoint(iteration=r.step, avg_tuple_reward=r.value) for r in metric_series(records, "avg_tuple_reward")]
+
+
+def loss_series_from_metrics(records: Iterable[MetricRecord]) -> List[float]:
+    return [r.value for r in records if r.name.endswith("_loss")]
+
+
 def parse_training_log(log_path: str | Path) -> List[TrainingPoint]:
     points: List[TrainingPoint] = []
     current_iter: int | None = None
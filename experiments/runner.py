@@ -12,10 +12,13 @@ from .architectures import ensure_templates_exist, resolve_architecture_template
 from .config import ExperimentConfig
 from .metrics import (
     build_comparison_report,
+    loss_series_from_metrics,
     parse_gradient_norm_series,
     parse_loss_series,
     parse_training_log,
     read_eval_summary,
+    read_metrics,
+    training_points_from_metrics,
     write_comparison_report,
     write_reward_curve,
 )
@@ -52,7 +55,7 @@ class ExperimentRunner:
         self._execute([self.config.binary_path, "-arg_file=", train_args_path.as_posix()], train_log)
         wall_clock_s = time.time() - start
 
-        points = parse_training_log(train_log)
+        points = self._load_training_points(train_log)
         reward_curve = run_dir / "reward_curve.csv"
         write_reward_curve(points, reward_curve)
 
@@ -102,10 +105,21 @@ class ExperimentRunner:
             "trainer_curriculum_iters": str(self.config.curriculum.total_iters),
             "trainer_curriculum_stage_iters": str(self.config.curriculum.stage_iters),
             "rand_seed": str(self.config.seed),
+            "metrics_file": self._metrics_path(run_dir).as_posix(),
         }
         self._write_args_file(args_path, args)
         return args_path, checkpoint_path
 
+    def _metrics_path(self, run_dir: Path) -> Path:
+        return run_dir / "train_metrics.bin"
+
+    def _load_training_points(self, train_log: Path):
+        # the metrics stream is exact, scraping stdout is only for binaries that predate it
+        metrics_path = self._metrics_path(train_log.parent)
+        if metrics_path.exists():
+            return training_points_from_metrics(read_metrics(metrics_path))
+        return parse_training_log(train_log) if train_log.exists() else []
+
     def _run_eval_sweep(self, run_dir: Path, checkpoint_path: Path, backend: str | None = None):
         summaries = []
         selected_backend = backend or self.config.policy_backend
@@ -200,7 +214,11 @@ class ExperimentRunner:
         }
 
     def _check_single_step_training(self, train_log: Path) -> Dict[str, Any]:
-        losses = parse_loss_series(train_log)
+        metrics_path = self._metrics_path(train_log.parent)
+        if metrics_path.exists():
+            losses = loss_series_from_metrics(read_metrics(metrics_path))
+        else:
+            losses = parse_loss_series(train_log)
         grads = parse_gradient_norm_series(train_log)
         has_loss_drop = len(losses) > 1 and losses[-1] < losses[0]
         nonzero_grad_count = sum(1 for g in grads if g != 0.0)
@@ -225,7 +243,7 @@ class ExperimentRunner:
         except subprocess.CalledProcessError:
             crashed = True
 
-        short_points = parse_training_log(short_log) if short_log.exists() else []
+        short_points = self._load_training_points(short_log)
         return {
             "passed": (not crashed) and len(short_points) > 0,
             "crashed": crashed,
@@ -113,13 +113,21 @@ void cACLearner::SyncNet()
 {
 	auto trainer = std::static_pointer_cast<cACTrainer>(mTrainer);
 
-	auto& actor_net = trainer->GetActor();
-	mNet->CopyModel(*actor_net);
+	auto actor_snapshot = trainer->PublishNet();
+	if (!mNet->ShareModel(actor_snapshot))
+	{
+		auto& actor_net = trainer->GetActor();
+		mNet->CopyModel(*actor_net);
+	}
 
 	if (HasCriticNet())
 	{
-		auto& critic_net = trainer->GetCritic();
-		mCriticNet->CopyModel(*critic_net);
+		auto critic_snapshot = trainer->PublishCritic();
+		if (!mCriticNet->ShareModel(critic_snapshot))
+		{
+			auto& critic_net = trainer->GetCritic();
+			mCriticNet->CopyModel(*critic_net);
+		}
 	}
 }
 
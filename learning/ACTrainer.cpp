@@ -1,6 +1,7 @@
 #include "ACTrainer.h"
 #include "util/FileUtil.h"
 #include "util/Util.h"
+#include "util/Metrics.h"
 #include "QNetTrainer.h"
 #include "ACLearner.h"
 
@@ -396,6 +397,18 @@ void cACTrainer::UpdateActorOffsetScale()
 
 bool cACTrainer::Step()
 {
+	if (EnableParallelUpdate())
+	{
+		// the actor trains on the batches selected at the end of the previous step
+		// while the critics update, the batches are then refilled from the new critics
+		StepPool(0, GetNetPoolSize());
+		if (mStage != eStageInit)
+		{
+			UpdateActorBatchBuffer();
+		}
+		return true;
+	}
+
 	for (int i = 0; i < GetNetPoolSize(); ++i)
 	{
 		printf("Update Net %i:\n", i);
@@ -411,24 +424,9 @@ bool cACTrainer::Step()
 	return true;
 }
 
-int cACTrainer::CalcBufferSize() const
-{
-	return 1 + GetStateSize() * 2 + GetActionSize();
-}
-
-int cACTrainer::GetRewardIdx() const
-{
-	return 0;
-}
-
-int cACTrainer::GetStateBegIdx() const
-{
-	return 1;
-}
-
-int cACTrainer::GetStateEndIdx() const
+bool cACTrainer::StoreTupleStateEnd() const
 {
-	return 1 + GetStateSize() + GetActionSize();
+	return true;
 }
 
 int cACTrainer::GetStateSize() const
@@ -442,11 +440,6 @@ int cACTrainer::GetStateSize() const
 	return size;
 }
 
-int cACTrainer::GetActionIdx() const
-{
-	return 1 + GetStateSize();
-}
-
 int cACTrainer::GetActionSize() const
 {
 	int size = 0;
@@ -458,65 +451,6 @@ int cACTrainer::GetActionSize() const
 	return size;
 }
 
-void cACTrainer::SetTuple(int t, const tExpTuple& tuple)
-{
-	auto curr_row = mPlaybackMem.row(t);
-
-	curr_row(GetRewardIdx()) = static_cast<float>(tuple.mReward);
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		curr_row(state_beg_idx + j) = static_cast<float>(tuple.mStateBeg(j));
-		curr_row(state_end_idx + j) = static_cast<float>(tuple.mStateEnd(j));
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		curr_row(action_idx + j) = static_cast<float>(tuple.mAction(j));
-	}
-
-	mFlagBuffer[t] = tuple.mFlags;
-}
-
-tExpTuple cACTrainer::GetTuple(int t) const
-{
-	tExpTuple tuple;
-	auto curr_row = mPlaybackMem.row(t);
-
-	tuple.mID = t;
-	tuple.mReward = curr_row[GetRewardIdx()];
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	tuple.mStateBeg.resize(state_size);
-	tuple.mStateEnd.resize(state_size);
-	tuple.mAction.resize(action_size);
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		tuple.mStateBeg(j) = curr_row(state_beg_idx + j);
-		tuple.mStateEnd(j) = curr_row(state_end_idx + j);
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		tuple.mAction(j) = curr_row(action_idx + j);
-	}
-
-	tuple.mFlags = mFlagBuffer[t];
-	return tuple;
-}
-
 int cACTrainer::GetActorBatchSize() const
 {
 	const std::unique_ptr<cNeuralNet>& net = GetActor();
@@ -533,6 +467,12 @@ const std::unique_ptr<cNeuralNet>& cACTrainer::GetActor() const
 	return mActorNet;
 }
 
+std::shared_ptr<const tParamSnapshot> cACTrainer::PublishCritic()
+{
+	const auto& critic = GetCritic();
+	return mCriticStore.Publish(*critic);
+}
+
 bool cACTrainer::HasInitModel() const
 {
 	return HasActorInitModel() && HasCriticInitModel();
@@ -614,7 +554,11 @@ void cACTrainer::UpdateActor()
 	{
 		UpdateActorBatchBuffer();
 	}
+	StepActorBatches();
+}
 
+void cACTrainer::StepActorBatches()
+{
 	int batch_size = GetActorBatchSize();
 	int buffer_size = static_cast<int>(mActorBatchBuffer.size());
 	int num_batches = buffer_size / batch_size;
@@ -626,6 +570,12 @@ void cACTrainer::UpdateActor()
 	}
 }
 
+void cACTrainer::BuildPoolJobs(int beg_id, int end_id, std::vector<cThreadPool::tJob>& out_jobs)
+{
+	cNeuralNetTrainer::BuildPoolJobs(beg_id, end_id, out_jobs);
+	out_jobs.push_back([this]() { StepActorBatches(); });
+}
+
 void cACTrainer::StepActor()
 {
 #if defined(OUTPUT_TRAINER_LOG)
@@ -665,6 +615,8 @@ void cACTrainer::UpdateActorNet(const cNeuralNet::tProblem& prob)
 
 		double loss = curr_net->ForwardBackward(prob);
 		printf("Actor Net Loss: %.8f\n", loss);
+		static const int loss_metric = cMetrics::RegisterGauge("actor_loss");
+		cMetrics::Set(loss_metric, loss, GetIter());
 		
 		cParamServer::tInputInfo server_input;
 		server_input.mID = net_id;
@@ -52,6 +52,7 @@ public:
 	virtual const std::unique_ptr<cNeuralNet>& GetNet() const;
 	virtual const std::unique_ptr<cNeuralNet>& GetCritic() const;
 	virtual const std::unique_ptr<cNeuralNet>& GetActor() const;
+	virtual std::shared_ptr<const tParamSnapshot> PublishCritic();
 
 	virtual bool HasInitModel() const;
 	virtual bool HasActorInitModel() const;
@@ -73,6 +74,7 @@ protected:
 	cNeuralNet::tProblem mActorProb;
 	std::unique_ptr<cNeuralNet> mActorNet;
 	std::vector<int> mActorBatchBuffer;
+	cParamStore mCriticStore;
 
 	cACTrainer();
 
@@ -91,6 +93,7 @@ protected:
 	virtual void FetchActorMinibatch(int batch_size, std::vector<int>& out_batch);
 
 	virtual bool Step();
+	virtual void BuildPoolJobs(int beg_id, int end_id, std::vector<cThreadPool::tJob>& out_jobs);
 	virtual void BuildTupleY(int net_id, const tExpTuple& tuple, Eigen::VectorXd& out_y) = 0;
 	virtual void BuildCriticXNext(const tExpTuple& tuple, Eigen::VectorXd& out_x);
 	virtual void ApplySteps(int num_steps);
@@ -106,20 +109,13 @@ protected:
 	virtual void UpdateCriticOffsetScale();
 	virtual void UpdateActorOffsetScale();
 
-	virtual int CalcBufferSize() const;
-
-	virtual int GetRewardIdx() const;
-	virtual int GetStateBegIdx() const;
-	virtual int GetStateEndIdx() const;
-	virtual int GetActionIdx() const;
-
-	virtual void SetTuple(int t, const tExpTuple& tuple);
-	virtual tExpTuple GetTuple(int t) const;
+	virtual bool StoreTupleStateEnd() const;
 
 	virtual int GetActorBatchSize() const;
 
 	virtual void UpdateActorBatchBuffer();
 	virtual void UpdateActor();
+	virtual void StepActorBatches();
 	virtual void StepActor();
 	virtual void BuildActorProblem(cNeuralNet::tProblem& out_prob);
 
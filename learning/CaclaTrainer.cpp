@@ -238,42 +238,39 @@ void cCaclaTrainer::CalcNewCumulativeRewardBatch(int net_id, const std::vector<i
 	assert(num_data <= GetBatchSize());
 	const auto& tar_net = GetTargetNet(net_id);
 
-	for (int i = 0; i < num_data; ++i)
+	mReturnEngine.BuildChains(mPlaybackMem, tuple_ids, eFlagFail);
+
+	// all states the returns bootstrap from are evaluated with a single batch
+	const std::vector<int>& boot_tuples = mReturnEngine.GetBootstrapTuples();
+	int num_boot = static_cast<int>(boot_tuples.size());
+	mReturnXBuffer.resize(num_boot, mBatchXBuffer.cols());
+	for (int i = 0; i < num_boot; ++i)
 	{
-		int t = tuple_ids[i];
-		tExpTuple tuple = GetTuple(t);
-		
+		tExpTuple tuple = GetTuple(boot_tuples[i]);
+
 		Eigen::VectorXd x_next;
 		BuildCriticXNext(tuple, x_next);
-		mBatchXBuffer.row(i) = x_next;
+		mReturnXBuffer.row(i) = x_next;
 	}
 
-	tar_net->EvalBatch(mBatchXBuffer, mBatchYBuffer);
-
-	double discount = GetDiscount();
-
-	for (int i = 0; i < num_data; ++i)
+	mReturnValBuffer.resize(num_boot);
+	if (num_boot > 0)
 	{
-		int t = tuple_ids[i];
-		tExpTuple tuple = GetTuple(t);
-
-		double val = 0;
-		double r = tuple.mReward;
-		double norm_r = NormalizeReward(r);
-
-		bool fail = tuple.GetFlag(eFlagFail);
-		if (fail)
-		{
-			val = norm_r;
-		}
-		else
-		{
-			double v_end = mBatchYBuffer(i, 0);
-			val = norm_r + discount * v_end;
-		}
+		tar_net->EvalBatch(mReturnXBuffer, mReturnYBuffer);
+		mReturnValBuffer = mReturnYBuffer.col(0);
+	}
 
-		out_vals(i) = val;
+	const std::vector<int>& step_tuples = mReturnEngine.GetStepTuples();
+	int num_steps = static_cast<int>(step_tuples.size());
+	mReturnRewardBuffer.resize(num_steps);
+	for (int i = 0; i < num_steps; ++i)
+	{
+		double r = mPlaybackMem.GetReward(step_tuples[i]);
+		mReturnRewardBuffer[i] = NormalizeReward(r);
 	}
+
+	double discount = GetDiscount();
+	mReturnEngine.CalcReturns(mReturnRewardBuffer, mReturnValBuffer, discount, out_vals);
 }
 
 void cCaclaTrainer::BuildActorProblemY(const std::vector<int>& tuple_ids, const Eigen::MatrixXd& X, cNeuralNet::tProblem& out_prob)
@@ -463,7 +460,7 @@ void cCaclaTrainer::UpdateBuffers(int t)
 
 bool cCaclaTrainer::IsOffPolicy(int t) const
 {
-	int flag = mFlagBuffer[t];
+	unsigned int flag = mPlaybackMem.GetFlags(t);
 	bool off_policy = tExpTuple::TestFlag(flag, eFlagOffPolicy);
 	return off_policy;
 }
@@ -0,0 +1,103 @@
+#include "MACEHead.h"
+#include <cassert>
+
+cMACEHead::tSample::tSample()
+{
+	mMaxIdx = gInvalidIdx;
+	mMaxVal = 0;
+	mIdx = gInvalidIdx;
+	mVal = 0;
+}
+
+void cMACEHead::Sample(const Eigen::VectorXd& params, int num_frags, double temp, double rand,
+						Eigen::VectorXd& out_probs, tSample& out_sample)
+{
+	assert(num_frags > 0);
+	assert(out_probs.size() >= num_frags);
+
+	auto vals = params.head(num_frags).array();
+	auto probs = out_probs.head(num_frags).array();
+
+	int max_idx = 0;
+	double max_val = vals.maxCoeff(&max_idx);
+	int idx = max_idx;
+
+	if (temp != 0)
+	{
+		// shifting by the max keeps the exponents <= 0, the unnormalized
+		// weights are sampled directly by scaling the uniform draw with their sum
+		probs = ((vals - max_val) * (1.0 / temp)).exp();
+		double sum = probs.sum();
+		idx = SampleCumulative(out_probs.data(), num_frags, rand * sum, max_idx);
+		probs *= 1.0 / sum;
+	}
+	else
+	{
+		probs.setZero();
+		probs[max_idx] = 1;
+	}
+
+	out_sample.mMaxIdx = max_idx;
+	out_sample.mMaxVal = max_val;
+	out_sample.mIdx = idx;
+	out_sample.mVal = params[idx];
+}
+
+void cMACEHead::EvalMax(const Eigen::VectorXd& params, int num_frags, tSample& out_sample)
+{
+	assert(num_frags > 0);
+	int max_idx = 0;
+	double max_val = params.head(num_frags).maxCoeff(&max_idx);
+
+	out_sample.mMaxIdx = max_idx;
+	out_sample.mMaxVal = max_val;
+	out_sample.mIdx = max_idx;
+	out_sample.mVal = max_val;
+}
+
+cMACEHead::tFragView cMACEHead::GetFragView(const Eigen::VectorXd& params, int num_frags, int frag_size, int a_idx)
+{
+	assert(a_idx >= 0 && a_idx < num_frags);
+	assert(params.size() >= num_frags + num_frags * frag_size);
+	return tFragView(params.data() + num_frags + a_idx * frag_size, frag_size);
+}
+
+void cMACEHead::EvalMaxBatch(const Eigen::MatrixXd& Y, int num_frags, Eigen::VectorXi& out_max_idx, Eigen::VectorXd& out_max_vals)
+{
+	assert(num_frags > 0);
+	assert(Y.cols() >= num_frags);
+	int num_rows = static_cast<int>(Y.rows());
+
+	// Y is column major, so the sweep runs down each value column
+	// and compares all rows against their running max at once
+	out_max_vals = Y.col(0);
+	out_max_idx = Eigen::VectorXi::Zero(num_rows);
+
+	for (int f = 1; f < num_frags; ++f)
+	{
+		const double* curr_col = Y.col(f).data();
+		for (int i = 0; i < num_rows; ++i)
+		{
+			double val = curr_col[i];
+			bool greater = val > out_max_vals[i];
+			out_max_vals[i] = (greater) ? val : out_max_vals[i];
+			out_max_idx[i] = (greater) ? f : out_max_idx[i];
+		}
+	}
+}
+
+int cMACEHead::SampleCumulative(const double* probs, int num_frags, double threshold, int default_idx)
+{
+	double cumulative = 0;
+	for (int f = 0; f < num_frags; ++f)
+	{
+		cumulative += probs[f];
+		if (threshold <= cumulative)
+		{
+			return f;
+		}
+	}
+
+	// only reached if rounding leaves the sum short of the threshold
+	return default_idx;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "util/MathUtil.h"
+
+// fused evaluation of the MACE output head, the net output is laid out as
+// [num_frags critic values, num_frags * frag_size actor fragments]
+// argmax, softmax and sampling over the critic values share a single sweep
+// and the chosen actor fragment is returned as a view into the output
+class cMACEHead
+{
+public:
+	typedef Eigen::Map<const Eigen::VectorXd> tFragView;
+
+	struct tSample
+	{
+		int mMaxIdx;
+		double mMaxVal;
+		int mIdx;
+		double mVal;
+
+		tSample();
+	};
+
+	// rand is a uniform sample in [0, 1), a temp of 0 always selects the max,
+	// out_probs must already hold num_frags entries and receives the softmax probabilities
+	static void Sample(const Eigen::VectorXd& params, int num_frags, double temp, double rand,
+						Eigen::VectorXd& out_probs, tSample& out_sample);
+	static void EvalMax(const Eigen::VectorXd& params, int num_frags, tSample& out_sample);
+	static tFragView GetFragView(const Eigen::VectorXd& params, int num_frags, int frag_size, int a_idx);
+
+	// batch version, each row of Y is the net output for one state
+	static void EvalMaxBatch(const Eigen::MatrixXd& Y, int num_frags, Eigen::VectorXi& out_max_idx, Eigen::VectorXd& out_max_vals);
+
+protected:
+	static int SampleCumulative(const double* probs, int num_frags, double threshold, int default_idx);
+};
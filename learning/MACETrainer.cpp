@@ -1,6 +1,7 @@
 #include "MACETrainer.h"
 #include "util/FileUtil.h"
 #include "util/Util.h"
+#include "util/Metrics.h"
 #include "QNetTrainer.h"
 
 //#define DISABLE_CRITIC_BUFFER
@@ -145,6 +146,8 @@ void cMACETrainer::InitBatchBuffers()
 		mBatchYBuffer.resize(batch_size, output_size);
 		mBatchValBuffer0.resize(batch_size);
 		mBatchValBuffer1.resize(batch_size);
+		mBatchFragIdxBuffer.resize(batch_size);
+		mBatchFragValBuffer.resize(batch_size);
 	}
 }
 
@@ -370,29 +373,9 @@ int cMACETrainer::GetTargetNetID(int net_id) const
 	return target_id;
 }
 
-int cMACETrainer::CalcBufferSize() const
+bool cMACETrainer::StoreTupleStateEnd() const
 {
-	return 1 + GetStateSize() * 2 + GetActionSize();
-}
-
-int cMACETrainer::GetRewardIdx() const
-{
-	return 0;
-}
-
-int cMACETrainer::GetStateBegIdx() const
-{
-	return 1;
-}
-
-int cMACETrainer::GetStateEndIdx() const
-{
-	return 1 + GetStateSize() + GetActionSize();
-}
-
-int cMACETrainer::GetActionIdx() const
-{
-	return 1 + GetStateSize();
+	return true;
 }
 
 int cMACETrainer::GetActionSize() const
@@ -460,13 +443,8 @@ void cMACETrainer::CalcCurrCumulativeRewardBatch(int net_id, const std::vector<i
 	}
 
 	tar_net->EvalBatch(mBatchXBuffer, mBatchYBuffer);
-
-	for (int i = 0; i < num_data; ++i)
-	{
-		auto curr_y = mBatchYBuffer.row(i);
-		double val = GetMaxFragValAux(curr_y);
-		out_vals(i) = val;
-	}
+	cMACEHead::EvalMaxBatch(mBatchYBuffer, mNumActionFrags, mBatchFragIdxBuffer, mBatchFragValBuffer);
+	out_vals.head(num_data) = mBatchFragValBuffer.head(num_data);
 }
 
 void cMACETrainer::CalcNewCumulativeRewardBatch(int net_id, const std::vector<int>& tuple_ids,
@@ -476,100 +454,38 @@ void cMACETrainer::CalcNewCumulativeRewardBatch(int net_id, const std::vector<in
 	assert(num_data <= GetBatchSize());
 	const auto& tar_net = GetTargetNet(net_id);
 
-	for (int i = 0; i < num_data; ++i)
-	{
-		int t = tuple_ids[i];
-		tExpTuple tuple = GetTuple(t);
-		mBatchXBuffer.row(i) = tuple.mStateEnd;
-	}
-
-	tar_net->EvalBatch(mBatchXBuffer, mBatchYBuffer);
-
-	double discount = GetDiscount();
-	double norm = CalcDiscountNorm(discount);
+	mReturnEngine.BuildChains(mPlaybackMem, tuple_ids, eFlagFail);
 
-	for (int i = 0; i < num_data; ++i)
+	// all states the returns bootstrap from are evaluated with a single batch
+	const std::vector<int>& boot_tuples = mReturnEngine.GetBootstrapTuples();
+	int num_boot = static_cast<int>(boot_tuples.size());
+	mReturnXBuffer.resize(num_boot, mBatchXBuffer.cols());
+	for (int i = 0; i < num_boot; ++i)
 	{
-		int t = tuple_ids[i];
-		tExpTuple tuple = GetTuple(t);
-
-		double new_q = 0;
-		double r = tuple.mReward;
-		r *= norm;
-
-		bool fail = tuple.GetFlag(eFlagFail);
-		if (fail)
-		{
-			new_q = r;
-		}
-		else
-		{
-			auto y_next = mBatchYBuffer.row(i);
-			double q_end = GetMaxFragValAux(y_next);
-			new_q = r + discount * q_end;
-		}
-		out_vals(i) = new_q;
-	}
-}
-
-void cMACETrainer::SetTuple(int t, const tExpTuple& tuple)
-{
-	auto curr_row = mPlaybackMem.row(t);
-
-	curr_row(GetRewardIdx()) = static_cast<float>(tuple.mReward);
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		curr_row(state_beg_idx + j) = static_cast<float>(tuple.mStateBeg(j));
-		curr_row(state_end_idx + j) = static_cast<float>(tuple.mStateEnd(j));
+		tExpTuple tuple = GetTuple(boot_tuples[i]);
+		mReturnXBuffer.row(i) = tuple.mStateEnd;
 	}
 
-	for (int j = 0; j < action_size; ++j)
+	mReturnValBuffer.resize(num_boot);
+	if (num_boot > 0)
 	{
-		curr_row(action_idx + j) = static_cast<float>(tuple.mAction(j));
+		tar_net->EvalBatch(mReturnXBuffer, mReturnYBuffer);
+		cMACEHead::EvalMaxBatch(mReturnYBuffer, mNumActionFrags, mBatchFragIdxBuffer, mReturnValBuffer);
 	}
 
-	mFlagBuffer[t] = tuple.mFlags;
-}
-
-tExpTuple cMACETrainer::GetTuple(int t) const
-{
-	tExpTuple tuple;
-	auto curr_row = mPlaybackMem.row(t);
-
-	tuple.mID = t;
-	tuple.mReward = curr_row[GetRewardIdx()];
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	tuple.mStateBeg.resize(state_size);
-	tuple.mStateEnd.resize(state_size);
-	tuple.mAction.resize(action_size);
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		tuple.mStateBeg(j) = curr_row(state_beg_idx + j);
-		tuple.mStateEnd(j) = curr_row(state_end_idx + j);
-	}
+	double discount = GetDiscount();
+	double norm = CalcDiscountNorm(discount);
 
-	for (int j = 0; j < action_size; ++j)
+	const std::vector<int>& step_tuples = mReturnEngine.GetStepTuples();
+	int num_steps = static_cast<int>(step_tuples.size());
+	mReturnRewardBuffer.resize(num_steps);
+	for (int i = 0; i < num_steps; ++i)
 	{
-		tuple.mAction(j) = curr_row(action_idx + j);
+		double r = mPlaybackMem.GetReward(step_tuples[i]);
+		mReturnRewardBuffer[i] = r * norm;
 	}
 
-	tuple.mFlags = mFlagBuffer[t];
-
-	return tuple;
+	mReturnEngine.CalcReturns(mReturnRewardBuffer, mReturnValBuffer, discount, out_vals);
 }
 
 void cMACETrainer::UpdateActorBatchBuffer()
@@ -683,6 +599,8 @@ void cMACETrainer::UpdateActorNet(const cNeuralNet::tProblem& prob)
 #endif
 		double loss = curr_net->ForwardBackward(prob);
 		printf("Actor Net Loss: %.8f\n", net_id, loss);
+		static const int loss_metric = cMetrics::RegisterGauge("actor_loss");
+		cMetrics::Set(loss_metric, loss, GetIter());
 
 #if defined(OUTPUT_TRAINER_LOG)
 		TIMER_RECORD_END(ASYNC_FORWARD_BACKWARD, mLog.mAsyncForwardBackTime, mLog.mAsyncForwardBackSamples)
@@ -797,14 +715,14 @@ void cMACETrainer::UpdateBuffers(int t)
 
 bool cMACETrainer::IsExpCritic(int t) const
 {
-	int flag = mFlagBuffer[t];
+	unsigned int flag = mPlaybackMem.GetFlags(t);
 	bool off_policy = tExpTuple::TestFlag(flag, cMACETrainer::eFlagExpCritic);
 	return off_policy;
 }
 
 bool cMACETrainer::IsExpActor(int t) const
 {
-	int flag = mFlagBuffer[t];
+	unsigned int flag = mPlaybackMem.GetFlags(t);
 	bool explore = tExpTuple::TestFlag(flag, cMACETrainer::eFlagExpActor);
 	return explore;
 }
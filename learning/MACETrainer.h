@@ -2,6 +2,7 @@
 
 #include "learning/NeuralNetTrainer.h"
 #include "util/CircularBuffer.h"
+#include "MACEHead.h"
 
 #define ENABLE_ACTOR_MULTI_SAMPLE_UPDATE
 
@@ -58,6 +59,8 @@ protected:
 	Eigen::MatrixXd mBatchYBuffer;
 	Eigen::VectorXd mBatchValBuffer0;
 	Eigen::VectorXd mBatchValBuffer1;
+	Eigen::VectorXi mBatchFragIdxBuffer;
+	Eigen::VectorXd mBatchFragValBuffer;
 
 	virtual void InitBatchBuffers();
 	virtual void InitActorProblem(cNeuralNet::tProblem& out_prob) const;
@@ -77,21 +80,13 @@ protected:
 
 	virtual int GetPoolSize() const;
 	virtual int GetTargetNetID(int net_id) const;
-	virtual int CalcBufferSize() const;
-	
-	virtual int GetRewardIdx() const;
-	virtual int GetStateBegIdx() const;
-	virtual int GetStateEndIdx() const;
-	virtual int GetActionIdx() const;
+	virtual bool StoreTupleStateEnd() const;
 	virtual int GetActionSize() const;
 
 	virtual double CalcCurrCumulativeReward(int net_id, const tExpTuple& tuple);
 	virtual double CalcNewCumulativeReward(int net_id, const tExpTuple& tuple);
 	virtual void CalcCurrCumulativeRewardBatch(int net_id, const std::vector<int>& tuple_ids, Eigen::VectorXd& out_vals);
 	virtual void CalcNewCumulativeRewardBatch(int net_id, const std::vector<int>& tuple_ids, Eigen::VectorXd& out_vals);
-	
-	virtual void SetTuple(int t, const tExpTuple& tuple);
-	virtual tExpTuple GetTuple(int t) const;
 
 	virtual void UpdateActorBatchBuffer();
 	virtual void UpdateActor();
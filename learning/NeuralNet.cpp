@@ -1,13 +1,17 @@
 #include "NeuralNet.h"
 #include <json/json.h>
 #include <algorithm>
+#include <atomic>
+#include <map>
 
 #include "util/Util.h"
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 #include "util/JsonUtil.h"
 #include "NNSolver.h"
 #include "AsyncSolver.h"
 #include "MinibatchAdapter.h"
+#include "QuantNet.h"
 
 const std::string gInputOffsetKey = "InputOffset";
 const std::string gInputScaleKey = "InputScale";
@@ -18,6 +22,10 @@ const std::string gOutputLayerName = "output";
 
 std::mutex cNeuralNet::gOutputLock;
 
+// model versions are drawn from one counter so that two nets only ever
+// report the same version when one of them is viewing the other's snapshot
+static std::atomic<uint64_t> gModelVersionCounter(0);
+
 cNeuralNet::tProblem::tProblem()
 {
 	mX.resize(0, 0);
@@ -65,6 +73,7 @@ void cNeuralNet::LoadArchitectureConfig(const std::string& net_file)
 	{
 		Clear();
 		mNet = std::unique_ptr<cPyTorchNetWrapper>(new cPyTorchNetWrapper(net_file, pytorch::TEST));
+		mNetArena.Bind(mNet->learnable_params());
 
 		if (!ValidOffsetScale())
 		{
@@ -82,6 +91,9 @@ void cNeuralNet::LoadCheckpoint(const std::string& model_file)
 {
 	if (model_file != "")
 	{
+		UnshareModel();
+		IncModelVersion();
+
 		if (HasNet())
 		{
 			mNet->CopyTrainedLayersFrom(model_file);
@@ -111,8 +123,13 @@ void cNeuralNet::LoadOptimizer(const std::string& config_file)
 {
 	if (config_file != "")
 	{
+		// nets with a solver keep their own params
+		UnshareModel();
+		IncModelVersion();
+
 		mOptimizerFile = config_file;
 		cOptimizerExecutor::BuildExecutor(config_file, mOptimizer);
+		mSolverArena.Bind(GetTrainNet()->learnable_params());
 
 		if (!ValidOffsetScale())
 		{
@@ -128,11 +145,10 @@ void cNeuralNet::LoadOptimizer(const std::string& config_file)
 
 void cNeuralNet::LoadScale(const std::string& scale_file)
 {
-	std::ifstream f_stream(scale_file);
-	Json::Reader reader;
+	IncModelVersion();
+
 	Json::Value root;
-	bool succ = reader.parse(f_stream, root);
-	f_stream.close();
+	bool succ = cAssetCache::LoadJson(scale_file, root);
 
 	int input_size = GetInputSize();
 	if (succ && !root[gInputOffsetKey].isNull())
@@ -205,11 +221,40 @@ void cNeuralNet::LoadScale(const std::string& scale_file)
 	}
 }
 
+void cNeuralNet::LoadSharedModel(const std::string& model_file)
+{
+	static std::mutex model_mutex;
+	static std::map<std::string, std::weak_ptr<const tParamSnapshot>> models;
+
+	if (model_file != "")
+	{
+		// entries only live as long as some net is still viewing them,
+		// so a model file rewritten after every viewer is gone gets reloaded
+		std::lock_guard<std::mutex> lock(model_mutex);
+		std::shared_ptr<const tParamSnapshot> snapshot = models[model_file].lock();
+		bool succ = snapshot != nullptr && ShareModel(snapshot);
+
+		if (!succ)
+		{
+			LoadModel(model_file);
+			snapshot = BuildSnapshot();
+			if (snapshot != nullptr && ShareModel(snapshot))
+			{
+				models[model_file] = snapshot;
+			}
+		}
+	}
+}
+
 void cNeuralNet::Clear()
 {
 	mNet.reset();
 	mOptimizer.reset();
+	mNetArena.Clear();
+	mSolverArena.Clear();
+	mSnapshot.reset();
 	mValidModel = false;
+	IncModelVersion();
 
 	mInputOffset.resize(0);
 	mInputScale.resize(0);
@@ -254,6 +299,7 @@ double cNeuralNet::ForwardBackward(const tProblem& prob)
 void cNeuralNet::StepOptimizer(int iters)
 {
 	mOptimizer->ApplySteps(iters);
+	IncModelVersion();
 
 	if (HasNet())
 	{
@@ -309,6 +355,7 @@ void cNeuralNet::SetInputOffsetScale(const Eigen::VectorXd& offset, const Eigen:
 	assert(scale.size() == GetInputSize());
 	mInputOffset = offset;
 	mInputScale = scale;
+	IncModelVersion();
 }
 
 void cNeuralNet::SetOutputOffsetScale(const Eigen::VectorXd& offset, const Eigen::VectorXd& scale)
@@ -317,6 +364,7 @@ void cNeuralNet::SetOutputOffsetScale(const Eigen::VectorXd& offset, const Eigen
 	assert(scale.size() == GetOutputSize());
 	mOutputOffset = offset;
 	mOutputScale = scale;
+	IncModelVersion();
 }
 
 const Eigen::VectorXd& cNeuralNet::GetInputOffset() const
@@ -699,7 +747,18 @@ bool cNeuralNet::HasValidModel() const
 
 void cNeuralNet::CopyModel(const cNeuralNet& other)
 {
-	CopyParams(other.GetParams(), GetParams());
+	UnshareModel();
+
+	const cParamArena* src_arena = other.GetParamArena();
+	cParamArena* dst_arena = GetParamArena();
+	if (src_arena != nullptr && dst_arena != nullptr && dst_arena->IsCompatible(*src_arena))
+	{
+		dst_arena->CopyData(*src_arena);
+	}
+	else
+	{
+		CopyParams(other.GetParams(), GetParams());
+	}
 
 	mInputOffset = other.GetInputOffset();
 	mInputScale = other.GetInputScale();
@@ -708,6 +767,7 @@ void cNeuralNet::CopyModel(const cNeuralNet& other)
 
 	SyncSolverParams();
 	mValidModel = true;
+	IncModelVersion();
 }
 
 void cNeuralNet::LerpModel(const cNeuralNet& other, double lerp)
@@ -717,29 +777,41 @@ void cNeuralNet::LerpModel(const cNeuralNet& other, double lerp)
 
 void cNeuralNet::BlendModel(const cNeuralNet& other, double this_weight, double other_weight)
 {
-	const auto& src_params = other.GetParams();
-	const auto& dst_params = GetParams();
+	UnshareModel();
 
-	int num_blobs = static_cast<int>(src_params.size());
-	for (int b = 0; b < num_blobs; ++b)
+	const cParamArena* src_arena = other.GetParamArena();
+	cParamArena* dst_arena = GetParamArena();
+	if (src_arena != nullptr && dst_arena != nullptr && dst_arena->IsCompatible(*src_arena))
 	{
-		auto src_blob = src_params[b];
-		auto dst_blob = dst_params[b];
-
-		auto src_blob_data = src_blob->cpu_data();
-		auto dst_blob_data = dst_blob->mutable_cpu_data();
-		int src_blob_count = src_blob->count();
-		int dst_blob_count = dst_blob->count();
-		assert(src_blob_count == dst_blob_count);
+		dst_arena->BlendData(*src_arena, this_weight, other_weight);
+	}
+	else
+	{
+		const auto& src_params = other.GetParams();
+		const auto& dst_params = GetParams();
 
-		for (int i = 0; i < src_blob_count; ++i)
+		int num_blobs = static_cast<int>(src_params.size());
+		for (int b = 0; b < num_blobs; ++b)
 		{
-			dst_blob_data[i] = this_weight * dst_blob_data[i] + other_weight * src_blob_data[i];
+			auto src_blob = src_params[b];
+			auto dst_blob = dst_params[b];
+
+			auto src_blob_data = src_blob->cpu_data();
+			auto dst_blob_data = dst_blob->mutable_cpu_data();
+			int src_blob_count = src_blob->count();
+			int dst_blob_count = dst_blob->count();
+			assert(src_blob_count == dst_blob_count);
+
+			for (int i = 0; i < src_blob_count; ++i)
+			{
+				dst_blob_data[i] = this_weight * dst_blob_data[i] + other_weight * src_blob_data[i];
+			}
 		}
 	}
 
 	SyncSolverParams();
 	mValidModel = true;
+	IncModelVersion();
 }
 
 void cNeuralNet::BuildBackendNetParams(pytorch::NetParameter& out_params) const
@@ -749,7 +821,17 @@ void cNeuralNet::BuildBackendNetParams(pytorch::NetParameter& out_params) const
 
 bool cNeuralNet::CompareModel(const cNeuralNet& other) const
 {
-	bool same = CompareParams(other.GetParams(), GetParams());
+	bool same = true;
+	const cParamArena* other_arena = other.GetParamArena();
+	const cParamArena* this_arena = GetParamArena();
+	if (other_arena != nullptr && this_arena != nullptr && this_arena->IsCompatible(*other_arena))
+	{
+		same = this_arena->CompareData(*other_arena);
+	}
+	else
+	{
+		same = CompareParams(other.GetParams(), GetParams());
+	}
 
 	same &= mInputOffset.isApprox(other.GetInputOffset(), 0);
 	same &= mInputScale.isApprox(other.GetInputScale(), 0);
@@ -759,6 +841,201 @@ bool cNeuralNet::CompareModel(const cNeuralNet& other) const
 	return same;
 }
 
+bool cNeuralNet::BuildQuantNet(cQuantNet& out_net) const
+{
+	// rebuilds the deploy graph layer by layer from the backend's params,
+	// the int8 weights are quantized as the layers are added
+	if (!HasNet())
+	{
+		printf("Net structure has not been initialized\n");
+		return false;
+	}
+
+	pytorch::NetParameter net_params;
+	mNet->ToProto(&net_params, false);
+
+	auto canonical_axis = [](int axis)
+	{
+		return (axis < 0) ? axis + 4 : axis;
+	};
+
+	auto read_blob = [](const pytorch::BlobProto& blob, int rows, int cols, Eigen::MatrixXd& out_mat)
+	{
+		int double_size = blob.double_data_size();
+		int float_size = blob.data_size();
+		bool succ = (double_size == rows * cols) || (double_size == 0 && float_size == rows * cols);
+		if (succ)
+		{
+			out_mat.resize(rows, cols);
+			for (int r = 0; r < rows; ++r)
+			{
+				for (int c = 0; c < cols; ++c)
+				{
+					int idx = r * cols + c;
+					out_mat(r, c) = (double_size > 0) ? blob.double_data(idx) : blob.data(idx);
+				}
+			}
+		}
+		return succ;
+	};
+
+	out_net.Init(GetInputSize());
+
+	bool succ = true;
+	int num_layers = net_params.layer_size();
+	for (int l = 0; l < num_layers && succ; ++l)
+	{
+		const pytorch::LayerParameter& layer = net_params.layer(l);
+		const std::string& type = layer.type();
+		const std::string& name = layer.name();
+
+		std::vector<std::string> bottoms;
+		std::vector<std::string> tops;
+		for (int i = 0; i < layer.bottom_size(); ++i)
+		{
+			bottoms.push_back(layer.bottom(i));
+		}
+		for (int i = 0; i < layer.top_size(); ++i)
+		{
+			tops.push_back(layer.top(i));
+		}
+
+		if (type == "Input")
+		{
+			continue;
+		}
+		else if (type == "Slice")
+		{
+			const pytorch::SliceParameter& slice_param = layer.slice_param();
+			int axis = canonical_axis(slice_param.has_slice_dim() ? slice_param.slice_dim() : slice_param.axis());
+			std::vector<int> slice_points;
+			for (int i = 0; i < slice_param.slice_point_size(); ++i)
+			{
+				slice_points.push_back(slice_param.slice_point(i));
+			}
+			succ = out_net.AddSlice(name, bottoms[0], tops, axis, slice_points);
+		}
+		else if (type == "Concat")
+		{
+			const pytorch::ConcatParameter& concat_param = layer.concat_param();
+			int axis = canonical_axis(concat_param.has_concat_dim() ? concat_param.concat_dim() : concat_param.axis());
+			succ = out_net.AddConcat(name, bottoms, tops[0], axis);
+		}
+		else if (type == "ReLU")
+		{
+			succ = out_net.AddReLU(name, bottoms[0], tops[0], layer.relu_param().negative_slope());
+		}
+		else if (type == "Flatten")
+		{
+			succ = out_net.AddFlatten(name, bottoms[0], tops[0]);
+		}
+		else if (type == "Dropout" || type == "Split")
+		{
+			for (size_t i = 0; i < tops.size() && succ; ++i)
+			{
+				succ = out_net.AddIdentity(bottoms[0], tops[i]);
+			}
+		}
+		else if (type == "InnerProduct")
+		{
+			const pytorch::InnerProductParameter& ip_param = layer.inner_product_param();
+			int num_output = ip_param.num_output();
+			const pytorch::BlobProto& weight_blob = layer.blobs(0);
+			int num_weights = std::max(weight_blob.double_data_size(), weight_blob.data_size());
+			int input_size = num_output > 0 ? num_weights / num_output : 0;
+
+			Eigen::MatrixXd weights;
+			Eigen::MatrixXd bias;
+			if (ip_param.transpose())
+			{
+				succ = read_blob(weight_blob, input_size, num_output, weights);
+				weights.transposeInPlace();
+			}
+			else
+			{
+				succ = read_blob(weight_blob, num_output, input_size, weights);
+			}
+
+			if (succ && layer.blobs_size() > 1)
+			{
+				succ = read_blob(layer.blobs(1), num_output, 1, bias);
+			}
+
+			if (succ)
+			{
+				Eigen::VectorXd bias_vec = (bias.size() > 0) ? Eigen::VectorXd(bias.col(0)) : Eigen::VectorXd();
+				succ = out_net.AddInnerProduct(name, bottoms[0], tops[0], weights, bias_vec);
+			}
+		}
+		else if (type == "Convolution")
+		{
+			const pytorch::ConvolutionParameter& conv_param = layer.convolution_param();
+			int num_output = conv_param.num_output();
+
+			int kernel_h = conv_param.has_kernel_h() ? conv_param.kernel_h() : conv_param.kernel_size(0);
+			int kernel_w = conv_param.has_kernel_w() ? conv_param.kernel_w()
+							: conv_param.kernel_size((conv_param.kernel_size_size() > 1) ? 1 : 0);
+			int stride_h = conv_param.has_stride_h() ? conv_param.stride_h()
+							: ((conv_param.stride_size() > 0) ? conv_param.stride(0) : 1);
+			int stride_w = conv_param.has_stride_w() ? conv_param.stride_w()
+							: ((conv_param.stride_size() > 0) ? conv_param.stride(conv_param.stride_size() - 1) : 1);
+			int pad_h = conv_param.has_pad_h() ? conv_param.pad_h()
+							: ((conv_param.pad_size() > 0) ? conv_param.pad(0) : 0);
+			int pad_w = conv_param.has_pad_w() ? conv_param.pad_w()
+							: ((conv_param.pad_size() > 0) ? conv_param.pad(conv_param.pad_size() - 1) : 0);
+
+			bool dilated = conv_param.dilation_size() > 0 && conv_param.dilation(0) != 1;
+			if (conv_param.group() != 1 || dilated)
+			{
+				printf("Quantized net does not support grouped or dilated convolutions in layer %s\n", name.c_str());
+				succ = false;
+			}
+			else
+			{
+				const pytorch::BlobProto& weight_blob = layer.blobs(0);
+				int num_weights = std::max(weight_blob.double_data_size(), weight_blob.data_size());
+				int input_size = num_output > 0 ? num_weights / num_output : 0;
+
+				Eigen::MatrixXd weights;
+				Eigen::MatrixXd bias;
+				succ = read_blob(weight_blob, num_output, input_size, weights);
+				if (succ && layer.blobs_size() > 1)
+				{
+					succ = read_blob(layer.blobs(1), num_output, 1, bias);
+				}
+
+				if (succ)
+				{
+					Eigen::VectorXd bias_vec = (bias.size() > 0) ? Eigen::VectorXd(bias.col(0)) : Eigen::VectorXd();
+					succ = out_net.AddConv(name, bottoms[0], tops[0], weights, bias_vec,
+											kernel_h, kernel_w, stride_h, stride_w, pad_h, pad_w);
+				}
+			}
+		}
+		else
+		{
+			printf("Quantized net does not support layer %s of type %s\n", name.c_str(), type.c_str());
+			succ = false;
+		}
+	}
+
+	succ = succ && out_net.Finalize();
+	if (succ)
+	{
+		out_net.SetInputOffsetScale(mInputOffset, mInputScale);
+		out_net.SetOutputOffsetScale(mOutputOffset, mOutputScale);
+		succ = out_net.GetOutputSize() == GetOutputSize();
+	}
+
+	if (!succ)
+	{
+		printf("Failed to build quantized net\n");
+		out_net.Clear();
+	}
+
+	return succ;
+}
+
 void cNeuralNet::ForwardInjectNoisePrefilled(double mean, double stdev, const std::string& layer_name, Eigen::VectorXd& out_y) const
 {
 	// assume the Eval has already been called which fills the blobs in the network using a given input
@@ -844,11 +1121,87 @@ const std::vector<pytorch::Blob<cNeuralNet::tNNData>*>& cNeuralNet::GetParams()
 	}
 }
 
+const cParamArena* cNeuralNet::GetParamArena() const
+{
+	if (HasNet())
+	{
+		return GetNetArena();
+	}
+	else
+	{
+		return GetSolverArena();
+	}
+}
+
+uint64_t cNeuralNet::GetModelVersion() const
+{
+	return mModelVersion;
+}
+
+std::shared_ptr<const tParamSnapshot> cNeuralNet::BuildSnapshot() const
+{
+	std::shared_ptr<tParamSnapshot> snapshot;
+	const cParamArena* arena = GetNetArena();
+	if (arena != nullptr)
+	{
+		snapshot = std::shared_ptr<tParamSnapshot>(new tParamSnapshot());
+		snapshot->mVersion = mModelVersion;
+		snapshot->mBlobCounts = arena->GetBlobCounts();
+		snapshot->mData = arena->BuildSharedData();
+		snapshot->mInputOffset = mInputOffset;
+		snapshot->mInputScale = mInputScale;
+		snapshot->mOutputOffset = mOutputOffset;
+		snapshot->mOutputScale = mOutputScale;
+	}
+	return snapshot;
+}
+
+bool cNeuralNet::ShareModel(const std::shared_ptr<const tParamSnapshot>& snapshot)
+{
+	bool succ = false;
+	if (snapshot != nullptr && HasNet() && !HasSolver())
+	{
+		if (snapshot == mSnapshot && snapshot->mVersion == mModelVersion)
+		{
+			succ = true;
+		}
+		else
+		{
+			succ = mNetArena.ShareData(snapshot->mBlobCounts, snapshot->mData, mNet->learnable_params());
+			if (succ)
+			{
+				mSnapshot = snapshot;
+				mInputOffset = snapshot->mInputOffset;
+				mInputScale = snapshot->mInputScale;
+				mOutputOffset = snapshot->mOutputOffset;
+				mOutputScale = snapshot->mOutputScale;
+				mModelVersion = snapshot->mVersion;
+				mValidModel = true;
+			}
+		}
+	}
+	return succ;
+}
+
+bool cNeuralNet::IsModelShared() const
+{
+	return mNetArena.IsShared();
+}
+
 void cNeuralNet::SyncSolverParams()
 {
 	if (HasSolver() && HasNet())
 	{
-		CopyModel(*mNet, *GetTrainNet());
+		const cParamArena* net_arena = GetNetArena();
+		const cParamArena* solver_arena = GetSolverArena();
+		if (net_arena != nullptr && solver_arena != nullptr && solver_arena->IsCompatible(*net_arena))
+		{
+			mSolverArena.CopyData(mNetArena);
+		}
+		else
+		{
+			CopyModel(*mNet, *GetTrainNet());
+		}
 	}
 }
 
@@ -856,7 +1209,19 @@ void cNeuralNet::SyncNetParams()
 {
 	if (HasSolver() && HasNet())
 	{
-		CopyModel(*GetTrainNet(), *mNet);
+		UnshareModel();
+		IncModelVersion();
+
+		const cParamArena* net_arena = GetNetArena();
+		const cParamArena* solver_arena = GetSolverArena();
+		if (net_arena != nullptr && solver_arena != nullptr && net_arena->IsCompatible(*solver_arena))
+		{
+			mNetArena.CopyData(mSolverArena);
+		}
+		else
+		{
+			CopyModel(*GetTrainNet(), *mNet);
+		}
 	}
 }
 
@@ -864,30 +1229,77 @@ void cNeuralNet::CopyGrad(const cNeuralNet& other)
 {
 	assert(HasSolver());
 	assert(other.HasSolver());
-	auto other_net = other.GetTrainNet();
-	auto this_net = GetTrainNet();
-	
-	auto other_params = other_net->learnable_params();
-	auto this_params = this_net->learnable_params();
-	assert(other_params.size() == this_params.size());
 
-	for (size_t i = 0; i < this_params.size(); ++i)
+	const cParamArena* other_arena = other.GetSolverArena();
+	const cParamArena* this_arena = GetSolverArena();
+	if (other_arena != nullptr && this_arena != nullptr && this_arena->IsCompatible(*other_arena))
+	{
+		mSolverArena.CopyDiff(*other_arena);
+	}
+	else
 	{
-		auto other_blob = other_params[i];
-		auto this_blob = this_params[i];
-		assert(other_blob->count() == this_blob->count());
+		auto other_net = other.GetTrainNet();
+		auto this_net = GetTrainNet();
 
-		auto other_diff = other_blob->cpu_diff();
-		auto this_diff = this_blob->mutable_cpu_diff();
-		auto other_data = other_blob->cpu_data();
-		auto this_data = this_blob->cpu_data();
-		for (int j = 0; j < this_blob->count(); ++j)
+		const auto& other_params = other_net->learnable_params();
+		const auto& this_params = this_net->learnable_params();
+		assert(other_params.size() == this_params.size());
+
+		for (size_t i = 0; i < this_params.size(); ++i)
 		{
-			this_diff[j] = other_diff[j];
+			auto other_blob = other_params[i];
+			auto this_blob = this_params[i];
+			assert(other_blob->count() == this_blob->count());
+
+			auto other_diff = other_blob->cpu_diff();
+			auto this_diff = this_blob->mutable_cpu_diff();
+			std::memcpy(this_diff, other_diff, this_blob->count() * sizeof(tNNData));
 		}
 	}
 }
 
+cParamArena* cNeuralNet::GetParamArena()
+{
+	const cNeuralNet* this_const = this;
+	return const_cast<cParamArena*>(this_const->GetParamArena());
+}
+
+const cParamArena* cNeuralNet::GetNetArena() const
+{
+	// returns null if the blobs no longer view the arena, eg. after a reshape,
+	// in which case callers fall back to the per-blob paths
+	const cParamArena* arena = nullptr;
+	if (HasNet() && mNetArena.IsValid(mNet->learnable_params()))
+	{
+		arena = &mNetArena;
+	}
+	return arena;
+}
+
+const cParamArena* cNeuralNet::GetSolverArena() const
+{
+	const cParamArena* arena = nullptr;
+	if (HasSolver() && mSolverArena.IsValid(GetTrainNet()->learnable_params()))
+	{
+		arena = &mSolverArena;
+	}
+	return arena;
+}
+
+void cNeuralNet::IncModelVersion()
+{
+	mModelVersion = ++gModelVersionCounter;
+}
+
+void cNeuralNet::UnshareModel()
+{
+	if (IsModelShared())
+	{
+		mNetArena.UnshareData(mNet->learnable_params());
+	}
+	mSnapshot.reset();
+}
+
 bool cNeuralNet::ValidOffsetScale() const
 {
 	return mInputOffset.size() > 0 && mInputScale.size() > 0
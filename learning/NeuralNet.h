@@ -1,10 +1,13 @@
 #pragma once
 #include "util/MathUtil.h"
+#include "ParamArena.h"
+#include "ParamStore.h"
 #include <pytorch/net.hpp>
 #include <pytorch/pytorch.hpp>
 #include <mutex>
 // FUUUUCK
 class cOptimizerExecutor;
+class cQuantNet;
 
 class cNeuralNet
 {
@@ -38,6 +41,8 @@ public:
 	virtual void LoadModel(const std::string& model_file) { LoadCheckpoint(model_file); }
 	virtual void LoadOptimizer(const std::string& config_file);
 	virtual void LoadScale(const std::string& scale_file);
+	// nets loading the same model file view a single read-only copy of its params
+	virtual void LoadSharedModel(const std::string& model_file);
 
 	virtual void LoadSolver(const std::string& solver_file, bool async = false) { LoadOptimizer(solver_file); }
 	virtual void StepSolver(int iters) { StepOptimizer(iters); }
@@ -91,12 +96,23 @@ public:
 	virtual void BuildBackendNetParams(pytorch::NetParameter& out_params) const;
 	virtual void BuildNetParams(pytorch::NetParameter& out_params) const { BuildBackendNetParams(out_params); }
 	virtual bool CompareModel(const cNeuralNet& other) const;
+	virtual bool BuildQuantNet(cQuantNet& out_net) const;
 
 	virtual void ForwardInjectNoisePrefilled(double mean, double stdev, const std::string& layer_name, Eigen::VectorXd& out_y) const;
 	virtual void GetLayerState(const std::string& layer_name, Eigen::VectorXd& out_state) const;
 	virtual void SetLayerState(const Eigen::VectorXd& state, const std::string& layer_name) const;
 
 	virtual const std::vector<pytorch::Blob<tNNData>*>& GetParams() const;
+	virtual const cParamArena* GetParamArena() const;
+
+	// stamp of the current params and offset/scale, a new one is drawn every time they change
+	virtual uint64_t GetModelVersion() const;
+	virtual std::shared_ptr<const tParamSnapshot> BuildSnapshot() const;
+	// views the snapshot's params in place of this net's own copy until the params are next modified,
+	// only nets without a solver can share, returns false if the snapshot doesn't fit the architecture
+	virtual bool ShareModel(const std::shared_ptr<const tParamSnapshot>& snapshot);
+	virtual bool IsModelShared() const;
+
 	virtual void SyncSolverParams();
 	virtual void SyncNetParams();
 
@@ -115,7 +131,14 @@ protected:
 	static std::mutex gOutputLock;
 
 	bool mValidModel;
-		std::unique_ptr<cPyTorchNetWrapper> mNet;
+	uint64_t mModelVersion;
+
+	// the arenas are declared before the nets so they outlive the blobs viewing them
+	cParamArena mNetArena;
+	cParamArena mSolverArena;
+
+	std::unique_ptr<cPyTorchNetWrapper> mNet;
+	std::shared_ptr<const tParamSnapshot> mSnapshot;
 	std::shared_ptr<cOptimizerExecutor> mOptimizer;
 	std::string mOptimizerFile;
 	
@@ -124,6 +147,13 @@ protected:
 	Eigen::VectorXd mOutputOffset;
 	Eigen::VectorXd mOutputScale;
 
+	virtual cParamArena* GetParamArena();
+	virtual const cParamArena* GetNetArena() const;
+	virtual const cParamArena* GetSolverArena() const;
+
+	virtual void IncModelVersion();
+	virtual void UnshareModel();
+
 	virtual bool ValidOffsetScale() const;
 	virtual void InitOffsetScale();
 
@@ -84,8 +84,14 @@ void cNeuralNetLearner::OutputModel(const std::string& filename) const
 
 void cNeuralNetLearner::SyncNet()
 {
-	auto& trainer_net = mTrainer->GetNet();
-	mNet->CopyModel(*trainer_net);
+	// the controller's net views the trainer's latest snapshot, learners that sync
+	// between training steps share a single copy of the params
+	auto snapshot = mTrainer->PublishNet();
+	if (!mNet->ShareModel(snapshot))
+	{
+		auto& trainer_net = mTrainer->GetNet();
+		mNet->CopyModel(*trainer_net);
+	}
 }
 
 bool cNeuralNetLearner::IsDone() const
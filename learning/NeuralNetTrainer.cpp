@@ -1,6 +1,7 @@
 #include "NeuralNetTrainer.h"
 #include "util/FileUtil.h"
 #include "util/Util.h"
+#include "util/Metrics.h"
 
 //#define DISABLE_EXP_REPLAY
 
@@ -33,6 +34,8 @@ void cNeuralNetTrainer::Init(const tParams& params)
 	ResetParams();
 	InitBatchBuffer();
 	InitProblem(mProb);
+	InitUpdatePool();
+	InitReturnEngine();
 
 	if (EnableAsyncMode())
 	{
@@ -187,6 +190,12 @@ const std::unique_ptr<cNeuralNet>& cNeuralNetTrainer::GetNet() const
 	return GetCurrNet();
 }
 
+std::shared_ptr<const tParamSnapshot> cNeuralNetTrainer::PublishNet()
+{
+	const auto& curr_net = GetNet();
+	return mNetStore.Publish(*curr_net);
+}
+
 const std::unique_ptr<cNeuralNet>& cNeuralNetTrainer::GetCurrNet() const
 {
 	return mNetPool[mCurrActiveNet];
@@ -355,8 +364,14 @@ int cNeuralNetTrainer::GetBatchSize() const
 
 void cNeuralNetTrainer::InitPlaybackMem(int size)
 {
-	mPlaybackMem.resize(size, CalcBufferSize());
-	mFlagBuffer.resize(size);
+	cReplayMem::tParams mem_params;
+	mem_params.mCapacity = size;
+	mem_params.mStateSize = GetStateSize();
+	mem_params.mActionSize = GetActionSize();
+	mem_params.mStoreStateEnd = StoreTupleStateEnd();
+	mem_params.mHalfOffset = mParams.mPlaybackHalfOffset;
+	mem_params.mHalfSize = mParams.mPlaybackHalfSize;
+	mPlaybackMem.Init(mem_params);
 }
 
 void cNeuralNetTrainer::InitBatchBuffer()
@@ -379,7 +394,7 @@ void cNeuralNetTrainer::InitProblem(cNeuralNet::tProblem& out_prob) const
 
 int cNeuralNetTrainer::GetPlaybackMemSize() const
 {
-	return static_cast<int>(mPlaybackMem.rows());
+	return mPlaybackMem.GetCapacity();
 }
 
 void cNeuralNetTrainer::ResetParams()
@@ -390,6 +405,7 @@ void cNeuralNetTrainer::ResetParams()
 	mBufferHead = 0;
 	mIter = 0;
 	mStage = eStageInit;
+	mPlaybackMem.Clear();
 }
 
 void cNeuralNetTrainer::Pretrain()
@@ -398,6 +414,11 @@ void cNeuralNetTrainer::Pretrain()
 
 bool cNeuralNetTrainer::Step()
 {
+	if (EnableParallelUpdate())
+	{
+		return StepPool(0, GetPoolSize());
+	}
+
 	bool succ = false;
 	for (int i = 0; i < GetPoolSize(); ++i)
 	{
@@ -411,6 +432,71 @@ bool cNeuralNetTrainer::Step()
 	return succ;
 }
 
+bool cNeuralNetTrainer::EnableParallelUpdate() const
+{
+	// async trainers already run one learner per thread
+	return mParams.mNumUpdateThreads > 1 && !EnableAsyncMode();
+}
+
+void cNeuralNetTrainer::InitReturnEngine()
+{
+	cReturnEngine::tParams return_params;
+	return_params.mNumSteps = mParams.mNumReturnSteps;
+	return_params.mLambda = mParams.mReturnLambda;
+	mReturnEngine.Init(return_params);
+}
+
+void cNeuralNetTrainer::InitUpdatePool()
+{
+	mPoolProbs.clear();
+	mPoolProbValid.clear();
+
+	if (EnableParallelUpdate())
+	{
+		mUpdatePool.Init(mParams.mNumUpdateThreads);
+
+		int pool_size = static_cast<int>(mNetPool.size());
+		mPoolProbs.resize(pool_size);
+		mPoolProbValid.resize(pool_size, false);
+		for (int i = 0; i < pool_size; ++i)
+		{
+			InitProblem(mPoolProbs[i]);
+		}
+	}
+}
+
+bool cNeuralNetTrainer::StepPool(int beg_id, int end_id)
+{
+	// minibatch sampling and targets stay on this thread since they draw from
+	// the shared rng and evaluate the other nets in the pool, only the
+	// forward-backward passes and solver steps of the nets run concurrently,
+	// so every net's targets come from the pool before this step
+	bool succ = false;
+	for (int i = beg_id; i < end_id; ++i)
+	{
+		printf("Update Net %i:\n", i);
+		mPoolProbValid[i] = BuildProblem(i, mPoolProbs[i]);
+		succ = mPoolProbValid[i];
+	}
+
+	std::vector<cThreadPool::tJob> jobs;
+	BuildPoolJobs(beg_id, end_id, jobs);
+	mUpdatePool.Run(jobs);
+
+	return succ;
+}
+
+void cNeuralNetTrainer::BuildPoolJobs(int beg_id, int end_id, std::vector<cThreadPool::tJob>& out_jobs)
+{
+	for (int i = beg_id; i < end_id; ++i)
+	{
+		if (mPoolProbValid[i])
+		{
+			out_jobs.push_back([this, i]() { UpdateNet(i, mPoolProbs[i]); });
+		}
+	}
+}
+
 bool cNeuralNetTrainer::BuildProblem(int net_id, cNeuralNet::tProblem& out_prob)
 {
 	bool succ = true;
@@ -588,6 +674,8 @@ void cNeuralNetTrainer::UpdateNet(int net_id, const cNeuralNet::tProblem& prob)
 #endif
 		double loss = curr_net->ForwardBackward(prob);
 		printf("Net %i Loss: %.8f\n", net_id, loss);
+		static const int loss_metric = cMetrics::RegisterGauge("net_loss");
+		cMetrics::Set(loss_metric, loss, GetIter());
 
 #if defined(OUTPUT_TRAINER_LOG)
 		TIMER_RECORD_END(ASYNC_FORWARD_BACKWARD, mLog.mAsyncForwardBackTime, mLog.mAsyncForwardBackSamples)
@@ -626,70 +714,20 @@ void cNeuralNetTrainer::UpdateNet(int net_id, const cNeuralNet::tProblem& prob)
 #endif
 }
 
-int cNeuralNetTrainer::CalcBufferSize() const
+bool cNeuralNetTrainer::StoreTupleStateEnd() const
 {
-	return GetStateSize() + GetActionSize();
-}
-
-int cNeuralNetTrainer::GetStateBegIdx() const
-{
-	return 0;
-}
-
-int cNeuralNetTrainer::GetActionIdx() const
-{
-	return GetStateSize();
+	return false;
 }
 
 void cNeuralNetTrainer::SetTuple(int t, const tExpTuple& tuple)
 {
-	auto curr_row = mPlaybackMem.row(t);
-
-	int state_beg_idx = GetStateBegIdx();
-	int state_size = GetStateSize();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		curr_row(state_beg_idx + j) = static_cast<float>(tuple.mStateBeg(j));
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		curr_row(action_idx + j) = static_cast<float>(tuple.mAction(j));
-	}
-
-	mFlagBuffer[t] = tuple.mFlags;
+	mPlaybackMem.Set(t, tuple);
 }
 
 tExpTuple cNeuralNetTrainer::GetTuple(int t) const
 {
 	tExpTuple tuple;
-	auto curr_row = mPlaybackMem.row(t);
-
-	int state_beg_idx = GetStateBegIdx();
-	int state_size = GetStateSize();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	tuple.mID = t;
-	tuple.mStateBeg.resize(state_size);
-	tuple.mStateEnd.resize(0);
-	tuple.mAction.resize(action_size);
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		tuple.mStateBeg(j) = curr_row(state_beg_idx + j);
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		tuple.mAction(j) = curr_row(action_idx + j);
-	}
-	
-	tuple.mFlags = mFlagBuffer[t];
-
+	mPlaybackMem.Get(t, tuple);
 	return tuple;
 }
 
@@ -3,9 +3,12 @@
 #include <mutex>
 #include "learning/TrainerInterface.h"
 #include "learning/ExpTuple.h"
+#include "learning/ReplayMem.h"
+#include "learning/ReturnEngine.h"
 #include "learning/NeuralNet.h"
 #include "learning/NeuralNetLearner.h"
 #include "learning/ParamServer.h"
+#include "util/ThreadPool.h"
 
 class cNeuralNetTrainer : public cTrainerInterface, 
 						public std::enable_shared_from_this<cNeuralNetTrainer>
@@ -34,6 +37,9 @@ public:
 	virtual void Train();
 
 	virtual const std::unique_ptr<cNeuralNet>& GetNet() const;
+	// snapshot of the current net for the learners' nets to view,
+	// only rebuilt after the net has been modified
+	virtual std::shared_ptr<const tParamSnapshot> PublishNet();
 	virtual double GetDiscount() const;
 	virtual double GetAvgReward() const;
 	virtual int GetIter() const;
@@ -82,8 +88,7 @@ protected:
 	int mBufferHead;
 	int mNumTuples;
 	int mTotalTuples;
-	Eigen::MatrixXf mPlaybackMem;
-	std::vector<unsigned int> mFlagBuffer;
+	cReplayMem mPlaybackMem;
 
 	cNeuralNet::tProblem mProb;
 	std::vector<std::unique_ptr<cNeuralNet>> mNetPool;
@@ -95,6 +100,17 @@ protected:
 	std::vector<cNeuralNetLearner*> mLearners;
 
 	cParamServer* mParamServer;
+	cParamStore mNetStore;
+
+	cThreadPool mUpdatePool;
+	std::vector<cNeuralNet::tProblem> mPoolProbs;
+	std::vector<bool> mPoolProbValid;
+
+	cReturnEngine mReturnEngine;
+	Eigen::MatrixXd mReturnXBuffer;
+	Eigen::MatrixXd mReturnYBuffer;
+	Eigen::VectorXd mReturnRewardBuffer;
+	Eigen::VectorXd mReturnValBuffer;
 
 	const std::unique_ptr<cNeuralNet>& GetCurrNet() const;
 
@@ -106,6 +122,11 @@ protected:
 	
 	virtual void Pretrain();
 	virtual bool Step();
+	virtual bool EnableParallelUpdate() const;
+	virtual void InitUpdatePool();
+	virtual void InitReturnEngine();
+	virtual bool StepPool(int beg_id, int end_id);
+	virtual void BuildPoolJobs(int beg_id, int end_id, std::vector<cThreadPool::tJob>& out_jobs);
 	virtual bool BuildProblem(int net_id, cNeuralNet::tProblem& out_prob);
 	virtual void BuildProblemX(int net_id, const std::vector<int>& tuple_ids, cNeuralNet::tProblem& out_prob);
 	virtual void BuildProblemY(int net_id, const std::vector<int>& tuple_ids, const Eigen::MatrixXd& X, cNeuralNet::tProblem& out_prob);
@@ -121,9 +142,7 @@ protected:
 	virtual bool CheckTuple(const tExpTuple& tuple) const;
 	virtual void UpdateNet(int net_id, const cNeuralNet::tProblem& prob);
 
-	virtual int CalcBufferSize() const;
-	virtual int GetStateBegIdx() const;
-	virtual int GetActionIdx() const;
+	virtual bool StoreTupleStateEnd() const;
 
 	virtual void SetTuple(int t, const tExpTuple& tuple);
 	virtual tExpTuple GetTuple(int t) const;
@@ -0,0 +1,254 @@
+#include "ParamArena.h"
+#include <cstring>
+#include <algorithm>
+#include <cassert>
+
+cParamArena::cParamArena()
+{
+	Clear();
+}
+
+cParamArena::~cParamArena()
+{
+}
+
+void cParamArena::Bind(const std::vector<pytorch::Blob<tNNData>*>& params)
+{
+	int num_blobs = static_cast<int>(params.size());
+	std::vector<int> offsets(num_blobs);
+	std::vector<int> counts(num_blobs);
+
+	int size = 0;
+	for (int b = 0; b < num_blobs; ++b)
+	{
+		int count = params[b]->count();
+		offsets[b] = size;
+		counts[b] = count;
+		size += PadCount(count);
+	}
+
+	// the new buffers are filled from the blobs before the old ones are released,
+	// since the blobs may still be pointing into the old buffers
+	tBuffer data = tBuffer::Zero(size);
+	tBuffer diff = tBuffer::Zero(size);
+
+	for (int b = 0; b < num_blobs; ++b)
+	{
+		auto blob = params[b];
+		int offset = offsets[b];
+		int count = counts[b];
+
+		tNNData* data_ptr = data.data() + offset;
+		tNNData* diff_ptr = diff.data() + offset;
+		std::memcpy(data_ptr, blob->cpu_data(), count * sizeof(tNNData));
+		std::memcpy(diff_ptr, blob->cpu_diff(), count * sizeof(tNNData));
+
+		blob->set_cpu_data(data_ptr);
+		blob->diff()->set_cpu_data(diff_ptr);
+	}
+
+	mData.swap(data);
+	mDiff.swap(diff);
+	mBlobOffsets.swap(offsets);
+	mBlobCounts.swap(counts);
+	mSharedData.reset();
+}
+
+void cParamArena::Clear()
+{
+	mBlobOffsets.clear();
+	mBlobCounts.clear();
+	mData.resize(0);
+	mDiff.resize(0);
+	mSharedData.reset();
+}
+
+bool cParamArena::ShareData(const std::vector<int>& blob_counts, const std::shared_ptr<const tBuffer>& data,
+							const std::vector<pytorch::Blob<tNNData>*>& params)
+{
+	bool succ = data != nullptr && IsValid(params)
+				&& blob_counts == mBlobCounts
+				&& static_cast<int>(data->size()) == GetSize();
+
+	if (succ && data != mSharedData)
+	{
+		// the shared buffer is never written through these blobs, every path
+		// that modifies the params has to unshare the arena first
+		tNNData* shared_data = const_cast<tNNData*>(data->data());
+		int num_blobs = GetNumBlobs();
+		for (int b = 0; b < num_blobs; ++b)
+		{
+			params[b]->set_cpu_data(shared_data + mBlobOffsets[b]);
+		}
+
+		mSharedData = data;
+		mData.resize(0);
+	}
+	return succ;
+}
+
+void cParamArena::UnshareData(const std::vector<pytorch::Blob<tNNData>*>& params)
+{
+	if (IsShared())
+	{
+		tBuffer data = *mSharedData;
+		int num_blobs = GetNumBlobs();
+		assert(static_cast<int>(params.size()) == num_blobs);
+		for (int b = 0; b < num_blobs; ++b)
+		{
+			params[b]->set_cpu_data(data.data() + mBlobOffsets[b]);
+		}
+
+		mData.swap(data);
+		mSharedData.reset();
+	}
+}
+
+bool cParamArena::IsShared() const
+{
+	return mSharedData != nullptr;
+}
+
+std::shared_ptr<const cParamArena::tBuffer> cParamArena::BuildSharedData() const
+{
+	std::shared_ptr<const tBuffer> data = mSharedData;
+	if (data == nullptr)
+	{
+		data = std::shared_ptr<const tBuffer>(new tBuffer(mData));
+	}
+	return data;
+}
+
+bool cParamArena::IsBound() const
+{
+	return mBlobOffsets.size() > 0;
+}
+
+bool cParamArena::IsValid(const std::vector<pytorch::Blob<tNNData>*>& params) const
+{
+	// a blob that has been reshaped into a larger size reallocates its own storage,
+	// so the views have to be checked before the arena can stand in for the blobs
+	int num_blobs = GetNumBlobs();
+	if (!IsBound() || static_cast<int>(params.size()) != num_blobs)
+	{
+		return false;
+	}
+
+	for (int b = 0; b < num_blobs; ++b)
+	{
+		const pytorch::Blob<tNNData>* blob = params[b];
+		int offset = mBlobOffsets[b];
+		if (blob->count() != mBlobCounts[b]
+			|| blob->cpu_data() != GetData() + offset
+			|| blob->cpu_diff() != mDiff.data() + offset)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool cParamArena::IsCompatible(const cParamArena& other) const
+{
+	return IsBound() && other.IsBound()
+		&& mBlobCounts == other.mBlobCounts;
+}
+
+int cParamArena::GetSize() const
+{
+	// the data buffer is empty while shared, the diffs always match the layout
+	return static_cast<int>(mDiff.size());
+}
+
+int cParamArena::GetNumBlobs() const
+{
+	return static_cast<int>(mBlobOffsets.size());
+}
+
+int cParamArena::GetBlobOffset(int b) const
+{
+	return mBlobOffsets[b];
+}
+
+int cParamArena::GetBlobCount(int b) const
+{
+	return mBlobCounts[b];
+}
+
+const std::vector<int>& cParamArena::GetBlobCounts() const
+{
+	return mBlobCounts;
+}
+
+cParamArena::tNNData* cParamArena::GetData()
+{
+	assert(!IsShared());
+	return mData.data();
+}
+
+const cParamArena::tNNData* cParamArena::GetData() const
+{
+	return (IsShared()) ? mSharedData->data() : mData.data();
+}
+
+cParamArena::tNNData* cParamArena::GetDiff()
+{
+	return mDiff.data();
+}
+
+const cParamArena::tNNData* cParamArena::GetDiff() const
+{
+	return mDiff.data();
+}
+
+cParamArena::tBufferMap cParamArena::GetDataView()
+{
+	return tBufferMap(GetData(), GetSize());
+}
+
+cParamArena::tConstBufferMap cParamArena::GetDataView() const
+{
+	return tConstBufferMap(GetData(), GetSize());
+}
+
+cParamArena::tBufferMap cParamArena::GetDiffView()
+{
+	return tBufferMap(mDiff.data(), mDiff.size());
+}
+
+cParamArena::tConstBufferMap cParamArena::GetDiffView() const
+{
+	return tConstBufferMap(mDiff.data(), mDiff.size());
+}
+
+void cParamArena::CopyData(const cParamArena& src)
+{
+	assert(IsCompatible(src));
+	std::memcpy(GetData(), src.GetData(), GetSize() * sizeof(tNNData));
+}
+
+void cParamArena::CopyDiff(const cParamArena& src)
+{
+	assert(IsCompatible(src));
+	std::memcpy(mDiff.data(), src.GetDiff(), GetSize() * sizeof(tNNData));
+}
+
+void cParamArena::BlendData(const cParamArena& src, double this_weight, double other_weight)
+{
+	assert(IsCompatible(src));
+	tBufferMap dst_view = GetDataView();
+	tConstBufferMap src_view = src.GetDataView();
+	dst_view = this_weight * dst_view + other_weight * src_view;
+}
+
+bool cParamArena::CompareData(const cParamArena& other) const
+{
+	assert(IsCompatible(other));
+	return GetDataView() == other.GetDataView();
+}
+
+int cParamArena::PadCount(int count)
+{
+	const int align = std::max(1, static_cast<int>(EIGEN_MAX_ALIGN_BYTES / sizeof(tNNData)));
+	return ((count + align - 1) / align) * align;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <Eigen/Dense>
+
+#include <pytorch/blob.hpp>
+
+// stores the data and diffs of a net's learnable params in two contiguous buffers,
+// the blobs are rebound to views into the buffers so whole-model copies, blends
+// and gradient transfers can run as single loops over the arena
+class cParamArena
+{
+public:
+	typedef double tNNData;
+	typedef Eigen::Matrix<tNNData, Eigen::Dynamic, 1> tBuffer;
+	typedef Eigen::Map<tBuffer, Eigen::AlignedMax> tBufferMap;
+	typedef Eigen::Map<const tBuffer, Eigen::AlignedMax> tConstBufferMap;
+
+	cParamArena();
+	virtual ~cParamArena();
+
+	virtual void Bind(const std::vector<pytorch::Blob<tNNData>*>& params);
+	virtual void Clear();
+
+	// points the blobs' data at a read-only buffer shared with other arenas of the same layout,
+	// the arena's own data is released until the arena is unshared again,
+	// the diffs stay private so each net can still backprop into its own buffer
+	virtual bool ShareData(const std::vector<int>& blob_counts, const std::shared_ptr<const tBuffer>& data,
+							const std::vector<pytorch::Blob<tNNData>*>& params);
+	// copy on write, gives the blobs back a private copy of the shared data
+	virtual void UnshareData(const std::vector<pytorch::Blob<tNNData>*>& params);
+	virtual bool IsShared() const;
+	// returns the shared buffer if there is one, otherwise a copy of the data that can be shared
+	virtual std::shared_ptr<const tBuffer> BuildSharedData() const;
+
+	virtual bool IsBound() const;
+	virtual bool IsValid(const std::vector<pytorch::Blob<tNNData>*>& params) const;
+	virtual bool IsCompatible(const cParamArena& other) const;
+
+	virtual int GetSize() const;
+	virtual int GetNumBlobs() const;
+	virtual int GetBlobOffset(int b) const;
+	virtual int GetBlobCount(int b) const;
+	virtual const std::vector<int>& GetBlobCounts() const;
+
+	virtual tNNData* GetData();
+	virtual const tNNData* GetData() const;
+	virtual tNNData* GetDiff();
+	virtual const tNNData* GetDiff() const;
+
+	virtual tBufferMap GetDataView();
+	virtual tConstBufferMap GetDataView() const;
+	virtual tBufferMap GetDiffView();
+	virtual tConstBufferMap GetDiffView() const;
+
+	virtual void CopyData(const cParamArena& src);
+	virtual void CopyDiff(const cParamArena& src);
+	virtual void BlendData(const cParamArena& src, double this_weight, double other_weight);
+	virtual bool CompareData(const cParamArena& other) const;
+
+protected:
+	std::vector<int> mBlobOffsets;
+	std::vector<int> mBlobCounts;
+	tBuffer mData;
+	tBuffer mDiff;
+	std::shared_ptr<const tBuffer> mSharedData;
+
+	// blobs are padded so that each one starts on an aligned boundary,
+	// the padding is kept at zero so it is harmless to the arena-wide loops
+	static int PadCount(int count);
+};
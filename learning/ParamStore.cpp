@@ -0,0 +1,40 @@
+#include "ParamStore.h"
+#include "NeuralNet.h"
+
+tParamSnapshot::tParamSnapshot()
+{
+	mVersion = 0;
+}
+
+cParamStore::cParamStore()
+{
+}
+
+cParamStore::~cParamStore()
+{
+}
+
+void cParamStore::Clear()
+{
+	std::lock_guard<std::mutex> lock(mPublishLock);
+	std::atomic_store(&mSnapshot, std::shared_ptr<const tParamSnapshot>());
+}
+
+std::shared_ptr<const tParamSnapshot> cParamStore::Publish(const cNeuralNet& net)
+{
+	std::lock_guard<std::mutex> lock(mPublishLock);
+	std::shared_ptr<const tParamSnapshot> snapshot = std::atomic_load(&mSnapshot);
+	if (snapshot == nullptr || snapshot->mVersion != net.GetModelVersion())
+	{
+		// a net that can't be snapshot clears the store so that readers
+		// fall back to copying instead of viewing stale params
+		snapshot = net.BuildSnapshot();
+		std::atomic_store(&mSnapshot, snapshot);
+	}
+	return snapshot;
+}
+
+std::shared_ptr<const tParamSnapshot> cParamStore::GetSnapshot() const
+{
+	return std::atomic_load(&mSnapshot);
+}
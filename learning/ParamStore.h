@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include "learning/ParamArena.h"
+
+class cNeuralNet;
+
+// immutable copy of a net's params and offset/scale, the data is laid out like the
+// net's param arena so that any net with the same architecture can view it in place
+struct tParamSnapshot
+{
+	tParamSnapshot();
+
+	uint64_t mVersion;
+	std::vector<int> mBlobCounts;
+	std::shared_ptr<const cParamArena::tBuffer> mData;
+
+	Eigen::VectorXd mInputOffset;
+	Eigen::VectorXd mInputScale;
+	Eigen::VectorXd mOutputOffset;
+	Eigen::VectorXd mOutputScale;
+};
+
+// publishes read-only snapshots of a net, a writer swaps in a new snapshot with an atomic store
+// and readers pick up the latest one with an atomic load without taking any locks,
+// old snapshots are released once the last net viewing them has moved on to a newer one
+class cParamStore
+{
+public:
+	cParamStore();
+	virtual ~cParamStore();
+
+	virtual void Clear();
+
+	// builds a new snapshot only if the net's model version has changed since the last one
+	virtual std::shared_ptr<const tParamSnapshot> Publish(const cNeuralNet& net);
+	virtual std::shared_ptr<const tParamSnapshot> GetSnapshot() const;
+
+protected:
+	std::mutex mPublishLock;
+	std::shared_ptr<const tParamSnapshot> mSnapshot;
+};
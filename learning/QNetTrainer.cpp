@@ -150,6 +150,12 @@ bool cQNetTrainer::Step()
 	max_idx = i + 1;
 #endif // FREEZE_TARGET_NET
 
+	if (EnableParallelUpdate())
+	{
+		StepPool(i, max_idx);
+		return true;
+	}
+
 	for (i; i < max_idx; ++i)
 	{
 		printf("Update Net %i:\n", i);
@@ -193,87 +199,7 @@ int cQNetTrainer::GetRandRefID(int id) const
 	return rand_id;
 }
 
-int cQNetTrainer::CalcBufferSize() const
-{
-	return 1 + GetStateSize() * 2 + GetActionSize();
-}
-
-int cQNetTrainer::GetRewardIdx() const
-{
-	return 0;
-}
-
-int cQNetTrainer::GetStateBegIdx() const
-{
-	return 1;
-}
-
-int cQNetTrainer::GetStateEndIdx() const
-{
-	return 1 + GetStateSize() + GetActionSize();
-}
-
-int cQNetTrainer::GetActionIdx() const
-{
-	return 1 + GetStateSize();
-}
-
-void cQNetTrainer::SetTuple(int t, const tExpTuple& tuple)
-{
-	auto curr_row = mPlaybackMem.row(t);
-
-	curr_row(GetRewardIdx()) = static_cast<float>(tuple.mReward);
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		curr_row(state_beg_idx + j) = static_cast<float>(tuple.mStateBeg(j));
-		curr_row(state_end_idx + j) = static_cast<float>(tuple.mStateEnd(j));
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		curr_row(action_idx + j) = static_cast<float>(tuple.mAction(j));
-	}
-
-	mFlagBuffer[t] = tuple.mFlags;
-}
-
-tExpTuple cQNetTrainer::GetTuple(int t) const
+bool cQNetTrainer::StoreTupleStateEnd() const
 {
-	tExpTuple tuple;
-	auto curr_row = mPlaybackMem.row(t);
-
-	tuple.mID = t;
-	tuple.mReward = curr_row[GetRewardIdx()];
-
-	int state_size = GetStateSize();
-	int state_beg_idx = GetStateBegIdx();
-	int state_end_idx = GetStateEndIdx();
-	int action_idx = GetActionIdx();
-	int action_size = GetActionSize();
-
-	tuple.mStateBeg.resize(state_size);
-	tuple.mStateEnd.resize(state_size);
-	tuple.mAction.resize(action_size);
-
-	for (int j = 0; j < state_size; ++j)
-	{
-		tuple.mStateBeg(j) = curr_row(state_beg_idx + j);
-		tuple.mStateEnd(j) = curr_row(state_end_idx + j);
-	}
-
-	for (int j = 0; j < action_size; ++j)
-	{
-		tuple.mAction(j) = curr_row(action_idx + j);
-	}
-
-	tuple.mFlags = mFlagBuffer[t];
-
-	return tuple;
+	return true;
 }
\ No newline at end of file
@@ -32,13 +32,5 @@ protected:
 	virtual int GetNextActiveID() const;
 	virtual int GetRandRefID(int id) const;
 
-	virtual int CalcBufferSize() const;
-
-	virtual int GetRewardIdx() const;
-	virtual int GetStateBegIdx() const;
-	virtual int GetStateEndIdx() const;
-	virtual int GetActionIdx() const;
-
-	virtual void SetTuple(int t, const tExpTuple& tuple);
-	virtual tExpTuple GetTuple(int t) const;
+	virtual bool StoreTupleStateEnd() const;
 };
\ No newline at end of file
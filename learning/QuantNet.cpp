@@ -0,0 +1,1167 @@
+#include "QuantNet.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "util/FileUtil.h"
+
+#if defined(__AVXVNNI__) || (defined(__AVX512VNNI__) && defined(__AVX512VL__))
+#define QUANT_NET_VNNI
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define QUANT_NET_AVX2
+#include <immintrin.h>
+#endif
+
+const char gQuantModelMagic[] = "TRLQNET1";
+const int gQuantModelMagicLen = 8;
+const int gQuantModelVersion = 1;
+const int gQuantMaxVal = 127;
+
+// the int8 dot products run over blocks of this many values
+const int gQuantBlockSize = 32;
+
+// the vnni kernel multiplies unsigned inputs, so it sees the activations shifted by this much
+// and the dot products are corrected with the weight row sums
+#if defined(QUANT_NET_VNNI)
+const int32_t gQuantInputZeroPoint = 128;
+#else
+const int32_t gQuantInputZeroPoint = 0;
+#endif
+
+cQuantNet::tShape::tShape()
+{
+	mC = 0;
+	mH = 0;
+	mW = 0;
+}
+
+cQuantNet::tShape::tShape(int c, int h, int w)
+{
+	mC = c;
+	mH = h;
+	mW = w;
+}
+
+int cQuantNet::tShape::GetSize() const
+{
+	return mC * mH * mW;
+}
+
+int cQuantNet::tShape::GetDim(int axis) const
+{
+	// axes follow the backend's NCHW convention, the batch axis is implicit
+	int dim = 1;
+	switch (axis)
+	{
+	case 1:
+		dim = mC;
+		break;
+	case 2:
+		dim = mH;
+		break;
+	case 3:
+		dim = mW;
+		break;
+	default:
+		break;
+	}
+	return dim;
+}
+
+cQuantNet::tLayer::tLayer()
+{
+	mType = eLayerMax;
+	mName = "";
+	mAxis = 1;
+	mKernelH = 1;
+	mKernelW = 1;
+	mStrideH = 1;
+	mStrideW = 1;
+	mPadH = 0;
+	mPadW = 0;
+	mNegSlope = 0;
+	mNumOutput = 0;
+	mInputSize = 0;
+	mPaddedSize = 0;
+	mInputScale = 1;
+}
+
+bool cQuantNet::tLayer::HasWeights() const
+{
+	return mType == eLayerConv || mType == eLayerInnerProduct;
+}
+
+bool cQuantNet::IsQuantModelFile(const std::string& file)
+{
+	bool is_quant = false;
+	FILE* f = fopen(file.c_str(), "rb");
+	if (f != nullptr)
+	{
+		char magic[gQuantModelMagicLen];
+		size_t num_read = fread(magic, 1, gQuantModelMagicLen, f);
+		is_quant = (num_read == gQuantModelMagicLen)
+				&& (std::memcmp(magic, gQuantModelMagic, gQuantModelMagicLen) == 0);
+		fclose(f);
+	}
+	return is_quant;
+}
+
+cQuantNet::cQuantNet()
+{
+	Clear();
+}
+
+cQuantNet::~cQuantNet()
+{
+}
+
+void cQuantNet::Clear()
+{
+	mValid = false;
+	mInputBlob = gInvalidIdx;
+	mOutputBlob = gInvalidIdx;
+	mBlobShapes.clear();
+	mBlobLookup.clear();
+	mLayers.clear();
+
+	mInputOffset.resize(0);
+	mInputScale.resize(0);
+	mOutputOffset.resize(0);
+	mOutputScale.resize(0);
+
+	mBlobData.clear();
+	mQInput.clear();
+	mQCols.clear();
+}
+
+void cQuantNet::Init(int input_size)
+{
+	Clear();
+	mInputBlob = AddBlob("data", tShape(1, 1, input_size));
+}
+
+int cQuantNet::AddBlob(const std::string& name, const tShape& shape)
+{
+	int id = static_cast<int>(mBlobShapes.size());
+	mBlobShapes.push_back(shape);
+	mBlobLookup.push_back(std::pair<std::string, int>(name, id));
+	return id;
+}
+
+int cQuantNet::FindBlob(const std::string& name) const
+{
+	// searched from the back so in-place layers resolve to their latest output
+	for (int i = static_cast<int>(mBlobLookup.size()) - 1; i >= 0; --i)
+	{
+		if (mBlobLookup[i].first == name)
+		{
+			return mBlobLookup[i].second;
+		}
+	}
+	return gInvalidIdx;
+}
+
+bool cQuantNet::AddSlice(const std::string& name, const std::string& bottom, const std::vector<std::string>& tops,
+						int axis, const std::vector<int>& slice_points)
+{
+	tLayer layer;
+	layer.mType = eLayerSlice;
+	layer.mName = name;
+	layer.mAxis = axis;
+	layer.mSlicePoints = slice_points;
+
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(name, bottom, bottom_id);
+	if (succ)
+	{
+		tShape shape = mBlobShapes[bottom_id];
+		int axis_dim = shape.GetDim(axis);
+		int num_tops = static_cast<int>(tops.size());
+
+		std::vector<int> points = slice_points;
+		if (points.size() == 0)
+		{
+			for (int i = 1; i < num_tops; ++i)
+			{
+				points.push_back(i * axis_dim / num_tops);
+			}
+		}
+		points.insert(points.begin(), 0);
+		points.push_back(axis_dim);
+
+		if (static_cast<int>(points.size()) != num_tops + 1)
+		{
+			printf("Invalid slice points for layer %s\n", name.c_str());
+			succ = false;
+		}
+		else
+		{
+			layer.mSlicePoints = points;
+			layer.mBottoms.push_back(bottom_id);
+			for (int i = 0; i < num_tops; ++i)
+			{
+				tShape top_shape = shape;
+				int dim = points[i + 1] - points[i];
+				switch (axis)
+				{
+				case 1:
+					top_shape.mC = dim;
+					break;
+				case 2:
+					top_shape.mH = dim;
+					break;
+				default:
+					top_shape.mW = dim;
+					break;
+				}
+				layer.mTops.push_back(AddBlob(tops[i], top_shape));
+			}
+			mLayers.push_back(layer);
+		}
+	}
+	return succ;
+}
+
+bool cQuantNet::AddConv(const std::string& name, const std::string& bottom, const std::string& top,
+						const Eigen::MatrixXd& weights, const Eigen::VectorXd& bias,
+						int kernel_h, int kernel_w, int stride_h, int stride_w, int pad_h, int pad_w)
+{
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(name, bottom, bottom_id);
+	if (succ)
+	{
+		tShape shape = mBlobShapes[bottom_id];
+		int input_size = shape.mC * kernel_h * kernel_w;
+		if (weights.cols() != input_size)
+		{
+			printf("Invalid weight dimensions for layer %s, expecting %i columns but got %i\n",
+					name.c_str(), input_size, static_cast<int>(weights.cols()));
+			succ = false;
+		}
+		else
+		{
+			tLayer layer;
+			layer.mType = eLayerConv;
+			layer.mName = name;
+			layer.mKernelH = kernel_h;
+			layer.mKernelW = kernel_w;
+			layer.mStrideH = stride_h;
+			layer.mStrideW = stride_w;
+			layer.mPadH = pad_h;
+			layer.mPadW = pad_w;
+			layer.mNumOutput = static_cast<int>(weights.rows());
+			layer.mInputSize = input_size;
+			layer.mPaddedSize = CalcPaddedSize(input_size);
+			layer.mWeights = weights;
+			layer.mBias = (bias.size() > 0) ? bias : Eigen::VectorXd::Zero(layer.mNumOutput);
+
+			int out_h = (shape.mH + 2 * pad_h - kernel_h) / stride_h + 1;
+			int out_w = (shape.mW + 2 * pad_w - kernel_w) / stride_w + 1;
+			layer.mBottoms.push_back(bottom_id);
+			layer.mTops.push_back(AddBlob(top, tShape(layer.mNumOutput, out_h, out_w)));
+
+			QuantizeWeights(layer);
+			mLayers.push_back(layer);
+		}
+	}
+	return succ;
+}
+
+bool cQuantNet::AddInnerProduct(const std::string& name, const std::string& bottom, const std::string& top,
+						const Eigen::MatrixXd& weights, const Eigen::VectorXd& bias)
+{
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(name, bottom, bottom_id);
+	if (succ)
+	{
+		int input_size = mBlobShapes[bottom_id].GetSize();
+		if (weights.cols() != input_size)
+		{
+			printf("Invalid weight dimensions for layer %s, expecting %i columns but got %i\n",
+				name.c_str(), input_size, static_cast<int>(weights.cols()));
+			succ = false;
+		}
+		else
+		{
+			tLayer layer;
+			layer.mType = eLayerInnerProduct;
+			layer.mName = name;
+			layer.mNumOutput = static_cast<int>(weights.rows());
+			layer.mInputSize = input_size;
+			layer.mPaddedSize = CalcPaddedSize(input_size);
+			layer.mWeights = weights;
+			layer.mBias = (bias.size() > 0) ? bias : Eigen::VectorXd::Zero(layer.mNumOutput);
+
+			layer.mBottoms.push_back(bottom_id);
+			layer.mTops.push_back(AddBlob(top, tShape(layer.mNumOutput, 1, 1)));
+
+			QuantizeWeights(layer);
+			mLayers.push_back(layer);
+		}
+	}
+	return succ;
+}
+
+bool cQuantNet::AddReLU(const std::string& name, const std::string& bottom, const std::string& top, double neg_slope)
+{
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(name, bottom, bottom_id);
+	if (succ)
+	{
+		tLayer layer;
+		layer.mType = eLayerReLU;
+		layer.mName = name;
+		layer.mNegSlope = neg_slope;
+		layer.mBottoms.push_back(bottom_id);
+
+		tShape shape = mBlobShapes[bottom_id];
+		layer.mTops.push_back(AddBlob(top, shape));
+		mLayers.push_back(layer);
+	}
+	return succ;
+}
+
+bool cQuantNet::AddFlatten(const std::string& name, const std::string& bottom, const std::string& top)
+{
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(name, bottom, bottom_id);
+	if (succ)
+	{
+		tLayer layer;
+		layer.mType = eLayerFlatten;
+		layer.mName = name;
+		layer.mBottoms.push_back(bottom_id);
+
+		int size = mBlobShapes[bottom_id].GetSize();
+		layer.mTops.push_back(AddBlob(top, tShape(size, 1, 1)));
+		mLayers.push_back(layer);
+	}
+	return succ;
+}
+
+bool cQuantNet::AddConcat(const std::string& name, const std::vector<std::string>& bottoms, const std::string& top, int axis)
+{
+	tLayer layer;
+	layer.mType = eLayerConcat;
+	layer.mName = name;
+	layer.mAxis = axis;
+
+	bool succ = bottoms.size() > 0;
+	tShape top_shape;
+	for (size_t i = 0; i < bottoms.size() && succ; ++i)
+	{
+		int bottom_id = gInvalidIdx;
+		succ &= CheckBottom(name, bottoms[i], bottom_id);
+		if (succ)
+		{
+			const tShape& shape = mBlobShapes[bottom_id];
+			if (i == 0)
+			{
+				top_shape = shape;
+			}
+			else
+			{
+				switch (axis)
+				{
+				case 1:
+					succ &= (shape.mH == top_shape.mH) && (shape.mW == top_shape.mW);
+					top_shape.mC += shape.mC;
+					break;
+				case 2:
+					succ &= (shape.mC == top_shape.mC) && (shape.mW == top_shape.mW);
+					top_shape.mH += shape.mH;
+					break;
+				default:
+					succ &= (shape.mC == top_shape.mC) && (shape.mH == top_shape.mH);
+					top_shape.mW += shape.mW;
+					break;
+				}
+			}
+			layer.mBottoms.push_back(bottom_id);
+		}
+	}
+
+	if (succ)
+	{
+		layer.mTops.push_back(AddBlob(top, top_shape));
+		mLayers.push_back(layer);
+	}
+	else
+	{
+		printf("Invalid inputs for concat layer %s\n", name.c_str());
+	}
+	return succ;
+}
+
+bool cQuantNet::AddIdentity(const std::string& bottom, const std::string& top)
+{
+	int bottom_id = gInvalidIdx;
+	bool succ = CheckBottom(top, bottom, bottom_id);
+	if (succ)
+	{
+		mBlobLookup.push_back(std::pair<std::string, int>(top, bottom_id));
+	}
+	return succ;
+}
+
+bool cQuantNet::Finalize()
+{
+	// the output is the last blob that is not consumed by any layer
+	int num_blobs = static_cast<int>(mBlobShapes.size());
+	std::vector<bool> consumed(num_blobs, false);
+	for (size_t l = 0; l < mLayers.size(); ++l)
+	{
+		const tLayer& layer = mLayers[l];
+		for (size_t i = 0; i < layer.mBottoms.size(); ++i)
+		{
+			consumed[layer.mBottoms[i]] = true;
+		}
+	}
+
+	mOutputBlob = gInvalidIdx;
+	for (int b = num_blobs - 1; b >= 0; --b)
+	{
+		if (!consumed[b])
+		{
+			mOutputBlob = b;
+			break;
+		}
+	}
+
+	mValid = (mLayers.size() > 0) && (mOutputBlob != gInvalidIdx) && (mOutputBlob != mInputBlob);
+	if (mValid)
+	{
+		mBlobData.resize(num_blobs);
+		for (int b = 0; b < num_blobs; ++b)
+		{
+			mBlobData[b].resize(mBlobShapes[b].GetSize());
+		}
+	}
+	else
+	{
+		printf("Failed to find output for quantized net\n");
+	}
+
+	return mValid;
+}
+
+void cQuantNet::SetInputOffsetScale(const Eigen::VectorXd& offset, const Eigen::VectorXd& scale)
+{
+	mInputOffset = offset;
+	mInputScale = scale;
+}
+
+void cQuantNet::SetOutputOffsetScale(const Eigen::VectorXd& offset, const Eigen::VectorXd& scale)
+{
+	mOutputOffset = offset;
+	mOutputScale = scale;
+}
+
+void cQuantNet::Calibrate(const Eigen::MatrixXd& X)
+{
+	assert(IsValid());
+	assert(HasFloatWeights());
+
+	int num_layers = GetNumLayers();
+	std::vector<double> max_abs(num_layers, 0);
+
+	Eigen::VectorXd y;
+	for (int i = 0; i < X.rows(); ++i)
+	{
+		Eigen::VectorXd x = X.row(i).transpose();
+		Forward(x, false, y, &max_abs);
+	}
+
+	for (int l = 0; l < num_layers; ++l)
+	{
+		tLayer& layer = mLayers[l];
+		if (layer.HasWeights())
+		{
+			double val = max_abs[l];
+			layer.mInputScale = (val > 0) ? val / gQuantMaxVal : 1;
+		}
+	}
+}
+
+void cQuantNet::Eval(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const
+{
+	Forward(x, true, out_y, nullptr);
+}
+
+void cQuantNet::EvalFloat(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const
+{
+	assert(HasFloatWeights());
+	Forward(x, false, out_y, nullptr);
+}
+
+bool cQuantNet::LoadModel(const std::string& model_file)
+{
+	Clear();
+
+	FILE* f = cFileUtil::OpenFile(model_file, "rb");
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	auto read_int = [f](int& out_val)
+	{
+		int32_t val = 0;
+		bool succ = fread(&val, sizeof(val), 1, f) == 1;
+		out_val = static_cast<int>(val);
+		return succ;
+	};
+
+	auto read_ints = [f, &read_int](std::vector<int>& out_vals)
+	{
+		int n = 0;
+		bool succ = read_int(n) && n >= 0;
+		out_vals.resize(succ ? n : 0);
+		for (int i = 0; i < n && succ; ++i)
+		{
+			succ &= read_int(out_vals[i]);
+		}
+		return succ;
+	};
+
+	auto read_vec = [f, &read_int](Eigen::VectorXd& out_vec)
+	{
+		int n = 0;
+		bool succ = read_int(n) && n >= 0;
+		out_vec.resize(succ ? n : 0);
+		if (succ && n > 0)
+		{
+			succ &= fread(out_vec.data(), sizeof(double), n, f) == static_cast<size_t>(n);
+		}
+		return succ;
+	};
+
+	char magic[gQuantModelMagicLen];
+	bool succ = fread(magic, 1, gQuantModelMagicLen, f) == gQuantModelMagicLen
+				&& std::memcmp(magic, gQuantModelMagic, gQuantModelMagicLen) == 0;
+
+	int version = 0;
+	succ = succ && read_int(version);
+	if (succ && version != gQuantModelVersion)
+	{
+		printf("Unsupported quantized model version %i\n", version);
+		succ = false;
+	}
+
+	int num_blobs = 0;
+	succ = succ && read_int(mInputBlob) && read_int(mOutputBlob) && read_int(num_blobs);
+	for (int b = 0; b < num_blobs && succ; ++b)
+	{
+		tShape shape;
+		succ &= read_int(shape.mC) && read_int(shape.mH) && read_int(shape.mW);
+		mBlobShapes.push_back(shape);
+	}
+
+	succ = succ && read_vec(mInputOffset) && read_vec(mInputScale)
+				&& read_vec(mOutputOffset) && read_vec(mOutputScale);
+
+	int num_layers = 0;
+	succ = succ && read_int(num_layers);
+	for (int l = 0; l < num_layers && succ; ++l)
+	{
+		tLayer layer;
+		int type = 0;
+		succ &= read_int(type) && type >= 0 && type < eLayerMax;
+		layer.mType = static_cast<eLayer>(type);
+
+		std::vector<int> params;
+		succ &= read_ints(layer.mBottoms) && read_ints(layer.mTops)
+				&& read_ints(layer.mSlicePoints) && read_ints(params);
+		succ &= params.size() == 10;
+		if (succ)
+		{
+			layer.mAxis = params[0];
+			layer.mKernelH = params[1];
+			layer.mKernelW = params[2];
+			layer.mStrideH = params[3];
+			layer.mStrideW = params[4];
+			layer.mPadH = params[5];
+			layer.mPadW = params[6];
+			layer.mNumOutput = params[7];
+			layer.mInputSize = params[8];
+			layer.mPaddedSize = params[9];
+		}
+
+		succ &= fread(&layer.mNegSlope, sizeof(double), 1, f) == 1;
+		succ &= fread(&layer.mInputScale, sizeof(double), 1, f) == 1;
+
+		for (size_t i = 0; i < layer.mBottoms.size() && succ; ++i)
+		{
+			succ &= layer.mBottoms[i] >= 0 && layer.mBottoms[i] < num_blobs;
+		}
+		for (size_t i = 0; i < layer.mTops.size() && succ; ++i)
+		{
+			succ &= layer.mTops[i] >= 0 && layer.mTops[i] < num_blobs;
+		}
+
+		if (succ && layer.HasWeights())
+		{
+			succ &= read_vec(layer.mWeightScales) && read_vec(layer.mBias);
+			succ &= layer.mWeightScales.size() == layer.mNumOutput
+					&& layer.mBias.size() == layer.mNumOutput
+					&& layer.mPaddedSize == CalcPaddedSize(layer.mInputSize);
+			if (succ)
+			{
+				size_t num_weights = static_cast<size_t>(layer.mNumOutput) * layer.mPaddedSize;
+				layer.mQWeights.resize(num_weights);
+				succ &= fread(layer.mQWeights.data(), sizeof(int8_t), num_weights, f) == num_weights;
+				CalcRowSums(layer);
+			}
+		}
+		mLayers.push_back(layer);
+	}
+
+	cFileUtil::CloseFile(f);
+
+	if (succ)
+	{
+		for (int b = 0; b < num_blobs; ++b)
+		{
+			mBlobLookup.push_back(std::pair<std::string, int>("", b));
+		}
+		succ = Finalize();
+	}
+
+	if (!succ)
+	{
+		printf("Failed to load quantized model from %s\n", model_file.c_str());
+		Clear();
+	}
+
+	return succ;
+}
+
+bool cQuantNet::OutputModel(const std::string& out_file) const
+{
+	FILE* f = cFileUtil::OpenFile(out_file, "wb");
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	auto write_int = [f](int val)
+	{
+		int32_t data = static_cast<int32_t>(val);
+		fwrite(&data, sizeof(data), 1, f);
+	};
+
+	auto write_ints = [f, &write_int](const std::vector<int>& vals)
+	{
+		write_int(static_cast<int>(vals.size()));
+		for (size_t i = 0; i < vals.size(); ++i)
+		{
+			write_int(vals[i]);
+		}
+	};
+
+	auto write_vec = [f, &write_int](const Eigen::VectorXd& vec)
+	{
+		write_int(static_cast<int>(vec.size()));
+		fwrite(vec.data(), sizeof(double), vec.size(), f);
+	};
+
+	fwrite(gQuantModelMagic, 1, gQuantModelMagicLen, f);
+	write_int(gQuantModelVersion);
+
+	int num_blobs = static_cast<int>(mBlobShapes.size());
+	write_int(mInputBlob);
+	write_int(mOutputBlob);
+	write_int(num_blobs);
+	for (int b = 0; b < num_blobs; ++b)
+	{
+		const tShape& shape = mBlobShapes[b];
+		write_int(shape.mC);
+		write_int(shape.mH);
+		write_int(shape.mW);
+	}
+
+	write_vec(mInputOffset);
+	write_vec(mInputScale);
+	write_vec(mOutputOffset);
+	write_vec(mOutputScale);
+
+	write_int(GetNumLayers());
+	for (int l = 0; l < GetNumLayers(); ++l)
+	{
+		const tLayer& layer = mLayers[l];
+		write_int(layer.mType);
+		write_ints(layer.mBottoms);
+		write_ints(layer.mTops);
+		write_ints(layer.mSlicePoints);
+
+		std::vector<int> params = { layer.mAxis, layer.mKernelH, layer.mKernelW,
+									layer.mStrideH, layer.mStrideW, layer.mPadH, layer.mPadW,
+									layer.mNumOutput, layer.mInputSize, layer.mPaddedSize };
+		write_ints(params);
+		fwrite(&layer.mNegSlope, sizeof(double), 1, f);
+		fwrite(&layer.mInputScale, sizeof(double), 1, f);
+
+		if (layer.HasWeights())
+		{
+			write_vec(layer.mWeightScales);
+			write_vec(layer.mBias);
+			fwrite(layer.mQWeights.data(), sizeof(int8_t), layer.mQWeights.size(), f);
+		}
+	}
+
+	bool succ = ferror(f) == 0;
+	cFileUtil::CloseFile(f);
+
+	if (!succ)
+	{
+		printf("Failed to write quantized model to %s\n", out_file.c_str());
+	}
+	return succ;
+}
+
+bool cQuantNet::IsValid() const
+{
+	return mValid;
+}
+
+bool cQuantNet::HasFloatWeights() const
+{
+	for (size_t l = 0; l < mLayers.size(); ++l)
+	{
+		const tLayer& layer = mLayers[l];
+		if (layer.HasWeights() && layer.mWeights.size() == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int cQuantNet::GetInputSize() const
+{
+	return (mInputBlob != gInvalidIdx) ? mBlobShapes[mInputBlob].GetSize() : 0;
+}
+
+int cQuantNet::GetOutputSize() const
+{
+	return (mOutputBlob != gInvalidIdx) ? mBlobShapes[mOutputBlob].GetSize() : 0;
+}
+
+int cQuantNet::GetNumLayers() const
+{
+	return static_cast<int>(mLayers.size());
+}
+
+const cQuantNet::tLayer& cQuantNet::GetLayer(int l) const
+{
+	return mLayers[l];
+}
+
+int cQuantNet::CalcPaddedSize(int size)
+{
+	return ((size + gQuantBlockSize - 1) / gQuantBlockSize) * gQuantBlockSize;
+}
+
+void cQuantNet::QuantizeWeights(tLayer& out_layer)
+{
+	int num_output = out_layer.mNumOutput;
+	int input_size = out_layer.mInputSize;
+	int padded_size = out_layer.mPaddedSize;
+	const Eigen::MatrixXd& weights = out_layer.mWeights;
+
+	out_layer.mWeightScales.resize(num_output);
+	out_layer.mQWeights.assign(static_cast<size_t>(num_output) * padded_size, 0);
+
+	for (int o = 0; o < num_output; ++o)
+	{
+		double max_abs = weights.row(o).cwiseAbs().maxCoeff();
+		double scale = (max_abs > 0) ? max_abs / gQuantMaxVal : 1;
+		out_layer.mWeightScales[o] = scale;
+
+		int8_t* row = out_layer.mQWeights.data() + static_cast<size_t>(o) * padded_size;
+		for (int i = 0; i < input_size; ++i)
+		{
+			double val = std::round(weights(o, i) / scale);
+			val = cMathUtil::Clamp(val, static_cast<double>(-gQuantMaxVal), static_cast<double>(gQuantMaxVal));
+			row[i] = static_cast<int8_t>(val);
+		}
+	}
+
+	CalcRowSums(out_layer);
+}
+
+void cQuantNet::CalcRowSums(tLayer& out_layer)
+{
+	// used to remove gQuantInputZeroPoint from the dot products
+	int num_output = out_layer.mNumOutput;
+	int padded_size = out_layer.mPaddedSize;
+	out_layer.mRowSums.resize(num_output);
+
+	for (int o = 0; o < num_output; ++o)
+	{
+		const int8_t* row = out_layer.mQWeights.data() + static_cast<size_t>(o) * padded_size;
+		int32_t sum = 0;
+		for (int i = 0; i < padded_size; ++i)
+		{
+			sum += row[i];
+		}
+		out_layer.mRowSums[o] = sum;
+	}
+}
+
+int32_t cQuantNet::DotInt8(const int8_t* a, const int8_t* b, int size)
+{
+	// a is the activation, b the weights, size is a multiple of gQuantBlockSize,
+	// the result still includes gQuantInputZeroPoint * sum(b)
+	int32_t result = 0;
+
+#if defined(QUANT_NET_VNNI)
+	const __m256i offset = _mm256_set1_epi8(static_cast<char>(0x80));
+	__m256i acc = _mm256_setzero_si256();
+	for (int i = 0; i < size; i += gQuantBlockSize)
+	{
+		__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		va = _mm256_xor_si256(va, offset);
+#if defined(__AVXVNNI__)
+		acc = _mm256_dpbusd_avx_epi32(acc, va, vb);
+#else
+		acc = _mm256_dpbusd_epi32(acc, va, vb);
+#endif
+	}
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_hadd_epi32(sum, sum);
+	sum = _mm_hadd_epi32(sum, sum);
+	result = _mm_cvtsi128_si32(sum);
+
+#elif defined(QUANT_NET_AVX2)
+	__m256i acc = _mm256_setzero_si256();
+	for (int i = 0; i < size; i += gQuantBlockSize)
+	{
+		__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		__m256i va_lo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(va));
+		__m256i va_hi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(va, 1));
+		__m256i vb_lo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(vb));
+		__m256i vb_hi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(vb, 1));
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va_lo, vb_lo));
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va_hi, vb_hi));
+	}
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_hadd_epi32(sum, sum);
+	sum = _mm_hadd_epi32(sum, sum);
+	result = _mm_cvtsi128_si32(sum);
+
+#else
+	for (int i = 0; i < size; ++i)
+	{
+		result += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+	}
+#endif
+
+	return result;
+}
+
+bool cQuantNet::CheckBottom(const std::string& layer_name, const std::string& bottom, int& out_id) const
+{
+	out_id = FindBlob(bottom);
+	bool succ = out_id != gInvalidIdx;
+	if (!succ)
+	{
+		printf("Failed to find input %s for layer %s\n", bottom.c_str(), layer_name.c_str());
+	}
+	return succ;
+}
+
+void cQuantNet::Forward(const Eigen::VectorXd& x, bool quantized, Eigen::VectorXd& out_y, std::vector<double>* out_calib) const
+{
+	assert(IsValid());
+	assert(x.size() == GetInputSize());
+
+	Eigen::VectorXd& input = mBlobData[mInputBlob];
+	input = x;
+	NormalizeInput(input);
+
+	int num_layers = GetNumLayers();
+	for (int l = 0; l < num_layers; ++l)
+	{
+		const tLayer& layer = mLayers[l];
+		if (out_calib != nullptr && layer.HasWeights())
+		{
+			const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+			double& max_abs = (*out_calib)[l];
+			max_abs = std::max(max_abs, bottom.cwiseAbs().maxCoeff());
+		}
+
+		switch (layer.mType)
+		{
+		case eLayerSlice:
+			ForwardSlice(layer);
+			break;
+		case eLayerConv:
+			if (quantized)
+			{
+				ForwardConvQuant(layer);
+			}
+			else
+			{
+				ForwardConvFloat(layer);
+			}
+			break;
+		case eLayerInnerProduct:
+			if (quantized)
+			{
+				ForwardInnerProductQuant(layer);
+			}
+			else
+			{
+				ForwardInnerProductFloat(layer);
+			}
+			break;
+		case eLayerReLU:
+			ForwardReLU(layer);
+			break;
+		case eLayerFlatten:
+			mBlobData[layer.mTops[0]] = mBlobData[layer.mBottoms[0]];
+			break;
+		case eLayerConcat:
+			ForwardConcat(layer);
+			break;
+		default:
+			assert(false); // unsupported layer
+			break;
+		}
+	}
+
+	out_y = mBlobData[mOutputBlob];
+	UnnormalizeOutput(out_y);
+}
+
+void cQuantNet::ForwardSlice(const tLayer& layer) const
+{
+	// blobs are stored as C x H x W, so a slice copies num_outer chunks per top
+	const tShape& shape = mBlobShapes[layer.mBottoms[0]];
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+
+	int axis_dim = shape.GetDim(layer.mAxis);
+	int num_outer = 1;
+	int inner_size = 1;
+	for (int a = 1; a < layer.mAxis; ++a)
+	{
+		num_outer *= shape.GetDim(a);
+	}
+	for (int a = layer.mAxis + 1; a <= 3; ++a)
+	{
+		inner_size *= shape.GetDim(a);
+	}
+
+	for (size_t t = 0; t < layer.mTops.size(); ++t)
+	{
+		Eigen::VectorXd& top = mBlobData[layer.mTops[t]];
+		int beg = layer.mSlicePoints[t];
+		int len = (layer.mSlicePoints[t + 1] - beg) * inner_size;
+
+		for (int n = 0; n < num_outer; ++n)
+		{
+			top.segment(n * len, len) = bottom.segment((n * axis_dim + beg) * inner_size, len);
+		}
+	}
+}
+
+void cQuantNet::ForwardConcat(const tLayer& layer) const
+{
+	const tShape& top_shape = mBlobShapes[layer.mTops[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+
+	int top_axis_dim = top_shape.GetDim(layer.mAxis);
+	int num_outer = 1;
+	int inner_size = 1;
+	for (int a = 1; a < layer.mAxis; ++a)
+	{
+		num_outer *= top_shape.GetDim(a);
+	}
+	for (int a = layer.mAxis + 1; a <= 3; ++a)
+	{
+		inner_size *= top_shape.GetDim(a);
+	}
+
+	int offset = 0;
+	for (size_t b = 0; b < layer.mBottoms.size(); ++b)
+	{
+		const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[b]];
+		int axis_dim = mBlobShapes[layer.mBottoms[b]].GetDim(layer.mAxis);
+		int len = axis_dim * inner_size;
+
+		for (int n = 0; n < num_outer; ++n)
+		{
+			top.segment((n * top_axis_dim + offset) * inner_size, len) = bottom.segment(n * len, len);
+		}
+		offset += axis_dim;
+	}
+}
+
+void cQuantNet::ForwardReLU(const tLayer& layer) const
+{
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+	if (layer.mNegSlope == 0)
+	{
+		top = bottom.cwiseMax(0);
+	}
+	else
+	{
+		top = bottom.cwiseMax(0) + layer.mNegSlope * bottom.cwiseMin(0);
+	}
+}
+
+void cQuantNet::ForwardConvFloat(const tLayer& layer) const
+{
+	const tShape& in_shape = mBlobShapes[layer.mBottoms[0]];
+	const tShape& out_shape = mBlobShapes[layer.mTops[0]];
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+
+	int num_pos = out_shape.mH * out_shape.mW;
+	Eigen::VectorXd col(layer.mInputSize);
+
+	for (int oy = 0; oy < out_shape.mH; ++oy)
+	{
+		for (int ox = 0; ox < out_shape.mW; ++ox)
+		{
+			int idx = 0;
+			for (int c = 0; c < in_shape.mC; ++c)
+			{
+				for (int ky = 0; ky < layer.mKernelH; ++ky)
+				{
+					int iy = oy * layer.mStrideH - layer.mPadH + ky;
+					for (int kx = 0; kx < layer.mKernelW; ++kx)
+					{
+						int ix = ox * layer.mStrideW - layer.mPadW + kx;
+						bool valid = iy >= 0 && iy < in_shape.mH && ix >= 0 && ix < in_shape.mW;
+						col[idx++] = (valid) ? bottom[(c * in_shape.mH + iy) * in_shape.mW + ix] : 0;
+					}
+				}
+			}
+
+			int pos = oy * out_shape.mW + ox;
+			for (int o = 0; o < layer.mNumOutput; ++o)
+			{
+				top[o * num_pos + pos] = layer.mWeights.row(o).dot(col) + layer.mBias[o];
+			}
+		}
+	}
+}
+
+void cQuantNet::ForwardConvQuant(const tLayer& layer) const
+{
+	const tShape& in_shape = mBlobShapes[layer.mBottoms[0]];
+	const tShape& out_shape = mBlobShapes[layer.mTops[0]];
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+
+	QuantizeInput(bottom, layer.mInputScale, 0, mQInput);
+
+	// im2col into rows of padded_size so each output is a single int8 dot product,
+	// zero padding is exact since the activations are quantized symmetrically
+	int num_pos = out_shape.mH * out_shape.mW;
+	int padded_size = layer.mPaddedSize;
+	mQCols.assign(static_cast<size_t>(num_pos) * padded_size, 0);
+
+	for (int oy = 0; oy < out_shape.mH; ++oy)
+	{
+		for (int ox = 0; ox < out_shape.mW; ++ox)
+		{
+			int pos = oy * out_shape.mW + ox;
+			int8_t* col = mQCols.data() + static_cast<size_t>(pos) * padded_size;
+			int idx = 0;
+			for (int c = 0; c < in_shape.mC; ++c)
+			{
+				for (int ky = 0; ky < layer.mKernelH; ++ky)
+				{
+					int iy = oy * layer.mStrideH - layer.mPadH + ky;
+					for (int kx = 0; kx < layer.mKernelW; ++kx)
+					{
+						int ix = ox * layer.mStrideW - layer.mPadW + kx;
+						bool valid = iy >= 0 && iy < in_shape.mH && ix >= 0 && ix < in_shape.mW;
+						col[idx++] = (valid) ? mQInput[(c * in_shape.mH + iy) * in_shape.mW + ix] : 0;
+					}
+				}
+			}
+		}
+	}
+
+	for (int o = 0; o < layer.mNumOutput; ++o)
+	{
+		const int8_t* w = layer.mQWeights.data() + static_cast<size_t>(o) * padded_size;
+		double scale = layer.mWeightScales[o] * layer.mInputScale;
+		double bias = layer.mBias[o];
+		int32_t row_sum = layer.mRowSums[o];
+
+		for (int pos = 0; pos < num_pos; ++pos)
+		{
+			const int8_t* col = mQCols.data() + static_cast<size_t>(pos) * padded_size;
+			int32_t acc = DotInt8(col, w, padded_size) - gQuantInputZeroPoint * row_sum;
+			top[o * num_pos + pos] = acc * scale + bias;
+		}
+	}
+}
+
+void cQuantNet::ForwardInnerProductFloat(const tLayer& layer) const
+{
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+	top.noalias() = layer.mWeights * bottom;
+	top += layer.mBias;
+}
+
+void cQuantNet::ForwardInnerProductQuant(const tLayer& layer) const
+{
+	const Eigen::VectorXd& bottom = mBlobData[layer.mBottoms[0]];
+	Eigen::VectorXd& top = mBlobData[layer.mTops[0]];
+	int padded_size = layer.mPaddedSize;
+
+	QuantizeInput(bottom, layer.mInputScale, padded_size, mQInput);
+
+	for (int o = 0; o < layer.mNumOutput; ++o)
+	{
+		const int8_t* w = layer.mQWeights.data() + static_cast<size_t>(o) * padded_size;
+		int32_t acc = DotInt8(mQInput.data(), w, padded_size) - gQuantInputZeroPoint * layer.mRowSums[o];
+		top[o] = acc * (layer.mWeightScales[o] * layer.mInputScale) + layer.mBias[o];
+	}
+}
+
+void cQuantNet::QuantizeInput(const Eigen::VectorXd& data, double scale, int padded_size, std::vector<int8_t>& out_data) const
+{
+	int size = static_cast<int>(data.size());
+	out_data.assign(std::max(size, padded_size), 0);
+
+	double inv_scale = 1 / scale;
+	for (int i = 0; i < size; ++i)
+	{
+		double val = std::round(data[i] * inv_scale);
+		val = std::min(std::max(val, static_cast<double>(-gQuantMaxVal)), static_cast<double>(gQuantMaxVal));
+		out_data[i] = static_cast<int8_t>(val);
+	}
+}
+
+void cQuantNet::NormalizeInput(Eigen::VectorXd& x) const
+{
+	if (mInputOffset.size() > 0 && mInputScale.size() > 0)
+	{
+		assert(x.size() == mInputOffset.size());
+		assert(x.size() == mInputScale.size());
+		x += mInputOffset;
+		x = x.cwiseProduct(mInputScale);
+	}
+}
+
+void cQuantNet::UnnormalizeOutput(Eigen::VectorXd& y) const
+{
+	if (mOutputOffset.size() > 0 && mOutputScale.size() > 0)
+	{
+		assert(y.size() == mOutputOffset.size());
+		assert(y.size() == mOutputScale.size());
+		y = y.cwiseQuotient(mOutputScale);
+		y -= mOutputOffset;
+	}
+}
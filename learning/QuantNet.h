@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "util/MathUtil.h"
+
+// inference-only net with int8 weights and activations for frozen policies,
+// the graph mirrors the deploy nets (slice, conv, inner product, relu, flatten, concat)
+// weights are quantized per output channel and the inputs of each conv and
+// inner product layer use a per-tensor scale calibrated from recorded states
+class cQuantNet
+{
+public:
+	enum eLayer
+	{
+		eLayerSlice,
+		eLayerConv,
+		eLayerInnerProduct,
+		eLayerReLU,
+		eLayerFlatten,
+		eLayerConcat,
+		eLayerMax
+	};
+
+	struct tShape
+	{
+		int mC;
+		int mH;
+		int mW;
+
+		tShape();
+		tShape(int c, int h, int w);
+		int GetSize() const;
+		int GetDim(int axis) const;
+	};
+
+	struct tLayer
+	{
+		tLayer();
+
+		eLayer mType;
+		std::string mName;
+		std::vector<int> mBottoms;
+		std::vector<int> mTops;
+
+		int mAxis;
+		std::vector<int> mSlicePoints;
+		int mKernelH;
+		int mKernelW;
+		int mStrideH;
+		int mStrideW;
+		int mPadH;
+		int mPadW;
+		double mNegSlope;
+
+		int mNumOutput;
+		int mInputSize;
+		int mPaddedSize;
+
+		// float weights are only kept while building, a loaded model only has the int8 weights
+		Eigen::MatrixXd mWeights;
+		Eigen::VectorXd mBias;
+
+		std::vector<int8_t> mQWeights;
+		std::vector<int32_t> mRowSums;
+		Eigen::VectorXd mWeightScales;
+		double mInputScale;
+
+		bool HasWeights() const;
+	};
+
+	static bool IsQuantModelFile(const std::string& file);
+
+	cQuantNet();
+	virtual ~cQuantNet();
+
+	virtual void Clear();
+	virtual void Init(int input_size);
+
+	virtual int AddBlob(const std::string& name, const tShape& shape);
+	virtual int FindBlob(const std::string& name) const;
+	virtual bool AddSlice(const std::string& name, const std::string& bottom, const std::vector<std::string>& tops,
+						int axis, const std::vector<int>& slice_points);
+	virtual bool AddConv(const std::string& name, const std::string& bottom, const std::string& top,
+						const Eigen::MatrixXd& weights, const Eigen::VectorXd& bias,
+						int kernel_h, int kernel_w, int stride_h, int stride_w, int pad_h, int pad_w);
+	virtual bool AddInnerProduct(const std::string& name, const std::string& bottom, const std::string& top,
+						const Eigen::MatrixXd& weights, const Eigen::VectorXd& bias);
+	virtual bool AddReLU(const std::string& name, const std::string& bottom, const std::string& top, double neg_slope);
+	virtual bool AddFlatten(const std::string& name, const std::string& bottom, const std::string& top);
+	virtual bool AddConcat(const std::string& name, const std::vector<std::string>& bottoms, const std::string& top, int axis);
+	virtual bool AddIdentity(const std::string& bottom, const std::string& top);
+	virtual bool Finalize();
+
+	virtual void SetInputOffsetScale(const Eigen::VectorXd& offset, const Eigen::VectorXd& scale);
+	virtual void SetOutputOffsetScale(const Eigen::VectorXd& offset, const Eigen::VectorXd& scale);
+
+	// X stores one recorded state per row
+	virtual void Calibrate(const Eigen::MatrixXd& X);
+
+	virtual void Eval(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const;
+	virtual void EvalFloat(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const;
+
+	virtual bool LoadModel(const std::string& model_file);
+	virtual bool OutputModel(const std::string& out_file) const;
+
+	virtual bool IsValid() const;
+	virtual bool HasFloatWeights() const;
+	virtual int GetInputSize() const;
+	virtual int GetOutputSize() const;
+	virtual int GetNumLayers() const;
+	virtual const tLayer& GetLayer(int l) const;
+
+protected:
+	bool mValid;
+	int mInputBlob;
+	int mOutputBlob;
+	std::vector<tShape> mBlobShapes;
+	std::vector<std::pair<std::string, int>> mBlobLookup;
+	std::vector<tLayer> mLayers;
+
+	Eigen::VectorXd mInputOffset;
+	Eigen::VectorXd mInputScale;
+	Eigen::VectorXd mOutputOffset;
+	Eigen::VectorXd mOutputScale;
+
+	mutable std::vector<Eigen::VectorXd> mBlobData;
+	mutable std::vector<int8_t> mQInput;
+	mutable std::vector<int8_t> mQCols;
+
+	static int CalcPaddedSize(int size);
+	static void QuantizeWeights(tLayer& out_layer);
+	static void CalcRowSums(tLayer& out_layer);
+	static int32_t DotInt8(const int8_t* a, const int8_t* b, int size);
+
+	virtual bool CheckBottom(const std::string& layer_name, const std::string& bottom, int& out_id) const;
+
+	// when out_calib is provided the max abs input of each weighted layer is accumulated into it
+	virtual void Forward(const Eigen::VectorXd& x, bool quantized, Eigen::VectorXd& out_y, std::vector<double>* out_calib) const;
+	virtual void ForwardSlice(const tLayer& layer) const;
+	virtual void ForwardConcat(const tLayer& layer) const;
+	virtual void ForwardReLU(const tLayer& layer) const;
+	virtual void ForwardConvFloat(const tLayer& layer) const;
+	virtual void ForwardConvQuant(const tLayer& layer) const;
+	virtual void ForwardInnerProductFloat(const tLayer& layer) const;
+	virtual void ForwardInnerProductQuant(const tLayer& layer) const;
+	virtual void QuantizeInput(const Eigen::VectorXd& data, double scale, int padded_size, std::vector<int8_t>& out_data) const;
+
+	virtual void NormalizeInput(Eigen::VectorXd& x) const;
+	virtual void UnnormalizeOutput(Eigen::VectorXd& y) const;
+};
@@ -0,0 +1,421 @@
+#include "ReplayMem.h"
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__F16C__) && defined(__AVX__)
+#define REPLAY_MEM_F16C
+#include <immintrin.h>
+#endif
+
+cReplayMem::tParams::tParams()
+{
+	mCapacity = 0;
+	mStateSize = 0;
+	mActionSize = 0;
+	mStoreStateEnd = true;
+	mHalfOffset = 0;
+	mHalfSize = 0;
+}
+
+cReplayMem::tEntry::tEntry()
+{
+	mReward = 0;
+	mFlags = 0;
+	mEndIdx = eEndLinkNone;
+}
+
+void cReplayMem::EncodeHalf(const double* vals, int num_vals, uint16_t* out_vals)
+{
+	int i = 0;
+#if defined(REPLAY_MEM_F16C)
+	for (; i + 8 <= num_vals; i += 8)
+	{
+		__m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(vals + i));
+		__m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(vals + i + 4));
+		__m256 curr_vals = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+		__m128i curr_half = _mm256_cvtps_ph(curr_vals, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out_vals + i), curr_half);
+	}
+#endif
+	for (; i < num_vals; ++i)
+	{
+		out_vals[i] = FloatToHalf(static_cast<float>(vals[i]));
+	}
+}
+
+void cReplayMem::DecodeHalf(const uint16_t* vals, int num_vals, double* out_vals)
+{
+	int i = 0;
+#if defined(REPLAY_MEM_F16C)
+	for (; i + 8 <= num_vals; i += 8)
+	{
+		__m128i curr_half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals + i));
+		__m256 curr_vals = _mm256_cvtph_ps(curr_half);
+		_mm256_storeu_pd(out_vals + i, _mm256_cvtps_pd(_mm256_castps256_ps128(curr_vals)));
+		_mm256_storeu_pd(out_vals + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(curr_vals, 1)));
+	}
+#endif
+	for (; i < num_vals; ++i)
+	{
+		out_vals[i] = HalfToFloat(vals[i]);
+	}
+}
+
+cReplayMem::cReplayMem()
+{
+	mFullSize = 0;
+	mLastIdx = gInvalidIdx;
+	mNumEndSlots = 0;
+}
+
+void cReplayMem::Init(const tParams& params)
+{
+	mParams = params;
+	mParams.mHalfOffset = cMathUtil::Clamp(mParams.mHalfOffset, 0, mParams.mStateSize);
+	mParams.mHalfSize = cMathUtil::Clamp(mParams.mHalfSize, 0, mParams.mStateSize - mParams.mHalfOffset);
+	mFullSize = mParams.mStateSize - mParams.mHalfSize;
+
+	int capacity = mParams.mCapacity;
+	mEntries.assign(capacity, tEntry());
+	mStateFull.assign(static_cast<size_t>(capacity) * mFullSize, 0);
+	mStateHalf.assign(static_cast<size_t>(capacity) * mParams.mHalfSize, 0);
+	mActions.assign(static_cast<size_t>(capacity) * mParams.mActionSize, 0);
+
+	Clear();
+}
+
+void cReplayMem::Clear()
+{
+	for (size_t i = 0; i < mEntries.size(); ++i)
+	{
+		mEntries[i].mEndIdx = eEndLinkNone;
+	}
+
+	mEndFull.clear();
+	mEndHalf.clear();
+	mEndFreeList.clear();
+	mNumEndSlots = 0;
+	mLastIdx = gInvalidIdx;
+}
+
+int cReplayMem::GetCapacity() const
+{
+	return mParams.mCapacity;
+}
+
+int cReplayMem::GetStateSize() const
+{
+	return mParams.mStateSize;
+}
+
+int cReplayMem::GetActionSize() const
+{
+	return mParams.mActionSize;
+}
+
+void cReplayMem::Set(int t, const tExpTuple& tuple)
+{
+	assert(t >= 0 && t < GetCapacity());
+	assert(tuple.mStateBeg.size() == GetStateSize());
+	assert(tuple.mAction.size() == GetActionSize());
+
+	tEntry& entry = mEntries[t];
+	if (entry.mEndIdx >= 0)
+	{
+		ReleaseEndSlot(entry.mEndIdx);
+	}
+
+	entry.mReward = static_cast<float>(tuple.mReward);
+	entry.mFlags = tuple.mFlags;
+	entry.mEndIdx = eEndLinkNone;
+
+	EncodeState(tuple.mStateBeg, GetFullBeg(t), GetHalfBeg(t));
+	int action_size = GetActionSize();
+	Eigen::Map<Eigen::VectorXf>(mActions.data() + static_cast<size_t>(t) * action_size, action_size) = tuple.mAction.cast<float>();
+
+	if (mParams.mStoreStateEnd)
+	{
+		assert(tuple.mStateEnd.size() == GetStateSize());
+		UpdatePrevLink(t);
+
+		// whether the end state can be shared is only known once the next tuple arrives,
+		// so it is kept in the pool until then
+		int end_idx = RequestEndSlot();
+		EncodeState(tuple.mStateEnd, GetFullEnd(end_idx), GetHalfEnd(end_idx));
+		entry.mEndIdx = end_idx;
+	}
+
+	mLastIdx = t;
+}
+
+void cReplayMem::Get(int t, tExpTuple& out_tuple) const
+{
+	const tEntry& entry = mEntries[t];
+	out_tuple.mID = t;
+	out_tuple.mReward = entry.mReward;
+	out_tuple.mFlags = entry.mFlags;
+	GetStateBeg(t, out_tuple.mStateBeg);
+	GetStateEnd(t, out_tuple.mStateEnd);
+	GetAction(t, out_tuple.mAction);
+}
+
+void cReplayMem::GetStateBeg(int t, Eigen::VectorXd& out_state) const
+{
+	DecodeState(GetFullBeg(t), GetHalfBeg(t), out_state);
+}
+
+void cReplayMem::GetStateEnd(int t, Eigen::VectorXd& out_state) const
+{
+	int end_idx = mEntries[t].mEndIdx;
+	if (end_idx == eEndLinkNext)
+	{
+		int next_t = (t + 1) % GetCapacity();
+		GetStateBeg(next_t, out_state);
+	}
+	else if (end_idx >= 0)
+	{
+		DecodeState(GetFullEnd(end_idx), GetHalfEnd(end_idx), out_state);
+	}
+	else
+	{
+		out_state.resize(0);
+	}
+}
+
+void cReplayMem::GetAction(int t, Eigen::VectorXd& out_action) const
+{
+	int action_size = GetActionSize();
+	out_action = Eigen::Map<const Eigen::VectorXf>(mActions.data() + static_cast<size_t>(t) * action_size, action_size).cast<double>();
+}
+
+double cReplayMem::GetReward(int t) const
+{
+	return mEntries[t].mReward;
+}
+
+unsigned int cReplayMem::GetFlags(int t) const
+{
+	return mEntries[t].mFlags;
+}
+
+int cReplayMem::GetNextTuple(int t) const
+{
+	int next_t = gInvalidIdx;
+	if (mEntries[t].mEndIdx == eEndLinkNext)
+	{
+		next_t = (t + 1) % GetCapacity();
+	}
+	return next_t;
+}
+
+int cReplayMem::GetNumEndStates() const
+{
+	return mNumEndSlots - static_cast<int>(mEndFreeList.size());
+}
+
+size_t cReplayMem::CalcMemSize() const
+{
+	size_t size = mEntries.capacity() * sizeof(tEntry)
+				+ mStateFull.capacity() * sizeof(float)
+				+ mStateHalf.capacity() * sizeof(uint16_t)
+				+ mActions.capacity() * sizeof(float)
+				+ mEndFull.capacity() * sizeof(float)
+				+ mEndHalf.capacity() * sizeof(uint16_t)
+				+ mEndFreeList.capacity() * sizeof(int);
+	return size;
+}
+
+uint16_t cReplayMem::FloatToHalf(float val)
+{
+	uint32_t bits = 0;
+	std::memcpy(&bits, &val, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7fffff;
+	int exp = static_cast<int>((bits >> 23) & 0xff);
+
+	if (exp == 0xff)
+	{
+		// inf or nan
+		return static_cast<uint16_t>(sign | 0x7c00 | ((mantissa != 0) ? 0x200 : 0));
+	}
+
+	int half_exp = exp - 127 + 15;
+	if (half_exp >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+
+	uint32_t half = 0;
+	uint32_t rem = 0;
+	uint32_t rem_half = 0;
+	if (half_exp <= 0)
+	{
+		if (half_exp < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+
+		// subnormal
+		mantissa |= 0x800000;
+		int shift = 14 - half_exp;
+		half = mantissa >> shift;
+		rem = mantissa & ((1u << shift) - 1);
+		rem_half = 1u << (shift - 1);
+	}
+	else
+	{
+		half = (static_cast<uint32_t>(half_exp) << 10) | (mantissa >> 13);
+		rem = mantissa & 0x1fff;
+		rem_half = 0x1000;
+	}
+
+	// round to nearest even, a carry into the exponent is still the correctly rounded value
+	if (rem > rem_half || (rem == rem_half && (half & 1)))
+	{
+		++half;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float cReplayMem::HalfToFloat(uint16_t val)
+{
+	uint32_t sign = static_cast<uint32_t>(val & 0x8000) << 16;
+	uint32_t exp = (val >> 10) & 0x1f;
+	uint32_t mantissa = val & 0x3ff;
+
+	uint32_t bits = 0;
+	if (exp == 0)
+	{
+		float subnormal = static_cast<float>(mantissa) * (1.f / 16777216.f);
+		return (sign != 0) ? -subnormal : subnormal;
+	}
+	else if (exp == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exp + 112) << 23) | (mantissa << 13);
+	}
+
+	float result = 0;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void cReplayMem::EncodeState(const Eigen::VectorXd& state, float* out_full, uint16_t* out_half) const
+{
+	int half_offset = mParams.mHalfOffset;
+	int half_size = mParams.mHalfSize;
+	int tail_size = mParams.mStateSize - half_offset - half_size;
+
+	const double* vals = state.data();
+	Eigen::Map<Eigen::VectorXf>(out_full, half_offset) = Eigen::Map<const Eigen::VectorXd>(vals, half_offset).cast<float>();
+	Eigen::Map<Eigen::VectorXf>(out_full + half_offset, tail_size) = Eigen::Map<const Eigen::VectorXd>(vals + half_offset + half_size, tail_size).cast<float>();
+	EncodeHalf(vals + half_offset, half_size, out_half);
+}
+
+void cReplayMem::DecodeState(const float* full, const uint16_t* half, Eigen::VectorXd& out_state) const
+{
+	int half_offset = mParams.mHalfOffset;
+	int half_size = mParams.mHalfSize;
+	int tail_size = mParams.mStateSize - half_offset - half_size;
+
+	out_state.resize(mParams.mStateSize);
+	double* vals = out_state.data();
+	Eigen::Map<Eigen::VectorXd>(vals, half_offset) = Eigen::Map<const Eigen::VectorXf>(full, half_offset).cast<double>();
+	Eigen::Map<Eigen::VectorXd>(vals + half_offset + half_size, tail_size) = Eigen::Map<const Eigen::VectorXf>(full + half_offset, tail_size).cast<double>();
+	DecodeHalf(half, half_size, vals + half_offset);
+}
+
+bool cReplayMem::MatchState(const float* full0, const uint16_t* half0, const float* full1, const uint16_t* half1) const
+{
+	// compared after encoding, so a match reproduces exactly what would have been stored
+	bool match = std::memcmp(full0, full1, mFullSize * sizeof(float)) == 0
+				&& std::memcmp(half0, half1, mParams.mHalfSize * sizeof(uint16_t)) == 0;
+	return match;
+}
+
+int cReplayMem::RequestEndSlot()
+{
+	int idx = gInvalidIdx;
+	if (!mEndFreeList.empty())
+	{
+		idx = mEndFreeList.back();
+		mEndFreeList.pop_back();
+	}
+	else
+	{
+		idx = mNumEndSlots;
+		++mNumEndSlots;
+		mEndFull.resize(static_cast<size_t>(mNumEndSlots) * mFullSize);
+		mEndHalf.resize(static_cast<size_t>(mNumEndSlots) * mParams.mHalfSize);
+	}
+	return idx;
+}
+
+void cReplayMem::ReleaseEndSlot(int idx)
+{
+	assert(idx >= 0 && idx < mNumEndSlots);
+	mEndFreeList.push_back(idx);
+}
+
+void cReplayMem::UpdatePrevLink(int t)
+{
+	// slots are filled in order, so the tuple before t is only overwritten after t
+	// and a link to the start state in t stays valid for as long as the tuple is alive
+	int capacity = GetCapacity();
+	if (mLastIdx != gInvalidIdx && mLastIdx != t && (mLastIdx + 1) % capacity == t)
+	{
+		tEntry& prev_entry = mEntries[mLastIdx];
+		int prev_end = prev_entry.mEndIdx;
+		if (prev_end >= 0
+			&& MatchState(GetFullEnd(prev_end), GetHalfEnd(prev_end), GetFullBeg(t), GetHalfBeg(t)))
+		{
+			ReleaseEndSlot(prev_end);
+			prev_entry.mEndIdx = eEndLinkNext;
+		}
+	}
+}
+
+float* cReplayMem::GetFullBeg(int t)
+{
+	return mStateFull.data() + static_cast<size_t>(t) * mFullSize;
+}
+
+const float* cReplayMem::GetFullBeg(int t) const
+{
+	return mStateFull.data() + static_cast<size_t>(t) * mFullSize;
+}
+
+uint16_t* cReplayMem::GetHalfBeg(int t)
+{
+	return mStateHalf.data() + static_cast<size_t>(t) * mParams.mHalfSize;
+}
+
+const uint16_t* cReplayMem::GetHalfBeg(int t) const
+{
+	return mStateHalf.data() + static_cast<size_t>(t) * mParams.mHalfSize;
+}
+
+float* cReplayMem::GetFullEnd(int idx)
+{
+	return mEndFull.data() + static_cast<size_t>(idx) * mFullSize;
+}
+
+const float* cReplayMem::GetFullEnd(int idx) const
+{
+	return mEndFull.data() + static_cast<size_t>(idx) * mFullSize;
+}
+
+uint16_t* cReplayMem::GetHalfEnd(int idx)
+{
+	return mEndHalf.data() + static_cast<size_t>(idx) * mParams.mHalfSize;
+}
+
+const uint16_t* cReplayMem::GetHalfEnd(int idx) const
+{
+	return mEndHalf.data() + static_cast<size_t>(idx) * mParams.mHalfSize;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "learning/ExpTuple.h"
+
+// compact storage for the experience replay memory, tuples are stored one per slot,
+// the end state of a tuple is not kept when it matches the start state of the tuple
+// added right after it, which is the case along a contiguous episode,
+// so only episode boundaries and interleaved experience keep a separate copy,
+// an optional segment of the state (eg. the ground samples) is stored in half precision
+class cReplayMem
+{
+public:
+	struct tParams
+	{
+		int mCapacity;
+		int mStateSize;
+		int mActionSize;
+		bool mStoreStateEnd;
+		int mHalfOffset;
+		int mHalfSize;
+
+		tParams();
+	};
+
+	static void EncodeHalf(const double* vals, int num_vals, uint16_t* out_vals);
+	static void DecodeHalf(const uint16_t* vals, int num_vals, double* out_vals);
+
+	cReplayMem();
+
+	void Init(const tParams& params);
+	void Clear();
+
+	int GetCapacity() const;
+	int GetStateSize() const;
+	int GetActionSize() const;
+
+	void Set(int t, const tExpTuple& tuple);
+	void Get(int t, tExpTuple& out_tuple) const;
+	void GetStateBeg(int t, Eigen::VectorXd& out_state) const;
+	void GetStateEnd(int t, Eigen::VectorXd& out_state) const;
+	void GetAction(int t, Eigen::VectorXd& out_action) const;
+	double GetReward(int t) const;
+	unsigned int GetFlags(int t) const;
+	// slot of the tuple that continues the episode after t, gInvalidIdx at episode boundaries
+	int GetNextTuple(int t) const;
+
+	// number of end states that could not be shared with the next tuple
+	int GetNumEndStates() const;
+	size_t CalcMemSize() const;
+
+protected:
+	enum eEndLink
+	{
+		eEndLinkNone = -2,
+		eEndLinkNext = -1 // shared with the start state of the next slot
+	};
+
+	struct tEntry
+	{
+		float mReward;
+		unsigned int mFlags;
+		int mEndIdx; // index into the end state pool or an eEndLink
+
+		tEntry();
+	};
+
+	tParams mParams;
+	int mFullSize;
+	int mLastIdx;
+
+	std::vector<tEntry> mEntries;
+	std::vector<float> mStateFull;
+	std::vector<uint16_t> mStateHalf;
+	std::vector<float> mActions;
+
+	std::vector<float> mEndFull;
+	std::vector<uint16_t> mEndHalf;
+	std::vector<int> mEndFreeList;
+	int mNumEndSlots;
+
+	static uint16_t FloatToHalf(float val);
+	static float HalfToFloat(uint16_t val);
+
+	void EncodeState(const Eigen::VectorXd& state, float* out_full, uint16_t* out_half) const;
+	void DecodeState(const float* full, const uint16_t* half, Eigen::VectorXd& out_state) const;
+	bool MatchState(const float* full0, const uint16_t* half0, const float* full1, const uint16_t* half1) const;
+
+	int RequestEndSlot();
+	void ReleaseEndSlot(int idx);
+	void UpdatePrevLink(int t);
+
+	float* GetFullBeg(int t);
+	const float* GetFullBeg(int t) const;
+	uint16_t* GetHalfBeg(int t);
+	const uint16_t* GetHalfBeg(int t) const;
+	float* GetFullEnd(int idx);
+	const float* GetFullEnd(int idx) const;
+	uint16_t* GetHalfEnd(int idx);
+	const uint16_t* GetHalfEnd(int idx) const;
+};
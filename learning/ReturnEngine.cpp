@@ -0,0 +1,140 @@
+#include "ReturnEngine.h"
+#include <cassert>
+
+cReturnEngine::tParams::tParams()
+{
+	mNumSteps = 1;
+	mLambda = 1;
+}
+
+cReturnEngine::cReturnEngine()
+{
+}
+
+void cReturnEngine::Init(const tParams& params)
+{
+	mParams = params;
+	mParams.mNumSteps = std::max(1, mParams.mNumSteps);
+	mParams.mLambda = cMathUtil::Clamp(mParams.mLambda, 0.0, 1.0);
+}
+
+const cReturnEngine::tParams& cReturnEngine::GetParams() const
+{
+	return mParams;
+}
+
+void cReturnEngine::BuildChains(const cReplayMem& mem, const std::vector<int>& tuple_ids, int fail_flag)
+{
+	int num_data = static_cast<int>(tuple_ids.size());
+	int num_steps = mParams.mNumSteps;
+	// intermediate values only contribute when lambda < 1
+	bool bootstrap_all = mParams.mLambda < 1;
+
+	mChainBeg.resize(num_data);
+	mChainLen.resize(num_data);
+	mStepTuples.clear();
+	mStepBootstrap.clear();
+	mBootstrapTuples.clear();
+	mBootstrapMap.clear();
+
+	for (int i = 0; i < num_data; ++i)
+	{
+		mChainBeg[i] = static_cast<int>(mStepTuples.size());
+
+		int t = tuple_ids[i];
+		int len = 0;
+		while (t != gInvalidIdx)
+		{
+			mStepTuples.push_back(t);
+			++len;
+
+			bool fail = tExpTuple::TestFlag(mem.GetFlags(t), fail_flag);
+			int next_t = gInvalidIdx;
+			if (!fail && len < num_steps)
+			{
+				next_t = mem.GetNextTuple(t);
+			}
+
+			bool chain_end = next_t == gInvalidIdx;
+			int boot_idx = gInvalidIdx;
+			if (!fail && (chain_end || bootstrap_all))
+			{
+				boot_idx = AddBootstrapTuple(t);
+			}
+			mStepBootstrap.push_back(boot_idx);
+
+			t = next_t;
+		}
+
+		mChainLen[i] = len;
+	}
+}
+
+const std::vector<int>& cReturnEngine::GetStepTuples() const
+{
+	return mStepTuples;
+}
+
+const std::vector<int>& cReturnEngine::GetBootstrapTuples() const
+{
+	return mBootstrapTuples;
+}
+
+void cReturnEngine::CalcReturns(const Eigen::VectorXd& step_rewards, const Eigen::VectorXd& bootstrap_vals,
+								double discount, Eigen::VectorXd& out_returns) const
+{
+	int num_data = static_cast<int>(mChainBeg.size());
+	assert(step_rewards.size() == static_cast<int>(mStepTuples.size()));
+	assert(bootstrap_vals.size() >= static_cast<int>(mBootstrapTuples.size()));
+	assert(out_returns.size() >= num_data);
+
+	double lambda = mParams.mLambda;
+	for (int i = 0; i < num_data; ++i)
+	{
+		int beg = mChainBeg[i];
+		int end = beg + mChainLen[i];
+
+		// G_k = r_k + gamma * ((1 - lambda) * V(s_k+1) + lambda * G_k+1),
+		// the last step bootstraps fully from V and failures have no successor
+		double ret = 0;
+		for (int k = end - 1; k >= beg; --k)
+		{
+			double r = step_rewards[k];
+			int boot_idx = mStepBootstrap[k];
+			if (k == end - 1)
+			{
+				double val = (boot_idx != gInvalidIdx) ? bootstrap_vals[boot_idx] : 0;
+				ret = r + discount * val;
+			}
+			else if (boot_idx != gInvalidIdx)
+			{
+				double val = bootstrap_vals[boot_idx];
+				ret = r + discount * ((1 - lambda) * val + lambda * ret);
+			}
+			else
+			{
+				ret = r + discount * ret;
+			}
+		}
+
+		out_returns[i] = ret;
+	}
+}
+
+int cReturnEngine::AddBootstrapTuple(int t)
+{
+	// chains from nearby tuples overlap, so shared states are only evaluated once
+	auto it = mBootstrapMap.find(t);
+	int idx = 0;
+	if (it == mBootstrapMap.end())
+	{
+		idx = static_cast<int>(mBootstrapTuples.size());
+		mBootstrapTuples.push_back(t);
+		mBootstrapMap[t] = idx;
+	}
+	else
+	{
+		idx = it->second;
+	}
+	return idx;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "learning/ReplayMem.h"
+
+// multi-step targets for the critic, each tuple in a minibatch is followed along
+// the episode links of the replay memory for up to n steps and the truncated
+// lambda-return is computed with a reverse sweep over the chain,
+// chains stop early at failures and episode boundaries,
+// with n = 1 this reduces to the usual r + gamma * V(s') target
+class cReturnEngine
+{
+public:
+	struct tParams
+	{
+		int mNumSteps;
+		double mLambda; // 1 gives the plain n-step return
+
+		tParams();
+	};
+
+	cReturnEngine();
+
+	void Init(const tParams& params);
+	const tParams& GetParams() const;
+
+	void BuildChains(const cReplayMem& mem, const std::vector<int>& tuple_ids, int fail_flag);
+
+	// tuples visited by the chains, their rewards are passed to CalcReturns in this order
+	const std::vector<int>& GetStepTuples() const;
+	// tuples whose end state values are needed, so they can all be evaluated in one batch
+	const std::vector<int>& GetBootstrapTuples() const;
+
+	void CalcReturns(const Eigen::VectorXd& step_rewards, const Eigen::VectorXd& bootstrap_vals,
+					double discount, Eigen::VectorXd& out_returns) const;
+
+protected:
+	tParams mParams;
+
+	std::vector<int> mChainBeg;
+	std::vector<int> mChainLen;
+	std::vector<int> mStepTuples;
+	std::vector<int> mStepBootstrap; // index into mBootstrapTuples, gInvalidIdx for failures and unused values
+	std::vector<int> mBootstrapTuples;
+	std::unordered_map<int, int> mBootstrapMap;
+
+	int AddBootstrapTuple(int t);
+};
@@ -6,10 +6,15 @@ cTrainerInterface::tParams::tParams()
 	mPolicyArchConfig = "";
 	mPolicyCheckpoint = "";
 	mPlaybackMemSize = 100000;
+	mPlaybackHalfOffset = 0;
+	mPlaybackHalfSize = 0;
 	mPoolSize = 1;
 	mNumInitSamples = 1024;
 	mNumStepsPerIter = 1;
+	mNumUpdateThreads = 1;
 	mFreezeTargetIters = 0;
+	mNumReturnSteps = 1;
+	mReturnLambda = 1;
 	mDiscount = 0.9;
 	mInitInputOffsetScale = true;
 
@@ -21,10 +21,15 @@ public:
 		std::string mPolicyArchConfig;
 		std::string mPolicyCheckpoint;
 		int mPlaybackMemSize;
+		int mPlaybackHalfOffset; // state entries stored in half precision in the replay memory
+		int mPlaybackHalfSize;
 		int mPoolSize;
 		int mNumInitSamples;
 		int mNumStepsPerIter;
+		int mNumUpdateThreads; // nets in the pool are updated concurrently when > 1
 		int mFreezeTargetIters; // for deep q learning
+		int mNumReturnSteps; // n-step critic targets, 1 for the one-step target
+		double mReturnLambda; // lambda-return over the n steps
 		double mDiscount;
 		bool mInitInputOffsetScale;
 
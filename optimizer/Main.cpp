@@ -5,7 +5,12 @@
 #include "scenarios/ScenarioTrainCacla.h"
 #include "scenarios/ScenarioTrainMACE.h"
 #include "scenarios/OptScenarioPoliEval.h"
+#include "scenarios/OptScenarioQuantPoli.h"
+#include "scenarios/OptScenarioTerrainLib.h"
+#include "scenarios/OptScenarioCompileAssets.h"
+#include "scenarios/OptScenarioKinRollout.h"
 #include "util/ArgParser.h"
+#include "util/AssetCache.h"
 
 // arg parser
 cArgParser gArgParser;
@@ -13,6 +18,7 @@ std::shared_ptr<cScenario> gScenario = nullptr;
 int gArgc = 0;
 char** gArgv = nullptr;
 int gNumThreads = 1;
+bool gCheckArgs = false;
 
 const double gTimeStep = 1.0 / 30;
 
@@ -29,6 +35,11 @@ void ParseArgs(int argc, char** argv)
 		gArgParser.AppendArgs(arg_file);
 	}
 	gArgParser.ParseInt("num_threads", gNumThreads);
+	gArgParser.ParseBool("check_args", gCheckArgs);
+
+	std::string asset_cache_dir = "";
+	gArgParser.ParseString("asset_cache_dir", asset_cache_dir);
+	cAssetCache::SetCacheDir(asset_cache_dir);
 }
 
 void SetupScenario()
@@ -68,6 +79,26 @@ void SetupScenario()
 
 		gScenario = std::shared_ptr<cScenario>(eval);
 	}
+	else if (scenario_name == "quantize_policy")
+	{
+		std::shared_ptr<cOptScenarioQuantPoli> quant = std::shared_ptr<cOptScenarioQuantPoli>(new cOptScenarioQuantPoli());
+		gScenario = std::shared_ptr<cScenario>(quant);
+	}
+	else if (scenario_name == "build_terrain_lib")
+	{
+		std::shared_ptr<cOptScenarioTerrainLib> terrain_lib = std::shared_ptr<cOptScenarioTerrainLib>(new cOptScenarioTerrainLib());
+		gScenario = std::shared_ptr<cScenario>(terrain_lib);
+	}
+	else if (scenario_name == "compile_assets")
+	{
+		std::shared_ptr<cOptScenarioCompileAssets> compile = std::shared_ptr<cOptScenarioCompileAssets>(new cOptScenarioCompileAssets());
+		gScenario = std::shared_ptr<cScenario>(compile);
+	}
+	else if (scenario_name == "kin_rollout")
+	{
+		std::shared_ptr<cOptScenarioKinRollout> rollout = std::shared_ptr<cOptScenarioKinRollout>(new cOptScenarioKinRollout());
+		gScenario = std::shared_ptr<cScenario>(rollout);
+	}
 	else
 	{
 		printf("No valid scenario specified\n");
@@ -78,6 +109,12 @@ void SetupScenario()
 		gScenario->ParseArgs(gArgParser);
 		printf("Loaded scenario: %s\n", gScenario->GetName().c_str());
 		gScenario->Init();
+
+		// every scene has parsed its args by now, so anything left unread is likely a typo
+		if (gCheckArgs)
+		{
+			gArgParser.CheckArgs();
+		}
 	}
 }
 
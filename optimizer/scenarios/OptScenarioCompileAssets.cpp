@@ -0,0 +1,64 @@
+#include "OptScenarioCompileAssets.h"
+#include "util/AssetCache.h"
+
+cOptScenarioCompileAssets::cOptScenarioCompileAssets()
+{
+}
+
+cOptScenarioCompileAssets::~cOptScenarioCompileAssets()
+{
+}
+
+void cOptScenarioCompileAssets::ParseArgs(const cArgParser& parser)
+{
+	cScenario::ParseArgs(parser);
+
+	const std::string asset_keys[] =
+	{
+		"character_file",
+		"state_file",
+		"motion_file",
+		"terrain_file"
+	};
+
+	mFiles.clear();
+	for (size_t i = 0; i < sizeof(asset_keys) / sizeof(asset_keys[0]); ++i)
+	{
+		std::string file = "";
+		parser.ParseString(asset_keys[i], file);
+		if (file != "")
+		{
+			mFiles.push_back(file);
+		}
+	}
+
+	std::vector<std::string> asset_files;
+	parser.ParseStringArray("asset_files", asset_files);
+	mFiles.insert(mFiles.end(), asset_files.begin(), asset_files.end());
+}
+
+void cOptScenarioCompileAssets::Run()
+{
+	if (cAssetCache::GetCacheDir() == "")
+	{
+		printf("No asset_cache_dir specified\n");
+		return;
+	}
+
+	int num_compiled = 0;
+	for (size_t i = 0; i < mFiles.size(); ++i)
+	{
+		bool succ = cAssetCache::CompileJson(mFiles[i]);
+		if (succ)
+		{
+			++num_compiled;
+		}
+	}
+	printf("Compiled %i of %i assets into %s\n", num_compiled, static_cast<int>(mFiles.size()),
+			cAssetCache::GetCacheDir().c_str());
+}
+
+std::string cOptScenarioCompileAssets::GetName() const
+{
+	return "Compile Assets";
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "scenarios/Scenario.h"
+
+// compiles json assets into the asset cache ahead of time, so even the first
+// run after a change skips parsing, takes the files referenced by the usual
+// asset args plus any listed in asset_files
+class cOptScenarioCompileAssets : public cScenario
+{
+public:
+	cOptScenarioCompileAssets();
+	virtual ~cOptScenarioCompileAssets();
+
+	virtual void ParseArgs(const cArgParser& parser);
+	virtual void Run();
+
+	virtual std::string GetName() const;
+
+protected:
+	std::vector<std::string> mFiles;
+};
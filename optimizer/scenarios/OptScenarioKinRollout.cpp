@@ -0,0 +1,476 @@
+#include "OptScenarioKinRollout.h"
+#include <ctime>
+#include "learning/QNetTrainer.h"
+#include "sim/TerrainGen2D.h"
+#include "sim/TerrainLibrary.h"
+
+// ground samples and view match cTerrainRLCharController
+const int gNumGroundSamples = 200;
+const double gViewMin = -0.5;
+const double gViewDist = 10;
+const int gPosDim = 2;
+// same finite difference step as cKinCharacter::BuildVel
+const double gDiffTimeStep = 1 / 60.0;
+
+cOptScenarioKinRollout::cOptScenarioKinRollout()
+{
+	mCharFile = "";
+	mMotionFile = "";
+	mTerrainFile = "";
+	mTerrainLibFile = "";
+	mTerrainBlend = 0;
+
+	mNumTuples = 100000;
+	mEpisodeLength = 200;
+	mBatchSize = 32;
+	mTimeStep = 1 / 30.0;
+	mTargetVel = 4;
+	mActionID = 0;
+	mSeed = 0;
+	mMotionCacheStep = 0;
+	mStateOutputFile = "";
+
+	mTrainerParams.mPoolSize = 2; // double Q learning
+	mTrainerParams.mPlaybackMemSize = 500000;
+	mTrainerParams.mNumInitSamples = 200;
+	mTrainerParams.mFreezeTargetIters = 0;
+	mPoliModelFile = "";
+	mOutputFile = "";
+	mItersPerOutput = 20;
+
+	mTime = 0;
+	mStateOutput = nullptr;
+}
+
+cOptScenarioKinRollout::~cOptScenarioKinRollout()
+{
+	Clear();
+}
+
+void cOptScenarioKinRollout::ParseArgs(const cArgParser& parser)
+{
+	cScenario::ParseArgs(parser);
+
+	parser.ParseString("character_file", mCharFile);
+	parser.ParseString("motion_file", mMotionFile);
+	parser.ParseString("terrain_file", mTerrainFile);
+	parser.ParseString("terrain_lib", mTerrainLibFile);
+	parser.ParseDouble("terrain_blend", mTerrainBlend);
+
+	parser.ParseInt("kin_rollout_tuples", mNumTuples);
+	parser.ParseInt("kin_rollout_episode_len", mEpisodeLength);
+	parser.ParseInt("kin_rollout_batch_size", mBatchSize);
+	parser.ParseDouble("kin_rollout_time_step", mTimeStep);
+	parser.ParseDouble("kin_rollout_target_vel", mTargetVel);
+	parser.ParseInt("kin_rollout_action", mActionID);
+	parser.ParseInt("kin_rollout_seed", mSeed);
+	parser.ParseDouble("kin_rollout_motion_cache_step", mMotionCacheStep);
+	parser.ParseString("kin_rollout_state_output", mStateOutputFile);
+
+	parser.ParseString("policy_model", mPoliModelFile);
+	parser.ParseString("output_path", mOutputFile);
+	parser.ParseInt("trainer_iters_per_output", mItersPerOutput);
+	parser.ParseString("policy_arch_config", mTrainerParams.mPolicyArchConfig);
+	parser.ParseString("policy_checkpoint", mTrainerParams.mPolicyCheckpoint);
+	parser.ParseInt("trainer_replay_mem_size", mTrainerParams.mPlaybackMemSize);
+	parser.ParseBool("trainer_init_input_offset_scale", mTrainerParams.mInitInputOffsetScale);
+	parser.ParseInt("trainer_num_init_samples", mTrainerParams.mNumInitSamples);
+	parser.ParseInt("trainer_num_steps_per_iters", mTrainerParams.mNumStepsPerIter);
+	parser.ParseInt("trainer_num_update_threads", mTrainerParams.mNumUpdateThreads);
+	parser.ParseInt("trainer_freeze_target_iters", mTrainerParams.mFreezeTargetIters);
+
+	bool half_ground = false;
+	parser.ParseBool("trainer_replay_half_ground", half_ground);
+	mTrainerParams.mPlaybackHalfOffset = 0;
+	mTrainerParams.mPlaybackHalfSize = (half_ground) ? gNumGroundSamples : 0;
+}
+
+void cOptScenarioKinRollout::Init()
+{
+	cScenario::Init();
+	mRand.Seed(static_cast<unsigned long>(mSeed));
+
+	bool succ = mChar.Init(mCharFile, mMotionFile);
+	if (succ && !mChar.HasMotion())
+	{
+		printf("No motion specified for kinematic rollout\n");
+		succ = false;
+	}
+
+	if (succ && mMotionCacheStep > 0)
+	{
+		// poses are sampled at arbitrary times, so a dense resampling of the clip
+		// turns each sample into a lerp between two cached frames
+		mChar.BuildMotionCache(mMotionCacheStep);
+	}
+
+	if (succ)
+	{
+		succ = cKinTree::LoadBodyDefs(mCharFile, mBodyDefs);
+	}
+
+	if (succ)
+	{
+		succ = BuildGround();
+	}
+
+	if (succ)
+	{
+		int num_joints = mChar.GetNumJoints();
+		mPartPos.resize(num_joints, gPosDim);
+		mNextPartPos.resize(num_joints, gPosDim);
+		InitTrainer();
+	}
+	else
+	{
+		printf("Failed to initialize kinematic rollout\n");
+		Clear();
+	}
+}
+
+void cOptScenarioKinRollout::Clear()
+{
+	cScenario::Clear();
+	if (mStateOutput != nullptr)
+	{
+		fclose(mStateOutput);
+		mStateOutput = nullptr;
+	}
+
+	mLearner.reset();
+	mTrainer.reset();
+	mGround.reset();
+	mChar.Clear();
+	mFKCache.Clear();
+}
+
+void cOptScenarioKinRollout::Run()
+{
+	if (mGround == nullptr)
+	{
+		return;
+	}
+
+	if (mStateOutputFile != "")
+	{
+		mStateOutput = fopen(mStateOutputFile.c_str(), "w");
+		if (mStateOutput == nullptr)
+		{
+			printf("Failed to open %s\n", mStateOutputFile.c_str());
+		}
+	}
+
+	int state_size = GetPoliStateSize();
+	std::vector<tExpTuple> tuples;
+	tuples.reserve(mBatchSize);
+
+	Eigen::VectorXd state_beg;
+	Eigen::VectorXd state_end;
+	const Eigen::MatrixXd& joint_mat = mChar.GetJointMat();
+	double root_x = 0;
+
+	clock_t beg_time = clock();
+	for (int i = 0; i < mNumTuples; ++i)
+	{
+		if (i % mEpisodeLength == 0)
+		{
+			ResetEpisode();
+			BuildPoliState(mTime, state_beg);
+			WriteState(state_beg);
+			root_x = cKinTree::GetRootPos(joint_mat, mPose)[0];
+		}
+
+		mTime += mTimeStep;
+		UpdateGround();
+		BuildPoliState(mTime, state_end);
+		WriteState(state_end);
+
+		// BuildPoliState leaves the pose at the given time in mPose
+		double prev_root_x = root_x;
+		root_x = cKinTree::GetRootPos(joint_mat, mPose)[0];
+		double dist = root_x - prev_root_x;
+
+		tExpTuple tuple(state_size, 0);
+		tuple.mID = i;
+		tuple.mReward = CalcReward(dist, mTimeStep);
+		tuple.mStateBeg = state_beg;
+		tuple.mStateEnd = state_end;
+		BuildAction(tuple.mAction);
+		tuples.push_back(tuple);
+
+		if (static_cast<int>(tuples.size()) >= mBatchSize)
+		{
+			TrainBatch(tuples);
+			tuples.clear();
+		}
+		state_beg.swap(state_end);
+	}
+	TrainBatch(tuples);
+
+	double run_time = static_cast<double>(clock() - beg_time) / CLOCKS_PER_SEC;
+	double sim_time = mNumTuples * mTimeStep;
+	printf("Rolled out %i tuples (%.2fs of motion) in %.3fs, %.0f tuples/s\n", mNumTuples, sim_time, run_time,
+			mNumTuples / std::max(run_time, 1e-6));
+
+	if (EnableTraining() && mOutputFile != "")
+	{
+		mTrainer->OutputModel(mOutputFile);
+	}
+
+	if (mStateOutput != nullptr)
+	{
+		fclose(mStateOutput);
+		mStateOutput = nullptr;
+	}
+}
+
+std::string cOptScenarioKinRollout::GetName() const
+{
+	return "Kinematic Rollout";
+}
+
+bool cOptScenarioKinRollout::BuildGround()
+{
+	cTerrainGen2D::eType terrain_type = cTerrainGen2D::eTypeFlat;
+	std::vector<Eigen::VectorXd> terrain_params;
+	if (mTerrainFile != "")
+	{
+		bool succ = cTerrainGen2D::LoadTerrainFile(mTerrainFile, terrain_type, terrain_params);
+		if (!succ)
+		{
+			return false;
+		}
+	}
+
+	mGround = std::shared_ptr<cGroundVar2D>(new cGroundVar2D());
+	mGround->SeedRand(static_cast<unsigned long>(mSeed));
+	mGround->SetTerrainFunc(cTerrainGen2D::GetTerrainFunc(terrain_type));
+	if (terrain_params.size() > 0)
+	{
+		Eigen::VectorXd params;
+		cTerrainGen2D::LerpParams(terrain_params, mTerrainBlend, params);
+		mGround->SetTerrainParams(params);
+	}
+
+	if (mTerrainLibFile != "")
+	{
+		auto terrain_lib = cTerrainLibrary::LoadShared(mTerrainLibFile);
+		if (terrain_lib == nullptr)
+		{
+			return false;
+		}
+		else if (terrain_lib->GetType() != terrain_type)
+		{
+			printf("Terrain library %s does not match the terrain type of the scenario\n", mTerrainLibFile.c_str());
+			return false;
+		}
+
+		if (terrain_params.size() > 1)
+		{
+			printf("Warning: terrain library %s has a single parameter set, terrain_blend is ignored\n", mTerrainLibFile.c_str());
+		}
+		mGround->SetTerrainLibrary(terrain_lib);
+	}
+	return true;
+}
+
+void cOptScenarioKinRollout::InitTrainer()
+{
+	mTrainer.reset();
+	mLearner.reset();
+	if (mTrainerParams.mPolicyArchConfig == "")
+	{
+		// without a net the rollout only produces states
+		return;
+	}
+
+	auto trainer = std::shared_ptr<cQNetTrainer>(new cQNetTrainer());
+	mTrainer = trainer;
+	mTrainer->Init(mTrainerParams);
+	if (mPoliModelFile != "")
+	{
+		mTrainer->LoadModel(mPoliModelFile);
+	}
+
+	int state_size = GetPoliStateSize();
+	if (mTrainer->GetStateSize() != state_size)
+	{
+		printf("Policy state size mismatch, net: %i, kinematic rollout: %i\n", mTrainer->GetStateSize(), state_size);
+		mTrainer.reset();
+		return;
+	}
+
+	mTrainer->RequestLearner(mLearner);
+	mLearner->SetNet(&mNet);
+	mLearner->Init();
+}
+
+bool cOptScenarioKinRollout::EnableTraining() const
+{
+	return mLearner != nullptr;
+}
+
+void cOptScenarioKinRollout::ResetEpisode()
+{
+	// start each episode at a random point in the clip with the root at the origin
+	mTime = mRand.RandDouble(0, mChar.GetMotionDuration());
+	mChar.SetOrigin(tVector::Zero());
+
+	mChar.CalcPose(mTime, mPose);
+	tVector root_pos = cKinTree::GetRootPos(mChar.GetJointMat(), mPose);
+	tVector origin = tVector::Zero();
+	origin[0] = -root_pos[0];
+	mChar.SetOrigin(origin);
+
+	cGroundVar2D::tParams params;
+	params.mSegmentWidth = 2 * gViewDist;
+	tVector bound_min = tVector(-gViewDist, 0, 0, 0);
+	tVector bound_max = tVector(gViewDist, 0, 0, 0);
+	mGround->Init(nullptr, params, bound_min, bound_max);
+}
+
+void cOptScenarioKinRollout::UpdateGround()
+{
+	mChar.CalcPose(mTime + gDiffTimeStep, mPose);
+	tVector root_pos = cKinTree::GetRootPos(mChar.GetJointMat(), mPose);
+	tVector bound_min = tVector(root_pos[0] - gViewDist, 0, 0, 0);
+	tVector bound_max = tVector(root_pos[0] + gViewDist, 0, 0, 0);
+	mGround->Update(bound_min, bound_max);
+}
+
+void cOptScenarioKinRollout::BuildPose(double time, Eigen::VectorXd& out_pose) const
+{
+	// the clip is recorded over flat ground, so the root follows the terrain below it
+	const Eigen::MatrixXd& joint_mat = mChar.GetJointMat();
+	mChar.CalcPose(time, out_pose);
+	tVector root_pos = cKinTree::GetRootPos(joint_mat, out_pose);
+	root_pos[1] += mGround->SampleHeight(root_pos);
+	cKinTree::SetRootPos(joint_mat, root_pos, out_pose);
+}
+
+int cOptScenarioKinRollout::GetPoliStateSize() const
+{
+	int num_parts = mChar.GetNumJoints();
+	int ground_size = gNumGroundSamples;
+	int pose_size = num_parts * gPosDim - 1; // -1 for root x
+	int vel_size = num_parts * gPosDim;
+	return ground_size + pose_size + vel_size;
+}
+
+void cOptScenarioKinRollout::BuildPoliState(double time, Eigen::VectorXd& out_state)
+{
+	const Eigen::MatrixXd& joint_mat = mChar.GetJointMat();
+	out_state.resize(GetPoliStateSize());
+
+	BuildPose(time + gDiffTimeStep, mPose);
+	CalcPartPos(mPose, mNextPartPos);
+	BuildPose(time, mPose);
+	CalcPartPos(mPose, mPartPos);
+
+	tVector root_pos = cKinTree::GetRootPos(joint_mat, mPose);
+	double ground_h = mGround->SampleHeight(root_pos);
+
+	int idx = 0;
+	for (int s = 0; s < gNumGroundSamples; ++s)
+	{
+		double dist = ((gViewDist - gViewMin) * s) / (gNumGroundSamples - 1) + gViewMin;
+		tVector sample_pos = tVector(root_pos[0] + dist, 0, 0, 0);
+		out_state[idx++] = mGround->SampleHeight(sample_pos) - ground_h;
+	}
+
+	out_state[idx++] = root_pos[1] - ground_h;
+	int num_parts = static_cast<int>(mPartPos.rows());
+	for (int i = 1; i < num_parts; ++i)
+	{
+		for (int j = 0; j < gPosDim; ++j)
+		{
+			out_state[idx++] = mPartPos(i, j) - root_pos[j];
+		}
+	}
+
+	for (int i = 0; i < num_parts; ++i)
+	{
+		for (int j = 0; j < gPosDim; ++j)
+		{
+			out_state[idx++] = (mNextPartPos(i, j) - mPartPos(i, j)) / gDiffTimeStep;
+		}
+	}
+	assert(idx == out_state.size());
+}
+
+void cOptScenarioKinRollout::CalcPartPos(const Eigen::VectorXd& pose, Eigen::MatrixXd& out_pos)
+{
+	const Eigen::MatrixXd& joint_mat = mChar.GetJointMat();
+	cKinTree::UpdateFKCache(joint_mat, pose, mFKCache);
+
+	int num_parts = static_cast<int>(out_pos.rows());
+	for (int i = 0; i < num_parts; ++i)
+	{
+		tVector pos;
+		if (cKinTree::IsValidBody(mBodyDefs, i))
+		{
+			pos = cKinTree::CalcBodyPartPos(mFKCache, mBodyDefs, i);
+		}
+		else
+		{
+			pos = cKinTree::CalcJointWorldPos(mFKCache, i);
+		}
+		out_pos.row(i) = pos.segment(0, gPosDim).transpose();
+	}
+}
+
+double cOptScenarioKinRollout::CalcReward(double dist, double time_step) const
+{
+	// same velocity term as the controllers' rewards, the clip never stumbles
+	const double vel_reward_w = 0.8;
+	const double stumble_reward_w = 0.2;
+	const double vel_gamma = 0.5;
+
+	double avg_vel = dist / time_step;
+	double vel_err = mTargetVel - avg_vel;
+	double vel_reward = std::exp(-vel_gamma * vel_err * vel_err);
+	double stumble_reward = 1;
+
+	double reward = vel_reward_w * vel_reward
+					+ stumble_reward_w * stumble_reward;
+	return reward;
+}
+
+void cOptScenarioKinRollout::BuildAction(Eigen::VectorXd& out_action) const
+{
+	int action_size = (mTrainer != nullptr) ? mTrainer->GetActionSize() : 1;
+	out_action = Eigen::VectorXd::Zero(action_size);
+	if (mActionID >= 0 && mActionID < action_size)
+	{
+		out_action[mActionID] = 1;
+	}
+}
+
+void cOptScenarioKinRollout::TrainBatch(const std::vector<tExpTuple>& tuples)
+{
+	if (!EnableTraining() || tuples.empty())
+	{
+		return;
+	}
+
+	mLearner->Train(tuples);
+	int iter = mLearner->GetIter();
+	if (mOutputFile != "" && iter > 0 && iter % mItersPerOutput == 0)
+	{
+		mLearner->OutputModel(mOutputFile);
+	}
+}
+
+void cOptScenarioKinRollout::WriteState(const Eigen::VectorXd& state)
+{
+	if (mStateOutput != nullptr)
+	{
+		// one state per line
+		int size = static_cast<int>(state.size());
+		for (int i = 0; i < size; ++i)
+		{
+			fprintf(mStateOutput, (i == 0) ? "%.6f" : ", %.6f", state[i]);
+		}
+		fprintf(mStateOutput, "\n");
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "scenarios/Scenario.h"
+#include "anim/KinCharacter.h"
+#include "sim/GroundVar2D.h"
+#include "learning/TrainerInterface.h"
+#include "learning/ExpTuple.h"
+#include "util/Rand.h"
+
+// rolls a character out along a motion clip over a kinematic ground with no dynamics world,
+// the policy states are laid out like the ones of cTerrainRLCharController,
+// so the tuples can pretrain a policy through the usual trainer path
+// and the states can be written out for state-space sweeps
+class cOptScenarioKinRollout : public cScenario
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	cOptScenarioKinRollout();
+	virtual ~cOptScenarioKinRollout();
+
+	virtual void ParseArgs(const cArgParser& parser);
+	virtual void Init();
+	virtual void Clear();
+	virtual void Run();
+
+	virtual std::string GetName() const;
+
+protected:
+	std::string mCharFile;
+	std::string mMotionFile;
+	std::string mTerrainFile;
+	std::string mTerrainLibFile;
+	double mTerrainBlend;
+
+	int mNumTuples;
+	int mEpisodeLength;
+	int mBatchSize;
+	double mTimeStep;
+	double mTargetVel;
+	int mActionID;
+	int mSeed;
+	double mMotionCacheStep; // resampling step for the motion clip, 0 samples the clip directly
+	std::string mStateOutputFile;
+
+	cTrainerInterface::tParams mTrainerParams;
+	std::string mPoliModelFile;
+	std::string mOutputFile;
+	int mItersPerOutput;
+
+	cKinCharacter mChar;
+	Eigen::MatrixXd mBodyDefs;
+	std::shared_ptr<cGroundVar2D> mGround;
+	double mTime;
+
+	cRand mRand;
+	cKinTree::tFKCache mFKCache;
+	Eigen::VectorXd mPose;
+	Eigen::MatrixXd mPartPos;
+	Eigen::MatrixXd mNextPartPos;
+
+	std::shared_ptr<cTrainerInterface> mTrainer;
+	std::shared_ptr<cNeuralNetLearner> mLearner;
+	cNeuralNet mNet;
+	FILE* mStateOutput;
+
+	virtual bool BuildGround();
+	virtual void InitTrainer();
+	virtual bool EnableTraining() const;
+
+	virtual void ResetEpisode();
+	virtual void UpdateGround();
+	virtual void BuildPose(double time, Eigen::VectorXd& out_pose) const;
+
+	virtual int GetPoliStateSize() const;
+	virtual void BuildPoliState(double time, Eigen::VectorXd& out_state);
+	virtual void CalcPartPos(const Eigen::VectorXd& pose, Eigen::MatrixXd& out_pos);
+	virtual double CalcReward(double dist, double time_step) const;
+	virtual void BuildAction(Eigen::VectorXd& out_action) const;
+
+	virtual void TrainBatch(const std::vector<tExpTuple>& tuples);
+	virtual void WriteState(const Eigen::VectorXd& state);
+};
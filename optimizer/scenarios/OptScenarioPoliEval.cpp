@@ -43,6 +43,14 @@ void cOptScenarioPoliEval::ParseArgs(const cArgParser& parser)
 	int rand_seed = 0;
 	parser.ParseInt("poli_eval_rand_seed", rand_seed);
 	mRandSeed = static_cast<unsigned long>(rand_seed);
+
+	std::string placement_str = "";
+	std::vector<int> placement_cpus;
+	cThreadPlacement::ePolicy placement_policy = cThreadPlacement::ePolicyNone;
+	parser.ParseString("thread_placement", placement_str);
+	parser.ParseIntArray("thread_cpus", placement_cpus);
+	cThreadPlacement::ParsePolicy(placement_str, placement_policy);
+	mPlacement.Init(placement_policy, placement_cpus);
 }
 
 void cOptScenarioPoliEval::Reset()
@@ -73,6 +81,10 @@ void cOptScenarioPoliEval::Run()
 {
 	int num_threads = GetPoolSize();
 	std::vector<std::thread> threads(num_threads);
+	mPlacement.PrintPlacement(num_threads);
+
+	int beg_cycles = mCycleCount;
+	auto run_beg = std::chrono::steady_clock::now();
 
 	for (int i = 0; i < num_threads; ++i)
 	{
@@ -95,7 +107,7 @@ void cOptScenarioPoliEval::Run()
 		eval_params.mMaxCycles = max_cycles;
 
 		std::thread& curr_thread = threads[i];
-		curr_thread = std::thread(&cOptScenarioPoliEval::EvalHelper, this, eval_params, mEvalPool[i]);
+		curr_thread = std::thread(&cOptScenarioPoliEval::EvalHelper, this, eval_params, mEvalPool[i], i);
 	}
 
 	for (int i = 0; i < num_threads; ++i)
@@ -103,6 +115,11 @@ void cOptScenarioPoliEval::Run()
 		threads[i].join();
 	}
 
+	std::chrono::duration<double> run_time = std::chrono::steady_clock::now() - run_beg;
+	int num_cycles = mCycleCount - beg_cycles;
+	printf("Evaluated %i cycles with %i threads in %.3fs, %.1f cycles/s\n", num_cycles, num_threads,
+			run_time.count(), num_cycles / std::max(run_time.count(), 1e-6));
+
 	if (mOutputFile != "")
 	{
 		OutputResults(mOutputFile);
@@ -147,18 +164,25 @@ void cOptScenarioPoliEval::BuildScenePool()
 	for (int i = 0; i < GetPoolSize(); ++i)
 	{
 		auto& curr_eval = mEvalPool[i];
-		curr_eval = std::shared_ptr<cScenarioPoliEval>(new cScenarioPoliEval());
-		curr_eval->ParseArgs(mArgParser);
+		// built on the cpu of the thread that will run it so its memory is on the local node
+		mPlacement.RunPinned(i, [this, valid_seed, curr_seed, &curr_eval]()
+		{
+			curr_eval = std::shared_ptr<cScenarioPoliEval>(new cScenarioPoliEval());
+			curr_eval->ParseArgs(mArgParser);
 
-		curr_eval->Init();
+			curr_eval->Init();
+
+			if (valid_seed)
+			{
+				curr_eval->SetRandSeed(curr_seed);
+				curr_eval->Reset(); // rebuild ground
+			}
+		});
 
 		if (valid_seed)
 		{
-			curr_eval->SetRandSeed(curr_seed);
-			curr_eval->Reset(); // rebuild ground
 			curr_seed = static_cast<unsigned long>(std::abs(rand.RandInt()));
 		}
-
 	}
 }
 
@@ -167,8 +191,10 @@ int cOptScenarioPoliEval::GetPoolSize() const
 	return static_cast<int>(mEvalPool.size());
 }
 
-void cOptScenarioPoliEval::EvalHelper(tEvalParams eval_params, std::shared_ptr<cScenarioPoliEval> eval)
+void cOptScenarioPoliEval::EvalHelper(tEvalParams eval_params, std::shared_ptr<cScenarioPoliEval> eval, int eval_id)
 {
+	mPlacement.PinThread(eval_id);
+
 	const int num_episodes_per_update = 10;
 
 	int num_episodes = 0;
@@ -3,6 +3,7 @@
 #include <string>
 #include <mutex>
 #include "scenarios/ScenarioPoliEval.h"
+#include "util/ThreadPlacement.h"
 
 class cOptScenarioPoliEval : public cScenario
 {
@@ -42,6 +43,7 @@ protected:
 	double mAvgDist;
 
 	std::mutex mUpdateMutex;
+	cThreadPlacement mPlacement;
 
 	std::string mOutputFile;
 
@@ -49,7 +51,7 @@ protected:
 	virtual void BuildScenePool();
 	virtual int GetPoolSize() const;
 
-	virtual void EvalHelper(tEvalParams eval_params, std::shared_ptr<cScenarioPoliEval> eval);
+	virtual void EvalHelper(tEvalParams eval_params, std::shared_ptr<cScenarioPoliEval> eval, int eval_id);
 	virtual void UpdateRecord(double avg_dist, int num_episodes, int num_cycles);
 
 	virtual void OutputResults(const std::string& out_file) const;
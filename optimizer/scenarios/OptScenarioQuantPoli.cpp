@@ -0,0 +1,262 @@
+#include "OptScenarioQuantPoli.h"
+#include <ctime>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <json/json.h>
+
+cOptScenarioQuantPoli::tReport::tReport()
+{
+	mNumStates = 0;
+	mMaxAbsDelta = 0;
+	mMeanAbsDelta = 0;
+	mRMSDelta = 0;
+	mMaxRelDelta = 0;
+	mFloatEvalTime = 0;
+	mQuantEvalTime = 0;
+}
+
+cOptScenarioQuantPoli::cOptScenarioQuantPoli()
+{
+	mPoliNetFile = "";
+	mPoliModelFile = "";
+	mCalibStateFile = "";
+	mEvalStateFile = "";
+	mQuantModelFile = "";
+	mReportFile = "";
+	mMaxCalibStates = std::numeric_limits<int>::max();
+}
+
+cOptScenarioQuantPoli::~cOptScenarioQuantPoli()
+{
+}
+
+void cOptScenarioQuantPoli::ParseArgs(const cArgParser& parser)
+{
+	cScenario::ParseArgs(parser);
+	parser.ParseString("policy_arch_config", mPoliNetFile);
+	parser.ParseString("policy_model", mPoliModelFile);
+	parser.ParseString("quant_calib_state_file", mCalibStateFile);
+	parser.ParseString("quant_eval_state_file", mEvalStateFile);
+	parser.ParseString("quant_model_output", mQuantModelFile);
+	parser.ParseString("quant_report_output", mReportFile);
+	parser.ParseInt("quant_max_calib_states", mMaxCalibStates);
+}
+
+void cOptScenarioQuantPoli::Run()
+{
+	cNeuralNet net;
+	net.LoadNet(mPoliNetFile);
+	net.LoadModel(mPoliModelFile);
+	if (!net.HasNet() || !net.HasValidModel())
+	{
+		printf("Failed to load policy %s %s\n", mPoliNetFile.c_str(), mPoliModelFile.c_str());
+		return;
+	}
+
+	int state_size = net.GetInputSize();
+	Eigen::MatrixXd calib_states;
+	bool succ = LoadStates(mCalibStateFile, state_size, mMaxCalibStates, calib_states);
+	if (!succ)
+	{
+		printf("Failed to load calibration states from %s\n", mCalibStateFile.c_str());
+		return;
+	}
+
+	cQuantNet quant_net;
+	succ = net.BuildQuantNet(quant_net);
+	if (!succ)
+	{
+		return;
+	}
+
+	quant_net.Calibrate(calib_states);
+	printf("Calibrated quantized policy with %i states\n", static_cast<int>(calib_states.rows()));
+
+	if (mQuantModelFile != "")
+	{
+		succ = quant_net.OutputModel(mQuantModelFile);
+		if (succ)
+		{
+			printf("Quantized model written to %s\n", mQuantModelFile.c_str());
+		}
+	}
+
+	// the report is built against the backend's float net rather than the
+	// float path of the quantized graph, so conversion errors show up as well
+	Eigen::MatrixXd eval_states;
+	if (mEvalStateFile != "")
+	{
+		succ = LoadStates(mEvalStateFile, state_size, std::numeric_limits<int>::max(), eval_states);
+		if (!succ)
+		{
+			printf("Failed to load evaluation states from %s, using calibration states\n", mEvalStateFile.c_str());
+		}
+	}
+	if (eval_states.rows() == 0)
+	{
+		eval_states = calib_states;
+	}
+
+	tReport report;
+	BuildReport(net, quant_net, eval_states, report);
+	PrintReport(report);
+
+	if (mReportFile != "")
+	{
+		OutputReport(report, mReportFile);
+	}
+}
+
+std::string cOptScenarioQuantPoli::GetName() const
+{
+	return "Quantize Policy";
+}
+
+bool cOptScenarioQuantPoli::LoadStates(const std::string& state_file, int state_size, int max_states, Eigen::MatrixXd& out_states) const
+{
+	// reads the states recorded by the policy evaluation with record_action_id_state,
+	// each line is an optional action id followed by the state
+	std::ifstream f_stream(state_file);
+	if (!f_stream.is_open())
+	{
+		return false;
+	}
+
+	std::vector<Eigen::VectorXd> states;
+	std::string line;
+	while (std::getline(f_stream, line) && static_cast<int>(states.size()) < max_states)
+	{
+		std::vector<double> vals;
+		std::stringstream line_stream(line);
+		std::string token;
+		while (std::getline(line_stream, token, ','))
+		{
+			std::stringstream token_stream(token);
+			double val = 0;
+			if (token_stream >> val)
+			{
+				vals.push_back(val);
+			}
+		}
+
+		int num_vals = static_cast<int>(vals.size());
+		int beg = num_vals - state_size;
+		if (beg == 0 || beg == 1)
+		{
+			states.push_back(Eigen::Map<Eigen::VectorXd>(vals.data() + beg, state_size));
+		}
+		else if (num_vals > 0)
+		{
+			printf("Skipping recorded state with %i values, expecting %i\n", num_vals, state_size);
+		}
+	}
+
+	int num_states = static_cast<int>(states.size());
+	out_states.resize(num_states, state_size);
+	for (int i = 0; i < num_states; ++i)
+	{
+		out_states.row(i) = states[i].transpose();
+	}
+
+	return num_states > 0;
+}
+
+void cOptScenarioQuantPoli::BuildReport(const cNeuralNet& net, const cQuantNet& quant_net, const Eigen::MatrixXd& states, tReport& out_report) const
+{
+	int num_states = static_cast<int>(states.rows());
+	int output_size = quant_net.GetOutputSize();
+
+	Eigen::MatrixXd float_Y(num_states, output_size);
+	Eigen::MatrixXd quant_Y(num_states, output_size);
+	Eigen::VectorXd y;
+
+	std::clock_t float_beg = std::clock();
+	for (int i = 0; i < num_states; ++i)
+	{
+		net.Eval(states.row(i).transpose(), y);
+		float_Y.row(i) = y.transpose();
+	}
+	std::clock_t float_end = std::clock();
+
+	for (int i = 0; i < num_states; ++i)
+	{
+		quant_net.Eval(states.row(i).transpose(), y);
+		quant_Y.row(i) = y.transpose();
+	}
+	std::clock_t quant_end = std::clock();
+
+	Eigen::MatrixXd delta = (quant_Y - float_Y).cwiseAbs();
+	Eigen::VectorXd range = float_Y.colwise().maxCoeff() - float_Y.colwise().minCoeff();
+
+	out_report.mNumStates = num_states;
+	out_report.mMaxAbsDelta = delta.maxCoeff();
+	out_report.mMeanAbsDelta = delta.mean();
+	out_report.mRMSDelta = std::sqrt(delta.squaredNorm() / delta.size());
+	out_report.mOutputMeanAbsDelta = delta.colwise().mean().transpose();
+	out_report.mOutputMaxAbsDelta = delta.colwise().maxCoeff().transpose();
+
+	out_report.mMaxRelDelta = 0;
+	for (int j = 0; j < output_size; ++j)
+	{
+		if (range[j] > 0)
+		{
+			out_report.mMaxRelDelta = std::max(out_report.mMaxRelDelta, out_report.mOutputMaxAbsDelta[j] / range[j]);
+		}
+	}
+
+	out_report.mFloatEvalTime = static_cast<double>(float_end - float_beg) / CLOCKS_PER_SEC / num_states;
+	out_report.mQuantEvalTime = static_cast<double>(quant_end - float_end) / CLOCKS_PER_SEC / num_states;
+}
+
+void cOptScenarioQuantPoli::PrintReport(const tReport& report) const
+{
+	printf("\nQuantized policy report (%i states)\n", report.mNumStates);
+	printf("Max abs delta: %.6f\n", report.mMaxAbsDelta);
+	printf("Mean abs delta: %.6f\n", report.mMeanAbsDelta);
+	printf("RMS delta: %.6f\n", report.mRMSDelta);
+	printf("Max rel delta: %.6f\n", report.mMaxRelDelta);
+	printf("Float eval time: %.3fus\n", report.mFloatEvalTime * 1e6);
+	printf("Quant eval time: %.3fus\n", report.mQuantEvalTime * 1e6);
+	if (report.mQuantEvalTime > 0)
+	{
+		printf("Speedup: %.2fx\n", report.mFloatEvalTime / report.mQuantEvalTime);
+	}
+}
+
+bool cOptScenarioQuantPoli::OutputReport(const tReport& report, const std::string& out_file) const
+{
+	Json::Value root;
+	root["num_states"] = report.mNumStates;
+	root["max_abs_delta"] = report.mMaxAbsDelta;
+	root["mean_abs_delta"] = report.mMeanAbsDelta;
+	root["rms_delta"] = report.mRMSDelta;
+	root["max_rel_delta"] = report.mMaxRelDelta;
+	root["float_eval_time"] = report.mFloatEvalTime;
+	root["quant_eval_time"] = report.mQuantEvalTime;
+
+	Json::Value mean_delta(Json::arrayValue);
+	Json::Value max_delta(Json::arrayValue);
+	for (int i = 0; i < report.mOutputMeanAbsDelta.size(); ++i)
+	{
+		mean_delta.append(report.mOutputMeanAbsDelta[i]);
+		max_delta.append(report.mOutputMaxAbsDelta[i]);
+	}
+	root["output_mean_abs_delta"] = mean_delta;
+	root["output_max_abs_delta"] = max_delta;
+
+	Json::StreamWriterBuilder builder;
+	std::string payload = Json::writeString(builder, root);
+
+	std::ofstream out(out_file.c_str());
+	bool succ = out.good();
+	if (succ)
+	{
+		out << payload;
+	}
+	else
+	{
+		printf("Failed to output quantization report to %s\n", out_file.c_str());
+	}
+	return succ;
+}
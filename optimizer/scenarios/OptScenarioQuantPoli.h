@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include "scenarios/Scenario.h"
+#include "learning/NeuralNet.h"
+#include "learning/QuantNet.h"
+
+// post-training quantization of a policy, calibrates the int8 activation scales
+// from recorded policy states, writes the quantized model and an accuracy report
+class cOptScenarioQuantPoli : public cScenario
+{
+public:
+	cOptScenarioQuantPoli();
+	virtual ~cOptScenarioQuantPoli();
+
+	virtual void ParseArgs(const cArgParser& parser);
+	virtual void Run();
+
+	virtual std::string GetName() const;
+
+protected:
+	struct tReport
+	{
+		int mNumStates;
+		double mMaxAbsDelta;
+		double mMeanAbsDelta;
+		double mRMSDelta;
+		double mMaxRelDelta;
+		Eigen::VectorXd mOutputMeanAbsDelta;
+		Eigen::VectorXd mOutputMaxAbsDelta;
+		double mFloatEvalTime;
+		double mQuantEvalTime;
+
+		tReport();
+	};
+
+	std::string mPoliNetFile;
+	std::string mPoliModelFile;
+	std::string mCalibStateFile;
+	std::string mEvalStateFile;
+	std::string mQuantModelFile;
+	std::string mReportFile;
+	int mMaxCalibStates;
+
+	virtual bool LoadStates(const std::string& state_file, int state_size, int max_states, Eigen::MatrixXd& out_states) const;
+	virtual void BuildReport(const cNeuralNet& net, const cQuantNet& quant_net, const Eigen::MatrixXd& states, tReport& out_report) const;
+	virtual void PrintReport(const tReport& report) const;
+	virtual bool OutputReport(const tReport& report, const std::string& out_file) const;
+};
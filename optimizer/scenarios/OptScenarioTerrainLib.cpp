@@ -0,0 +1,69 @@
+#include "OptScenarioTerrainLib.h"
+#include <ctime>
+
+cOptScenarioTerrainLib::cOptScenarioTerrainLib()
+{
+	mTerrainFile = "";
+	mTerrainBlend = 0;
+	mOutputFile = "";
+	mNumSegments = 1024;
+	// matches the segment width of the var2d ground in cScenarioSimChar
+	mSegmentWidth = 20;
+	mSeed = 0;
+}
+
+cOptScenarioTerrainLib::~cOptScenarioTerrainLib()
+{
+}
+
+void cOptScenarioTerrainLib::ParseArgs(const cArgParser& parser)
+{
+	cScenario::ParseArgs(parser);
+	parser.ParseString("terrain_file", mTerrainFile);
+	parser.ParseDouble("terrain_blend", mTerrainBlend);
+	parser.ParseString("terrain_lib_output", mOutputFile);
+	parser.ParseInt("terrain_lib_segments", mNumSegments);
+	parser.ParseDouble("terrain_lib_segment_width", mSegmentWidth);
+	parser.ParseInt("terrain_lib_seed", mSeed);
+}
+
+void cOptScenarioTerrainLib::Run()
+{
+	if (mOutputFile == "")
+	{
+		printf("No terrain library output specified\n");
+		return;
+	}
+
+	cTerrainGen2D::eType terrain_type = cTerrainGen2D::eTypeFlat;
+	std::vector<Eigen::VectorXd> terrain_params;
+	if (mTerrainFile != "")
+	{
+		bool succ = cTerrainGen2D::LoadTerrainFile(mTerrainFile, terrain_type, terrain_params);
+		if (!succ)
+		{
+			return;
+		}
+	}
+
+	Eigen::VectorXd params = cTerrainGen2D::GetDefaultParams();
+	if (terrain_params.size() > 0)
+	{
+		cTerrainGen2D::LerpParams(terrain_params, mTerrainBlend, params);
+	}
+
+	clock_t beg_time = clock();
+	bool succ = cTerrainLibrary::Build(terrain_type, params, mSegmentWidth, mNumSegments,
+										static_cast<unsigned long>(mSeed), mOutputFile);
+	double build_time = static_cast<double>(clock() - beg_time) / CLOCKS_PER_SEC;
+
+	if (succ)
+	{
+		printf("Built terrain library %s with %i segments in %.3fs\n", mOutputFile.c_str(), mNumSegments, build_time);
+	}
+}
+
+std::string cOptScenarioTerrainLib::GetName() const
+{
+	return "Build Terrain Library";
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include "scenarios/Scenario.h"
+#include "sim/TerrainLibrary.h"
+
+// pregenerates a seeded library of terrain segments for the terrain file
+// and blend given in the args, scenes pick it up through terrain_lib
+class cOptScenarioTerrainLib : public cScenario
+{
+public:
+	cOptScenarioTerrainLib();
+	virtual ~cOptScenarioTerrainLib();
+
+	virtual void ParseArgs(const cArgParser& parser);
+	virtual void Run();
+
+	virtual std::string GetName() const;
+
+protected:
+	std::string mTerrainFile;
+	double mTerrainBlend;
+	std::string mOutputFile;
+	int mNumSegments;
+	double mSegmentWidth;
+	int mSeed;
+};
@@ -36,11 +36,17 @@ newoption {
 	description = "Enable optional IPC integration"
 }
 
+newoption {
+	trigger = "with-egl",
+	description = "Enable headless offscreen rendering through EGL"
+}
+
 local backend = _OPTIONS["backend"] or "libtorch"
 local use_libtorch = (backend == "libtorch" or backend == "both")
 local use_onnxruntime = (backend == "onnxruntime" or backend == "both")
 local use_pybind = _OPTIONS["with-pybind"] ~= nil
 local use_ipc = _OPTIONS["with-ipc"] ~= nil
+local use_egl = _OPTIONS["with-egl"] ~= nil
 
 
 solution "TerrainRL"
@@ -166,6 +172,10 @@ project "TerrainRL"
 	if use_ipc then
 		defines { "ENABLE_OPTIONAL_IPC" }
 	end
+	if use_egl then
+		defines { "ENABLE_EGL" }
+		links { "EGL" }
+	end
 
 
 	-- linux library cflags and libs
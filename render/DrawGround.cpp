@@ -1,5 +1,6 @@
 #include "DrawGround.h"
 #include "DrawUtil.h"
+#include "DrawMesh.h"
 #include "sim/GroundFlat.h"
 #include "sim/GroundVar2D.h"
 
@@ -8,6 +9,37 @@ const double gBigMarkerSpacing = gMarkerSpacing * 5;
 const double gMarkerH = 0.04;
 const double gBigMarkerH = 0.075;
 
+const double gTerrainChunkDepth = 1;
+
+cDrawGround::tTerrainChunk::tTerrainChunk()
+{
+	mBuildID = gInvalidIdx;
+	mLastUsed = 0;
+	mMinY = 0;
+}
+
+cDrawGround::cDrawGround()
+{
+	mTerrainChunkTimer = 0;
+}
+
+cDrawGround::~cDrawGround()
+{
+}
+
+void cDrawGround::Clear()
+{
+	for (int c = 0; c < gNumTerrainChunks; ++c)
+	{
+		tTerrainChunk& chunk = mTerrainChunks[c];
+		chunk.mFill.Clear();
+		chunk.mLine.Clear();
+		chunk.mBuildID = gInvalidIdx;
+		chunk.mLastUsed = 0;
+	}
+	mTerrainChunkTimer = 0;
+}
+
 void cDrawGround::Draw2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max)
 {
 	cGround::eGroundType type = ground->GetGroundType();
@@ -47,10 +79,12 @@ void cDrawGround::DrawFlat2D(const cGround* ground, const tVector& col, const tV
 	assert(ground->GetGroundType() == cGround::eGroundTypeFlat);
 	
 	const cGroundFlat* ground_flat = reinterpret_cast<const cGroundFlat*>(ground);
-	tVector ground_origin = ground_flat->GetPos();
-
 	const double ground_h = ground_flat->SampleHeight(tVector::Zero());
+	DrawFlat2D(ground_h, col, bound_min, bound_max);
+}
 
+void cDrawGround::DrawFlat2D(double ground_h, const tVector& col, const tVector& bound_min, const tVector& bound_max)
+{
 	tVector origin = (bound_min + bound_max) * 0.5;
 	double w = bound_max[0] - bound_min[0];
 	double h = bound_max[1] - bound_min[1];
@@ -66,6 +100,65 @@ void cDrawGround::DrawFlat2D(const cGround* ground, const tVector& col, const tV
 	cDrawUtil::DrawRuler2D(pos, size, col, gMarkerSpacing, gBigMarkerSpacing, gMarkerH, gBigMarkerH);
 }
 
+void cDrawGround::DrawSurface2D(const tVectorArr& surface, const tVector& col, const tVector& bound_min, const tVector& bound_max)
+{
+	int num_verts = static_cast<int>(surface.size());
+	if (num_verts < 2)
+	{
+		return;
+	}
+
+	double min_x = bound_min[0];
+	double max_x = bound_max[0];
+	double min_y = bound_min[1];
+
+	cDrawUtil::SetLineWidth(1);
+	cDrawUtil::SetColor(col);
+	for (int i = 0; i < num_verts - 1; ++i)
+	{
+		tVector a = surface[i];
+		tVector b = surface[i + 1];
+		if (b[0] >= min_x && a[0] <= max_x)
+		{
+			a[2] = 0;
+			b[2] = 0;
+			double curr_min_y = std::min(std::min(a[1], b[1]), min_y);
+			cDrawUtil::DrawQuad(a, tVector(a[0], curr_min_y, 0, 0), tVector(b[0], curr_min_y, 0, 0), b);
+		}
+	}
+
+	cDrawUtil::SetColor(tVector(0, 0, 0, 1));
+	cDrawUtil::DrawLineStrip(surface);
+
+	// the surface is piecewise linear, so markers are placed by walking the vertices
+	cDrawUtil::SetColor(tVector(0.f, 0.f, 0.f, 1.f));
+	for (int m = 0; m < 2; ++m)
+	{
+		bool big = (m == 1);
+		cDrawUtil::SetLineWidth((big) ? 3.f : 2.f);
+		double curr_spacing = (big) ? gBigMarkerSpacing : gMarkerSpacing;
+		double curr_h = (big) ? gBigMarkerH : gMarkerH;
+
+		int i = 0;
+		for (double x = min_x - std::fmod(min_x, curr_spacing); x < max_x; x += curr_spacing)
+		{
+			while (i < num_verts - 2 && surface[i + 1][0] < x)
+			{
+				++i;
+			}
+
+			const tVector& a = surface[i];
+			const tVector& b = surface[i + 1];
+			if (x >= a[0] && x <= b[0] && b[0] > a[0])
+			{
+				double lerp = (x - a[0]) / (b[0] - a[0]);
+				double ground_h = (1 - lerp) * a[1] + lerp * b[1];
+				cDrawUtil::DrawLine(tVector(x, ground_h + curr_h * 0.5f, 0, 0), tVector(x, ground_h - curr_h * 0.5f, 0, 0));
+			}
+		}
+	}
+}
+
 void cDrawGround::DrawFlat3D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max)
 {
 	assert(ground->GetGroundType() == cGround::eGroundTypeFlat);
@@ -106,26 +199,22 @@ void cDrawGround::DrawVar2D(const cGround* ground, const tVector& col, const tVe
 	min_i = cMathUtil::Clamp(min_i, 0, grid_w - 1);
 	max_i = cMathUtil::Clamp(max_i, 0, grid_w - 1);
 
-	for (int i = min_i; i < max_i; ++i)
+	cDrawUtil::SetLineWidth(1);
+	int seg_offset = 0;
+	for (int s = 0; s < cGroundVar2D::gNumSegments; ++s)
 	{
-		tVector a = ground_var->GetVertex(i, 0);
-		tVector b = ground_var->GetVertex(i + 1, 0);
-		a[2] = 0;
-		b[2] = 0;
-
-		double curr_min_y = std::min(a[1], b[1]);
-		curr_min_y = std::min(curr_min_y, min_y);
-
-		tVector c = b;
-		tVector d = a;
-		c[1] = curr_min_y;
-		d[1] = curr_min_y;
-		
-		cDrawUtil::SetLineWidth(1);
-		cDrawUtil::SetColor(col);
-		cDrawUtil::DrawQuad(a, d, c, b);
-		cDrawUtil::SetColor(tVector(0, 0, 0, 1));
-		cDrawUtil::DrawLine(a, b);
+		int seg_w = ground_var->GetSegmentGridWidth(s);
+		if (seg_w > 1)
+		{
+			// neighbouring segments share their boundary vertex
+			int seg_min_i = std::max(min_i - seg_offset, 0);
+			int seg_max_i = std::min(max_i - seg_offset, seg_w - 1);
+			if (seg_min_i < seg_max_i)
+			{
+				DrawVar2DSegment(ground_var, s, seg_min_i, seg_max_i, min_y, col);
+			}
+			seg_offset += seg_w - 1;
+		}
 	}
 
 	// draw markers
@@ -152,6 +241,104 @@ void cDrawGround::DrawVar2D(const cGround* ground, const tVector& col, const tVe
 	}
 }
 
+void cDrawGround::DrawVar2DSegment(const cGroundVar2D* ground, int s, int min_i, int max_i,
+									double min_y, const tVector& col)
+{
+	const tTerrainChunk& chunk = GetTerrainChunk(ground, s);
+	int num_verts = max_i - min_i + 1;
+
+	cDrawUtil::SetColor(col);
+	chunk.mFill.Draw(GL_TRIANGLE_STRIP, 2 * min_i, 2 * num_verts);
+	if (min_y < chunk.mMinY)
+	{
+		tVector a = ground->GetSegmentVertex(s, min_i, 0);
+		tVector b = ground->GetSegmentVertex(s, max_i, 0);
+		cDrawUtil::DrawQuad(tVector(a[0], chunk.mMinY, 0, 0), tVector(a[0], min_y, 0, 0),
+							tVector(b[0], min_y, 0, 0), tVector(b[0], chunk.mMinY, 0, 0));
+	}
+
+	cDrawUtil::SetColor(tVector(0, 0, 0, 1));
+	chunk.mLine.Draw(GL_LINE_STRIP, min_i, num_verts);
+}
+
+cDrawGround::tTerrainChunk& cDrawGround::GetTerrainChunk(const cGroundVar2D* ground, int s)
+{
+	int build_id = ground->GetSegmentBuildID(s);
+	++mTerrainChunkTimer;
+
+	int chunk_idx = 0;
+	for (int c = 0; c < gNumTerrainChunks; ++c)
+	{
+		const tTerrainChunk& curr_chunk = mTerrainChunks[c];
+		if (curr_chunk.mBuildID == build_id)
+		{
+			chunk_idx = c;
+			break;
+		}
+		else if (curr_chunk.mLastUsed < mTerrainChunks[chunk_idx].mLastUsed)
+		{
+			chunk_idx = c;
+		}
+	}
+
+	tTerrainChunk& chunk = mTerrainChunks[chunk_idx];
+	chunk.mLastUsed = mTerrainChunkTimer;
+
+	if (chunk.mBuildID != build_id)
+	{
+		int grid_w = ground->GetSegmentGridWidth(s);
+		double min_y = std::numeric_limits<double>::infinity();
+		for (int i = 0; i < grid_w; ++i)
+		{
+			min_y = std::min(min_y, ground->GetSegmentVertex(s, i, 0)[1]);
+		}
+		min_y -= gTerrainChunkDepth;
+
+		const tVector normal = tVector(0, 0, 1, 0);
+		std::vector<float> fill_data;
+		std::vector<float> line_data;
+		fill_data.reserve(grid_w * 2 * cDrawMesh::gVertSize);
+		line_data.reserve(grid_w * cDrawMesh::gVertSize);
+
+		for (int i = 0; i < grid_w; ++i)
+		{
+			tVector top = ground->GetSegmentVertex(s, i, 0);
+			top[2] = 0;
+			tVector bottom = top;
+			bottom[1] = min_y;
+
+			const tVector* fill_verts[] = { &top, &bottom };
+			for (int v = 0; v < 2; ++v)
+			{
+				for (int k = 0; k < cDrawMesh::gPosSize; ++k)
+				{
+					fill_data.push_back(static_cast<float>((*fill_verts[v])[k]));
+				}
+				for (int k = 0; k < cDrawMesh::gNormalSize; ++k)
+				{
+					fill_data.push_back(static_cast<float>(normal[k]));
+				}
+			}
+
+			for (int k = 0; k < cDrawMesh::gPosSize; ++k)
+			{
+				line_data.push_back(static_cast<float>(top[k]));
+			}
+			for (int k = 0; k < cDrawMesh::gNormalSize; ++k)
+			{
+				line_data.push_back(static_cast<float>(normal[k]));
+			}
+		}
+
+		chunk.mFill.Init(fill_data);
+		chunk.mLine.Init(line_data);
+		chunk.mMinY = min_y;
+		chunk.mBuildID = build_id;
+	}
+
+	return chunk;
+}
+
 void cDrawGround::DrawVar3D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max)
 {
 	assert(ground->GetGroundType() == cGround::eGroundTypeVar2D);
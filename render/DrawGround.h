@@ -1,16 +1,53 @@
 #pragma once
 
 #include "sim/Ground.h"
+#include "render/DrawMesh.h"
 
+class cGroundVar2D;
+
+// terrain segments are uploaded once per build and kept until they are regenerated,
+// the cache is per instance, so each gl context should draw through its own cDrawGround
 class cDrawGround
 {
 public:
-	static void Draw2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
+	cDrawGround();
+	virtual ~cDrawGround();
+
+	// releases the cached terrain buffers, call while the gl context is still current
+	virtual void Clear();
+
+	virtual void Draw2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
 	static void Draw3D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
 
+	// draw from copies of the ground state, eg. a cSceneSnapshot
+	static void DrawFlat2D(double ground_h, const tVector& col, const tVector& bound_min, const tVector& bound_max);
+	static void DrawSurface2D(const tVectorArr& surface, const tVector& col, const tVector& bound_min, const tVector& bound_max);
+
 protected:
+	// the fill extends a fixed depth below the lowest point of the segment
+	// and anything further down is covered by a single quad
+	static const int gNumTerrainChunks = 4;
+
+	struct tTerrainChunk
+	{
+		int mBuildID;
+		int mLastUsed;
+		double mMinY;
+		cDrawMesh mFill;
+		cDrawMesh mLine;
+
+		tTerrainChunk();
+	};
+
+	tTerrainChunk mTerrainChunks[gNumTerrainChunks];
+	int mTerrainChunkTimer;
+
 	static void DrawFlat2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
 	static void DrawFlat3D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
-	static void DrawVar2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
+	virtual void DrawVar2D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
 	static void DrawVar3D(const cGround* ground, const tVector& col, const tVector& bound_min, const tVector& bound_max);
+
+	virtual void DrawVar2DSegment(const cGroundVar2D* ground, int s, int min_i, int max_i,
+								double min_y, const tVector& col);
+	virtual tTerrainChunk& GetTerrainChunk(const cGroundVar2D* ground, int s);
 };
\ No newline at end of file
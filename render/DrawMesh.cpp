@@ -0,0 +1,69 @@
+#include "DrawMesh.h"
+#include <cassert>
+
+cDrawMesh::cDrawMesh()
+{
+	mBuffer = 0;
+	mNumVerts = 0;
+}
+
+cDrawMesh::~cDrawMesh()
+{
+	// the buffer is not released here since the context may already be gone
+	// by the time the mesh is destroyed, use Clear while it is still alive
+}
+
+void cDrawMesh::Init(const std::vector<float>& data)
+{
+	assert(data.size() % gVertSize == 0);
+	mNumVerts = static_cast<int>(data.size()) / gVertSize;
+
+	if (mBuffer == 0)
+	{
+		glGenBuffers(1, &mBuffer);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void cDrawMesh::Clear()
+{
+	if (mBuffer != 0)
+	{
+		glDeleteBuffers(1, &mBuffer);
+		mBuffer = 0;
+	}
+	mNumVerts = 0;
+}
+
+bool cDrawMesh::IsValid() const
+{
+	return mBuffer != 0;
+}
+
+int cDrawMesh::GetNumVerts() const
+{
+	return mNumVerts;
+}
+
+void cDrawMesh::Draw(GLenum prim, int first, int count) const
+{
+	assert(IsValid());
+	assert(first >= 0 && first + count <= mNumVerts);
+	GLsizei stride = static_cast<GLsizei>(gVertSize * sizeof(float));
+	const float* offset = nullptr;
+
+	glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(gPosSize, GL_FLOAT, stride, offset);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glNormalPointer(GL_FLOAT, stride, offset + gPosSize);
+
+	glDrawArrays(prim, first, count);
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+
+// vertex buffer that is uploaded once and drawn with vertex arrays,
+// vertices are interleaved as [pos(3), normal(3)] floats
+class cDrawMesh
+{
+public:
+	static const int gPosSize = 3;
+	static const int gNormalSize = 3;
+	static const int gVertSize = gPosSize + gNormalSize;
+
+	cDrawMesh();
+	virtual ~cDrawMesh();
+
+	// the buffer is reused when a mesh is rebuilt, so the gl context has to be current
+	virtual void Init(const std::vector<float>& data);
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+	virtual int GetNumVerts() const;
+	virtual void Draw(GLenum prim, int first, int count) const;
+
+protected:
+	GLuint mBuffer;
+	int mNumVerts;
+};
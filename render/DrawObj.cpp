@@ -59,4 +59,25 @@ void cDrawObj::DrawCapsule(const cSimCapsule* cap, cDrawUtil::eDrawMode draw_mod
 	cDrawUtil::DrawCapsule(h, r, 8, 8, draw_mode);
 
 	glPopMatrix();
+}
+
+void cDrawObj::AddSnapshotShape(const cSimObj* obj, const tVector& fill_col, const tVector& line_col, cSceneSnapshot& out_snapshot)
+{
+	tVector axis;
+	double theta;
+	obj->GetRotation(axis, theta);
+	tMatrix trans = cMathUtil::TranslateMat(obj->GetPos()) * cMathUtil::RotateMat(axis, theta);
+
+	cSimObj::eShape shape = obj->GetShape();
+	if (shape == cSimObj::eShapeBox)
+	{
+		const cSimBox* box = reinterpret_cast<const cSimBox*>(obj);
+		out_snapshot.AddShape(cSceneSnapshot::eShapeBox, trans, box->GetSize(), fill_col, line_col);
+	}
+	else if (shape == cSimObj::eShapeCapsule)
+	{
+		const cSimCapsule* cap = reinterpret_cast<const cSimCapsule*>(obj);
+		tVector size = tVector(cap->GetHeight(), cap->GetRadius(), 0, 0);
+		out_snapshot.AddShape(cSceneSnapshot::eShapeCapsule, trans, size, fill_col, line_col);
+	}
 }
\ No newline at end of file
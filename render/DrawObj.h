@@ -5,6 +5,7 @@
 #include "sim/SimBox.h"
 #include "sim/SimPlane.h"
 #include "sim/SimCapsule.h"
+#include "render/SceneSnapshot.h"
 
 class cDrawObj
 {
@@ -13,4 +14,7 @@ public:
 	static void DrawBox(const cSimBox* box, cDrawUtil::eDrawMode draw_mode = cDrawUtil::eDrawSolid);
 	static void DrawPlane(const cSimPlane* plane, double size, cDrawUtil::eDrawMode draw_mode = cDrawUtil::eDrawSolid);
 	static void DrawCapsule(const cSimCapsule* cap, cDrawUtil::eDrawMode draw_mode = cDrawUtil::eDrawSolid);
+
+	// records the object's current transform instead of drawing it, planes are not recorded
+	static void AddSnapshotShape(const cSimObj* obj, const tVector& fill_col, const tVector& line_col, cSceneSnapshot& out_snapshot);
 };
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "DrawSceneSnapshot.h"
+#include "render/DrawUtil.h"
+#include "render/DrawGround.h"
+#include "render/DrawPerturb.h"
+
+void cDrawSceneSnapshot::DrawShapes(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp)
+{
+	bool blend = cSceneSnapshot::CanLerpShapes(prev, curr) && lerp < 1;
+
+	cDrawUtil::SetLineWidth(1);
+	for (int s = 0; s < static_cast<int>(curr.mShapes.size()); ++s)
+	{
+		const cSceneSnapshot::tShape& shape = curr.mShapes[s];
+		if (blend)
+		{
+			tMatrix trans = cSceneSnapshot::LerpShapeTrans(prev, curr, s, lerp);
+			DrawShape(shape, trans);
+		}
+		else
+		{
+			DrawShape(shape, shape.mTrans);
+		}
+	}
+}
+
+void cDrawSceneSnapshot::DrawGround(const cSceneSnapshot& snapshot, const tVector& bound_min, const tVector& bound_max)
+{
+	switch (snapshot.mGroundType)
+	{
+	case cSceneSnapshot::eGroundFlat:
+		cDrawGround::DrawFlat2D(snapshot.mGroundHeight, snapshot.mGroundCol, bound_min, bound_max);
+		break;
+	case cSceneSnapshot::eGroundVar2D:
+		cDrawGround::DrawSurface2D(snapshot.mGroundSurface, snapshot.mGroundCol, bound_min, bound_max);
+		break;
+	default:
+		break;
+	}
+}
+
+void cDrawSceneSnapshot::DrawPerturbs(const cSceneSnapshot& snapshot)
+{
+	for (size_t p = 0; p < snapshot.mPerturbs.size(); ++p)
+	{
+		const cSceneSnapshot::tPerturbEntry& perturb = snapshot.mPerturbs[p];
+		if (perturb.mTorque)
+		{
+			cDrawPerturb::DrawTorque2D(perturb.mPos, perturb.mPerturb);
+		}
+		else
+		{
+			cDrawPerturb::DrawForce2D(perturb.mPos, perturb.mPerturb);
+		}
+	}
+}
+
+void cDrawSceneSnapshot::DrawTrace(const cSceneSnapshot& snapshot)
+{
+	if (snapshot.mEnableTrace)
+	{
+		snapshot.mTracer.Draw();
+	}
+}
+
+void cDrawSceneSnapshot::DrawShape(const cSceneSnapshot::tShape& shape, const tMatrix& trans)
+{
+	glPushMatrix();
+	cDrawUtil::GLMultMatrix(trans);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		bool wire = (i == 1);
+		if (wire && shape.mLineCol[3] <= 0)
+		{
+			break;
+		}
+
+		cDrawUtil::eDrawMode draw_mode = (wire) ? cDrawUtil::eDrawWire : cDrawUtil::eDrawSolid;
+		cDrawUtil::SetColor((wire) ? shape.mLineCol : shape.mFillCol);
+		switch (shape.mShape)
+		{
+		case cSceneSnapshot::eShapeBox:
+			cDrawUtil::DrawBox(tVector::Zero(), shape.mSize, draw_mode);
+			break;
+		case cSceneSnapshot::eShapeCapsule:
+			cDrawUtil::DrawCapsule(shape.mSize[0], shape.mSize[1], 8, 8, draw_mode);
+			break;
+		default:
+			assert(false); // unsupported shape
+			break;
+		}
+	}
+
+	glPopMatrix();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "render/SceneSnapshot.h"
+
+// draws the contents of scene snapshots, body transforms are blended
+// between the previous and current snapshot by lerp
+class cDrawSceneSnapshot
+{
+public:
+	static void DrawShapes(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp);
+	static void DrawGround(const cSceneSnapshot& snapshot, const tVector& bound_min, const tVector& bound_max);
+	static void DrawPerturbs(const cSceneSnapshot& snapshot);
+	static void DrawTrace(const cSceneSnapshot& snapshot);
+
+protected:
+	static void DrawShape(const cSceneSnapshot::tShape& shape, const tMatrix& trans);
+};
@@ -25,6 +25,67 @@ void cDrawSimCharacter::Draw(const cSimCharacter& character, const tVector& fill
 	}
 }
 
+void cDrawSimCharacter::AddSnapshotShapes(const cSimCharacter& character, const tVector& fill_tint, const tVector& line_col,
+											bool enable_draw_shape, cSceneSnapshot& out_snapshot)
+{
+	const tVector gContactCol = tVector(0.5, 0.75, 0.5, 1);
+
+	bool has_draw_shapes = character.HasDrawShapes();
+	if (has_draw_shapes && enable_draw_shape)
+	{
+		const auto& shape_defs = character.GetDrawShapeDefs();
+		size_t num_shapes = shape_defs.rows();
+		for (int i = 0; i < num_shapes; ++i)
+		{
+			cKinTree::tDrawShapeDef curr_def = shape_defs.row(i);
+			cKinTree::eBodyShape shape = static_cast<cKinTree::eBodyShape>((int) curr_def[cKinTree::eDrawShapeShape]);
+
+			double theta = 0;
+			tVector axis = tVector(0, 0, 1, 0);
+			cKinTree::GetDrawShapeRotation(curr_def, axis, theta);
+			int parent_joint = cKinTree::GetDrawShapeParentJoint(curr_def);
+			tVector attach_pt = cKinTree::GetDrawShapeAttachPt(curr_def);
+			tVector col = cKinTree::GetDrawShapeColor(curr_def);
+			col = col.cwiseProduct(fill_tint);
+
+			tMatrix trans = character.BuildJointWorldTrans(parent_joint);
+			trans = trans * cMathUtil::TranslateMat(attach_pt) * cMathUtil::RotateMat(axis, theta);
+
+			if (shape == cKinTree::eBodyShapeBox)
+			{
+				tVector size = tVector(curr_def[cKinTree::eDrawShapeParam0], curr_def[cKinTree::eDrawShapeParam1], curr_def[cKinTree::eDrawShapeParam2], 0);
+				out_snapshot.AddShape(cSceneSnapshot::eShapeBox, trans, size, col, line_col);
+			}
+			else if (shape == cKinTree::eBodyShapeCapsule)
+			{
+				tVector size = tVector(curr_def[cKinTree::eDrawShapeParam0], curr_def[cKinTree::eDrawShapeParam1], 0, 0);
+				out_snapshot.AddShape(cSceneSnapshot::eShapeCapsule, trans, size, col, line_col);
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < character.GetNumBodyParts(); ++i)
+		{
+			if (character.IsValidBodyPart(i))
+			{
+				const auto& curr_part = character.GetBodyPart(i);
+				tVector col;
+				if (curr_part->IsInContact())
+				{
+					col = gContactCol;
+				}
+				else
+				{
+					col = character.GetPartColor(i);
+					col = col.cwiseProduct(fill_tint);
+				}
+				cDrawObj::AddSnapshotShape(curr_part.get(), col, line_col, out_snapshot);
+			}
+		}
+	}
+}
+
 void cDrawSimCharacter::DrawCoM(const cSimCharacter& character, double marker_size, double vel_scale, 
 								const tVector& col, const tVector& offset)
 {
@@ -82,9 +143,8 @@ void cDrawSimCharacter::DrawPoliInfo(const cCharController* ctrl, const cCamera&
 	const cTerrainRLCharController* trl_ctrl = dynamic_cast<const cTerrainRLCharController*>(ctrl);
 	if (trl_ctrl != nullptr)
 	{
-		const cCircularBuffer<double>& val_log = trl_ctrl->GetPoliValLog();
 		double aspect = cam.GetAspectRatio();
-		DrawInfoValLog(val_log, aspect);
+		DrawInfoValLog(*trl_ctrl, aspect);
 	}
 #endif
 }
@@ -260,8 +320,10 @@ void cDrawSimCharacter::DrawPolicyPlots(const cCharController* ctrl, const cCame
 	glPopMatrix();
 }
 
-void cDrawSimCharacter::DrawInfoValLog(const cCircularBuffer<double>& val_log, double aspect)
+void cDrawSimCharacter::DrawInfoValLog(const cTerrainRLCharController& ctrl, double aspect)
 {
+#if defined(ENABLE_DEBUG_VISUALIZATION)
+	const cTerrainRLCharController::tPoliValLog& val_log = ctrl.GetPoliValLog();
 	const double min_val = 0;
 	const double max_val = 1;
 	
@@ -324,6 +386,7 @@ void cDrawSimCharacter::DrawInfoValLog(const cCircularBuffer<double>& val_log, d
 		glMatrixMode(GL_MODELVIEW);
 		glPopMatrix();
 	}
+#endif // ENABLE_DEBUG_VISUALIZATION
 }
 
 int cDrawSimCharacter::GetCharNumGroundFeatures(const cSimCharacter& character)
@@ -2,19 +2,23 @@
 
 #include "sim/SimCharacter.h"
 #include "sim/Ground.h"
-#include "util/CircularBuffer.h"
 #include "render/Camera.h"
+#include "render/SceneSnapshot.h"
 
 class cCharController;
 class cDogController;
 class cDogControllerCacla;
 class cRaptorController;
 class cRaptorControllerCacla;
+class cTerrainRLCharController;
 
 class cDrawSimCharacter
 {
 public:
 	static void Draw(const cSimCharacter& character, const tVector& fill_tint, const tVector& line_col, bool enable_draw_shape = false);
+	// records the shapes Draw would draw, in the same order
+	static void AddSnapshotShapes(const cSimCharacter& character, const tVector& fill_tint, const tVector& line_col,
+								bool enable_draw_shape, cSceneSnapshot& out_snapshot);
 	static void DrawCoM(const cSimCharacter& character, double marker_size, double vel_scale,
 						const tVector& col, const tVector& offset);
 	static void DrawTorque(const cSimCharacter& character, const tVector& offset);
@@ -29,7 +33,7 @@ public:
 	static void DrawPolicyPlots(const cCharController* ctrl, const cCamera& cam);
 
 protected:
-	static void DrawInfoValLog(const cCircularBuffer<double>& val_log, double aspect);
+	static void DrawInfoValLog(const cTerrainRLCharController& ctrl, double aspect);
 
 	static int GetCharNumGroundFeatures(const cSimCharacter& character);
 	static tVector GetCharGroundSample(const cSimCharacter& character, int i);
@@ -10,4 +10,20 @@ void cDrawWorld::DrawPerturbs(const cWorld& world)
 		const tPerturb& perturb = perturb_man.GetPerturb(p);
 		cDrawPerturb::Draw(perturb);
 	}
+}
+
+void cDrawWorld::AddSnapshotPerturbs(const cWorld& world, cSceneSnapshot& out_snapshot)
+{
+	const cPerturbManager& perturb_man = world.GetPerturbManager();
+	int num_perturbs = perturb_man.GetNumPerturbs();
+	for (int p = 0; p < num_perturbs; ++p)
+	{
+		const tPerturb& perturb = perturb_man.GetPerturb(p);
+		if (perturb.mType == tPerturb::ePerturbForce || perturb.mType == tPerturb::ePerturbTorque)
+		{
+			bool torque = (perturb.mType == tPerturb::ePerturbTorque);
+			tVector pos = perturb.mObj->LocalToWorldPos(perturb.mLocalPos);
+			out_snapshot.AddPerturb(torque, pos, perturb.mPerturb);
+		}
+	}
 }
\ No newline at end of file
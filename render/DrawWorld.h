@@ -1,9 +1,11 @@
 #pragma once
 
 #include "sim/World.h"
+#include "render/SceneSnapshot.h"
 
 class cDrawWorld
 {
 public:
 	static void DrawPerturbs(const cWorld& world);
+	static void AddSnapshotPerturbs(const cWorld& world, cSceneSnapshot& out_snapshot);
 };
\ No newline at end of file
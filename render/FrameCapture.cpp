@@ -0,0 +1,147 @@
+#include "FrameCapture.h"
+#include <cstring>
+#include <cassert>
+
+cFrameCapture::cFrameCapture()
+{
+	mWidth = 0;
+	mHeight = 0;
+	mNextPBO = 0;
+	mNumFramesCaptured = 0;
+	for (int i = 0; i < gNumPBOs; ++i)
+	{
+		mPBOs[i] = 0;
+		mPending[i] = false;
+	}
+}
+
+cFrameCapture::~cFrameCapture()
+{
+	// the pbos are not released here since the context may already be gone
+	mEncoder.Clear();
+}
+
+bool cFrameCapture::Init(int width, int height, const std::string& out_path,
+						cFrameEncoder::eFormat format, int num_buffers)
+{
+	Clear();
+
+	mWidth = width;
+	mHeight = height;
+	mNextPBO = 0;
+	mNumFramesCaptured = 0;
+
+	bool succ = mEncoder.Init(out_path, format, width, height, num_buffers);
+	if (succ)
+	{
+		size_t frame_size = mWidth * mHeight * cFrameEncoder::gChannels;
+		glGenBuffers(gNumPBOs, mPBOs);
+		for (int i = 0; i < gNumPBOs; ++i)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBOs[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+			mPending[i] = false;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	return succ;
+}
+
+void cFrameCapture::Clear()
+{
+	if (IsValid())
+	{
+		Flush();
+		glDeleteBuffers(gNumPBOs, mPBOs);
+	}
+
+	for (int i = 0; i < gNumPBOs; ++i)
+	{
+		mPBOs[i] = 0;
+		mPending[i] = false;
+	}
+	mEncoder.Clear();
+}
+
+bool cFrameCapture::IsValid() const
+{
+	return mPBOs[0] != 0;
+}
+
+void cFrameCapture::Capture(const cTextureDesc& frame_buffer)
+{
+	assert(IsValid());
+	if (frame_buffer.GetWidth() != mWidth || frame_buffer.GetHeight() != mHeight)
+	{
+		printf("Frame buffer size %ix%i does not match capture size %ix%i, frame skipped\n",
+			frame_buffer.GetWidth(), frame_buffer.GetHeight(), mWidth, mHeight);
+		return;
+	}
+
+	int idx = mNextPBO;
+	int prev_idx = (idx + gNumPBOs - 1) % gNumPBOs;
+	assert(!mPending[idx]);
+
+	GLint prev_read_buffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_buffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_buffer.GetObj());
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBOs[idx]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	// with a pack buffer bound this only queues the copy
+	glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_buffer);
+	mPending[idx] = true;
+	++mNumFramesCaptured;
+
+	// by now the previous frame's copy has had a whole frame to complete
+	if (mPending[prev_idx])
+	{
+		ResolvePBO(prev_idx);
+	}
+	mNextPBO = (idx + 1) % gNumPBOs;
+}
+
+void cFrameCapture::Flush()
+{
+	// resolve in capture order so frames are written in sequence
+	for (int i = 0; i < gNumPBOs; ++i)
+	{
+		int idx = (mNextPBO + i) % gNumPBOs;
+		if (mPending[idx])
+		{
+			ResolvePBO(idx);
+		}
+	}
+	mEncoder.Flush();
+}
+
+int cFrameCapture::GetNumFramesCaptured() const
+{
+	return mNumFramesCaptured;
+}
+
+void cFrameCapture::ResolvePBO(int idx)
+{
+	assert(mPending[idx]);
+	std::vector<uint8_t>* frame = mEncoder.RequestBuffer();
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, mPBOs[idx]);
+	const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (data != nullptr)
+	{
+		std::memcpy(frame->data(), data, frame->size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		printf("Failed to map frame readback buffer\n");
+		std::memset(frame->data(), 0, frame->size());
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	mEncoder.Submit(frame);
+	mPending[idx] = false;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "render/TextureDesc.h"
+#include "render/FrameEncoder.h"
+
+// reads rendered frames back through a pair of pixel buffer objects,
+// the readback for a frame is only mapped once the next frame has been issued,
+// so glReadPixels returns immediately and the copy overlaps with rendering,
+// mapped frames are passed on to a cFrameEncoder for writing
+class cFrameCapture
+{
+public:
+	static const int gNumPBOs = 2;
+
+	cFrameCapture();
+	virtual ~cFrameCapture();
+
+	// the gl context has to be current
+	virtual bool Init(int width, int height, const std::string& out_path,
+					cFrameEncoder::eFormat format, int num_buffers);
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+	virtual void Capture(const cTextureDesc& frame_buffer);
+	// resolves the outstanding readback and waits until every frame is on disk
+	virtual void Flush();
+	virtual int GetNumFramesCaptured() const;
+
+protected:
+	int mWidth;
+	int mHeight;
+	GLuint mPBOs[gNumPBOs];
+	bool mPending[gNumPBOs];
+	int mNextPBO;
+	int mNumFramesCaptured;
+
+	cFrameEncoder mEncoder;
+
+	virtual void ResolvePBO(int idx);
+};
@@ -0,0 +1,360 @@
+#include "FrameEncoder.h"
+#include <cassert>
+#include <algorithm>
+
+const int gRGBChannels = 3;
+const size_t gMaxStoredBlockSize = 0xffff;
+
+bool cFrameEncoder::ParseFormat(const std::string& str, eFormat& out_format)
+{
+	bool succ = true;
+	if (str == "raw")
+	{
+		out_format = eFormatRaw;
+	}
+	else if (str == "png")
+	{
+		out_format = eFormatPNG;
+	}
+	else
+	{
+		printf("Unsupported frame format %s\n", str.c_str());
+		succ = false;
+	}
+	return succ;
+}
+
+cFrameEncoder::cFrameEncoder()
+{
+	mFormat = eFormatPNG;
+	mWidth = 0;
+	mHeight = 0;
+	mRawFile = nullptr;
+	mNumFramesWritten = 0;
+	mNumBusy = 0;
+	mDone = false;
+}
+
+cFrameEncoder::~cFrameEncoder()
+{
+	Clear();
+}
+
+bool cFrameEncoder::Init(const std::string& out_path, eFormat format, int width, int height, int num_buffers)
+{
+	Clear();
+
+	mOutPath = out_path;
+	mFormat = format;
+	mWidth = width;
+	mHeight = height;
+	mNumFramesWritten = 0;
+	mNumBusy = 0;
+	mDone = false;
+
+	if (mFormat == eFormatRaw)
+	{
+		std::string raw_path = mOutPath + ".rgb";
+		mRawFile = fopen(raw_path.c_str(), "wb");
+		if (mRawFile == nullptr)
+		{
+			printf("Failed to open %s\n", raw_path.c_str());
+			return false;
+		}
+		printf("Writing %ix%i rgb24 frames to %s\n", mWidth, mHeight, raw_path.c_str());
+	}
+
+	num_buffers = std::max(1, num_buffers);
+	mBuffers.resize(num_buffers);
+	for (int i = 0; i < num_buffers; ++i)
+	{
+		mBuffers[i].resize(mWidth * mHeight * gChannels);
+		mFreeBuffers.push_back(&mBuffers[i]);
+	}
+
+	mWorker = std::thread(&cFrameEncoder::WorkerLoop, this);
+	return true;
+}
+
+void cFrameEncoder::Clear()
+{
+	if (mWorker.joinable())
+	{
+		Flush();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mDone = true;
+		}
+		mQueueCond.notify_all();
+		mWorker.join();
+	}
+
+	if (mRawFile != nullptr)
+	{
+		fclose(mRawFile);
+		mRawFile = nullptr;
+	}
+
+	mQueue.clear();
+	mFreeBuffers.clear();
+	mBuffers.clear();
+}
+
+bool cFrameEncoder::IsValid() const
+{
+	return !mBuffers.empty();
+}
+
+int cFrameEncoder::GetWidth() const
+{
+	return mWidth;
+}
+
+int cFrameEncoder::GetHeight() const
+{
+	return mHeight;
+}
+
+int cFrameEncoder::GetNumFramesWritten() const
+{
+	return mNumFramesWritten;
+}
+
+std::vector<uint8_t>* cFrameEncoder::RequestBuffer()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mFreeCond.wait(lock, [this]() { return !mFreeBuffers.empty(); });
+
+	std::vector<uint8_t>* buffer = mFreeBuffers.back();
+	mFreeBuffers.pop_back();
+	return buffer;
+}
+
+void cFrameEncoder::Submit(std::vector<uint8_t>* frame)
+{
+	assert(frame->size() == static_cast<size_t>(mWidth * mHeight * gChannels));
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueue.push_back(frame);
+	}
+	mQueueCond.notify_one();
+}
+
+void cFrameEncoder::Flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mFreeCond.wait(lock, [this]() { return mQueue.empty() && mNumBusy == 0; });
+	if (mRawFile != nullptr)
+	{
+		fflush(mRawFile);
+	}
+}
+
+void cFrameEncoder::WorkerLoop()
+{
+	while (true)
+	{
+		std::vector<uint8_t>* frame = nullptr;
+		int frame_idx = 0;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueueCond.wait(lock, [this]() { return mDone || !mQueue.empty(); });
+			if (mQueue.empty())
+			{
+				break;
+			}
+
+			frame = mQueue.front();
+			mQueue.pop_front();
+			frame_idx = mNumFramesWritten + mNumBusy;
+			++mNumBusy;
+		}
+
+		WriteFrame(*frame, frame_idx);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFreeBuffers.push_back(frame);
+			--mNumBusy;
+			++mNumFramesWritten;
+		}
+		mFreeCond.notify_all();
+	}
+}
+
+void cFrameEncoder::WriteFrame(const std::vector<uint8_t>& frame, int frame_idx)
+{
+	switch (mFormat)
+	{
+	case eFormatRaw:
+		WriteRaw(frame);
+		break;
+	case eFormatPNG:
+		WritePNG(frame, frame_idx);
+		break;
+	default:
+		assert(false); // unsupported format
+		break;
+	}
+}
+
+void cFrameEncoder::WriteRaw(const std::vector<uint8_t>& frame)
+{
+	int row_size = mWidth * gRGBChannels;
+	mRowBuffer.resize(row_size);
+
+	// gl rows start at the bottom
+	for (int y = mHeight - 1; y >= 0; --y)
+	{
+		const uint8_t* src = frame.data() + y * mWidth * gChannels;
+		for (int x = 0; x < mWidth; ++x)
+		{
+			mRowBuffer[x * gRGBChannels] = src[x * gChannels];
+			mRowBuffer[x * gRGBChannels + 1] = src[x * gChannels + 1];
+			mRowBuffer[x * gRGBChannels + 2] = src[x * gChannels + 2];
+		}
+		fwrite(mRowBuffer.data(), 1, row_size, mRawFile);
+	}
+}
+
+void cFrameEncoder::WritePNG(const std::vector<uint8_t>& frame, int frame_idx)
+{
+	// scanlines are stored without filtering or compression, which keeps encoding
+	// cheaper than the readback, the frames can be recompressed offline
+	int row_size = 1 + mWidth * gRGBChannels;
+	mRowBuffer.resize(row_size * mHeight);
+	for (int y = 0; y < mHeight; ++y)
+	{
+		const uint8_t* src = frame.data() + (mHeight - 1 - y) * mWidth * gChannels;
+		uint8_t* dst = mRowBuffer.data() + y * row_size;
+		dst[0] = 0; // filter type none
+		++dst;
+		for (int x = 0; x < mWidth; ++x)
+		{
+			dst[x * gRGBChannels] = src[x * gChannels];
+			dst[x * gRGBChannels + 1] = src[x * gChannels + 1];
+			dst[x * gRGBChannels + 2] = src[x * gChannels + 2];
+		}
+	}
+
+	size_t raw_size = mRowBuffer.size();
+	size_t num_blocks = std::max(static_cast<size_t>(1), (raw_size + gMaxStoredBlockSize - 1) / gMaxStoredBlockSize);
+	std::vector<uint8_t>& idat = mPNGData;
+	idat.clear();
+	idat.reserve(2 + raw_size + num_blocks * 5 + 4);
+
+	// zlib stream of stored deflate blocks
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	uint32_t adler_a = 1;
+	uint32_t adler_b = 0;
+	for (size_t b = 0; b < num_blocks; ++b)
+	{
+		size_t beg = b * gMaxStoredBlockSize;
+		size_t len = std::min(gMaxStoredBlockSize, raw_size - beg);
+		bool last = (b == num_blocks - 1);
+
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(static_cast<uint8_t>(len & 0xff));
+		idat.push_back(static_cast<uint8_t>((len >> 8) & 0xff));
+		idat.push_back(static_cast<uint8_t>(~len & 0xff));
+		idat.push_back(static_cast<uint8_t>((~len >> 8) & 0xff));
+		idat.insert(idat.end(), mRowBuffer.begin() + beg, mRowBuffer.begin() + beg + len);
+
+		// the sums cannot overflow within 5552 bytes, so the modulo is deferred
+		for (size_t i = beg; i < beg + len; i += 5552)
+		{
+			size_t end = std::min(beg + len, i + 5552);
+			for (size_t j = i; j < end; ++j)
+			{
+				adler_a += mRowBuffer[j];
+				adler_b += adler_a;
+			}
+			adler_a %= 65521;
+			adler_b %= 65521;
+		}
+	}
+	AppendBE32((adler_b << 16) | adler_a, idat);
+
+	std::vector<uint8_t> header;
+	AppendBE32(mWidth, header);
+	AppendBE32(mHeight, header);
+	header.push_back(8); // bit depth
+	header.push_back(2); // rgb
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	std::vector<uint8_t> png(signature, signature + sizeof(signature));
+	png.reserve(idat.size() + 64);
+	AppendPNGChunk("IHDR", header.data(), header.size(), png);
+	AppendPNGChunk("IDAT", idat.data(), idat.size(), png);
+	AppendPNGChunk("IEND", nullptr, 0, png);
+
+	std::string path = BuildPNGPath(frame_idx);
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f != nullptr)
+	{
+		fwrite(png.data(), 1, png.size(), f);
+		fclose(f);
+	}
+	else
+	{
+		printf("Failed to write frame %s\n", path.c_str());
+	}
+}
+
+std::string cFrameEncoder::BuildPNGPath(int frame_idx) const
+{
+	char buffer[32];
+	sprintf(buffer, "_%06i.png", frame_idx);
+	return mOutPath + buffer;
+}
+
+void cFrameEncoder::AppendPNGChunk(const char* type, const uint8_t* data, size_t size, std::vector<uint8_t>& out_png)
+{
+	AppendBE32(static_cast<uint32_t>(size), out_png);
+	size_t type_beg = out_png.size();
+	out_png.insert(out_png.end(), type, type + 4);
+	if (size > 0)
+	{
+		out_png.insert(out_png.end(), data, data + size);
+	}
+
+	uint32_t crc = CalcCRC(0xffffffff, out_png.data() + type_beg, size + 4) ^ 0xffffffff;
+	AppendBE32(crc, out_png);
+}
+
+uint32_t cFrameEncoder::CalcCRC(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static const std::vector<uint32_t> table = BuildCRCTable();
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+std::vector<uint32_t> cFrameEncoder::BuildCRCTable()
+{
+	std::vector<uint32_t> table(256);
+	for (uint32_t n = 0; n < 256; ++n)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; ++k)
+		{
+			c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+		}
+		table[n] = c;
+	}
+	return table;
+}
+
+void cFrameEncoder::AppendBE32(uint32_t val, std::vector<uint8_t>& out_data)
+{
+	out_data.push_back(static_cast<uint8_t>((val >> 24) & 0xff));
+	out_data.push_back(static_cast<uint8_t>((val >> 16) & 0xff));
+	out_data.push_back(static_cast<uint8_t>((val >> 8) & 0xff));
+	out_data.push_back(static_cast<uint8_t>(val & 0xff));
+}
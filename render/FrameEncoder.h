@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+// writes captured frames to disk on a worker thread so rendering never waits on io,
+// frames are handed over as bottom-up rgba buffers straight from glReadPixels,
+// a fixed pool of buffers bounds the memory, when every buffer is queued
+// RequestBuffer blocks until the worker catches up instead of dropping frames
+class cFrameEncoder
+{
+public:
+	enum eFormat
+	{
+		eFormatRaw, // one file with all frames as top-down rgb24, eg. for ffmpeg -f rawvideo
+		eFormatPNG, // one png per frame
+		eFormatMax
+	};
+
+	static const int gChannels = 4;
+
+	static bool ParseFormat(const std::string& str, eFormat& out_format);
+
+	cFrameEncoder();
+	virtual ~cFrameEncoder();
+
+	// png frames are named <out_path>_<frame>.png, the raw stream is written to <out_path>.rgb
+	virtual bool Init(const std::string& out_path, eFormat format, int width, int height, int num_buffers);
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+	virtual int GetWidth() const;
+	virtual int GetHeight() const;
+	virtual int GetNumFramesWritten() const;
+
+	virtual std::vector<uint8_t>* RequestBuffer();
+	virtual void Submit(std::vector<uint8_t>* frame);
+	virtual void Flush();
+
+protected:
+	std::string mOutPath;
+	eFormat mFormat;
+	int mWidth;
+	int mHeight;
+	FILE* mRawFile;
+
+	std::vector<std::vector<uint8_t>> mBuffers;
+	std::vector<std::vector<uint8_t>*> mFreeBuffers;
+	std::deque<std::vector<uint8_t>*> mQueue;
+	int mNumFramesWritten;
+	int mNumBusy;
+	bool mDone;
+
+	std::thread mWorker;
+	std::mutex mMutex;
+	std::condition_variable mQueueCond;
+	std::condition_variable mFreeCond;
+
+	// encoding scratch, only touched by the worker
+	std::vector<uint8_t> mRowBuffer;
+	std::vector<uint8_t> mPNGData;
+
+	virtual void WorkerLoop();
+	virtual void WriteFrame(const std::vector<uint8_t>& frame, int frame_idx);
+	virtual void WriteRaw(const std::vector<uint8_t>& frame);
+	virtual void WritePNG(const std::vector<uint8_t>& frame, int frame_idx);
+	virtual std::string BuildPNGPath(int frame_idx) const;
+
+	static void AppendPNGChunk(const char* type, const uint8_t* data, size_t size, std::vector<uint8_t>& out_png);
+	static uint32_t CalcCRC(uint32_t crc, const uint8_t* data, size_t size);
+	static std::vector<uint32_t> BuildCRCTable();
+	static void AppendBE32(uint32_t val, std::vector<uint8_t>& out_data);
+};
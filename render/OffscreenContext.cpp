@@ -0,0 +1,168 @@
+#include "OffscreenContext.h"
+#include <cstdio>
+
+#if defined(ENABLE_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool cOffscreenContext::IsSupported()
+{
+#if defined(ENABLE_EGL)
+	return true;
+#else
+	return false;
+#endif
+}
+
+cOffscreenContext::cOffscreenContext()
+{
+	mDisplay = nullptr;
+	mSurface = nullptr;
+	mContext = nullptr;
+}
+
+cOffscreenContext::~cOffscreenContext()
+{
+	Clear();
+}
+
+#if defined(ENABLE_EGL)
+
+bool cOffscreenContext::Init(int width, int height)
+{
+	Clear();
+
+	EGLDisplay display = OpenDisplay();
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+	{
+		printf("Failed to initialize EGL display\n");
+		return false;
+	}
+	mDisplay = display;
+
+	const EGLint config_attribs[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+	{
+		printf("No EGL config for desktop GL\n");
+		Clear();
+		return false;
+	}
+
+	// the renderer uses the fixed function pipeline, so a compatibility context is needed
+	eglBindAPI(EGL_OPENGL_API);
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+	if (context == EGL_NO_CONTEXT)
+	{
+		printf("Failed to create EGL context\n");
+		Clear();
+		return false;
+	}
+	mContext = context;
+
+	const EGLint surface_attribs[] =
+	{
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE
+	};
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attribs);
+	mSurface = (surface == EGL_NO_SURFACE) ? nullptr : surface;
+
+	// without a pbuffer the context can still be made current on its own
+	// if the display supports EGL_KHR_surfaceless_context
+	if (!eglMakeCurrent(display, surface, surface, context))
+	{
+		printf("Failed to make EGL context current\n");
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+void cOffscreenContext::Clear()
+{
+	if (mDisplay != nullptr)
+	{
+		EGLDisplay display = mDisplay;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (mContext != nullptr)
+		{
+			eglDestroyContext(display, mContext);
+		}
+		if (mSurface != nullptr)
+		{
+			eglDestroySurface(display, mSurface);
+		}
+		eglTerminate(display);
+	}
+
+	mDisplay = nullptr;
+	mSurface = nullptr;
+	mContext = nullptr;
+}
+
+void* cOffscreenContext::OpenDisplay() const
+{
+	// prefer enumerating devices since it needs neither X nor a gbm node,
+	// this picks up the gpu on nvidia drivers and llvmpipe under mesa
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLQUERYDEVICESEXTPROC query_devices =
+		reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+		reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	if (query_devices != nullptr && get_platform_display != nullptr)
+	{
+		EGLDeviceEXT device;
+		EGLint num_devices = 0;
+		if (query_devices(1, &device, &num_devices) && num_devices > 0)
+		{
+			display = get_platform_display(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+		}
+	}
+
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	return display;
+}
+
+#else
+
+bool cOffscreenContext::Init(int /*width*/, int /*height*/)
+{
+	printf("Offscreen rendering requires a build with ENABLE_EGL\n");
+	return false;
+}
+
+void cOffscreenContext::Clear()
+{
+}
+
+void* cOffscreenContext::OpenDisplay() const
+{
+	return nullptr;
+}
+
+#endif
+
+bool cOffscreenContext::IsValid() const
+{
+	return mContext != nullptr;
+}
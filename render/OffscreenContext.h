@@ -0,0 +1,25 @@
+#pragma once
+
+// headless gl context for rendering without a window or display server,
+// scenes are drawn into framebuffer objects so the context only needs a token surface,
+// requires a build with ENABLE_EGL, eg. premake4 --with-egl
+class cOffscreenContext
+{
+public:
+	static bool IsSupported();
+
+	cOffscreenContext();
+	virtual ~cOffscreenContext();
+
+	virtual bool Init(int width, int height);
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+protected:
+	// egl handles, kept opaque so egl headers stay out of the rest of the renderer
+	void* mDisplay;
+	void* mSurface;
+	void* mContext;
+
+	virtual void* OpenDisplay() const;
+};
@@ -0,0 +1,87 @@
+#include "SceneSnapshot.h"
+
+void cSceneSnapshot::LerpCamera(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, cCamera& out_cam)
+{
+	out_cam = curr.mCam;
+	if (prev.IsValid())
+	{
+		tVector pos = (1 - lerp) * prev.mCam.GetPosition() + lerp * curr.mCam.GetPosition();
+		tVector focus = (1 - lerp) * prev.mCam.GetFocus() + lerp * curr.mCam.GetFocus();
+		out_cam.SetPosition(pos);
+		out_cam.SetFocus(focus);
+	}
+}
+
+bool cSceneSnapshot::CanLerpShapes(const cSceneSnapshot& prev, const cSceneSnapshot& curr)
+{
+	// shapes are recorded in the same order every step, so a change in count
+	// means objects were spawned or removed and the pairs no longer line up
+	return prev.IsValid() && prev.mShapes.size() == curr.mShapes.size();
+}
+
+tMatrix cSceneSnapshot::LerpShapeTrans(const cSceneSnapshot& prev, const cSceneSnapshot& curr, int s, double lerp)
+{
+	const tMatrix& trans0 = prev.mShapes[s].mTrans;
+	const tMatrix& trans1 = curr.mShapes[s].mTrans;
+
+	Eigen::Quaterniond rot0 = Eigen::Quaterniond(tMatrix3(trans0.block<3, 3>(0, 0)));
+	Eigen::Quaterniond rot1 = Eigen::Quaterniond(tMatrix3(trans1.block<3, 3>(0, 0)));
+
+	tMatrix trans = tMatrix::Identity();
+	trans.block<3, 3>(0, 0) = rot0.slerp(lerp, rot1).toRotationMatrix();
+	trans.block<3, 1>(0, 3) = (1 - lerp) * trans0.block<3, 1>(0, 3) + lerp * trans1.block<3, 1>(0, 3);
+	return trans;
+}
+
+cSceneSnapshot::cSceneSnapshot()
+{
+	mStepCount = gInvalidIdx;
+	mWallTime = 0;
+	mGroundType = eGroundNone;
+	mGroundCol = tVector::Ones();
+	mGroundHeight = 0;
+	mEnableTrace = false;
+}
+
+cSceneSnapshot::~cSceneSnapshot()
+{
+}
+
+void cSceneSnapshot::Clear()
+{
+	mStepCount = gInvalidIdx;
+	mWallTime = 0;
+	mTextInfo.clear();
+	mShapes.clear();
+	mPerturbs.clear();
+	mGroundType = eGroundNone;
+	mGroundHeight = 0;
+	mGroundSurface.clear();
+	mEnableTrace = false;
+}
+
+bool cSceneSnapshot::IsValid() const
+{
+	return mStepCount != gInvalidIdx;
+}
+
+void cSceneSnapshot::AddShape(eShape shape, const tMatrix& trans, const tVector& size,
+								const tVector& fill_col, const tVector& line_col)
+{
+	mShapes.push_back(tShape());
+	tShape& entry = mShapes.back();
+	entry.mShape = shape;
+	entry.mTrans = trans;
+	entry.mSize = size;
+	entry.mFillCol = fill_col;
+	entry.mLineCol = line_col;
+}
+
+void cSceneSnapshot::AddPerturb(bool torque, const tVector& pos, const tVector& perturb)
+{
+	mPerturbs.push_back(tPerturbEntry());
+	tPerturbEntry& entry = mPerturbs.back();
+	entry.mTorque = torque;
+	entry.mPos = pos;
+	entry.mPerturb = perturb;
+}
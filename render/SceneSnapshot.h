@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include "util/MathUtil.h"
+#include "render/Camera.h"
+#include "sim/CharTracer.h"
+
+// immutable copy of everything the main scene needs for drawing,
+// built on the simulation thread after a step so the display can draw it
+// without touching the live simulation, consecutive snapshots can be blended
+class cSceneSnapshot
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	enum eShape
+	{
+		eShapeBox,
+		eShapeCapsule,
+		eShapeMax
+	};
+
+	enum eGround
+	{
+		eGroundNone,
+		eGroundFlat,
+		eGroundVar2D,
+		eGroundMax
+	};
+
+	struct tShape
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		eShape mShape;
+		tMatrix mTrans;
+		// box extents, or height and radius for capsules
+		tVector mSize;
+		tVector mFillCol;
+		tVector mLineCol;
+	};
+
+	struct tPerturbEntry
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		bool mTorque;
+		tVector mPos;
+		tVector mPerturb;
+	};
+
+	typedef std::vector<tShape, Eigen::aligned_allocator<tShape>> tShapeArr;
+	typedef std::vector<tPerturbEntry, Eigen::aligned_allocator<tPerturbEntry>> tPerturbArr;
+
+	// blends the camera and body transforms of two snapshots,
+	// everything else is taken from the newer one
+	static void LerpCamera(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, cCamera& out_cam);
+	static bool CanLerpShapes(const cSceneSnapshot& prev, const cSceneSnapshot& curr);
+	static tMatrix LerpShapeTrans(const cSceneSnapshot& prev, const cSceneSnapshot& curr, int s, double lerp);
+
+	// number of steps simulated so far and the wall clock time the snapshot was published at, in seconds
+	int mStepCount;
+	double mWallTime;
+
+	cCamera mCam;
+	std::string mTextInfo;
+
+	tShapeArr mShapes;
+	tPerturbArr mPerturbs;
+
+	eGround mGroundType;
+	tVector mGroundCol;
+	double mGroundHeight;
+	// surface vertices covering the view plus a margin on either side
+	tVectorArr mGroundSurface;
+
+	bool mEnableTrace;
+	cCharTracer mTracer;
+
+	cSceneSnapshot();
+	virtual ~cSceneSnapshot();
+
+	// keeps the allocations so rebuilding a snapshot every step is cheap
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+	virtual void AddShape(eShape shape, const tMatrix& trans, const tVector& size,
+							const tVector& fill_col, const tVector& line_col);
+	virtual void AddPerturb(bool torque, const tVector& pos, const tVector& perturb);
+};
@@ -31,6 +31,44 @@ void cDrawScenario::Draw()
 	glPopMatrix();
 }
 
+void cDrawScenario::BuildSnapshot(cSceneSnapshot& out_snapshot) const
+{
+	out_snapshot.mCam = mCam;
+	out_snapshot.mTextInfo = BuildTextInfoStr();
+}
+
+void cDrawScenario::DrawSnapshot(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp)
+{
+	cCamera cam;
+	cSceneSnapshot::LerpCamera(prev, curr, lerp, cam);
+
+	glPushMatrix();
+	cam.SetupGLView();
+
+	DrawSetup();
+	DrawSnapshotScene(prev, curr, lerp, cam);
+	DrawCleanup();
+
+	glPopMatrix();
+}
+
+bool cDrawScenario::HasOverlays() const
+{
+	return false;
+}
+
+void cDrawScenario::DrawOverlays(const cCamera& cam)
+{
+	glPushMatrix();
+	cam.SetupGLView();
+
+	DrawSetup();
+	DrawOverlayScene();
+	DrawCleanup();
+
+	glPopMatrix();
+}
+
 void cDrawScenario::Reset()
 {
 	cScenario::Reset();
@@ -287,6 +325,14 @@ void cDrawScenario::DrawScene()
 {
 }
 
+void cDrawScenario::DrawSnapshotScene(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, const cCamera& cam)
+{
+}
+
+void cDrawScenario::DrawOverlayScene()
+{
+}
+
 std::string cDrawScenario::BuildTextInfoStr() const
 {
 	return "";
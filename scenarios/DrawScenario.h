@@ -3,6 +3,7 @@
 
 #include "Scenario.h"
 #include "render/Camera.h"
+#include "render/SceneSnapshot.h"
 
 class cDrawScenario : public cScenario
 {
@@ -34,6 +35,13 @@ public:
 
 	virtual std::string BuildTextInfoStr() const;
 
+	// snapshots let the scene be drawn from another thread while the simulation keeps stepping,
+	// overlays still read the live simulation and have to be drawn while it is paused
+	virtual void BuildSnapshot(cSceneSnapshot& out_snapshot) const;
+	virtual void DrawSnapshot(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp);
+	virtual bool HasOverlays() const;
+	virtual void DrawOverlays(const cCamera& cam);
+
 protected:
 	cCamera& mCam;
 	eCamTrackMode mCamTrackMode;
@@ -57,4 +65,6 @@ protected:
 	virtual void DrawSetup();
 	virtual void DrawCleanup();
 	virtual void DrawScene();
+	virtual void DrawSnapshotScene(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, const cCamera& cam);
+	virtual void DrawOverlayScene();
 };
\ No newline at end of file
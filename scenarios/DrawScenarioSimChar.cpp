@@ -6,6 +6,8 @@
 #include "render/DrawSimCharacter.h"
 #include "render/DrawPerturb.h"
 #include "render/DrawGround.h"
+#include "render/DrawSceneSnapshot.h"
+#include "sim/GroundVar2D.h"
 
 const double gLinkWidth = 0.05f;
 const tVector gLineColor = tVector(0, 0, 0, 1);
@@ -30,6 +32,7 @@ cDrawScenarioSimChar::cDrawScenarioSimChar(cCamera& cam)
 
 cDrawScenarioSimChar::~cDrawScenarioSimChar()
 {
+	mDrawGround.Clear();
 }
 
 void cDrawScenarioSimChar::Init()
@@ -61,6 +64,7 @@ void cDrawScenarioSimChar::Clear()
 	cDrawScenarioSimInteractive::Clear();
 	mScene->Clear();
 	mTracer.Clear();
+	mDrawGround.Clear();
 }
 
 void cDrawScenarioSimChar::Update(double time_elapsed)
@@ -271,6 +275,32 @@ void cDrawScenarioSimChar::DrawScene()
 	DrawObjsMainScene();
 	DrawPerturbs();
 
+	if (mEnableTrace)
+	{
+		DrawTrace();
+	}
+
+	DrawOverlayScene();
+}
+
+void cDrawScenarioSimChar::DrawSnapshotScene(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, const cCamera& cam)
+{
+	DrawGrid(cam);
+
+	tVector focus = cam.GetFocus();
+	tVector half_size = tVector(cam.GetWidth(), cam.GetHeight(), 0, 0) * 0.5;
+	cDrawSceneSnapshot::DrawGround(curr, focus - half_size, focus + half_size);
+	cDrawSceneSnapshot::DrawShapes(prev, curr, lerp);
+	cDrawSceneSnapshot::DrawPerturbs(curr);
+
+	glPushMatrix();
+	cDrawUtil::Translate(GetVisOffset());
+	cDrawSceneSnapshot::DrawTrace(curr);
+	glPopMatrix();
+}
+
+void cDrawScenarioSimChar::DrawOverlayScene()
+{
 	if (mDrawInfo)
 	{
 		DrawInfo();
@@ -281,11 +311,6 @@ void cDrawScenarioSimChar::DrawScene()
 		DrawPoliInfo();
 	}
 
-	if (mEnableTrace)
-	{
-		DrawTrace();
-	}
-
 	if (mDrawFeatures)
 	{
 		DrawFeatures();
@@ -298,12 +323,17 @@ void cDrawScenarioSimChar::DrawScene()
 }
 
 void cDrawScenarioSimChar::DrawGrid() const
+{
+	DrawGrid(mCam);
+}
+
+void cDrawScenarioSimChar::DrawGrid(const cCamera& cam) const
 {
 	const double spacing = 0.10f;
 	const double big_spacing = spacing * 5.f;
-	tVector origin = mCam.GetFocus();
+	tVector origin = cam.GetFocus();
 	origin += tVector(0, 0, -1, 0);
-	tVector size = tVector(mCam.GetWidth(), mCam.GetHeight(), 0, 0);
+	tVector size = tVector(cam.GetWidth(), cam.GetHeight(), 0, 0);
 
 	cDrawUtil::SetColor(tVector(188 / 255.f, 219 / 255.f, 242 / 255.f, 1.f));
 	cDrawUtil::DrawGrid2D(origin, size, spacing, big_spacing);
@@ -335,7 +365,7 @@ void cDrawScenarioSimChar::DrawGround() const
 	tVector ground_col = GetGroundColor();
 	tVector bound_min = focus - tVector(cam_w, cam_h, 0, 0) * 0.5;
 	tVector bound_max = focus + tVector(cam_w, cam_h, 0, 0) * 0.5;
-	cDrawGround::Draw2D(ground.get(), ground_col, bound_min, bound_max);
+	mDrawGround.Draw2D(ground.get(), ground_col, bound_min, bound_max);
 }
 
 void cDrawScenarioSimChar::DrawCharacter() const
@@ -375,6 +405,45 @@ void cDrawScenarioSimChar::DrawObjs() const
 	}
 }
 
+void cDrawScenarioSimChar::BuildGroundSnapshot(cSceneSnapshot& out_snapshot) const
+{
+	const auto& ground = mScene->GetGround();
+	out_snapshot.mGroundCol = GetGroundColor();
+
+	cGround::eGroundType type = ground->GetGroundType();
+	if (type == cGround::eGroundTypeFlat)
+	{
+		out_snapshot.mGroundType = cSceneSnapshot::eGroundFlat;
+		out_snapshot.mGroundHeight = ground->SampleHeight(tVector::Zero());
+	}
+	else if (type == cGround::eGroundTypeVar2D)
+	{
+		const cGroundVar2D* ground_var = reinterpret_cast<const cGroundVar2D*>(ground.get());
+		tVector ground_origin = ground_var->GetPos();
+
+		// half a view of margin on either side, so the window still covers the view
+		// while the display blends the camera towards the next snapshot
+		tVector focus = mCam.GetFocus();
+		double cam_w = mCam.GetWidth();
+		double min_x = focus[0] - cam_w;
+		double max_x = focus[0] + cam_w;
+
+		int grid_w = ground_var->GetGridWidth();
+		tVector min_coord = ground_var->CalcGridCoord(tVector(min_x, 0, ground_origin[2], 0));
+		tVector max_coord = ground_var->CalcGridCoord(tVector(max_x, 0, ground_origin[2], 0));
+		int min_i = static_cast<int>(std::floor(min_coord[0]));
+		int max_i = static_cast<int>(std::ceil(max_coord[0])) + 1;
+		min_i = cMathUtil::Clamp(min_i, 0, grid_w - 1);
+		max_i = cMathUtil::Clamp(max_i, 0, grid_w - 1);
+
+		out_snapshot.mGroundType = cSceneSnapshot::eGroundVar2D;
+		for (int i = min_i; i <= max_i; ++i)
+		{
+			out_snapshot.mGroundSurface.push_back(ground_var->GetVertex(i, 0));
+		}
+	}
+}
+
 tVector cDrawScenarioSimChar::GetVisOffset() const
 {
 	return gVisOffset;
@@ -466,9 +535,40 @@ std::string cDrawScenarioSimChar::BuildTextInfoStr() const
 	return str;
 }
 
+void cDrawScenarioSimChar::BuildSnapshot(cSceneSnapshot& out_snapshot) const
+{
+	cDrawScenarioSimInteractive::BuildSnapshot(out_snapshot);
+
+	const auto& character = mScene->GetCharacter();
+	bool enable_draw_shape = true;
+	cDrawSimCharacter::AddSnapshotShapes(*(character.get()), gFillTint, GetLineColor(), enable_draw_shape, out_snapshot);
+
+	const tVector obj_col = tVector(0.5, 0.5, 0.5, 1);
+	const auto& obj_entries = mScene->GetObjs();
+	for (size_t i = 0; i < obj_entries.size(); ++i)
+	{
+		cDrawObj::AddSnapshotShape(obj_entries[i].mObj.get(), obj_col, GetLineColor(), out_snapshot);
+	}
+
+	cDrawWorld::AddSnapshotPerturbs(*(mScene->GetWorld().get()), out_snapshot);
+	BuildGroundSnapshot(out_snapshot);
+
+	out_snapshot.mEnableTrace = mEnableTrace;
+	if (mEnableTrace)
+	{
+		out_snapshot.mTracer = mTracer;
+	}
+}
+
+bool cDrawScenarioSimChar::HasOverlays() const
+{
+	return mDrawInfo || mDrawPoliInfo || mDrawFeatures || mDrawPolicyPlots;
+}
+
 void cDrawScenarioSimChar::Shutdown()
 {
 	mScene->Shutdown();
+	mDrawGround.Clear();
 }
 
 const std::shared_ptr<cScenarioSimChar>& cDrawScenarioSimChar::GetScene() const
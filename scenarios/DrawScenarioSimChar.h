@@ -5,6 +5,7 @@
 #include "DrawScenarioSimInteractive.h"
 #include "ScenarioSimChar.h"
 #include "sim/CharTracer.h"
+#include "render/DrawGround.h"
 
 class cShader;
 class cSkyBox;
@@ -36,6 +37,9 @@ public:
 	virtual std::string BuildTextInfoStr() const;
 	virtual void Shutdown();
 
+	virtual void BuildSnapshot(cSceneSnapshot& out_snapshot) const;
+	virtual bool HasOverlays() const;
+
 	std::string GetName() const;
 
 protected:
@@ -51,6 +55,9 @@ protected:
 	std::vector<int> mTraceHandles;
 	tVector mCamDelta;
 
+	// keeps the terrain buffers uploaded to this scenario's gl context
+	mutable cDrawGround mDrawGround;
+
 	virtual void BuildScene();
 	virtual tVector GetCamTrackPos() const;
 	virtual tVector GetCamStillPos() const;
@@ -63,7 +70,10 @@ protected:
 	virtual void ToggleTrace();
 
 	virtual void DrawScene();
+	virtual void DrawSnapshotScene(const cSceneSnapshot& prev, const cSceneSnapshot& curr, double lerp, const cCamera& cam);
+	virtual void DrawOverlayScene();
 	virtual void DrawGrid() const;
+	virtual void DrawGrid(const cCamera& cam) const;
 	virtual void DrawGroundMainScene();
 	virtual void DrawCharacterMainScene();
 	virtual void DrawObjsMainScene();
@@ -71,6 +81,7 @@ protected:
 	virtual void DrawCharacter() const;
 	virtual void DrawTrace() const;
 	virtual void DrawObjs() const;
+	virtual void BuildGroundSnapshot(cSceneSnapshot& out_snapshot) const;
 
 	virtual tVector GetVisOffset() const;
 	virtual tVector GetLineColor() const;
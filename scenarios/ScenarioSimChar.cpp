@@ -45,6 +45,12 @@ cScenarioSimChar::tObjEntry::tObjEntry()
 	mEndTime = INFINITY;
 }
 
+cScenarioSimChar::tSnapshot::tSnapshot()
+{
+	mValid = false;
+	mTime = 0;
+}
+
 cScenarioSimChar::cScenarioSimChar()
 {
 	mTime = 0;
@@ -54,8 +60,10 @@ cScenarioSimChar::cScenarioSimChar()
 	mCharType = eCharNone;
 	mCharCtrl = eCharCtrlNone;
 	mExpLayer = "";
+	mPDMassMatTol = cImpPDController::gDefaultMassMatTol;
 	mTerrainType = cTerrainGen2D::eTypeFlat;
 	mTerrainBlend = 0;
+	mTerrainLibFile = "";
 
 	mMinPerturb = 50;
 	mMaxPerturb = 100;
@@ -63,6 +71,10 @@ cScenarioSimChar::cScenarioSimChar()
 	mMaxPerturbDuration = 0.5;
 
 	mGravity = gGravity;
+	mEnableResetSnapshot = false;
+	mStepMode = cStepController::eModeFixed;
+	mStepLogFile = "";
+	mStepReplayFile = "";
 
 	mPreSubstepCallback = nullptr;
 	mPostSubstepCallback = nullptr;
@@ -92,6 +104,7 @@ void cScenarioSimChar::ParseArgs(const cArgParser& parser)
 	parser.ParseInt("num_update_steps", mNumUpdateSteps);
 	parser.ParseInt("num_sim_substeps", mNumSimSubsteps);
 	parser.ParseString("exp_layer", mExpLayer);
+	parser.ParseDouble("pd_mass_mat_tol", mPDMassMatTol);
 
 	std::string char_type_str = "";
 	parser.ParseString("char_type", char_type_str);
@@ -103,6 +116,27 @@ void cScenarioSimChar::ParseArgs(const cArgParser& parser)
 
 	ParseTerrainParams(parser, mTerrainType, mTerrainParams);
 	parser.ParseDouble("terrain_blend", mTerrainBlend);
+	parser.ParseString("terrain_lib", mTerrainLibFile);
+	parser.ParseBool("enable_reset_snapshot", mEnableResetSnapshot);
+
+	std::string step_mode_str = "";
+	parser.ParseString("step_mode", step_mode_str);
+	if (step_mode_str != "")
+	{
+		cStepController::ParseMode(step_mode_str, mStepMode);
+	}
+	parser.ParseInt("adaptive_min_update_steps", mStepParams.mMinUpdateSteps);
+	parser.ParseInt("adaptive_max_update_steps", mStepParams.mMaxUpdateSteps);
+	parser.ParseInt("adaptive_min_sim_substeps", mStepParams.mMinSimSubsteps);
+	parser.ParseInt("adaptive_max_sim_substeps", mStepParams.mMaxSimSubsteps);
+	parser.ParseInt("adaptive_min_solver_iters", mStepParams.mMinSolverIters);
+	parser.ParseInt("adaptive_max_solver_iters", mStepParams.mMaxSolverIters);
+	parser.ParseInt("adaptive_max_step_decrease", mStepParams.mMaxStepDecrease);
+	parser.ParseDouble("adaptive_contact_threshold", mStepParams.mContactThreshold);
+	parser.ParseDouble("adaptive_penetration_threshold", mStepParams.mPenetrationThreshold);
+	parser.ParseDouble("adaptive_vel_change_threshold", mStepParams.mVelChangeThreshold);
+	parser.ParseString("step_log_file", mStepLogFile);
+	parser.ParseString("step_replay_file", mStepReplayFile);
 
 	mValidCharInitPos = parser.ParseDouble("char_init_pos_x", mCharInitPos[0]);
 }
@@ -114,13 +148,24 @@ void cScenarioSimChar::Init()
 	BuildWorld();
 	BuildGround();
 	BuildCharacter();
+	InitStepCtrl();
 
 	ClearObjs();
+	mResetSnapshot.mValid = false;
 }
 
 void cScenarioSimChar::Reset()
 {
 	cScenario::Reset();
+	mStepCtrl.Reset();
+	mStepPrevVel.resize(0);
+
+	if (mEnableResetSnapshot && mResetSnapshot.mValid)
+	{
+		// every episode restarts from the same character state and terrain
+		LoadSnapshot(mResetSnapshot);
+		return;
+	}
 
 	mTime = 0;
 	mChar->Reset();
@@ -129,10 +174,20 @@ void cScenarioSimChar::Reset()
 	ResetGround();
 	InitCharacterPos(mChar);
 	ClearObjs();
+
+	if (mEnableResetSnapshot)
+	{
+		SaveSnapshot(mResetSnapshot);
+	}
 }
 
 void cScenarioSimChar::Clear()
 {
+	if (mStepCtrl.GetMode() != cStepController::eModeFixed)
+	{
+		mStepCtrl.PrintStats();
+	}
+	mStepCtrl.Clear();
 	mChar->Clear();
 	mGround.reset();
 	ClearObjs();
@@ -157,8 +212,15 @@ void cScenarioSimChar::Update(double time_elapsed)
 	mChar->ClearEffortBuffer();
 #endif
 
-	double update_step = time_elapsed / mNumUpdateSteps;
-	int num_update_steps = (time_elapsed == 0) ? 1 : mNumUpdateSteps;
+	int num_update_steps = mNumUpdateSteps;
+	if (mStepCtrl.GetMode() != cStepController::eModeFixed)
+	{
+		cStepController::tSettings step_settings;
+		UpdateStepSettings(prev_time, step_settings);
+		num_update_steps = step_settings.mNumUpdateSteps;
+	}
+
+	double update_step = time_elapsed / num_update_steps;
 	for (int i = 0; i < num_update_steps; ++i)
 	{  
 		PreSubstepUpdate(update_step);
@@ -181,6 +243,36 @@ void cScenarioSimChar::Update(double time_elapsed)
 #endif
 }
 
+void cScenarioSimChar::SaveSnapshot(tSnapshot& out_snapshot) const
+{
+	// projectiles are transient and are not part of the snapshot
+	out_snapshot.mTime = mTime;
+	mChar->SaveState(out_snapshot.mCharState);
+
+	if (HasVar2DGround())
+	{
+		auto ground = std::static_pointer_cast<cGroundVar2D>(mGround);
+		ground->SaveState(out_snapshot.mGroundState);
+	}
+	out_snapshot.mValid = true;
+}
+
+void cScenarioSimChar::LoadSnapshot(const tSnapshot& snapshot)
+{
+	assert(snapshot.mValid);
+	ClearObjs();
+
+	mTime = snapshot.mTime;
+	if (HasVar2DGround())
+	{
+		auto ground = std::static_pointer_cast<cGroundVar2D>(mGround);
+		ground->LoadState(snapshot.mGroundState);
+	}
+
+	mChar->LoadState(snapshot.mCharState);
+	mWorld->RefreshBroadphase();
+}
+
 const std::shared_ptr<cSimCharacter>& cScenarioSimChar::GetCharacter()  const
 {
 	return mChar;
@@ -257,16 +349,8 @@ void cScenarioSimChar::SetTerrainParamsLerp(double lerp)
 	int num_params = GetNumTerrainParams();
 	if (num_params > 0)
 	{
-		lerp = cMathUtil::Clamp(lerp, 0.0, num_params - 1.0);
-
-		int idx0 = static_cast<int>(lerp);
-		int idx1 = std::min(idx0 + 1, num_params - 1);
-		lerp -= idx0;
-
-		const cTerrainGen2D::tParams& params0 = mTerrainParams[idx0];
-		const cTerrainGen2D::tParams& params1 = mTerrainParams[idx1];
-		cTerrainGen2D::tParams lerp_params = (1 - lerp) * params0 + lerp * params1;
-
+		Eigen::VectorXd lerp_params;
+		cTerrainGen2D::LerpParams(mTerrainParams, lerp, lerp_params);
 		mGround->SetTerrainParams(lerp_params);
 	}
 }
@@ -366,6 +450,23 @@ void cScenarioSimChar::BuildGround()
 		SetTerrainParamsLerp(mTerrainBlend);
 	}
 	
+	if (mTerrainLibFile != "")
+	{
+		auto terrain_lib = cTerrainLibrary::LoadShared(mTerrainLibFile);
+		if (terrain_lib != nullptr && terrain_lib->GetType() != mTerrainType)
+		{
+			printf("Terrain library %s does not match the terrain type of the scenario, terrain will be generated instead\n", mTerrainLibFile.c_str());
+		}
+		else if (terrain_lib != nullptr)
+		{
+			if (GetNumTerrainParams() > 1)
+			{
+				printf("Warning: terrain library %s has a single parameter set, terrain_blend is ignored\n", mTerrainLibFile.c_str());
+			}
+			ground_var2d->SetTerrainLibrary(terrain_lib);
+		}
+	}
+
 	ground_var2d->Init(mWorld, params, bound_min, bound_max);
 	
 	//std::shared_ptr<cGroundFlat> ground_flat = std::shared_ptr<cGroundFlat>(new cGroundFlat());
@@ -424,6 +525,7 @@ bool cScenarioSimChar::BuildDogController(std::shared_ptr<cCharController>& out_
 	std::shared_ptr<cDogControllerQ> dog_ctrl = std::shared_ptr<cDogControllerQ>(new cDogControllerQ());
 	dog_ctrl->SetGround(mGround);
 	dog_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	dog_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	out_ctrl = dog_ctrl;
 	return succ;
@@ -435,6 +537,7 @@ bool cScenarioSimChar::BuildDogControllerCacla(std::shared_ptr<cCharController>&
 	std::shared_ptr<cDogControllerCacla> dog_ctrl = std::shared_ptr<cDogControllerCacla>(new cDogControllerCacla());
 	dog_ctrl->SetGround(mGround);
 	dog_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	dog_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	out_ctrl = dog_ctrl;
 	return succ;
@@ -446,6 +549,7 @@ bool cScenarioSimChar::BuildDogControllerMACE(std::shared_ptr<cCharController>&
 	std::shared_ptr<cDogControllerMACE> dog_ctrl = std::shared_ptr<cDogControllerMACE>(new cDogControllerMACE());
 	dog_ctrl->SetGround(mGround);
 	dog_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	dog_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	dog_ctrl->SetExpLayer(mExpLayer);
 
@@ -459,6 +563,7 @@ bool cScenarioSimChar::BuildGoatControllerMACE(std::shared_ptr<cCharController>&
 	std::shared_ptr<cGoatControllerMACE> goat_ctrl = std::shared_ptr<cGoatControllerMACE>(new cGoatControllerMACE());
 	goat_ctrl->SetGround(mGround);
 	goat_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	goat_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	goat_ctrl->SetExpLayer(mExpLayer);
 
@@ -472,6 +577,7 @@ bool cScenarioSimChar::BuildRaptorController(std::shared_ptr<cCharController>& o
 	std::shared_ptr<cRaptorControllerQ> raptor_ctrl = std::shared_ptr<cRaptorControllerQ>(new cRaptorControllerQ());
 	raptor_ctrl->SetGround(mGround);
 	raptor_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	raptor_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	out_ctrl = raptor_ctrl;
 	return succ;
@@ -483,6 +589,7 @@ bool cScenarioSimChar::BuildRaptorControllerCacla(std::shared_ptr<cCharControlle
 	std::shared_ptr<cRaptorControllerCacla> raptor_ctrl = std::shared_ptr<cRaptorControllerCacla>(new cRaptorControllerCacla());
 	raptor_ctrl->SetGround(mGround);
 	raptor_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	raptor_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	out_ctrl = raptor_ctrl;
 	return succ;
@@ -494,6 +601,7 @@ bool cScenarioSimChar::BuildRaptorControllerMACE(std::shared_ptr<cCharController
 	std::shared_ptr<cRaptorControllerMACE> raptor_ctrl = std::shared_ptr<cRaptorControllerMACE>(new cRaptorControllerMACE());
 	raptor_ctrl->SetGround(mGround);
 	raptor_ctrl->Init(mChar.get(), mGravity, mCharacterFile);
+	raptor_ctrl->SetMassMatTol(mPDMassMatTol);
 
 	raptor_ctrl->SetExpLayer(mExpLayer);
 
@@ -507,6 +615,11 @@ cWorld::ePlaneCons cScenarioSimChar::GetCharPlaneCons() const
 	return cWorld::ePlaneConsXY;
 }
 
+bool cScenarioSimChar::HasVar2DGround() const
+{
+	return mGround != nullptr && mGround->GetGroundType() == cGround::eGroundTypeVar2D;
+}
+
 void cScenarioSimChar::CreateCharacter(std::shared_ptr<cSimCharacter>& out_char) const
 {
 	if (mCharType == eCharDog)
@@ -551,6 +664,64 @@ void cScenarioSimChar::InitCharacterPos(std::shared_ptr<cSimCharacter>& out_char
 	out_char->SetRootPos(root_pos);
 }
 
+void cScenarioSimChar::InitStepCtrl()
+{
+	cStepController::tSettings fixed_settings;
+	fixed_settings.mNumUpdateSteps = mNumUpdateSteps;
+	fixed_settings.mNumSimSubsteps = mNumSimSubsteps;
+	fixed_settings.mSolverIters = mWorld->GetSolverIters();
+
+	cStepController::eMode mode = mStepMode;
+	if (mode == cStepController::eModeReplay && mStepReplayFile == "")
+	{
+		printf("No step replay file specified, using fixed steps\n");
+		mode = cStepController::eModeFixed;
+	}
+
+	mStepCtrl.Clear();
+	mStepCtrl.Init(mode, mStepParams, fixed_settings);
+	mStepPrevVel.resize(0);
+
+	if (mode == cStepController::eModeReplay)
+	{
+		bool succ = mStepCtrl.OpenReplay(mStepReplayFile);
+		if (!succ)
+		{
+			printf("Failed to open step replay file %s\n", mStepReplayFile.c_str());
+		}
+	}
+
+	if (mStepLogFile != "")
+	{
+		bool succ = mStepCtrl.OpenLog(mStepLogFile);
+		if (!succ)
+		{
+			printf("Failed to open step log file %s\n", mStepLogFile.c_str());
+		}
+	}
+}
+
+void cScenarioSimChar::UpdateStepSettings(double time, cStepController::tSettings& out_settings)
+{
+	// measures are taken from the state at the end of the previous frame,
+	// so the chosen settings are a deterministic function of the simulation
+	cStepController::tMeasures measures;
+	measures.mNumContacts = mWorld->GetNumContacts();
+	measures.mMaxPenetration = mWorld->GetMaxPenetration();
+
+	Eigen::VectorXd vel;
+	mChar->BuildVel(vel);
+	if (mStepPrevVel.size() == vel.size())
+	{
+		measures.mVelChange = (vel - mStepPrevVel).lpNorm<Eigen::Infinity>();
+	}
+	mStepPrevVel = vel;
+
+	mStepCtrl.CalcSettings(time, measures, out_settings);
+	mWorld->SetNumSubsteps(out_settings.mNumSimSubsteps);
+	mWorld->SetSolverIters(out_settings.mSolverIters);
+}
+
 void cScenarioSimChar::UpdateWorld(double time_step)
 {
 	mWorld->Update(time_step);
@@ -674,34 +845,7 @@ void cScenarioSimChar::ParseTerrainParams(const cArgParser& parser, cTerrainGen2
 	parser.ParseString("terrain_file", terrain_file);
 	if (terrain_file != "")
 	{
-		std::ifstream f_stream(terrain_file);
-		Json::Reader reader;
-		Json::Value root;
-		bool succ = reader.parse(f_stream, root);
-		f_stream.close();
-
-		if (succ)
-		{
-			if (!root[cTerrainGen2D::gTypeKey].isNull())
-			{
-				std::string type_str = root[cTerrainGen2D::gTypeKey].asString();
-				cTerrainGen2D::ParseType(type_str, out_type);
-			}
-
-			if (!root[cTerrainGen2D::gParamsKey].isNull())
-			{
-				Json::Value params_arr = root[cTerrainGen2D::gParamsKey];
-				assert(params_arr.isArray());
-				int num = params_arr.size();
-
-				out_params.resize(num);
-				for (int i = 0; i < num; ++i)
-				{
-					Eigen::VectorXd& curr_params = out_params[i];
-					cTerrainGen2D::LoadParams(params_arr.get(i, 0), curr_params);
-				}
-			}
-		}
+		cTerrainGen2D::LoadTerrainFile(terrain_file, out_type, out_params);
 	}
 }
 
@@ -8,7 +8,9 @@
 #include "sim/SimCharacter.h"
 #include "sim/Perturb.h"
 #include "sim/Ground.h"
+#include "sim/GroundVar2D.h"
 #include "sim/TerrainGen2D.h"
+#include "sim/StepController.h"
 
 class cScenarioSimChar : public cScenario
 {
@@ -43,6 +45,17 @@ public:
 		double mEndTime;
 	};
 
+	// full simulation state of the scene, buffers are reused between saves
+	// so a snapshot can be taken and restored without allocations
+	struct tSnapshot
+	{
+		tSnapshot();
+		bool mValid;
+		double mTime;
+		cSimCharacter::tState mCharState;
+		cGroundVar2D::tState mGroundState;
+	};
+
 	cScenarioSimChar();
 	virtual ~cScenarioSimChar();
 
@@ -52,6 +65,9 @@ public:
 	virtual void Clear();
 	virtual void Update(double time_elapsed);
 
+	virtual void SaveSnapshot(tSnapshot& out_snapshot) const;
+	virtual void LoadSnapshot(const tSnapshot& snapshot);
+
 	virtual const std::shared_ptr<cSimCharacter>& GetCharacter() const;
 	virtual const std::shared_ptr<cWorld>& GetWorld() const;
 	virtual tVector GetCharPos() const;
@@ -98,6 +114,7 @@ protected:
 	eCharType mCharType;
 	eCharCtrl mCharCtrl;
 	std::string mExpLayer; // mostly for action exploration
+	double mPDMassMatTol; // 0 refactors the mass matrix on every update
 
 	bool mValidCharInitPos;
 	tVector mCharInitPos;
@@ -105,12 +122,24 @@ protected:
 	cTerrainGen2D::eType mTerrainType;
 	std::vector<Eigen::VectorXd> mTerrainParams;
 	double mTerrainBlend;
+	// pregenerated segments used in place of the terrain generators, see cTerrainLibrary
+	std::string mTerrainLibFile;
 
 	double mMinPerturb;
 	double mMaxPerturb;
 	double mMinPerturbDuration;
 	double mMaxPerturbDuration;
 
+	bool mEnableResetSnapshot;
+	tSnapshot mResetSnapshot;
+
+	cStepController mStepCtrl;
+	cStepController::eMode mStepMode;
+	cStepController::tParams mStepParams;
+	std::string mStepLogFile;
+	std::string mStepReplayFile;
+	Eigen::VectorXd mStepPrevVel;
+
 	std::vector<tObjEntry> mObjs;
 	tTimeCallbackFunc mPreSubstepCallback;
 	tTimeCallbackFunc mPostSubstepCallback;
@@ -130,11 +159,14 @@ protected:
 	virtual bool BuildRaptorControllerMACE(std::shared_ptr<cCharController>& out_ctrl) const;
 
 	virtual cWorld::ePlaneCons GetCharPlaneCons() const;
+	virtual bool HasVar2DGround() const;
 
 	virtual void CreateCharacter(std::shared_ptr<cSimCharacter>& out_char) const;
 	virtual tVector GetDefaultCharPos() const;
 	virtual void InitCharacterPos(std::shared_ptr<cSimCharacter>& out_char) const;
 
+	virtual void InitStepCtrl();
+	virtual void UpdateStepSettings(double time, cStepController::tSettings& out_settings);
 	virtual void UpdateWorld(double time_step);
 	virtual void UpdateCharacter(double time_step);
 	virtual void UpdateGround();
@@ -1,7 +1,9 @@
 #include "ScenarioTrain.h"
 #include <thread>
+#include <chrono>
 
 #include "sim/BaseControllerCacla.h"
+#include "util/AssetCache.h"
 
 const double gInitCurriculumPhase = 1;
 
@@ -33,6 +35,20 @@ cScenarioTrain::cScenarioTrain()
 	mTimeStep = 1 / 30.0;
 
 	mEnableAsyncMode = false;
+	mPlaybackHalfGround = false;
+
+	mMetricsFile = "";
+	mMetricsFormat = cMetrics::eFormatBinary;
+	mMetricsFlushPeriod = 1;
+	mIterMetric = cMetrics::gInvalidID;
+	mNumTuplesMetric = cMetrics::gInvalidID;
+	mAvgRewardMetric = cMetrics::gInvalidID;
+	mRewardHistMetric = cMetrics::gInvalidID;
+	mCurriculumPhaseMetric = cMetrics::gInvalidID;
+	mExpRateMetric = cMetrics::gInvalidID;
+	mExpTempMetric = cMetrics::gInvalidID;
+	mExpBaseRateMetric = cMetrics::gInvalidID;
+
 	EnableTraining(true);
 }
 
@@ -60,7 +76,10 @@ void cScenarioTrain::ParseArgs(const cArgParser& parser)
 	parser.ParseBool("trainer_init_input_offset_scale", mTrainerParams.mInitInputOffsetScale);
 	parser.ParseInt("trainer_num_init_samples", mTrainerParams.mNumInitSamples);
 	parser.ParseInt("trainer_num_steps_per_iters", mTrainerParams.mNumStepsPerIter);
+	parser.ParseInt("trainer_num_update_threads", mTrainerParams.mNumUpdateThreads);
 	parser.ParseInt("trainer_freeze_target_iters", mTrainerParams.mFreezeTargetIters);
+	parser.ParseInt("trainer_return_steps", mTrainerParams.mNumReturnSteps);
+	parser.ParseDouble("trainer_return_lambda", mTrainerParams.mReturnLambda);
 	parser.ParseInt("trainer_int_iter", mTrainerParams.mIntOutputIters);
 	parser.ParseString("trainer_int_output", mTrainerParams.mIntOutputFile);
 	parser.ParseInt("trainer_num_anneal_iters", mNumAnnealIters);
@@ -70,6 +89,21 @@ void cScenarioTrain::ParseArgs(const cArgParser& parser)
 	parser.ParseInt("trainer_iters_per_output", mItersPerOutput);
 
 	parser.ParseBool("trainer_enable_async_mode", mEnableAsyncMode);
+	parser.ParseBool("trainer_replay_half_ground", mPlaybackHalfGround);
+
+	std::string metrics_format_str = "";
+	parser.ParseString("metrics_file", mMetricsFile);
+	parser.ParseString("metrics_format", metrics_format_str);
+	parser.ParseDouble("metrics_flush_period", mMetricsFlushPeriod);
+	cMetrics::ParseFormat(metrics_format_str, mMetricsFormat);
+
+	std::string placement_str = "";
+	std::vector<int> placement_cpus;
+	cThreadPlacement::ePolicy placement_policy = cThreadPlacement::ePolicyNone;
+	parser.ParseString("thread_placement", placement_str);
+	parser.ParseIntArray("thread_cpus", placement_cpus);
+	cThreadPlacement::ParsePolicy(placement_str, placement_policy);
+	mPlacement.Init(placement_policy, placement_cpus);
 
 	mArgParser = parser;
 }
@@ -77,6 +111,7 @@ void cScenarioTrain::ParseArgs(const cArgParser& parser)
 void cScenarioTrain::Init()
 {
 	cScenario::Init();
+	InitMetrics();
 	BuildScenePool();
 	InitTrainer();
 	InitLearners();
@@ -95,12 +130,17 @@ void cScenarioTrain::Clear()
 {
 	cScenario::Clear();
 	mLearners.clear();
+	cMetrics::Close();
 }
 
 void cScenarioTrain::Run()
 {
 	int num_threads = GetPoolSize();
 	std::vector<std::thread> threads(num_threads);
+	mPlacement.PrintPlacement(num_threads);
+
+	int beg_tuples = GetNumTuples();
+	auto run_beg = std::chrono::steady_clock::now();
 
 	for (int i = 0; i < num_threads; ++i)
 	{
@@ -112,6 +152,12 @@ void cScenarioTrain::Run()
 	{
 		threads[i].join();
 	}
+
+	// compare runs with and without thread_placement for its effect on throughput
+	std::chrono::duration<double> run_time = std::chrono::steady_clock::now() - run_beg;
+	int num_tuples = GetNumTuples() - beg_tuples;
+	printf("Collected %i tuples with %i threads in %.3fs, %.1f tuples/s\n", num_tuples, num_threads,
+			run_time.count(), num_tuples / std::max(run_time.count(), 1e-6));
 }
 
 void cScenarioTrain::Update(double time_elapsed)
@@ -187,6 +233,7 @@ void cScenarioTrain::Shutdown()
 	cScenario::Shutdown();
 	mTrainer->EndTraining();
 	mTrainer->OutputModel(mOutputFile);
+	cMetrics::Close();
 }
 
 std::string cScenarioTrain::GetName() const
@@ -198,27 +245,37 @@ void cScenarioTrain::BuildScenePool()
 {
 	ClearScenePool();
 
+	auto build_beg = std::chrono::steady_clock::now();
 	mExpPool.resize(mExpPoolSize);
 	for (int i = 0; i < GetPoolSize(); ++i)
 	{
 		auto& curr_exp = mExpPool[i];
-		BuildExpScene(curr_exp);
-		curr_exp->ParseArgs(mArgParser);
-		curr_exp->Init();
-
-		if (i == 0)
+		// scenes are still built one at a time, only on the cpu of the thread that will run them
+		mPlacement.RunPinned(i, [this, i, &curr_exp]()
 		{
-			mExpRate = curr_exp->GetExpRate();
-			mExpTemp = curr_exp->GetExpTemp();
-			mExpBaseRate = curr_exp->GetExpBaseActionRate();
-		}
+			BuildExpScene(curr_exp);
+			curr_exp->ParseArgs(mArgParser);
+			curr_exp->Init();
 
-		curr_exp->SetExpRate(mInitExpRate);
-		curr_exp->SetExpTemp(mInitExpTemp);
-		curr_exp->SetExpBaseActionRate(mInitExpBaseRate);
-		UpdateSceneCurriculum(gInitCurriculumPhase, *curr_exp.get());
-		curr_exp->Reset(); // rebuild ground
+			if (i == 0)
+			{
+				mExpRate = curr_exp->GetExpRate();
+				mExpTemp = curr_exp->GetExpTemp();
+				mExpBaseRate = curr_exp->GetExpBaseActionRate();
+			}
+
+			curr_exp->SetExpRate(mInitExpRate);
+			curr_exp->SetExpTemp(mInitExpTemp);
+			curr_exp->SetExpBaseActionRate(mInitExpBaseRate);
+			UpdateSceneCurriculum(gInitCurriculumPhase, *curr_exp.get());
+			curr_exp->Reset(); // rebuild ground
+		});
 	}
+
+	// startup time, most of it goes into loading the same assets for every scene
+	std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_beg;
+	printf("Built %i scenes in %.3fs\n", GetPoolSize(), build_time.count());
+	cAssetCache::PrintStats();
 }
 
 void cScenarioTrain::ClearScenePool()
@@ -253,6 +310,7 @@ void cScenarioTrain::BuildExpScene(std::shared_ptr<cScenarioExp>& out_exp) const
 void cScenarioTrain::InitTrainer()
 {
 	BuildTrainer(mTrainer);
+	SetupTrainerPlaybackParams();
 	mTrainer->Init(mTrainerParams);
 	LoadModel();
 	SetupTrainerOutputOffsetScale();
@@ -274,6 +332,23 @@ void cScenarioTrain::InitLearners()
 	}
 }
 
+void cScenarioTrain::InitMetrics()
+{
+	if (mMetricsFile != "")
+	{
+		cMetrics::Open(mMetricsFile, mMetricsFormat, mMetricsFlushPeriod);
+	}
+
+	mIterMetric = cMetrics::RegisterGauge("iter");
+	mNumTuplesMetric = cMetrics::RegisterGauge("num_tuples");
+	mAvgRewardMetric = cMetrics::RegisterGauge("avg_tuple_reward");
+	mRewardHistMetric = cMetrics::RegisterHist("tuple_reward", 0, 1, 20);
+	mCurriculumPhaseMetric = cMetrics::RegisterGauge("curriculum_phase");
+	mExpRateMetric = cMetrics::RegisterGauge("exp_rate");
+	mExpTempMetric = cMetrics::RegisterGauge("exp_temp");
+	mExpBaseRateMetric = cMetrics::RegisterGauge("exp_base_rate");
+}
+
 void cScenarioTrain::SetupLearner(const std::shared_ptr<cSimCharacter>& character, std::shared_ptr<cNeuralNetLearner>& out_learner) const
 {
 	std::shared_ptr<cNNController> ctrl = std::static_pointer_cast<cNNController>(character->GetController());
@@ -319,6 +394,23 @@ void cScenarioTrain::BuildTrainer(std::shared_ptr<cTrainerInterface>& out_traine
 	}
 }
 
+void cScenarioTrain::SetupTrainerPlaybackParams()
+{
+	mTrainerParams.mPlaybackHalfOffset = 0;
+	mTrainerParams.mPlaybackHalfSize = 0;
+
+	if (mPlaybackHalfGround)
+	{
+		// the ground samples dominate the policy state and tolerate the reduced precision
+		auto ctrl = std::dynamic_pointer_cast<cNNController>(GetRefController());
+		if (ctrl != nullptr)
+		{
+			mTrainerParams.mPlaybackHalfOffset = ctrl->GetPoliStateGroundOffset();
+			mTrainerParams.mPlaybackHalfSize = ctrl->GetPoliStateGroundSize();
+		}
+	}
+}
+
 void cScenarioTrain::SetupTrainerOutputOffsetScale()
 {
 	bool valid_init_model = mTrainer->HasInitModel();
@@ -371,6 +463,21 @@ void cScenarioTrain::UpdateTrainer(const std::vector<tExpTuple>& tuples, int exp
 
 	double exp_base_rate = CalcExpBaseRate(iters);
 	printf("Exp Base Rate: %.5f\n", exp_base_rate);
+
+	if (cMetrics::IsOpen())
+	{
+		cMetrics::Set(mIterMetric, iters, iters);
+		cMetrics::Set(mNumTuplesMetric, num_tuples, iters);
+		cMetrics::Set(mAvgRewardMetric, avg_reward, iters);
+		for (size_t i = 0; i < tuples.size(); ++i)
+		{
+			cMetrics::Observe(mRewardHistMetric, tuples[i].mReward, iters);
+		}
+		cMetrics::Set(mCurriculumPhaseMetric, curriculum_phase, iters);
+		cMetrics::Set(mExpRateMetric, exp_rate, iters);
+		cMetrics::Set(mExpTempMetric, exp_temp, iters);
+		cMetrics::Set(mExpBaseRateMetric, exp_base_rate, iters);
+	}
 	
 	if ((iters % mItersPerOutput == 0 && iters > 0) || iters == 1)
 	{
@@ -477,6 +584,8 @@ void cScenarioTrain::OutputModel()
 
 void cScenarioTrain::ExpHelper(std::shared_ptr<cScenarioExp> exp, int exp_id)
 {
+	mPlacement.PinThread(exp_id);
+
 	bool done = false;
 	while (!done)
 	{
@@ -484,3 +593,13 @@ void cScenarioTrain::ExpHelper(std::shared_ptr<cScenarioExp> exp, int exp_id)
 	}
 	exp->Shutdown();
 }
+
+int cScenarioTrain::GetNumTuples() const
+{
+	int num_tuples = 0;
+	for (size_t i = 0; i < mLearners.size(); ++i)
+	{
+		num_tuples = std::max(num_tuples, mLearners[i]->GetNumTuples());
+	}
+	return num_tuples;
+}
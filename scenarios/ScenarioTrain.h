@@ -4,6 +4,8 @@
 #include "scenarios/ScenarioExp.h"
 #include "learning/QNetTrainer.h"
 #include "learning/AsyncQNetTrainer.h"
+#include "util/Metrics.h"
+#include "util/ThreadPlacement.h"
 #include <mutex>
 
 class cScenarioTrain : public cScenario
@@ -46,6 +48,7 @@ protected:
 	int mExpPoolSize;
 	bool mEnableTraining;
 	bool mEnableAsyncMode;
+	bool mPlaybackHalfGround; // store the ground samples in the replay memory at half precision
 
 	double mExpRate;
 	double mExpTemp;
@@ -72,6 +75,23 @@ protected:
 	std::string mOutputFile;
 	int mItersPerOutput;
 
+	// per iteration progress is also streamed to the metrics file when one is given
+	std::string mMetricsFile;
+	cMetrics::eFormat mMetricsFormat;
+	double mMetricsFlushPeriod;
+	int mIterMetric;
+	int mNumTuplesMetric;
+	int mAvgRewardMetric;
+	int mRewardHistMetric;
+	int mCurriculumPhaseMetric;
+	int mExpRateMetric;
+	int mExpTempMetric;
+	int mExpBaseRateMetric;
+
+	// exp threads are pinned to cpus by the placement and each scene is built on its thread's cpu
+	// so that its memory is allocated on the local node
+	cThreadPlacement mPlacement;
+
 	virtual void BuildScenePool();
 	virtual void ClearScenePool();
 	virtual void ResetScenePool();
@@ -81,11 +101,13 @@ protected:
 
 	virtual void InitTrainer();
 	virtual void InitLearners();
+	virtual void InitMetrics();
 	virtual void SetupLearner(const std::shared_ptr<cSimCharacter>& character, std::shared_ptr<cNeuralNetLearner>& out_learner) const;
 	
 	virtual const std::shared_ptr<cCharController>& GetRefController() const;
 
 	virtual void BuildTrainer(std::shared_ptr<cTrainerInterface>& out_trainer);
+	virtual void SetupTrainerPlaybackParams();
 	virtual void SetupTrainerOutputOffsetScale();
 	virtual void LoadModel();
 	virtual bool IsLearnerDone(int learner_id) const;
@@ -104,4 +126,5 @@ protected:
 	virtual void OutputModel();
 
 	virtual void ExpHelper(std::shared_ptr<cScenarioExp> exp, int exp_id);
+	virtual int GetNumTuples() const;
 };
\ No newline at end of file
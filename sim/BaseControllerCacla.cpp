@@ -59,7 +59,7 @@ bool cBaseControllerCacla::LoadCriticNet(const std::string& net_file)
 
 void cBaseControllerCacla::LoadCriticModel(const std::string& model_file)
 {
-	mCriticNet.LoadModel(model_file);
+	mCriticNet.LoadSharedModel(model_file);
 }
 
 void cBaseControllerCacla::CopyNet(const cNeuralNet& net)
@@ -204,7 +204,7 @@ void cBaseControllerCacla::BuildCriticOutputOffsetScale(Eigen::VectorXd& out_off
 void cBaseControllerCacla::ExploitPolicy(tAction& out_action)
 {
 	Eigen::VectorXd opt_params;
-	mNet.Eval(mPoliState, opt_params);
+	EvalNet(mPoliState, opt_params);
 	assert(opt_params.size() == GetNumOptParams());
 
 	out_action.mID = gInvalidIdx;
@@ -185,10 +185,12 @@ void cBaseControllerMACE::DecideAction(tAction& out_action)
 void cBaseControllerMACE::ExploitPolicy(tAction& out_action)
 {
 	Eigen::VectorXd y;
-	mNet.Eval(mPoliState, y);
+	EvalNet(mPoliState, y);
 
-	int a = GetMaxFragIdx(y);
-	double val = GetVal(y, a);
+	cMACEHead::tSample sample;
+	cMACEHead::EvalMax(y, GetNumActionFrags(), sample);
+	int a = sample.mIdx;
+	double val = sample.mVal;
 	BuildActorAction(y, a, out_action);
 
 #if defined(ENABLE_DEBUG_VISUALIZATION)
@@ -265,17 +267,21 @@ void cBaseControllerMACE::DecideActionBoltzmann(tAction& out_action)
 	else
 	{
 		Eigen::VectorXd y;
-		mNet.Eval(mPoliState, y);
-
-		int a_max = GetMaxFragIdx(y);
-		int a = a_max;
+		EvalNet(mPoliState, y);
 
+		cMACEHead::tSample sample;
 		if (mEnableExp)
 		{
-			a = BoltzmannSelectActor(y, mBoltzmannBuffer);
+			BoltzmannSelectActor(y, mBoltzmannBuffer, sample);
+		}
+		else
+		{
+			cMACEHead::EvalMax(y, GetNumActionFrags(), sample);
 		}
 
-		double val = GetVal(y, a);
+		int a_max = sample.mMaxIdx;
+		int a = sample.mIdx;
+		double val = sample.mVal;
 		BuildActorAction(y, a, out_action);
 
 		if (mEnableExp)
@@ -320,9 +326,11 @@ void cBaseControllerMACE::DecideActionBoltzmann(tAction& out_action)
 void cBaseControllerMACE::GetRandActorAction(tAction& out_action)
 {
 	Eigen::VectorXd y;
-	mNet.Eval(mPoliState, y);
+	EvalNet(mPoliState, y);
 
-	int max_a = GetMaxFragIdx(y);
+	cMACEHead::tSample sample;
+	cMACEHead::EvalMax(y, GetNumActionFrags(), sample);
+	int max_a = sample.mMaxIdx;
 	int a = cMathUtil::RandIntExclude(0, GetNumActionFrags(), max_a);
 	double val = GetVal(y, a);
 	BuildActorAction(y, a, out_action);
@@ -338,8 +346,9 @@ void cBaseControllerMACE::GetRandActorAction(tAction& out_action)
 
 void cBaseControllerMACE::BuildActorAction(const Eigen::VectorXd& params, int a_id, tAction& out_action) const
 {
-	Eigen::VectorXd action_frag;
-	GetFrag(params, a_id, action_frag);
+	// the fragment is passed on as a view into the net output,
+	// so selecting an actor neither copies nor allocates
+	cMACEHead::tFragView action_frag = cMACEHead::GetFragView(params, GetNumActionFrags(), GetActionFragSize(), a_id);
 	assert(action_frag.size() == GetNumOptParams());
 
 	out_action.mID = a_id;
@@ -347,52 +356,23 @@ void cBaseControllerMACE::BuildActorAction(const Eigen::VectorXd& params, int a_
 	SetOptParams(action_frag, out_action.mParams);
 }
 
-int cBaseControllerMACE::BoltzmannSelectActor(const Eigen::VectorXd& params, Eigen::VectorXd& val_buffer) const
+void cBaseControllerMACE::BoltzmannSelectActor(const Eigen::VectorXd& params, Eigen::VectorXd& out_probs, cMACEHead::tSample& out_sample) const
 {
-	int a_max = GetMaxFragIdx(params);
-	int a = a_max;
+	int num_actors = GetNumActionFrags();
+	double rand = (mExpTemp != 0) ? cMathUtil::RandDouble() : 0;
+	cMACEHead::Sample(params, num_actors, mExpTemp, rand, out_probs, out_sample);
 
+#if defined (ENABLE_DEBUG_PRINT)
 	if (mExpTemp != 0)
 	{
-		int num_actors = GetNumActionFrags();
-		double max_val = GetVal(params, a_max);
-
-		double sum = 0;
-		for (int i = 0; i < num_actors; ++i)
-		{
-			double curr_val = GetVal(params, i);
-			curr_val = std::exp((curr_val - max_val) / mExpTemp);
-
-			val_buffer[i] = curr_val;
-			sum += curr_val;
-		}
-
-		double rand = cMathUtil::RandDouble(0, sum);
-		for (int i = 0; i < num_actors; ++i)
-		{
-			double curr_val = val_buffer[i];
-			rand -= curr_val;
-
-			if (rand <= 0)
-			{
-				a = i;
-				break;
-			}
-		}
-
-#if defined (ENABLE_DEBUG_PRINT)
 		printf("Boltzmann:\t");
 		for (int i = 0; i < num_actors; ++i)
 		{
-			double curr_val = val_buffer[i];
-			curr_val /= sum;
-			printf("%.3f\t", curr_val);
+			printf("%.3f\t", out_probs[i]);
 		}
 		printf("\n");
-#endif
 	}
-
-	return a;
+#endif
 }
 
 void cBaseControllerMACE::ApplyExpNoise(tAction& out_action)
@@ -2,6 +2,7 @@
 
 #include "sim/TerrainRLCharController.h"
 #include "learning/MACETrainer.h"
+#include "learning/MACEHead.h"
 
 //#define DISABLE_INIT_ACTOR_BIAS
 
@@ -48,7 +49,7 @@ protected:
 
 	virtual void GetRandActorAction(tAction& out_action);
 	virtual void BuildActorAction(const Eigen::VectorXd& params, int a_id, tAction& out_action) const;
-	virtual int BoltzmannSelectActor(const Eigen::VectorXd& params, Eigen::VectorXd& val_buffer) const;
+	virtual void BoltzmannSelectActor(const Eigen::VectorXd& params, Eigen::VectorXd& out_probs, cMACEHead::tSample& out_sample) const;
 
 	virtual void ApplyExpNoise(tAction& out_action);
 	virtual void ApplyExpNoiseState(tAction& out_action);
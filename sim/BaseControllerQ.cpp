@@ -60,7 +60,7 @@ void cBaseControllerQ::DecideAction(tAction& out_action)
 void cBaseControllerQ::ExploitPolicy(tAction& out_action)
 {
 	Eigen::VectorXd action;
-	mNet.Eval(mPoliState, action);
+	EvalNet(mPoliState, action);
 	int a = 0;
 	double max_val = action.maxCoeff(&a);
 
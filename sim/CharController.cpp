@@ -27,6 +27,20 @@ void cCharController::Update(double time_step)
 	cController::Update(time_step);
 }
 
+void cCharController::SaveState(std::vector<double>& out_state) const
+{
+	cController::SaveState(out_state);
+	out_state.push_back(mState);
+	out_state.push_back(mPhase);
+}
+
+void cCharController::LoadState(const std::vector<double>& state, int& in_out_idx)
+{
+	cController::LoadState(state, in_out_idx);
+	mState = static_cast<int>(state[in_out_idx++]);
+	mPhase = state[in_out_idx++];
+}
+
 int cCharController::GetState() const
 {
 	return mState;
@@ -10,6 +10,9 @@ public:
 
 	virtual void Reset();
 	virtual void Update(double time_step);
+	virtual void SaveState(std::vector<double>& out_state) const;
+	virtual void LoadState(const std::vector<double>& state, int& in_out_idx);
+
 	virtual int GetState() const;
 	virtual double GetPhase() const;
 	virtual void SetPhase(double phase);
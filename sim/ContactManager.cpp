@@ -4,6 +4,8 @@
 #include <iostream>
 
 const int cContactManager::gInvalidID = -1;
+const int gBitsPerWord = 32;
+const btScalar gContactDistTol = 0.001f;
 
 cContactManager::tContactHandle::tContactHandle()
 {
@@ -12,13 +14,6 @@ cContactManager::tContactHandle::tContactHandle()
 	mFilterFlags = gFlagAll;
 }
 
-cContactManager::tContactEntry::tContactEntry()
-{
-	mFlags = gFlagAll;
-	mFilterFlags = gFlagAll;
-	mInContact = false;
-}
-
 bool cContactManager::tContactHandle::IsValid() const
 {
 	return mID != gInvalidID;
@@ -27,7 +22,12 @@ bool cContactManager::tContactHandle::IsValid() const
 cContactManager::cContactManager(cWorld& world)
 	: mWorld(world)
 {
-
+	mSubstepGen = 1;
+	mUpdateGen = mSubstepGen;
+	mSubstepNumContacts = 0;
+	mSubstepMaxPenetration = 0;
+	mNumContacts = 0;
+	mMaxPenetration = 0;
 }
 
 cContactManager::~cContactManager()
@@ -38,67 +38,43 @@ cContactManager::~cContactManager()
 void cContactManager::Init()
 {
 	Clear();
+	gContactProcessedCallback = cContactManager::ContactProcessedCallback;
 }
 
 void cContactManager::Reset()
 {
-	for (int i = 0; i < GetNumEntries(); ++i)
-	{
-		tContactEntry& entry = mContactEntries[i];
-		entry.mInContact = false;
-	}
+	ClearContacts();
 }
 
 void cContactManager::Clear()
 {
-	mContactEntries.clear();
+	mFlags.clear();
+	mFilterFlags.clear();
+	mContactGen.clear();
+	mContactDist.clear();
+	mContactPts.clear();
+	mRegisteredBits.clear();
+	ClearContacts();
 }
 
 void cContactManager::Update()
 {
-	ClearContacts();
-	std::unique_ptr<btDiscreteDynamicsWorld>& bt_world = mWorld.GetInternalWorld();
+	// contacts were already recorded during the narrowphase of each substep,
+	// only the ones from the last substep are reported
+	mUpdateGen = mSubstepGen;
+	mNumContacts = mSubstepNumContacts;
+	mMaxPenetration = mSubstepMaxPenetration;
 
-	int num_manifolds = bt_world->getDispatcher()->getNumManifolds();
-	for (int i = 0; i < num_manifolds; ++i)
-	{
-		btPersistentManifold* mani = bt_world->getDispatcher()->getManifoldByIndexInternal(i);
-		const btCollisionObject* obj0 = static_cast<const btCollisionObject*>(mani->getBody0());
-		const btCollisionObject* obj1 = static_cast<const btCollisionObject*>(mani->getBody1());
-
-		int num_contacts = mani->getNumContacts();
-		for (int j = 0; j < num_contacts; ++j)
-		{
-			btManifoldPoint& pt = mani->getContactPoint(j);
-			// std::cout << " Detected contact1: " << pt.getDistance() << std::endl;
-			btScalar dist_tol = 0.001f;
-			if (pt.getDistance() <= dist_tol)
-			{
-				// std::cout << " Detected contact: " << std::endl;
-				const cSimObj* sim_obj0 = static_cast<const cSimObj*>(obj0->getUserPointer());
-				const cSimObj* sim_obj1 = static_cast<const cSimObj*>(obj1->getUserPointer());
-
-				const tContactHandle& h0 = sim_obj0->GetContactHandle();
-				const tContactHandle& h1 = sim_obj1->GetContactHandle();
-			
-				bool valid_contact = IsValidContact(h0, h1);
-				if (valid_contact)
-				{
-					if (h0.IsValid())
-					{
-						mContactEntries[h0.mID].mInContact = true;
-						mContactEntries[h0.mID].mContactPt = mWorld.GetManifoldPtA(pt);
-					}
+#if defined(CONTACT_MANAGER_VALIDATE)
+	ValidateContacts();
+#endif
+}
 
-					if (h1.IsValid())
-					{
-						mContactEntries[h1.mID].mInContact = true;
-						mContactEntries[h0.mID].mContactPt = mWorld.GetManifoldPtB(pt);
-					}
-				}
-			}
-		}
-	}
+void cContactManager::BeginSubstep()
+{
+	++mSubstepGen;
+	mSubstepNumContacts = 0;
+	mSubstepMaxPenetration = 0;
 }
 
 cContactManager::tContactHandle cContactManager::RegisterContact(int contact_flags, int filter_flags)
@@ -108,9 +84,8 @@ cContactManager::tContactHandle cContactManager::RegisterContact(int contact_fla
 	handle.mFilterFlags = filter_flags;
 	handle.mID = RegisterNewID();
 
-	tContactEntry& entry = mContactEntries[handle.mID];
-	entry.mFlags = contact_flags;
-	entry.mFilterFlags = filter_flags;
+	mFlags[handle.mID] = contact_flags;
+	mFilterFlags[handle.mID] = filter_flags;
 
 	assert(handle.IsValid());
 	return handle;
@@ -119,51 +94,100 @@ cContactManager::tContactHandle cContactManager::RegisterContact(int contact_fla
 void cContactManager::UpdateContact(const cContactManager::tContactHandle& handle)
 {
 	assert(handle.IsValid());
-	tContactEntry& entry = mContactEntries[handle.mID];
-	entry.mFlags = handle.mFlags;
-	entry.mFilterFlags = handle.mFilterFlags;
+	mFlags[handle.mID] = handle.mFlags;
+	mFilterFlags[handle.mID] = handle.mFilterFlags;
 }
 
 int cContactManager::GetNumEntries() const
 {
-	return static_cast<int>(mContactEntries.size());
+	return static_cast<int>(mFlags.size());
 }
 
 bool cContactManager::IsInContact(const tContactHandle& handle) const
 {
 	if (handle.IsValid())
 	{
-		return mContactEntries[handle.mID].mInContact;
+		return mContactGen[handle.mID] == mUpdateGen;
 	}
 	return false;
 }
 
 tVector cContactManager::GetContactPt(const tContactHandle& handle) const
 {
-	if (handle.IsValid())
+	if (IsInContact(handle))
 	{
-		return mContactEntries[handle.mID].mContactPt;
+		return mContactPts[handle.mID];
 	}
 	return tVector::Zero();
 }
 
+int cContactManager::GetNumContacts() const
+{
+	return mNumContacts;
+}
+
+double cContactManager::GetMaxPenetration() const
+{
+	return mMaxPenetration;
+}
+
+bool cContactManager::ContactProcessedCallback(btManifoldPoint& pt, void* body0, void* body1)
+{
+	const btCollisionObject* obj0 = static_cast<const btCollisionObject*>(body0);
+	const btCollisionObject* obj1 = static_cast<const btCollisionObject*>(body1);
+
+	// the user index stores the contact handle id, so pairs without
+	// registered handles are rejected without touching the sim objects
+	int id0 = obj0->getUserIndex();
+	int id1 = obj1->getUserIndex();
+	if (id0 != gInvalidID || id1 != gInvalidID)
+	{
+		const cSimObj* sim_obj0 = static_cast<const cSimObj*>(obj0->getUserPointer());
+		const cSimObj* sim_obj1 = static_cast<const cSimObj*>(obj1->getUserPointer());
+		const cSimObj* tracked_obj = (id0 != gInvalidID) ? sim_obj0 : sim_obj1;
+		cContactManager& manager = tracked_obj->GetWorld()->GetContactManager();
+		manager.ProcessContact(pt, *sim_obj0, *sim_obj1);
+	}
+	return false;
+}
+
 int cContactManager::RegisterNewID()
 {
-	int id = gInvalidID;
-	id = static_cast<int>(mContactEntries.size());
-	mContactEntries.resize(id + 1);
+	int id = GetNumEntries();
+	mFlags.push_back(gFlagAll);
+	mFilterFlags.push_back(gFlagAll);
+	mContactGen.push_back(0);
+	mContactDist.push_back(0);
+	mContactPts.push_back(tVector::Zero());
+
+	int word = id / gBitsPerWord;
+	if (word >= static_cast<int>(mRegisteredBits.size()))
+	{
+		mRegisteredBits.resize(word + 1, 0);
+	}
+	mRegisteredBits[word] |= 1u << (id % gBitsPerWord);
 	return id;
 }
 
 void cContactManager::ClearContacts()
 {
-	int num_entries = GetNumEntries();
-	for (int i = 0; i < num_entries; ++i)
+	// moving to a new generation invalidates all recorded contacts
+	++mSubstepGen;
+	mUpdateGen = mSubstepGen;
+	mSubstepNumContacts = 0;
+	mSubstepMaxPenetration = 0;
+	mNumContacts = 0;
+	mMaxPenetration = 0;
+}
+
+bool cContactManager::IsRegistered(int id) const
+{
+	if (id >= 0 && id < GetNumEntries())
 	{
-		tContactEntry& curr_entry = mContactEntries[i];
-		curr_entry.mInContact = false;
-		curr_entry.mContactPt.setZero();
+		unsigned int word = mRegisteredBits[id / gBitsPerWord];
+		return (word & (1u << (id % gBitsPerWord))) != 0;
 	}
+	return false;
 }
 
 bool cContactManager::IsValidContact(const tContactHandle& h0, const tContactHandle& h1) const
@@ -173,3 +197,116 @@ bool cContactManager::IsValidContact(const tContactHandle& h0, const tContactHan
 	bool valid_contact = valid_h0 && valid_h1;
 	return valid_contact;
 }
+
+void cContactManager::ProcessContact(const btManifoldPoint& pt, const cSimObj& obj0, const cSimObj& obj1)
+{
+	// objects without a registered handle still carry the flags set through cSimObj::UpdateContact
+	tContactHandle h0 = obj0.GetContactHandle();
+	tContactHandle h1 = obj1.GetContactHandle();
+	h0.mID = (IsRegistered(h0.mID)) ? h0.mID : gInvalidID;
+	h1.mID = (IsRegistered(h1.mID)) ? h1.mID : gInvalidID;
+
+	btScalar dist = pt.getDistance();
+	if (dist <= gContactDistTol && IsValidContact(h0, h1))
+	{
+		++mSubstepNumContacts;
+		double penetration = -dist / mWorld.GetScale();
+		mSubstepMaxPenetration = std::max(mSubstepMaxPenetration, penetration);
+
+		if (h0.IsValid())
+		{
+			RecordContact(h0.mID, dist, mWorld.GetManifoldPtA(pt));
+		}
+
+		if (h1.IsValid())
+		{
+			RecordContact(h1.mID, dist, mWorld.GetManifoldPtB(pt));
+		}
+	}
+}
+
+void cContactManager::RecordContact(int id, double dist, const tVector& pt)
+{
+	// keep the deepest point when a handle has several contacts in the same substep
+	if (mContactGen[id] != mSubstepGen || dist < mContactDist[id])
+	{
+		mContactGen[id] = mSubstepGen;
+		mContactDist[id] = dist;
+		mContactPts[id] = pt;
+	}
+}
+
+#if defined(CONTACT_MANAGER_VALIDATE)
+void cContactManager::ValidateContacts() const
+{
+	// compare against a full scan of the dispatcher's manifolds
+	std::vector<int> scan_contacts(GetNumEntries(), 0);
+	std::vector<int> filtered_contacts(GetNumEntries(), 0);
+	const std::unique_ptr<btDiscreteDynamicsWorld>& bt_world = mWorld.GetInternalWorld();
+
+	int num_manifolds = bt_world->getDispatcher()->getNumManifolds();
+	for (int i = 0; i < num_manifolds; ++i)
+	{
+		btPersistentManifold* mani = bt_world->getDispatcher()->getManifoldByIndexInternal(i);
+		const btCollisionObject* obj0 = static_cast<const btCollisionObject*>(mani->getBody0());
+		const btCollisionObject* obj1 = static_cast<const btCollisionObject*>(mani->getBody1());
+
+		int num_contacts = mani->getNumContacts();
+		for (int j = 0; j < num_contacts; ++j)
+		{
+			btManifoldPoint& pt = mani->getContactPoint(j);
+			if (pt.getDistance() <= gContactDistTol)
+			{
+				const cSimObj* sim_obj0 = static_cast<const cSimObj*>(obj0->getUserPointer());
+				const cSimObj* sim_obj1 = static_cast<const cSimObj*>(obj1->getUserPointer());
+
+				const tContactHandle& h0 = sim_obj0->GetContactHandle();
+				const tContactHandle& h1 = sim_obj1->GetContactHandle();
+
+				if (IsValidContact(h0, h1))
+				{
+					if (h0.IsValid())
+					{
+						scan_contacts[h0.mID] = 1;
+					}
+
+					if (h1.IsValid())
+					{
+						scan_contacts[h1.mID] = 1;
+					}
+				}
+				else
+				{
+					// eg. projectiles filter out everything and must not put a character part in contact
+					if (h0.IsValid())
+					{
+						filtered_contacts[h0.mID] = 1;
+					}
+
+					if (h1.IsValid())
+					{
+						filtered_contacts[h1.mID] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < GetNumEntries(); ++i)
+	{
+		tContactHandle handle;
+		handle.mID = i;
+		bool in_contact = IsInContact(handle);
+		if (in_contact && scan_contacts[i] == 0 && filtered_contacts[i] != 0)
+		{
+			printf("Contact recorded for handle %i from a pair rejected by the contact flags\n", i);
+			assert(false);
+		}
+		else if (in_contact != (scan_contacts[i] != 0))
+		{
+			printf("Contact mismatch for handle %i, tracked: %i, scan: %i\n", i, in_contact, scan_contacts[i]);
+			assert(false);
+		}
+	}
+}
+#endif
@@ -3,7 +3,11 @@
 #include <memory>
 #include "util/MathUtil.h"
 
+//#define CONTACT_MANAGER_VALIDATE
+
 class cWorld;
+class cSimObj;
+class btManifoldPoint;
 
 class cContactManager
 {
@@ -31,28 +35,50 @@ public:
 	virtual void Clear();
 	virtual void Update();
 
+	// called by the world at the start of every substep
+	virtual void BeginSubstep();
+
 	virtual tContactHandle RegisterContact(int contact_flags, int filter_flags);
 	virtual void UpdateContact(const cContactManager::tContactHandle& handle);
 	virtual int GetNumEntries() const;
 	virtual bool IsInContact(const tContactHandle& handle) const;
 	virtual tVector GetContactPt(const tContactHandle& handle) const;
 
+	// stats over the registered contacts from the last substep
+	virtual int GetNumContacts() const;
+	virtual double GetMaxPenetration() const;
+
 protected:
-	struct tContactEntry
-	{
-		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-		tContactEntry();
+	cWorld& mWorld;
 
-		int mFlags;
-		int mFilterFlags;
-		bool mInContact;
-		tVector mContactPt;
-	};
+	// contacts are recorded from bullet's contact processed callback as the narrowphase
+	// refreshes each manifold, an entry is in contact if it was touched during the last substep
+	unsigned int mSubstepGen;
+	unsigned int mUpdateGen;
 
-	cWorld& mWorld;
-	std::vector<tContactEntry, Eigen::aligned_allocator<tContactEntry>> mContactEntries;
+	int mSubstepNumContacts;
+	double mSubstepMaxPenetration;
+	int mNumContacts;
+	double mMaxPenetration;
+
+	// per handle state
+	std::vector<int> mFlags;
+	std::vector<int> mFilterFlags;
+	std::vector<unsigned int> mContactGen;
+	std::vector<double> mContactDist;
+	std::vector<tVector, Eigen::aligned_allocator<tVector>> mContactPts;
+	std::vector<unsigned int> mRegisteredBits;
+
+	static bool ContactProcessedCallback(btManifoldPoint& pt, void* body0, void* body1);
 
 	virtual int RegisterNewID();
 	virtual void ClearContacts();
+	virtual bool IsRegistered(int id) const;
 	virtual bool IsValidContact(const tContactHandle& h0, const tContactHandle& h1) const;
-};
\ No newline at end of file
+	virtual void ProcessContact(const btManifoldPoint& pt, const cSimObj& obj0, const cSimObj& obj1);
+	virtual void RecordContact(int id, double dist, const tVector& pt);
+
+#if defined(CONTACT_MANAGER_VALIDATE)
+	virtual void ValidateContacts() const;
+#endif
+};
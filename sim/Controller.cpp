@@ -37,6 +37,14 @@ void cController::Update(double time_step)
 	// *whistle whistle*....nothing to see here
 }
 
+void cController::SaveState(std::vector<double>& out_state) const
+{
+}
+
+void cController::LoadState(const std::vector<double>& state, int& in_out_idx)
+{
+}
+
 bool cController::IsValid() const
 {
 	return mValid;
@@ -50,7 +58,7 @@ void cController::SetOptParams(const Eigen::VectorXd& params)
 {
 }
 
-void cController::SetOptParams(const Eigen::VectorXd& params, Eigen::VectorXd& out_params) const
+void cController::SetOptParams(const Eigen::Ref<const Eigen::VectorXd>& params, Eigen::VectorXd& out_params) const
 {
 	out_params = params;
 }
@@ -108,4 +116,21 @@ bool cController::IsActive() const
 void cController::SetMode(eMode mode)
 {
 	mMode = mode;
+}
+
+void cController::PushState(const Eigen::VectorXd& vec, std::vector<double>& out_state)
+{
+	int size = static_cast<int>(vec.size());
+	out_state.push_back(size);
+	out_state.insert(out_state.end(), vec.data(), vec.data() + size);
+}
+
+void cController::PopState(const std::vector<double>& state, int& in_out_idx, Eigen::VectorXd& out_vec)
+{
+	int size = static_cast<int>(state[in_out_idx]);
+	++in_out_idx;
+	assert(in_out_idx + size <= static_cast<int>(state.size()));
+
+	out_vec = Eigen::Map<const Eigen::VectorXd>(state.data() + in_out_idx, size);
+	in_out_idx += size;
 }
\ No newline at end of file
@@ -26,7 +26,7 @@ public:
 
 	virtual void BuildOptParams(Eigen::VectorXd& out_params) const;
 	virtual void SetOptParams(const Eigen::VectorXd& params);
-	virtual void SetOptParams(const Eigen::VectorXd& params, Eigen::VectorXd& out_params) const;
+	virtual void SetOptParams(const Eigen::Ref<const Eigen::VectorXd>& params, Eigen::VectorXd& out_params) const;
 	virtual int GetNumOptParams() const;
 	virtual void FetchOptParamScale(Eigen::VectorXd& out_scale) const;
 	virtual void OutputOptParams(const std::string& file, const Eigen::VectorXd& params) const;
@@ -34,6 +34,11 @@ public:
 	virtual void ReadParams(const std::string& file);
 	virtual void ReadParams(std::ifstream& f_stream);
 
+	// appends the controller's internal state to a flat buffer, used to snapshot
+	// and restore episodes without rebuilding the controller
+	virtual void SaveState(std::vector<double>& out_state) const;
+	virtual void LoadState(const std::vector<double>& state, int& in_out_idx);
+
 	virtual void SetActive(bool active);
 	virtual bool IsActive() const;
 	virtual void SetMode(eMode mode);
@@ -44,4 +49,7 @@ protected:
 	bool mValid;
 
 	cController();
+
+	static void PushState(const Eigen::VectorXd& vec, std::vector<double>& out_state);
+	static void PopState(const std::vector<double>& state, int& in_out_idx, Eigen::VectorXd& out_vec);
 };
\ No newline at end of file
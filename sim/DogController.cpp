@@ -5,6 +5,7 @@
 #include "sim/SimCharacter.h"
 #include "sim/RBDUtil.h"
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 #include "util/Util.h"
 
 //#define DOG_CTRL_PROFILER
@@ -226,6 +227,39 @@ void cDogController::Clear()
 	mDefaultAction = gInvalidIdx;
 }
 
+void cDogController::SaveState(std::vector<double>& out_state) const
+{
+	cTerrainRLCharController::SaveState(out_state);
+	out_state.push_back(mPrevCycleTime);
+	out_state.push_back(mCurrCycleTime);
+	out_state.push_back(mPrevStumbleCount);
+	out_state.push_back(mCurrStumbleCount);
+	out_state.insert(out_state.end(), mPrevCOM.data(), mPrevCOM.data() + mPrevCOM.size());
+	out_state.insert(out_state.end(), mPrevDistTraveled.data(), mPrevDistTraveled.data() + mPrevDistTraveled.size());
+}
+
+void cDogController::LoadState(const std::vector<double>& state, int& in_out_idx)
+{
+	cTerrainRLCharController::LoadState(state, in_out_idx);
+	mPrevCycleTime = state[in_out_idx++];
+	mCurrCycleTime = state[in_out_idx++];
+	mPrevStumbleCount = state[in_out_idx++];
+	mCurrStumbleCount = state[in_out_idx++];
+	for (int i = 0; i < mPrevCOM.size(); ++i)
+	{
+		mPrevCOM[i] = state[in_out_idx++];
+	}
+	for (int i = 0; i < mPrevDistTraveled.size(); ++i)
+	{
+		mPrevDistTraveled[i] = state[in_out_idx++];
+	}
+
+	// pd targets are derived from the fsm state, so refresh them without running a transition
+	ClearCommands();
+	tStateParams params = GetCurrParams();
+	SetStateParams(params);
+}
+
 void cDogController::Update(double time_step)
 {
 	cTerrainRLCharController::Update(time_step);
@@ -306,6 +340,11 @@ void cDogController::SetMode(eMode mode)
 	}
 }
 
+void cDogController::SetMassMatTol(double tol)
+{
+	mImpPDCtrl.SetMassMatTol(tol);
+}
+
 void cDogController::CommandAction(int action_id)
 {
 	int num_actions = GetNumActions();
@@ -549,7 +588,7 @@ void cDogController::SetOptParams(const Eigen::VectorXd& opt_params)
 	SetOptParams(opt_params, mCurrAction.mParams);
 }
 
-void cDogController::SetOptParams(const Eigen::VectorXd& opt_params, Eigen::VectorXd& out_params) const
+void cDogController::SetOptParams(const Eigen::Ref<const Eigen::VectorXd>& opt_params, Eigen::VectorXd& out_params) const
 {
 	assert(opt_params.size() == GetNumOptParams());
 	assert(gNumParamInfo == GetNumParams());
@@ -651,10 +690,8 @@ void cDogController::ResetParams()
 
 bool cDogController::LoadControllers(const std::string& file)
 {
-	std::ifstream f_stream(file);
-	Json::Reader reader;
 	Json::Value root;
-	bool succ = reader.parse(f_stream, root);
+	bool succ = cAssetCache::LoadJson(file, root);
 	if (succ)
 	{
 		if (!root[gControllersKey].isNull())
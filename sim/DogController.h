@@ -67,6 +67,8 @@ public:
 	virtual void Reset();
 	virtual void Clear();
 	virtual void Update(double time_step);
+	virtual void SaveState(std::vector<double>& out_state) const;
+	virtual void LoadState(const std::vector<double>& state, int& in_out_idx);
 	
 	virtual void SeCtrlStateParams(eState state, const tStateParams& params);
 
@@ -76,6 +78,7 @@ public:
 	virtual int GetNumStates() const;
 
 	virtual void SetMode(eMode mode);
+	virtual void SetMassMatTol(double tol);
 	virtual void CommandAction(int action_id);
 	virtual void CommandRandAction();
 	virtual int GetDefaultAction() const;
@@ -95,7 +98,7 @@ public:
 	virtual void SetParams(const Eigen::VectorXd& params);
 	virtual void BuildOptParams(Eigen::VectorXd& out_params) const;
 	virtual void SetOptParams(const Eigen::VectorXd& opt_params);
-	virtual void SetOptParams(const Eigen::VectorXd& opt_params, Eigen::VectorXd& out_params) const;
+	virtual void SetOptParams(const Eigen::Ref<const Eigen::VectorXd>& opt_params, Eigen::VectorXd& out_params) const;
 
 	virtual void ReadParams(const std::string& file);
 	virtual void ReadParams(std::ifstream& f_stream);
@@ -2,8 +2,10 @@
 #include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
 #include <time.h>
 #include <iostream>
+#include <atomic>
 
 const double gInvalidHeight = -std::numeric_limits<double>::infinity();
+static std::atomic<int> gNextBuildID(0);
 
 cGroundVar2D::tParams::tParams()
 {
@@ -12,6 +14,16 @@ cGroundVar2D::tParams::tParams()
 	mPadding = ePaddingFlat;
 }
 
+cGroundVar2D::tState::tState()
+{
+	mFlipSeg = false;
+	for (int s = 0; s < gNumSegments; ++s)
+	{
+		mSegBuildIDs[s] = gInvalidIdx;
+		mSegMinX[s] = 0;
+	}
+}
+
 cGroundVar2D::cGroundVar2D()
 {
 	mRand.Seed(static_cast<unsigned long int>(cMathUtil::RandInt(0, std::numeric_limits<int>::max())));
@@ -196,12 +208,14 @@ tVector cGroundVar2D::GetPos() const
 
 	for (int i = 0; i < gNumSegments; ++i)
 	{
-		tVector curr_min;
-		tVector curr_max;
-		mSegments[i]->CalcAABB(curr_min, curr_max);
-
-		aabb_min = aabb_min.cwiseMin(curr_min);
-		aabb_max = aabb_max.cwiseMax(curr_max);
+		const auto& seg = mSegments[i];
+		if (!seg->IsEmpty())
+		{
+			tVector curr_min = tVector(seg->GetMinX(), seg->mMinY, 0, 0);
+			tVector curr_max = tVector(seg->GetMaxX(), seg->mMaxY, 0, 0);
+			aabb_min = aabb_min.cwiseMin(curr_min);
+			aabb_max = aabb_max.cwiseMax(curr_max);
+		}
 	}
 
 	tVector pos = 0.5 * (aabb_max + aabb_min);
@@ -214,16 +228,76 @@ double cGroundVar2D::GetWidth() const
 	return w;
 }
 
+int cGroundVar2D::GetSegmentBuildID(int s) const
+{
+	return GetSegment(s)->mBuildID;
+}
+
+int cGroundVar2D::GetSegmentGridWidth(int s) const
+{
+	return GetSegment(s)->GetGridWidth();
+}
+
+tVector cGroundVar2D::GetSegmentVertex(int s, int i, int j) const
+{
+	return GetSegment(s)->GetVertex(i, j);
+}
+
 void cGroundVar2D::SetTerrainFunc(cTerrainGen2D::tTerrainFunc func)
 {
 	mTerrainFunc = func;
 }
 
+void cGroundVar2D::SetTerrainLibrary(const std::shared_ptr<const cTerrainLibrary>& lib)
+{
+	mTerrainLib = lib;
+}
+
 void cGroundVar2D::SeedRand(unsigned long seed)
 {
 	mRand.Seed(seed);
 }
 
+void cGroundVar2D::SaveState(tState& out_state) const
+{
+	out_state.mFlipSeg = mFlipSeg;
+	out_state.mRand = mRand;
+
+	for (int s = 0; s < gNumSegments; ++s)
+	{
+		const auto& seg = mSegments[s];
+		if (out_state.mSegBuildIDs[s] != seg->mBuildID)
+		{
+			out_state.mSegBuildIDs[s] = seg->mBuildID;
+			out_state.mSegMinX[s] = seg->mMinX;
+			out_state.mSegData[s] = seg->mData;
+		}
+	}
+}
+
+void cGroundVar2D::LoadState(const tState& state)
+{
+	for (int s = 0; s < gNumSegments; ++s)
+	{
+		auto& seg = mSegments[s];
+		int build_id = state.mSegBuildIDs[s];
+		if (seg->mBuildID != build_id)
+		{
+			// only segments that have been regenerated since the save need to be rebuilt
+			seg->Clear();
+			if (build_id != gInvalidIdx)
+			{
+				seg->mData = state.mSegData[s];
+				seg->BuildBody(mWorld, state.mSegMinX[s], mParams.mFriction);
+				seg->mBuildID = build_id;
+			}
+		}
+	}
+
+	mFlipSeg = state.mFlipSeg;
+	mRand = state.mRand;
+}
+
 void cGroundVar2D::ResetParams()
 {
 	mFlipSeg = false;
@@ -320,7 +394,7 @@ void cGroundVar2D::BuildSegment(int seg_id, double bound_min, double bound_max,
 	{
 		AddPadding(seg_id, bound_min, bound_max);
 	}
-	(*mTerrainFunc)(bound_max - bound_min, mTerrainParams, mRand, seg->mData);
+	AddTerrain(seg_id, bound_min, bound_max);
 
 	int num_verts = static_cast<int>(seg->mData.size());
 	float end_h = 0;
@@ -339,6 +413,7 @@ void cGroundVar2D::BuildSegment(int seg_id, double bound_min, double bound_max,
 							(bound_min) :
 							(bound_max - (num_verts - 1) * tSegment::gGridSpacingX);
 	seg->Init(mWorld, new_bound_min, mParams.mFriction);
+	seg->mBuildID = gNextBuildID++;
 }
 
 void cGroundVar2D::AddPadding(int seg_id, double bound_min, double bound_max)
@@ -354,6 +429,31 @@ void cGroundVar2D::AddPadding(int seg_id, double bound_min, double bound_max)
 	}
 }
 
+void cGroundVar2D::AddTerrain(int seg_id, double bound_min, double bound_max)
+{
+	std::unique_ptr<tSegment>& seg = mSegments[seg_id];
+	if (mTerrainLib != nullptr)
+	{
+		// library segments can be narrower than the requested width, so random segments
+		// are chained until they cover it and the excess is trimmed
+		int num_verts0 = static_cast<int>(seg->mData.size());
+		int num_verts = static_cast<int>(std::ceil((bound_max - bound_min) / tSegment::gGridSpacingX)) + 1;
+		num_verts += (num_verts0 > 0) ? num_verts0 - 1 : 0;
+
+		int num_lib_segs = mTerrainLib->GetNumSegments();
+		while (static_cast<int>(seg->mData.size()) < num_verts)
+		{
+			int lib_seg = mRand.RandInt(0, num_lib_segs);
+			mTerrainLib->AppendSegment(lib_seg, seg->mData);
+		}
+		seg->mData.resize(num_verts);
+	}
+	else
+	{
+		(*mTerrainFunc)(bound_max - bound_min, mTerrainParams, mRand, seg->mData);
+	}
+}
+
 double cGroundVar2D::GetMinX() const
 {
 	return GetMinSegment()->GetMinX();
@@ -382,6 +482,11 @@ const double cGroundVar2D::tSegment::gGridSpacingZ = 1;
 cGroundVar2D::tSegment::tSegment()
 {
 	mMinX = 0;
+	mMaxX = 0;
+	mMinY = 0;
+	mMaxY = 0;
+	mWorldScale = 1;
+	mBuildID = gInvalidIdx;
 }
 
 cGroundVar2D::tSegment::~tSegment()
@@ -391,7 +496,33 @@ cGroundVar2D::tSegment::~tSegment()
 
 void cGroundVar2D::tSegment::Init(std::shared_ptr<cWorld> world, double min_x, double friction)
 {
-	double world_scale = world->GetScale();
+	double world_scale = (world != nullptr) ? world->GetScale() : 1;
+	int grid_width = static_cast<int>(mData.size());
+	int grid_length = GetGridLength();
+
+	for (size_t i = 0; i < mData.size(); ++i)
+	{
+		mData[i] *= static_cast<float>(world_scale);
+	}
+
+	mData.resize(grid_width * grid_length);
+	for (int i = 1; i < grid_length; ++i)
+	{
+		int k=0;
+		for ( int j = i * grid_width; j < (i * grid_width + grid_width); j++ )
+		{
+			mData[j] = mData[k];
+			++k;
+		}
+	}
+
+	BuildBody(world, min_x, friction);
+}
+
+void cGroundVar2D::tSegment::BuildBody(std::shared_ptr<cWorld> world, double min_x, double friction)
+{
+	// expects mData to already be scaled and replicated along the grid length
+	double world_scale = (world != nullptr) ? world->GetScale() : 1;
 	double height_scale = 1;
 	double x_scale = gGridSpacingX * world_scale;
 	double z_scale = gGridSpacingZ * world_scale;
@@ -400,8 +531,8 @@ void cGroundVar2D::tSegment::Init(std::shared_ptr<cWorld> world, double min_x, d
 	const PHY_ScalarType data_type = PHY_FLOAT;
 	const double h_pad = 0.1; // is this necessary for completely flat terrain?
 
-	int grid_width = static_cast<int>(mData.size());
 	int grid_length = GetGridLength();
+	int grid_width = static_cast<int>(mData.size()) / grid_length;
 	
 	mMinX = min_x;
 
@@ -409,28 +540,27 @@ void cGroundVar2D::tSegment::Init(std::shared_ptr<cWorld> world, double min_x, d
 	tVector aabb_max = tVector::Zero();
 
 	aabb_min[0] = mMinX;
-	aabb_max[0] = mMinX + (mData.size() - 1) * gGridSpacingX;
+	aabb_max[0] = mMinX + (grid_width - 1) * gGridSpacingX;
 	aabb_min[1] = std::numeric_limits<double>::infinity();
 	aabb_max[1] = -std::numeric_limits<double>::infinity();
 
-	for (size_t i = 0; i < mData.size(); ++i)
+	for (int i = 0; i < grid_width; ++i)
 	{
-		double h = mData[i];
+		double h = mData[i] / world_scale;
 		aabb_min[1] = std::min(aabb_min[1], h);
 		aabb_max[1] = std::max(aabb_max[1], h);
-
-		mData[i] *= static_cast<float>(world_scale);
 	}
 
-	mData.resize(grid_width * grid_length);
-	for (int i = 1; i < grid_length; ++i)
+	// the bounds are kept so that sampling never has to query the world
+	mWorldScale = world_scale;
+	mMaxX = aabb_max[0];
+	mMinY = aabb_min[1];
+	mMaxY = aabb_max[1];
+
+	if (world == nullptr)
 	{
-		int k=0;
-		for ( int j = i * grid_width; j < (i * grid_width + grid_width); j++ )
-		{
-			mData[j] = mData[k];
-			++k;
-		}
+		// kinematic ground, the heights can be sampled but nothing collides with them
+		return;
 	}
 
 	double min_height = world_scale * (aabb_min[1] - h_pad);
@@ -468,6 +598,7 @@ void cGroundVar2D::tSegment::Clear()
 	// delete height_field;
 	mData.clear();
 	mData.shrink_to_fit();
+	mBuildID = gInvalidIdx;
 }
 
 bool cGroundVar2D::tSegment::IsEmpty() const
@@ -481,11 +612,7 @@ const double cGroundVar2D::tSegment::GetMinX() const
 	{
 		return std::numeric_limits<double>::infinity();
 	}
-
-	tVector aabb_min;
-	tVector aabb_max;
-	CalcAABB(aabb_min, aabb_max);
-	return aabb_min[0];
+	return mMinX;
 }
 
 const double cGroundVar2D::tSegment::GetMaxX() const
@@ -494,11 +621,7 @@ const double cGroundVar2D::tSegment::GetMaxX() const
 	{
 		return -std::numeric_limits<double>::infinity();
 	}
-
-	tVector aabb_min;
-	tVector aabb_max;
-	CalcAABB(aabb_min, aabb_max);
-	return aabb_max[0];
+	return mMaxX;
 }
 
 int cGroundVar2D::tSegment::GetGridWidth() const
@@ -523,9 +646,13 @@ double cGroundVar2D::tSegment::GetLength() const
 
 tVector cGroundVar2D::tSegment::GetScaling() const
 {
-	double world_scale = mWorld->GetScale();
-	btVector3 bt_scale = mShape->getLocalScaling();
-	return tVector(bt_scale[0], bt_scale[1], bt_scale[2], 0) / world_scale;
+	return tVector(gGridSpacingX, 1 / mWorldScale, gGridSpacingZ, 0);
+}
+
+tVector cGroundVar2D::tSegment::GetOrigin() const
+{
+	// center of the heightfield, same as the position of its body
+	return tVector(0.5 * (mMinX + mMaxX), 0.5 * (mMinY + mMaxY), 0, 0);
 }
 
 tVector cGroundVar2D::tSegment::GetVertex(int i, int j) const
@@ -533,7 +660,7 @@ tVector cGroundVar2D::tSegment::GetVertex(int i, int j) const
 	assert(i >= 0 && i < GetGridWidth());
 	assert(j >= 0 && j < GetGridLength());
 
-	tVector origin = GetPos();
+	tVector origin = GetOrigin();
 	tVector scaling = GetScaling();
 
 	int w = GetGridWidth();
@@ -577,14 +704,12 @@ double cGroundVar2D::tSegment::SampleHeight(const tVector& pos, bool& out_valid_
 
 double cGroundVar2D::tSegment::GetStartHeight() const
 {
-	double scale = mWorld->GetScale();
-	return mData[0] / scale;
+	return mData[0] / mWorldScale;
 }
 
 double cGroundVar2D::tSegment::GetEndHeight() const
 {
-	double scale = mWorld->GetScale();
-	return mData[mData.size() - 1] / scale;
+	return mData[mData.size() - 1] / mWorldScale;
 }
 
 tVector cGroundVar2D::tSegment::CalcGridCoord(const tVector& pos) const
@@ -594,7 +719,7 @@ tVector cGroundVar2D::tSegment::CalcGridCoord(const tVector& pos) const
 	int w = GetGridWidth();
 	int l = GetGridLength();
 
-	tVector origin = GetPos();
+	tVector origin = GetOrigin();
 	tVector scale = GetScaling();
 	tVector coord = pos - origin;
 	coord[1] = coord[2];
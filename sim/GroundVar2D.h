@@ -2,6 +2,7 @@
 
 #include "sim/Ground.h"
 #include "sim/TerrainGen2D.h"
+#include "sim/TerrainLibrary.h"
 #include "util/Rand.h"
 
 class cGroundVar2D : public cGround
@@ -24,9 +25,25 @@ public:
 		ePadding mPadding;
 	};
 
+	static const int gNumSegments = 2;
+
+	// snapshot of the generated terrain, segments are only copied when they
+	// have been rebuilt since the last save into the same state
+	struct tState
+	{
+		tState();
+		bool mFlipSeg;
+		cRand mRand;
+		int mSegBuildIDs[gNumSegments];
+		double mSegMinX[gNumSegments];
+		std::vector<float> mSegData[gNumSegments];
+	};
+
 	cGroundVar2D();
 	virtual ~cGroundVar2D();
 
+	// a null world builds a kinematic ground that only supports height queries,
+	// none of the segments get a collision body
 	virtual void Init(std::shared_ptr<cWorld> world, const tParams& params,
 					const tVector& bound_min, const tVector& bound_max);
 	virtual void Update(const tVector& bound_min, const tVector& bound_max);
@@ -45,11 +62,21 @@ public:
 	virtual tVector GetPos() const;
 	virtual double GetWidth() const;
 
+	// per segment access, segments are ordered from min to max x,
+	// build ids are unique across all grounds so they can be used to cache derived data
+	virtual int GetSegmentBuildID(int s) const;
+	virtual int GetSegmentGridWidth(int s) const;
+	virtual tVector GetSegmentVertex(int s, int i, int j) const;
+
 	virtual void SetTerrainFunc(cTerrainGen2D::tTerrainFunc func);
+	// when a library is set segments are drawn from it at random instead of being generated
+	virtual void SetTerrainLibrary(const std::shared_ptr<const cTerrainLibrary>& lib);
 	virtual void SeedRand(unsigned long seed);
 
+	virtual void SaveState(tState& out_state) const;
+	virtual void LoadState(const tState& state);
+
 protected:
-	static const int gNumSegments = 2;
 	enum eAlignMode
 	{
 		eAlignMin,
@@ -66,6 +93,7 @@ protected:
 		virtual ~tSegment();
 		
 		void Init(std::shared_ptr<cWorld> world, double min_x, double friction);
+		void BuildBody(std::shared_ptr<cWorld> world, double min_x, double friction);
 		void Clear();
 		bool IsEmpty() const;
 		const double GetMinX() const;
@@ -77,6 +105,7 @@ protected:
 		double GetLength() const;
 
 		tVector GetScaling() const;
+		tVector GetOrigin() const;
 
 		tVector GetVertex(int i, int j) const;
 		int CalcDataIdx(int i, int j) const;
@@ -90,11 +119,17 @@ protected:
 
 		std::vector<float> mData;
 		double mMinX;
+		double mMaxX;
+		double mMinY;
+		double mMaxY;
+		double mWorldScale;
+		int mBuildID;
 	};
 
 	tParams mParams;
 	cRand mRand;
 	cTerrainGen2D::tTerrainFunc mTerrainFunc;
+	std::shared_ptr<const cTerrainLibrary> mTerrainLib;
 
 	bool mFlipSeg;
 	std::unique_ptr<tSegment> mSegments[gNumSegments];
@@ -115,6 +150,7 @@ protected:
 	virtual void BuildSegment(int seg_id, double bound_min, double bound_max, 
 							eAlignMode align_mode, const tVector& fix_point);
 	virtual void AddPadding(int seg_id, double bound_min, double bound_max);
+	virtual void AddTerrain(int seg_id, double bound_min, double bound_max);
 
 	virtual double GetMinX() const;
 	virtual double GetMidX() const;
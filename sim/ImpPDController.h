@@ -10,6 +10,8 @@ class cImpPDController : public cController
 public:
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+	static const double gDefaultMassMatTol;
+
 	cImpPDController();
 	virtual ~cImpPDController();
 
@@ -35,6 +37,14 @@ public:
 	virtual cPDController& GetPDCtrl(int joint_id);
 	virtual const cPDController& GetPDCtrl(int joint_id) const;
 
+	// the mass matrix is refactored only if it changed by more than tol relative to the
+	// last factored one, solves with a reused factorization are refined once,
+	// 0 refactors on any change
+	virtual void SetMassMatTol(double tol);
+	virtual double GetMassMatTol() const;
+	virtual int GetNumFactorizations() const;
+	virtual int GetNumFactorSkips() const;
+
 protected:
 	Eigen::VectorXd mKp;
 	Eigen::VectorXd mKd;
@@ -44,6 +54,28 @@ protected:
 	bool mExternRBDModel;
 	std::shared_ptr<cRBDModel> mRBDModel;
 
+	// gains with inactive joints masked out, rebuilt only when activity or gains change
+	Eigen::VectorXi mActiveJoints;
+	Eigen::VectorXd mKpActive;
+	Eigen::VectorXd mKdActive;
+	bool mDirtyGains;
+
+	// workspace reused across substeps
+	Eigen::VectorXd mPoseErr;
+	Eigen::VectorXd mVelErr;
+	Eigen::VectorXd mAcc;
+	Eigen::VectorXd mRes;
+	Eigen::VectorXd mTau;
+	Eigen::MatrixXd mSolveMat;
+	Eigen::MatrixXd mFactorMassMat;
+	Eigen::LDLT<Eigen::MatrixXd> mLDLT;
+	bool mValidFactor;
+	double mFactorTimeStep;
+	double mMassMatTol;
+	int mNumFactors;
+	int mNumFactorSkips;
+	bool mCheckedFactorSkips;
+
 #if defined(IMP_PD_CTRL_PROFILER)
 	double mPerfSolveTime;
 	double mPerfTotalTime;
@@ -55,6 +87,13 @@ protected:
 	virtual std::shared_ptr<cRBDModel> BuildRBDModel(const cSimCharacter& character, const tVector& gravity) const;
 	virtual void UpdateRBDModel();
 
+	virtual void InitWorkspace();
+	virtual void UpdateActiveGains();
+	virtual bool NeedsFactorization(const Eigen::MatrixXd& mass_mat, double time_step) const;
+	virtual void FactorMassMat(const Eigen::MatrixXd& mass_mat, double time_step);
+	virtual void SolveRefined(const Eigen::MatrixXd& mass_mat, double time_step, Eigen::VectorXd& in_out_x);
+	virtual void CheckFactorSkips();
+
 	virtual void CalcControlForces(double time_step, Eigen::VectorXd& out_tau);
 	virtual void BuildPoseErr(Eigen::VectorXd& out_pose_err) const;
 	virtual void BuildVelErr(Eigen::VectorXd& out_vel_err) const;
@@ -18,6 +18,16 @@ int cNNController::GetPoliActionSize() const
 	return 0;
 }
 
+int cNNController::GetPoliStateGroundOffset() const
+{
+	return 0;
+}
+
+int cNNController::GetPoliStateGroundSize() const
+{
+	return 0;
+}
+
 int cNNController::GetNetInputSize() const
 {
 	return GetPoliStateSize();
@@ -79,7 +89,15 @@ bool cNNController::LoadNet(const std::string& net_file)
 
 void cNNController::LoadModel(const std::string& model_file)
 {
-	mNet.LoadModel(model_file);
+	mQuantNet.Clear();
+	if (cQuantNet::IsQuantModelFile(model_file))
+	{
+		LoadQuantModel(model_file);
+	}
+	else
+	{
+		mNet.LoadSharedModel(model_file);
+	}
 }
 
 void cNNController::LoadScale(const std::string& scale_file)
@@ -89,6 +107,7 @@ void cNNController::LoadScale(const std::string& scale_file)
 
 void cNNController::CopyNet(const cNeuralNet& net)
 {
+	mQuantNet.Clear();
 	mNet.CopyModel(net);
 }
 
@@ -114,6 +133,11 @@ cNeuralNet& cNNController::GetNet()
 	return mNet;
 }
 
+bool cNNController::UseQuantNet() const
+{
+	return mQuantNet.IsValid();
+}
+
 bool cNNController::HasNet() const
 {
 	return mNet.HasNet();
@@ -123,4 +147,42 @@ void cNNController::LoadNetIntern(const std::string& net_file)
 {
 	mNet.Clear();
 	mNet.LoadNet(net_file);
+}
+
+bool cNNController::LoadQuantModel(const std::string& model_file)
+{
+	bool succ = mQuantNet.LoadModel(model_file);
+	if (succ)
+	{
+		int input_size = mQuantNet.GetInputSize();
+		int output_size = mQuantNet.GetOutputSize();
+		int state_size = GetNetInputSize();
+		int action_size = GetNetOutputSize();
+
+		if (input_size != state_size || output_size != action_size)
+		{
+			printf("Quantized model dimensions do not match the controller (%i x %i vs %i x %i).\n", 
+					input_size, output_size, state_size, action_size);
+			mQuantNet.Clear();
+			succ = false;
+		}
+	}
+
+	if (!succ)
+	{
+		assert(false);
+	}
+	return succ;
+}
+
+void cNNController::EvalNet(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const
+{
+	if (UseQuantNet())
+	{
+		mQuantNet.Eval(x, out_y);
+	}
+	else
+	{
+		mNet.Eval(x, out_y);
+	}
 }
\ No newline at end of file
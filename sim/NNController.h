@@ -1,6 +1,7 @@
 #pragma once
 
 #include "learning/NeuralNet.h"
+#include "learning/QuantNet.h"
 #include "CharController.h"
 
 class cNNController : public cCharController
@@ -10,6 +11,8 @@ public:
 
 	virtual int GetPoliStateSize() const;
 	virtual int GetPoliActionSize() const;
+	virtual int GetPoliStateGroundOffset() const;
+	virtual int GetPoliStateGroundSize() const;
 	virtual int GetNetInputSize() const;
 	virtual int GetNetOutputSize() const;
 
@@ -28,11 +31,17 @@ public:
 	virtual void BuildNNOutputOffsetScale(Eigen::VectorXd& out_offset, Eigen::VectorXd& out_scale) const;
 	virtual const cNeuralNet& GetNet() const;
 	virtual cNeuralNet& GetNet();
+	virtual bool UseQuantNet() const;
 
 protected:
 	cNeuralNet mNet;
 
+	// frozen int8 policy, used in place of mNet when a quantized model is loaded
+	cQuantNet mQuantNet;
+
 	cNNController();
 	virtual bool HasNet() const;
 	virtual void LoadNetIntern(const std::string& net_file);
+	virtual bool LoadQuantModel(const std::string& model_file);
+	virtual void EvalNet(const Eigen::VectorXd& x, Eigen::VectorXd& out_y) const;
 };
\ No newline at end of file
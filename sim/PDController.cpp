@@ -3,6 +3,7 @@
 
 #include "sim/SimCharacter.h"
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 
 const std::string gPDControllersKey = "PDControllers";
 const std::string gPDParamKeys[cPDController::eParamMax] =
@@ -18,11 +19,8 @@ const std::string gPDParamKeys[cPDController::eParamMax] =
 
 bool cPDController::LoadParams(const std::string& file, Eigen::MatrixXd& out_buffer)
 {
-	std::ifstream f_stream(file);
-	Json::Reader reader;
 	Json::Value root;
-	bool succ = reader.parse(f_stream, root);
-	f_stream.close();
+	bool succ = cAssetCache::LoadJson(file, root);
 
 	if (succ)
 	{
@@ -6,6 +6,7 @@
 #include "sim/SimCharacter.h"
 #include "sim/RBDUtil.h"
 #include "util/FileUtil.h"
+#include "util/AssetCache.h"
 
 const cRaptorController::eStance gDefaultStance = cRaptorController::eStanceRight;
 const cRaptorController::tStateDef gStateDefs[cRaptorController::eStateMax] =
@@ -192,6 +193,40 @@ void cRaptorController::Clear()
 	mDefaultAction = gInvalidIdx;
 }
 
+void cRaptorController::SaveState(std::vector<double>& out_state) const
+{
+	cTerrainRLCharController::SaveState(out_state);
+	out_state.push_back(mStance);
+	out_state.push_back(mPrevCycleTime);
+	out_state.push_back(mCurrCycleTime);
+	out_state.push_back(mPrevStumbleCount);
+	out_state.push_back(mCurrStumbleCount);
+	out_state.insert(out_state.end(), mPrevCOM.data(), mPrevCOM.data() + mPrevCOM.size());
+	out_state.insert(out_state.end(), mPrevDistTraveled.data(), mPrevDistTraveled.data() + mPrevDistTraveled.size());
+}
+
+void cRaptorController::LoadState(const std::vector<double>& state, int& in_out_idx)
+{
+	cTerrainRLCharController::LoadState(state, in_out_idx);
+	eStance stance = static_cast<eStance>(static_cast<int>(state[in_out_idx++]));
+	mPrevCycleTime = state[in_out_idx++];
+	mCurrCycleTime = state[in_out_idx++];
+	mPrevStumbleCount = state[in_out_idx++];
+	mCurrStumbleCount = state[in_out_idx++];
+	for (int i = 0; i < mPrevCOM.size(); ++i)
+	{
+		mPrevCOM[i] = state[in_out_idx++];
+	}
+	for (int i = 0; i < mPrevDistTraveled.size(); ++i)
+	{
+		mPrevDistTraveled[i] = state[in_out_idx++];
+	}
+
+	// stance also refreshes the pd targets for the current fsm state
+	ClearCommands();
+	SetStance(stance);
+}
+
 void cRaptorController::Update(double time_step)
 {
 	cTerrainRLCharController::Update(time_step);
@@ -272,6 +307,11 @@ void cRaptorController::SetMode(eMode mode)
 	}
 }
 
+void cRaptorController::SetMassMatTol(double tol)
+{
+	mImpPDCtrl.SetMassMatTol(tol);
+}
+
 void cRaptorController::CommandAction(int action_id)
 {
 	int num_actions = GetNumActions();
@@ -516,7 +556,7 @@ void cRaptorController::SetOptParams(const Eigen::VectorXd& opt_params)
 	SetOptParams(opt_params, mCurrAction.mParams);
 }
 
-void cRaptorController::SetOptParams(const Eigen::VectorXd& opt_params, Eigen::VectorXd& out_params) const
+void cRaptorController::SetOptParams(const Eigen::Ref<const Eigen::VectorXd>& opt_params, Eigen::VectorXd& out_params) const
 {
 	assert(opt_params.size() == GetNumOptParams());
 	assert(gNumOptParamMasks == GetNumParams());
@@ -631,10 +671,8 @@ void cRaptorController::BuildNormPose(Eigen::VectorXd& pose) const
 
 bool cRaptorController::LoadControllers(const std::string& file)
 {
-	std::ifstream f_stream(file);
-	Json::Reader reader;
 	Json::Value root;
-	bool succ = reader.parse(f_stream, root);
+	bool succ = cAssetCache::LoadJson(file, root);
 	if (succ)
 	{
 		if (!root[gControllersKey].isNull())
@@ -106,6 +106,55 @@ void cSimCharacter::Update(double time_step)
 #endif
 }
 
+void cSimCharacter::SaveState(tState& out_state) const
+{
+	int num_parts = GetNumBodyParts();
+	out_state.mBodyStates.resize(num_parts);
+	for (int i = 0; i < num_parts; ++i)
+	{
+		if (IsValidBodyPart(i))
+		{
+			mWorld->GetBodyState(mBodyParts[i].get(), out_state.mBodyStates[i]);
+		}
+	}
+
+	out_state.mPose = mPose;
+	out_state.mVel = mVel;
+	out_state.mCtrlState.clear();
+	if (HasController())
+	{
+		mController->SaveState(out_state.mCtrlState);
+	}
+}
+
+void cSimCharacter::LoadState(const tState& state)
+{
+	int num_parts = GetNumBodyParts();
+	assert(state.mBodyStates.size() == num_parts);
+	for (int i = 0; i < num_parts; ++i)
+	{
+		if (IsValidBodyPart(i))
+		{
+			mWorld->SetBodyState(state.mBodyStates[i], mBodyParts[i].get());
+		}
+	}
+
+	mPose = state.mPose;
+	mVel = state.mVel;
+	ClearJointTorques();
+
+	if (HasController() && state.mCtrlState.size() > 0)
+	{
+		int idx = 0;
+		mController->LoadState(state.mCtrlState, idx);
+		assert(idx == static_cast<int>(state.mCtrlState.size()));
+	}
+
+#if defined(ENABLE_TRAINING)
+	ClearEffortBuffer();
+#endif
+}
+
 tVector cSimCharacter::GetRootPos() const
 {
 	int root_id = GetRootID();
@@ -665,6 +714,7 @@ void cSimCharacter::PlayPossum()
 void cSimCharacter::SetPose(const Eigen::VectorXd& pose)
 {
 	cCharacter::SetPose(pose);
+	cKinTree::UpdateFKCache(mJointMat, mPose, mFKCache);
 
 	for (int i = 0; i < static_cast<int>(mBodyParts.size()); ++i)
 	{
@@ -673,8 +723,9 @@ void cSimCharacter::SetPose(const Eigen::VectorXd& pose)
 			auto& curr_part = mBodyParts[i];
 			tVector axis;
 			double theta;
-			cKinTree::CalcBodyPartRotation(mJointMat, mPose, mBodyDefs, i, axis, theta);
-			tVector attach_pt = cKinTree::CalcBodyPartPos(mJointMat, mPose, mBodyDefs, i);
+			tMatrix body_trans = cKinTree::BodyWorldTrans(mFKCache, mBodyDefs, i);
+			cMathUtil::RotMatToAxisAngle(body_trans, axis, theta);
+			tVector attach_pt = cKinTree::CalcBodyPartPos(mFKCache, mBodyDefs, i);
 
 			curr_part->SetPos(attach_pt);
 			curr_part->SetRotation(axis, theta);
@@ -23,6 +23,14 @@ public:
 		cWorld::ePlaneCons mPlaneCons;
 	};
 
+	struct tState
+	{
+		btAlignedObjectArray<cWorld::tBodyState> mBodyStates;
+		Eigen::VectorXd mPose;
+		Eigen::VectorXd mVel;
+		std::vector<double> mCtrlState;
+	};
+
 	cSimCharacter();
 	virtual ~cSimCharacter();
 
@@ -31,6 +39,9 @@ public:
 	virtual void Reset();
 	virtual void Update(double time_step);
 
+	virtual void SaveState(tState& out_state) const;
+	virtual void LoadState(const tState& state);
+
 	virtual tVector GetRootPos() const;
 	virtual void GetRootRotation(tVector& out_axis, double& out_theta) const;
 	virtual tVector GetRootVel() const;
@@ -140,6 +140,9 @@ void cSimObj::RegisterContact(int contact_flags, int filter_flags)
 	{
 		mContactHandle = mWorld->RegisterContact(contact_flags, filter_flags);
 		assert(mContactHandle.IsValid());
+
+		// lets the contact callbacks find the handle without going through the sim object
+		mBody->setUserIndex(mContactHandle.mID);
 	}
 	else
 	{
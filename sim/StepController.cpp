@@ -0,0 +1,393 @@
+#include "StepController.h"
+#include <assert.h>
+#include <algorithm>
+#include <set>
+#include <mutex>
+
+#include "util/MathUtil.h"
+#include "util/FileUtil.h"
+
+const std::string gModeStrs[cStepController::eModeMax] =
+{
+	"fixed",
+	"adaptive",
+	"replay"
+};
+
+cStepController::tParams::tParams()
+{
+	// unset bounds are filled in from the fixed settings in Init
+	mMinUpdateSteps = gInvalidIdx;
+	mMaxUpdateSteps = gInvalidIdx;
+	mMinSimSubsteps = gInvalidIdx;
+	mMaxSimSubsteps = gInvalidIdx;
+	mMinSolverIters = gInvalidIdx;
+	mMaxSolverIters = gInvalidIdx;
+	mMaxStepDecrease = 2;
+
+	mContactThreshold = 4;
+	mPenetrationThreshold = 0.01;
+	mVelChangeThreshold = 10;
+}
+
+cStepController::tMeasures::tMeasures()
+{
+	mNumContacts = 0;
+	mMaxPenetration = 0;
+	mVelChange = 0;
+}
+
+cStepController::tSettings::tSettings()
+{
+	mNumUpdateSteps = 20;
+	mNumSimSubsteps = 1;
+	mSolverIters = 10;
+}
+
+cStepController::cStepController()
+{
+	mMode = eModeFixed;
+	mValidPrev = false;
+	mLogFile = nullptr;
+	mReplayFile = nullptr;
+	mNumSteps = 0;
+	mNumBaselineSteps = 0;
+}
+
+cStepController::~cStepController()
+{
+	CloseFiles();
+}
+
+void cStepController::Init(eMode mode, const tParams& params, const tSettings& fixed_settings)
+{
+	mMode = mode;
+	mParams = params;
+	mFixedSettings = fixed_settings;
+	SetDefaultBounds(fixed_settings, mParams);
+
+	if (mMode == eModeAdaptive && !CheckParams(mParams))
+	{
+		printf("Invalid adaptive step bounds, falling back to fixed steps\n");
+		mMode = eModeFixed;
+	}
+	Reset();
+}
+
+void cStepController::Reset()
+{
+	mValidPrev = false;
+}
+
+void cStepController::Clear()
+{
+	CloseFiles();
+	mMode = eModeFixed;
+	mValidPrev = false;
+	mNumSteps = 0;
+	mNumBaselineSteps = 0;
+}
+
+bool cStepController::OpenLog(const std::string& file)
+{
+	CloseLog();
+	mLogFileName = ClaimLogFile(file);
+	if (mLogFileName != file)
+	{
+		printf("Step log %s is already in use, logging to %s\n", file.c_str(), mLogFileName.c_str());
+	}
+
+	mLogFile = cFileUtil::OpenFile(mLogFileName, "w");
+	bool succ = mLogFile != nullptr;
+	if (succ)
+	{
+		fprintf(mLogFile, "time, update_steps, sim_substeps, solver_iters, contacts, max_penetration, vel_change\n");
+	}
+	else
+	{
+		ReleaseLogFile(mLogFileName);
+		mLogFileName = "";
+	}
+	return succ;
+}
+
+bool cStepController::OpenReplay(const std::string& file)
+{
+	cFileUtil::CloseFile(mReplayFile);
+	mReplayFile = cFileUtil::OpenFile(file, "r");
+	bool succ = mReplayFile != nullptr;
+	if (succ)
+	{
+		// skip header
+		int c = 0;
+		do
+		{
+			c = fgetc(mReplayFile);
+		} while (c != '\n' && c != EOF);
+	}
+	return succ;
+}
+
+void cStepController::CloseFiles()
+{
+	CloseLog();
+	cFileUtil::CloseFile(mReplayFile);
+}
+
+void cStepController::CloseLog()
+{
+	if (mLogFile != nullptr)
+	{
+		fprintf(mLogFile, "# steps: %lld, baseline steps: %lld, saved: %.5f\n", mNumSteps, mNumBaselineSteps, GetStepsSaved());
+		cFileUtil::CloseFile(mLogFile);
+		ReleaseLogFile(mLogFileName);
+		mLogFileName = "";
+	}
+}
+
+std::mutex& GetLogFileLock()
+{
+	static std::mutex log_file_lock;
+	return log_file_lock;
+}
+
+std::set<std::string>& GetOpenLogFiles()
+{
+	static std::set<std::string> open_files;
+	return open_files;
+}
+
+std::string cStepController::ClaimLogFile(const std::string& file)
+{
+	std::lock_guard<std::mutex> lock(GetLogFileLock());
+	std::set<std::string>& open_files = GetOpenLogFiles();
+
+	std::string name = file;
+	std::string ext = cFileUtil::GetExtension(file);
+	std::string base = (ext != "") ? cFileUtil::RemoveExtension(file) : file;
+	for (int i = 1; open_files.find(name) != open_files.end(); ++i)
+	{
+		name = base + "_" + std::to_string(i);
+		if (ext != "")
+		{
+			name += "." + ext;
+		}
+	}
+
+	open_files.insert(name);
+	return name;
+}
+
+void cStepController::ReleaseLogFile(const std::string& file)
+{
+	std::lock_guard<std::mutex> lock(GetLogFileLock());
+	GetOpenLogFiles().erase(file);
+}
+
+void cStepController::CalcSettings(double time, const tMeasures& measures, tSettings& out_settings)
+{
+	switch (mMode)
+	{
+	case eModeAdaptive:
+		CalcAdaptiveSettings(measures, out_settings);
+		break;
+	case eModeReplay:
+		if (!ReadReplaySettings(out_settings))
+		{
+			printf("Step replay ended, falling back to fixed steps\n");
+			mMode = eModeFixed;
+			out_settings = mFixedSettings;
+		}
+		break;
+	default:
+		out_settings = mFixedSettings;
+		break;
+	}
+
+	if (mMode == eModeAdaptive)
+	{
+		BoundSettings(out_settings);
+	}
+
+	mPrevSettings = out_settings;
+	mValidPrev = true;
+
+	mNumSteps += out_settings.mNumUpdateSteps * out_settings.mNumSimSubsteps;
+	mNumBaselineSteps += mFixedSettings.mNumUpdateSteps * mFixedSettings.mNumSimSubsteps;
+
+	WriteLog(time, measures, out_settings);
+}
+
+cStepController::eMode cStepController::GetMode() const
+{
+	return mMode;
+}
+
+const cStepController::tParams& cStepController::GetParams() const
+{
+	return mParams;
+}
+
+long long cStepController::GetNumSteps() const
+{
+	return mNumSteps;
+}
+
+long long cStepController::GetNumBaselineSteps() const
+{
+	return mNumBaselineSteps;
+}
+
+double cStepController::GetStepsSaved() const
+{
+	double saved = 0;
+	if (mNumBaselineSteps > 0)
+	{
+		saved = 1 - static_cast<double>(mNumSteps) / mNumBaselineSteps;
+	}
+	return saved;
+}
+
+void cStepController::PrintStats() const
+{
+	printf("Physics steps: %lld, baseline: %lld, saved: %.2f%%\n", mNumSteps, mNumBaselineSteps, 100 * GetStepsSaved());
+}
+
+bool cStepController::CheckParams(const tParams& params)
+{
+	bool valid = true;
+	if (params.mMinUpdateSteps < 1 || params.mMinUpdateSteps > params.mMaxUpdateSteps)
+	{
+		printf("Adaptive update steps must satisfy 1 <= min <= max, got [%i, %i]\n", params.mMinUpdateSteps, params.mMaxUpdateSteps);
+		valid = false;
+	}
+	if (params.mMinSimSubsteps < 1 || params.mMinSimSubsteps > params.mMaxSimSubsteps)
+	{
+		printf("Adaptive sim substeps must satisfy 1 <= min <= max, got [%i, %i]\n", params.mMinSimSubsteps, params.mMaxSimSubsteps);
+		valid = false;
+	}
+	if (params.mMinSolverIters < 1 || params.mMinSolverIters > params.mMaxSolverIters)
+	{
+		printf("Adaptive solver iterations must satisfy 1 <= min <= max, got [%i, %i]\n", params.mMinSolverIters, params.mMaxSolverIters);
+		valid = false;
+	}
+	return valid;
+}
+
+bool cStepController::ParseMode(const std::string& str, eMode& out_mode)
+{
+	for (int i = 0; i < eModeMax; ++i)
+	{
+		if (str == gModeStrs[i])
+		{
+			out_mode = static_cast<eMode>(i);
+			return true;
+		}
+	}
+	printf("Unsupported step mode %s\n", str.c_str());
+	assert(false);
+	return false;
+}
+
+void cStepController::CalcAdaptiveSettings(const tMeasures& measures, tSettings& out_settings) const
+{
+	// difficulty is the largest of the normalized measures
+	double contact_lerp = measures.mNumContacts / mParams.mContactThreshold;
+	double pen_lerp = measures.mMaxPenetration / mParams.mPenetrationThreshold;
+	double vel_lerp = measures.mVelChange / mParams.mVelChangeThreshold;
+	double lerp = std::max(contact_lerp, std::max(pen_lerp, vel_lerp));
+	lerp = cMathUtil::Saturate(lerp);
+
+	out_settings.mNumUpdateSteps = LerpSteps(mParams.mMinUpdateSteps, mParams.mMaxUpdateSteps, lerp);
+	out_settings.mNumSimSubsteps = LerpSteps(mParams.mMinSimSubsteps, mParams.mMaxSimSubsteps, lerp);
+	out_settings.mSolverIters = LerpSteps(mParams.mMinSolverIters, mParams.mMaxSolverIters, lerp);
+
+	if (mValidPrev)
+	{
+		// increase immediately, but ramp down to avoid oscillating between settings
+		int max_dec = mParams.mMaxStepDecrease;
+		out_settings.mNumUpdateSteps = std::max(out_settings.mNumUpdateSteps, mPrevSettings.mNumUpdateSteps - max_dec);
+		out_settings.mNumSimSubsteps = std::max(out_settings.mNumSimSubsteps, mPrevSettings.mNumSimSubsteps - max_dec);
+		out_settings.mSolverIters = std::max(out_settings.mSolverIters, mPrevSettings.mSolverIters - max_dec);
+	}
+}
+
+void cStepController::SetDefaultBounds(const tSettings& fixed_settings, tParams& out_params) const
+{
+	// the fixed settings are the upper bound, the lower bounds keep the
+	// same ratios as the original 5..20 update steps and 5..10 solver iterations
+	if (out_params.mMaxUpdateSteps == gInvalidIdx)
+	{
+		out_params.mMaxUpdateSteps = fixed_settings.mNumUpdateSteps;
+	}
+	if (out_params.mMinUpdateSteps == gInvalidIdx)
+	{
+		out_params.mMinUpdateSteps = std::max(1, out_params.mMaxUpdateSteps / 4);
+	}
+	if (out_params.mMaxSimSubsteps == gInvalidIdx)
+	{
+		out_params.mMaxSimSubsteps = fixed_settings.mNumSimSubsteps;
+	}
+	if (out_params.mMinSimSubsteps == gInvalidIdx)
+	{
+		out_params.mMinSimSubsteps = std::max(1, out_params.mMaxSimSubsteps / 4);
+	}
+	if (out_params.mMaxSolverIters == gInvalidIdx)
+	{
+		out_params.mMaxSolverIters = fixed_settings.mSolverIters;
+	}
+	if (out_params.mMinSolverIters == gInvalidIdx)
+	{
+		out_params.mMinSolverIters = std::max(1, out_params.mMaxSolverIters / 2);
+	}
+}
+
+bool cStepController::ReadReplaySettings(tSettings& out_settings)
+{
+	bool succ = false;
+	if (mReplayFile != nullptr)
+	{
+		double time = 0;
+		int update_steps = 0;
+		int sim_substeps = 0;
+		int solver_iters = 0;
+		int num_read = fscanf(mReplayFile, "%lf, %i, %i, %i%*[^\n]", &time, &update_steps, &sim_substeps, &solver_iters);
+		succ = num_read == 4;
+		if (succ && (update_steps < 1 || sim_substeps < 1 || solver_iters < 1))
+		{
+			printf("Invalid step replay entry at time %.5f: %i, %i, %i\n", time, update_steps, sim_substeps, solver_iters);
+			succ = false;
+		}
+
+		if (succ)
+		{
+			out_settings.mNumUpdateSteps = update_steps;
+			out_settings.mNumSimSubsteps = sim_substeps;
+			out_settings.mSolverIters = solver_iters;
+		}
+	}
+	return succ;
+}
+
+void cStepController::WriteLog(double time, const tMeasures& measures, const tSettings& settings)
+{
+	if (mLogFile != nullptr)
+	{
+		// %.17g so replays see the same values the run did
+		fprintf(mLogFile, "%.17g, %i, %i, %i, %i, %.17g, %.17g\n", time, settings.mNumUpdateSteps, settings.mNumSimSubsteps,
+				settings.mSolverIters, measures.mNumContacts, measures.mMaxPenetration, measures.mVelChange);
+	}
+}
+
+int cStepController::LerpSteps(int min_val, int max_val, double lerp) const
+{
+	double val = (1 - lerp) * min_val + lerp * max_val;
+	return static_cast<int>(std::ceil(val));
+}
+
+void cStepController::BoundSettings(tSettings& out_settings) const
+{
+	out_settings.mNumUpdateSteps = cMathUtil::Clamp(out_settings.mNumUpdateSteps, mParams.mMinUpdateSteps, mParams.mMaxUpdateSteps);
+	out_settings.mNumSimSubsteps = cMathUtil::Clamp(out_settings.mNumSimSubsteps, mParams.mMinSimSubsteps, mParams.mMaxSimSubsteps);
+	out_settings.mSolverIters = cMathUtil::Clamp(out_settings.mSolverIters, mParams.mMinSolverIters, mParams.mMaxSolverIters);
+}
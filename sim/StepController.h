@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <stdio.h>
+
+// picks the number of controller update steps, physics substeps and solver
+// iterations for each frame from how hard the current contact situation is
+class cStepController
+{
+public:
+	enum eMode
+	{
+		eModeFixed,
+		eModeAdaptive,
+		eModeReplay,
+		eModeMax
+	};
+
+	struct tParams
+	{
+		tParams();
+
+		// bounds left at gInvalidIdx default to ranges that end at the fixed settings
+		int mMinUpdateSteps;
+		int mMaxUpdateSteps;
+		int mMinSimSubsteps;
+		int mMaxSimSubsteps;
+		int mMinSolverIters;
+		int mMaxSolverIters;
+		int mMaxStepDecrease; // steps can drop by at most this much per frame
+
+		// measures at which the maximum number of steps is used
+		double mContactThreshold;
+		double mPenetrationThreshold;
+		double mVelChangeThreshold;
+	};
+
+	struct tMeasures
+	{
+		tMeasures();
+
+		int mNumContacts;
+		double mMaxPenetration;
+		double mVelChange; // max change in joint velocities over the last frame
+	};
+
+	struct tSettings
+	{
+		tSettings();
+
+		int mNumUpdateSteps;
+		int mNumSimSubsteps;
+		int mSolverIters;
+	};
+
+	cStepController();
+	virtual ~cStepController();
+
+	virtual void Init(eMode mode, const tParams& params, const tSettings& fixed_settings);
+	virtual void Reset();
+	virtual void Clear();
+
+	// scenes that share a log path, eg. the exp scenes of a trainer, each get their own file,
+	// the first one writes to file and the others to file_1, file_2, ...
+	virtual bool OpenLog(const std::string& file);
+	virtual bool OpenReplay(const std::string& file);
+	virtual void CloseFiles();
+
+	virtual void CalcSettings(double time, const tMeasures& measures, tSettings& out_settings);
+
+	virtual eMode GetMode() const;
+	virtual const tParams& GetParams() const;
+	virtual long long GetNumSteps() const;
+	virtual long long GetNumBaselineSteps() const;
+	virtual double GetStepsSaved() const;
+	virtual void PrintStats() const;
+
+	static bool CheckParams(const tParams& params);
+	static bool ParseMode(const std::string& str, eMode& out_mode);
+
+protected:
+	eMode mMode;
+	tParams mParams;
+	tSettings mFixedSettings;
+	tSettings mPrevSettings;
+	bool mValidPrev;
+
+	FILE* mLogFile;
+	FILE* mReplayFile;
+	std::string mLogFileName;
+
+	// physics substeps taken and what the fixed settings would have taken
+	long long mNumSteps;
+	long long mNumBaselineSteps;
+
+	virtual void CloseLog();
+	virtual void CalcAdaptiveSettings(const tMeasures& measures, tSettings& out_settings) const;
+	static std::string ClaimLogFile(const std::string& file);
+	static void ReleaseLogFile(const std::string& file);
+
+	virtual void SetDefaultBounds(const tSettings& fixed_settings, tParams& out_params) const;
+	virtual bool ReadReplaySettings(tSettings& out_settings);
+	virtual void WriteLog(double time, const tMeasures& measures, const tSettings& settings);
+	virtual int LerpSteps(int min_val, int max_val, double lerp) const;
+	virtual void BoundSettings(tSettings& out_settings) const;
+};
@@ -1,5 +1,6 @@
 #include "TerrainGen2D.h"
 #include <algorithm>
+#include "util/AssetCache.h"
 
 const float cTerrainGen2D::gVertSpacing = 0.1f;
 const std::string cTerrainGen2D::gTypeKey = "Type";
@@ -182,6 +183,54 @@ cTerrainGen2D::tTerrainFunc cTerrainGen2D::GetTerrainFunc(eType terrain_type)
 
 
 
+bool cTerrainGen2D::LoadTerrainFile(const std::string& file, eType& out_type, std::vector<Eigen::VectorXd>& out_params)
+{
+	Json::Value root;
+	bool succ = cAssetCache::LoadJson(file, root);
+
+	if (succ)
+	{
+		if (!root[gTypeKey].isNull())
+		{
+			std::string type_str = root[gTypeKey].asString();
+			ParseType(type_str, out_type);
+		}
+
+		if (!root[gParamsKey].isNull())
+		{
+			Json::Value params_arr = root[gParamsKey];
+			assert(params_arr.isArray());
+			int num = params_arr.size();
+
+			out_params.resize(num);
+			for (int i = 0; i < num; ++i)
+			{
+				Eigen::VectorXd& curr_params = out_params[i];
+				LoadParams(params_arr.get(i, 0), curr_params);
+			}
+		}
+	}
+	else
+	{
+		printf("Failed to load terrain file %s\n", file.c_str());
+	}
+
+	return succ;
+}
+
+void cTerrainGen2D::LerpParams(const std::vector<Eigen::VectorXd>& params, double lerp, Eigen::VectorXd& out_params)
+{
+	int num_params = static_cast<int>(params.size());
+	assert(num_params > 0);
+	lerp = cMathUtil::Clamp(lerp, 0.0, num_params - 1.0);
+
+	int idx0 = static_cast<int>(lerp);
+	int idx1 = std::min(idx0 + 1, num_params - 1);
+	lerp -= idx0;
+
+	out_params = (1 - lerp) * params[idx0] + lerp * params[idx1];
+}
+
 double cTerrainGen2D::BuildFlat(double width, const tParams& params, cRand& rand, std::vector<float>& out_data)
 {
 	return AddFlat(width, out_data);
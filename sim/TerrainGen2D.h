@@ -93,6 +93,9 @@ public:
 	static tParams GetDefaultParams();
 	static void LoadParams(const Json::Value& root, Eigen::VectorXd& out_params);
 	static void ParseType(const std::string& str, eType& out_type);
+	static bool LoadTerrainFile(const std::string& file, eType& out_type, std::vector<Eigen::VectorXd>& out_params);
+	// blends between consecutive parameter sets, lerp runs from 0 to the number of sets - 1
+	static void LerpParams(const std::vector<Eigen::VectorXd>& params, double lerp, Eigen::VectorXd& out_params);
 
 	typedef double (*tTerrainFunc)(double width, const tParams& params, cRand& rand, std::vector<float>& out_data);
 	static tTerrainFunc GetTerrainFunc(eType terrain_type);
@@ -0,0 +1,243 @@
+#include "TerrainLibrary.h"
+#include <cstring>
+#include <map>
+#include <mutex>
+#include "util/FileUtil.h"
+
+const char gTerrainLibMagic[] = "TRLTLIB1";
+const int gTerrainLibMagicLen = 8;
+const int gTerrainLibVersion = 1;
+
+bool cTerrainLibrary::Build(cTerrainGen2D::eType type, const Eigen::VectorXd& params, double seg_width,
+							int num_segments, unsigned long seed, const std::string& out_file)
+{
+	assert(params.size() == cTerrainGen2D::eParamsMax);
+	assert(num_segments > 0);
+	assert(seg_width > 0);
+
+	FILE* f = cFileUtil::OpenFile(out_file, "wb");
+	if (f == nullptr)
+	{
+		printf("Failed to open terrain library output %s\n", out_file.c_str());
+		return false;
+	}
+
+	tHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.mMagic, gTerrainLibMagic, gTerrainLibMagicLen);
+	header.mVersion = gTerrainLibVersion;
+	header.mType = static_cast<int32_t>(type);
+	header.mNumParams = static_cast<int32_t>(params.size());
+	header.mNumSegments = num_segments;
+	header.mSegmentWidth = seg_width;
+	header.mVertSpacing = cTerrainGen2D::gVertSpacing;
+	header.mSeed = seed;
+
+	cTerrainGen2D::tTerrainFunc terrain_func = cTerrainGen2D::GetTerrainFunc(type);
+	cTerrainGen2D::tParams terrain_params = params;
+
+	// every segment gets its own seed so a library can be regenerated or extended piecewise,
+	// offset by one since the default engine treats seeds 0 and 1 the same
+	std::vector<uint64_t> offsets(num_segments + 1);
+	std::vector<float> data;
+	std::vector<float> seg_data;
+	offsets[0] = 0;
+	for (int s = 0; s < num_segments; ++s)
+	{
+		// the generators continue from the last height in the buffer,
+		// so each segment starts from an empty one like in cGroundVar2D
+		cRand rand;
+		rand.Seed(seed + s + 1);
+		seg_data.clear();
+		(*terrain_func)(seg_width, terrain_params, rand, seg_data);
+		data.insert(data.end(), seg_data.begin(), seg_data.end());
+		offsets[s + 1] = data.size();
+	}
+
+	bool succ = fwrite(&header, sizeof(header), 1, f) == 1;
+	succ &= fwrite(params.data(), sizeof(double), params.size(), f) == static_cast<size_t>(params.size());
+	succ &= fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), f) == offsets.size();
+	succ &= fwrite(data.data(), sizeof(float), data.size(), f) == data.size();
+	cFileUtil::CloseFile(f);
+
+	if (!succ)
+	{
+		printf("Failed to write terrain library %s\n", out_file.c_str());
+	}
+	return succ;
+}
+
+std::shared_ptr<const cTerrainLibrary> cTerrainLibrary::LoadShared(const std::string& file)
+{
+	static std::mutex lib_mutex;
+	static std::map<std::string, std::weak_ptr<const cTerrainLibrary>> libs;
+
+	std::lock_guard<std::mutex> lock(lib_mutex);
+	std::shared_ptr<const cTerrainLibrary> lib = libs[file].lock();
+	if (lib == nullptr)
+	{
+		std::shared_ptr<cTerrainLibrary> new_lib = std::shared_ptr<cTerrainLibrary>(new cTerrainLibrary());
+		bool succ = new_lib->Load(file);
+		if (succ)
+		{
+			lib = new_lib;
+			libs[file] = lib;
+		}
+	}
+	return lib;
+}
+
+cTerrainLibrary::cTerrainLibrary()
+{
+	memset(&mHeader, 0, sizeof(mHeader));
+	mOffsets = nullptr;
+	mData = nullptr;
+}
+
+cTerrainLibrary::~cTerrainLibrary()
+{
+	Clear();
+}
+
+bool cTerrainLibrary::Load(const std::string& file)
+{
+	Clear();
+	bool succ = mFile.Open(file);
+	if (!succ)
+	{
+		printf("Failed to open terrain library %s\n", file.c_str());
+	}
+	else
+	{
+		succ = ParseFile(file);
+	}
+
+	if (!succ)
+	{
+		Clear();
+	}
+	return succ;
+}
+
+void cTerrainLibrary::Clear()
+{
+	mFile.Close();
+	memset(&mHeader, 0, sizeof(mHeader));
+	mParams.resize(0);
+	mOffsets = nullptr;
+	mData = nullptr;
+}
+
+bool cTerrainLibrary::IsValid() const
+{
+	return mData != nullptr;
+}
+
+cTerrainGen2D::eType cTerrainLibrary::GetType() const
+{
+	return static_cast<cTerrainGen2D::eType>(mHeader.mType);
+}
+
+const Eigen::VectorXd& cTerrainLibrary::GetParams() const
+{
+	return mParams;
+}
+
+double cTerrainLibrary::GetSegmentWidth() const
+{
+	return mHeader.mSegmentWidth;
+}
+
+unsigned long cTerrainLibrary::GetSeed() const
+{
+	return static_cast<unsigned long>(mHeader.mSeed);
+}
+
+int cTerrainLibrary::GetNumSegments() const
+{
+	return mHeader.mNumSegments;
+}
+
+int cTerrainLibrary::GetSegmentSize(int s) const
+{
+	assert(s >= 0 && s < GetNumSegments());
+	return static_cast<int>(mOffsets[s + 1] - mOffsets[s]);
+}
+
+const float* cTerrainLibrary::GetSegmentData(int s) const
+{
+	assert(s >= 0 && s < GetNumSegments());
+	return mData + mOffsets[s];
+}
+
+void cTerrainLibrary::AppendSegment(int s, std::vector<float>& out_data) const
+{
+	const float* seg_data = GetSegmentData(s);
+	int seg_size = GetSegmentSize(s);
+	if (out_data.empty())
+	{
+		out_data.insert(out_data.end(), seg_data, seg_data + seg_size);
+	}
+	else
+	{
+		// like the terrain generators, continue from the last height and share its vertex
+		float h_offset = out_data.back() - seg_data[0];
+		out_data.reserve(out_data.size() + seg_size - 1);
+		for (int i = 1; i < seg_size; ++i)
+		{
+			out_data.push_back(seg_data[i] + h_offset);
+		}
+	}
+}
+
+bool cTerrainLibrary::ParseFile(const std::string& file)
+{
+	const char* bytes = mFile.GetData();
+	size_t file_size = mFile.GetSize();
+	bool succ = file_size >= sizeof(tHeader);
+	if (succ)
+	{
+		memcpy(&mHeader, bytes, sizeof(tHeader));
+		succ = memcmp(mHeader.mMagic, gTerrainLibMagic, gTerrainLibMagicLen) == 0
+				&& mHeader.mVersion == gTerrainLibVersion
+				&& mHeader.mType >= 0 && mHeader.mType < cTerrainGen2D::eTypeMax
+				&& mHeader.mNumParams == cTerrainGen2D::eParamsMax
+				&& mHeader.mNumSegments > 0;
+	}
+
+	size_t params_beg = sizeof(tHeader);
+	size_t offsets_beg = params_beg + mHeader.mNumParams * sizeof(double);
+	size_t data_beg = offsets_beg + (mHeader.mNumSegments + 1) * sizeof(uint64_t);
+	succ = succ && file_size >= data_beg;
+
+	if (succ)
+	{
+		mParams.resize(mHeader.mNumParams);
+		memcpy(mParams.data(), bytes + params_beg, mHeader.mNumParams * sizeof(double));
+		mOffsets = reinterpret_cast<const uint64_t*>(bytes + offsets_beg);
+		mData = reinterpret_cast<const float*>(bytes + data_beg);
+
+		// segments must be contiguous, span at least one edge so they can be chained,
+		// and the heights have to fit in the file
+		succ = mOffsets[0] == 0;
+		for (int s = 0; succ && s < mHeader.mNumSegments; ++s)
+		{
+			succ = mOffsets[s + 1] > mOffsets[s] + 1;
+		}
+		size_t data_size = (file_size - data_beg) / sizeof(float);
+		succ = succ && mOffsets[mHeader.mNumSegments] <= data_size;
+	}
+
+	if (succ && mHeader.mVertSpacing != cTerrainGen2D::gVertSpacing)
+	{
+		printf("Terrain library %s was built with vertex spacing %.5f, expected %.5f\n",
+				file.c_str(), mHeader.mVertSpacing, cTerrainGen2D::gVertSpacing);
+		succ = false;
+	}
+
+	if (!succ)
+	{
+		printf("Invalid terrain library %s\n", file.c_str());
+	}
+	return succ;
+}
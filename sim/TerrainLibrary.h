@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "sim/TerrainGen2D.h"
+#include "util/MappedFile.h"
+
+// pregenerated terrain segments for a single terrain type and parameter set,
+// stored in a flat binary file that is memory mapped so that scenes can pull
+// segments by index without running the generators, file layout:
+// header, params[num_params], offsets[num_segments + 1], heights[offsets[num_segments]]
+// offsets are counted in floats from the start of the height data
+class cTerrainLibrary
+{
+public:
+	static bool Build(cTerrainGen2D::eType type, const Eigen::VectorXd& params, double seg_width,
+					int num_segments, unsigned long seed, const std::string& out_file);
+
+	// libraries loaded through here are shared by every caller asking for the same file
+	static std::shared_ptr<const cTerrainLibrary> LoadShared(const std::string& file);
+
+	cTerrainLibrary();
+	virtual ~cTerrainLibrary();
+
+	virtual bool Load(const std::string& file);
+	virtual void Clear();
+	virtual bool IsValid() const;
+
+	virtual cTerrainGen2D::eType GetType() const;
+	virtual const Eigen::VectorXd& GetParams() const;
+	virtual double GetSegmentWidth() const;
+	virtual unsigned long GetSeed() const;
+
+	virtual int GetNumSegments() const;
+	virtual int GetSegmentSize(int s) const;
+	virtual const float* GetSegmentData(int s) const;
+	// appended segments continue from the last height in out_data
+	virtual void AppendSegment(int s, std::vector<float>& out_data) const;
+
+protected:
+	struct tHeader
+	{
+		char mMagic[8];
+		int32_t mVersion;
+		int32_t mType;
+		int32_t mNumParams;
+		int32_t mNumSegments;
+		double mSegmentWidth;
+		double mVertSpacing;
+		uint64_t mSeed;
+	};
+
+	tHeader mHeader;
+	Eigen::VectorXd mParams;
+	const uint64_t* mOffsets;
+	const float* mData;
+
+	cMappedFile mFile;
+
+	virtual bool ParseFile(const std::string& file);
+};
@@ -11,10 +11,6 @@ const int gNumGroundSamples = 200;
 const double gViewMin = -0.5;
 const double gDefaultViewDist = 10;
 
-#if defined(ENABLE_DEBUG_VISUALIZATION)
-const int gPoliValLogSize = 50;
-#endif // ENABLE_DEBUG_VISUALIZATION
-
 cTerrainRLCharController::cTerrainRLCharController() : cNNController()
 {
 	mCurrAction.mID = gInvalidIdx;
@@ -39,7 +35,6 @@ void cTerrainRLCharController::Init(cSimCharacter* character)
 	mValid = true;
 
 #if defined(ENABLE_DEBUG_VISUALIZATION)
-	mPoliValLog.Reserve(gPoliValLogSize);
 	mPoliValLog.Clear();
 #endif // ENABLE_DEBUG_VISUALIZATION
 }
@@ -69,6 +64,33 @@ void cTerrainRLCharController::Update(double time_step)
 	cNNController::Update(time_step);
 }
 
+void cTerrainRLCharController::SaveState(std::vector<double>& out_state) const
+{
+	cNNController::SaveState(out_state);
+	out_state.push_back(mFirstCycle);
+	out_state.push_back(mIsOffPolicy);
+	out_state.push_back(mCurrAction.mID);
+	PushState(mCurrAction.mParams, out_state);
+	PushState(mPoliState, out_state);
+	PushState(mGroundSamples, out_state);
+	out_state.insert(out_state.end(), mGroundSampleOrigin.data(), mGroundSampleOrigin.data() + mGroundSampleOrigin.size());
+}
+
+void cTerrainRLCharController::LoadState(const std::vector<double>& state, int& in_out_idx)
+{
+	cNNController::LoadState(state, in_out_idx);
+	mFirstCycle = state[in_out_idx++] != 0;
+	mIsOffPolicy = state[in_out_idx++] != 0;
+	mCurrAction.mID = static_cast<int>(state[in_out_idx++]);
+	PopState(state, in_out_idx, mCurrAction.mParams);
+	PopState(state, in_out_idx, mPoliState);
+	PopState(state, in_out_idx, mGroundSamples);
+	for (int i = 0; i < mGroundSampleOrigin.size(); ++i)
+	{
+		mGroundSampleOrigin[i] = state[in_out_idx++];
+	}
+}
+
 void cTerrainRLCharController::SetGround(std::shared_ptr<cGround> ground)
 {
 	mGround = ground;
@@ -107,6 +129,16 @@ int cTerrainRLCharController::GetPoliStateSize() const
 	return state_size;
 }
 
+int cTerrainRLCharController::GetPoliStateGroundOffset() const
+{
+	return GetPoliStateOffset(ePoliStateGround);
+}
+
+int cTerrainRLCharController::GetPoliStateGroundSize() const
+{
+	return GetPoliStateSize(ePoliStateGround);
+}
+
 bool cTerrainRLCharController::IsOffPolicy() const
 {
 	return mIsOffPolicy;
@@ -358,7 +390,7 @@ void cTerrainRLCharController::BuildRandBaseAction(tAction& out_action) const
 }
 
 #if defined(ENABLE_DEBUG_VISUALIZATION)
-const cCircularBuffer<double>& cTerrainRLCharController::GetPoliValLog() const
+const cTerrainRLCharController::tPoliValLog& cTerrainRLCharController::GetPoliValLog() const
 {
 	return mPoliValLog;
 }
@@ -15,6 +15,8 @@ public:
 	virtual void Reset();
 	virtual void Clear();
 	virtual void Update(double time_step);
+	virtual void SaveState(std::vector<double>& out_state) const;
+	virtual void LoadState(const std::vector<double>& state, int& in_out_idx);
 
 	virtual void SetGround(std::shared_ptr<cGround> ground);
 	
@@ -29,6 +31,8 @@ public:
 	virtual bool IsOffPolicy() const;
 	virtual int GetPoliStateSize() const;
 	virtual int GetPoliActionSize() const;
+	virtual int GetPoliStateGroundOffset() const;
+	virtual int GetPoliStateGroundSize() const;
 	virtual void RecordPoliState(Eigen::VectorXd& out_state) const;
 	virtual void RecordPoliAction(Eigen::VectorXd& out_action) const = 0;
 
@@ -93,14 +97,16 @@ protected:
 
 #if defined(ENABLE_DEBUG_VISUALIZATION)
 public:
-	const cCircularBuffer<double>& GetPoliValLog() const;
+	typedef cStaticCircularBuffer<double, 50> tPoliValLog;
+
+	const tPoliValLog& GetPoliValLog() const;
 	virtual void GetVisCharacterFeatures(Eigen::VectorXd& out_features) const;
 	virtual void GetVisTerrainFeatures(Eigen::VectorXd& out_features) const;
 	virtual void GetVisActionFeatures(Eigen::VectorXd& out_features) const;
 	virtual void GetVisActionValues(Eigen::VectorXd& out_vals) const;
 
 protected:
-	cCircularBuffer<double> mPoliValLog;
+	tPoliValLog mPoliValLog;
 	Eigen::VectorXd mVisNNOutput;
 #endif // ENABLE_DEBUG_VISUALIZATION
 };
\ No newline at end of file
@@ -71,6 +71,7 @@ void cWorld::Init(const tParams& params)
 	mSimWorld = std::unique_ptr<btDiscreteDynamicsWorld>(new btDiscreteDynamicsWorld(mCollisionDispatcher.get(),
 		mBroadPhase.get(), mSolver.get(), mCollisionConfig.get()));
 	SetGravity(params.mGravity);
+	mSimWorld->setInternalTickCallback(cWorld::PreTickCallback, this, true);
 
 	mContactManager.Init();
 	mPerturbManager.Clear();
@@ -85,12 +86,7 @@ void cWorld::Reset()
 	mSolver->reset();
 	mBroadPhase->resetPool(mCollisionDispatcher.get());
 
-	btOverlappingPairCache* pair_cache = mSimWorld->getBroadphase()->getOverlappingPairCache();
-	btBroadphasePairArray& pair_array = pair_cache->getOverlappingPairArray();
-	for (int i = 0; i < pair_array.size(); ++i)
-	{
-		pair_cache->cleanOverlappingPair(pair_array[i], mSimWorld->getDispatcher());
-	}
+	ClearContactCache();
 }
 
 void cWorld::Update(double time_elapsed)
@@ -207,6 +203,19 @@ void cWorld::SetGravity(const tVector& gravity)
 		static_cast<btScalar>(gravity[2] * scale)));
 }
 
+void cWorld::RefreshBroadphase()
+{
+	// objects were moved without stepping the simulation, so the cached
+	// contact manifolds are stale and the aabbs need to be recomputed
+	mContactManager.Reset();
+	mPerturbManager.Clear();
+	mSimWorld->clearForces();
+	mSolver->reset();
+
+	ClearContactCache();
+	mSimWorld->updateAabbs();
+}
+
 cContactManager::tContactHandle cWorld::RegisterContact(int contact_flags, int filter_flags)
 {
 	return mContactManager.RegisterContact(contact_flags, filter_flags);
@@ -227,6 +236,41 @@ bool cWorld::IsInContact(const cContactManager::tContactHandle& handle) const
 	return mContactManager.IsInContact(handle);
 }
 
+cContactManager& cWorld::GetContactManager()
+{
+	return mContactManager;
+}
+
+int cWorld::GetNumContacts() const
+{
+	return mContactManager.GetNumContacts();
+}
+
+double cWorld::GetMaxPenetration() const
+{
+	return mContactManager.GetMaxPenetration();
+}
+
+int cWorld::GetNumSubsteps() const
+{
+	return mParams.mNumSubsteps;
+}
+
+void cWorld::SetNumSubsteps(int num_substeps)
+{
+	mParams.mNumSubsteps = std::max(1, num_substeps);
+}
+
+int cWorld::GetSolverIters() const
+{
+	return mSimWorld->getSolverInfo().m_numIterations;
+}
+
+void cWorld::SetSolverIters(int iters)
+{
+	mSimWorld->getSolverInfo().m_numIterations = std::max(1, iters);
+}
+
 void cWorld::RayTest(const tVector& beg, const tVector& end, tRayTestResults& results) const
 {
 	btScalar scale = static_cast<btScalar>(GetScale());
@@ -442,6 +486,31 @@ void cWorld::CalcAABB(const cSimObj* obj, tVector& out_min, tVector& out_max) co
 	out_max = tVector(bt_max[0], bt_max[1], bt_max[2], 0) / scale;
 }
 
+void cWorld::GetBodyState(const cSimObj* obj, tBodyState& out_state) const
+{
+	auto& body = obj->GetRigidBody();
+	out_state.mTrans = body->getWorldTransform();
+	out_state.mLinVel = body->getLinearVelocity();
+	out_state.mAngVel = body->getAngularVelocity();
+	out_state.mActivationState = body->getActivationState();
+}
+
+void cWorld::SetBodyState(const tBodyState& state, cSimObj* out_obj) const
+{
+	auto& body = out_obj->GetRigidBody();
+	body->setCenterOfMassTransform(state.mTrans);
+	body->setLinearVelocity(state.mLinVel);
+	body->setAngularVelocity(state.mAngVel);
+	body->setInterpolationLinearVelocity(state.mLinVel);
+	body->setInterpolationAngularVelocity(state.mAngVel);
+	body->clearForces();
+	body->forceActivationState(state.mActivationState);
+	body->setDeactivationTime(0);
+
+	// keep the motion state in sync since it is only written during a step
+	out_obj->setWorldTransform(state.mTrans);
+}
+
 void cWorld::ApplyForce(const tVector& force, const tVector& local_pos, cSimObj* out_obj) const
 {
 	auto& body = out_obj->GetRigidBody();
@@ -582,6 +651,12 @@ std::unique_ptr<btDiscreteDynamicsWorld>& cWorld::GetInternalWorld()
 }
 
 
+void cWorld::PreTickCallback(btDynamicsWorld* world, btScalar time_step)
+{
+	cWorld* sim_world = static_cast<cWorld*>(world->getWorldUserInfo());
+	sim_world->mContactManager.BeginSubstep();
+}
+
 void cWorld::ClearConstraints()
 {
 	for (int i = GetNumConstriants() - 1; i >= 0; i--)
@@ -592,6 +667,16 @@ void cWorld::ClearConstraints()
 	}
 }
 
+void cWorld::ClearContactCache()
+{
+	btOverlappingPairCache* pair_cache = mSimWorld->getBroadphase()->getOverlappingPairCache();
+	btBroadphasePairArray& pair_array = pair_cache->getOverlappingPairArray();
+	for (int i = 0; i < pair_array.size(); ++i)
+	{
+		pair_cache->cleanOverlappingPair(pair_array[i], mSimWorld->getDispatcher());
+	}
+}
+
 int cWorld::GetNumConstriants() const
 {
 	return static_cast<int>(mSimWorld->getNumConstraints());
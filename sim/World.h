@@ -87,6 +87,18 @@ public:
 	};
 	typedef std::vector<tRayTestResult, Eigen::aligned_allocator<tRayTestResult>> tRayTestResults;
 
+	// raw bullet state of a rigid body, stored without any unit conversions
+	// so that restoring it reproduces the simulation exactly
+	struct tBodyState
+	{
+		BT_DECLARE_ALIGNED_ALLOCATOR();
+
+		btTransform mTrans;
+		btVector3 mLinVel;
+		btVector3 mAngVel;
+		int mActivationState;
+	};
+
 	cWorld();
 	virtual ~cWorld();
 	virtual void Init(const tParams& params);
@@ -104,11 +116,20 @@ public:
 	virtual void BuildConsFactor(ePlaneCons plane_cons, tVector& out_linear_factor, tVector& out_angular_factor);
 
 	virtual void SetGravity(const tVector& gravity);
+	virtual void RefreshBroadphase();
 
 	virtual cContactManager::tContactHandle RegisterContact(int contact_flags, int filter_flags);
 	virtual void UpdateContact(const cContactManager::tContactHandle& handle);
 	virtual bool IsInContact(const cContactManager::tContactHandle& handle) const;
 	virtual tVector GetContactPt(const cContactManager::tContactHandle& handle) const;
+	virtual cContactManager& GetContactManager();
+	virtual int GetNumContacts() const;
+	virtual double GetMaxPenetration() const;
+
+	virtual int GetNumSubsteps() const;
+	virtual void SetNumSubsteps(int num_substeps);
+	virtual int GetSolverIters() const;
+	virtual void SetSolverIters(int iters);
 
 	virtual void RayTest(const tVector& beg, const tVector& end, tRayTestResults& results) const;
 	virtual void AddPerturb(const tPerturb& perturb);
@@ -137,6 +158,8 @@ public:
 	virtual btQuaternion GetRotQuaternion(const cSimObj* obj) const;
 	virtual void SetRotation(const tVector& axis, double theta, cSimObj* out_obj) const;
 	virtual void CalcAABB(const cSimObj* obj, tVector& out_min, tVector& out_max) const;
+	virtual void GetBodyState(const cSimObj* obj, tBodyState& out_state) const;
+	virtual void SetBodyState(const tBodyState& state, cSimObj* out_obj) const;
 
 	virtual void ApplyForce(const tVector& force, const tVector& local_pos, cSimObj* out_obj) const;
 	virtual void ApplyTorque(const tVector& torque, cSimObj* out_obj) const;
@@ -177,6 +200,9 @@ protected:
 	cPerturbManager mPerturbManager;
 
 	virtual void ClearConstraints();
+	virtual void ClearContactCache();
+
+	static void PreTickCallback(btDynamicsWorld* world, btScalar time_step);
 	virtual int GetNumConstriants() const;
 
 	virtual tConstraintHandle AddHingeConstraint(cSimObj* obj0, cSimObj* obj1, const tJointParams& params);
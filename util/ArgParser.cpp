@@ -1,9 +1,11 @@
 #include "ArgParser.h"
 
 #include <assert.h>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "FileUtil.h"
 
@@ -11,6 +13,22 @@ const int gInvalidIndex = -1;
 const char gKeyStart = '-';
 const char gKeyEnd = '=';
 
+const char* gArgTypeNames[cArgParser::eArgTypeMax] =
+{
+	"string",
+	"string array",
+	"int",
+	"int array",
+	"double",
+	"double array",
+	"bool"
+};
+
+const char* cArgParser::GetArgTypeName(eArgType type)
+{
+	return gArgTypeNames[type];
+}
+
 cArgParser::cArgParser()
 {
 }
@@ -32,11 +50,13 @@ void cArgParser::AppendArgs(char **args, int num_args)
 		std::string curr_str = std::string(args[i]);
 		mArgs.push_back(curr_str);
 	}
+	BuildTable();
 }
 
 void cArgParser::Clear()
 {
 	mArgs.clear();
+	mTable.reset();
 }
 
 void cArgParser::AppendArgs(const std::string& file)
@@ -105,20 +125,16 @@ void cArgParser::AppendArgs(const std::string& file)
 	}
 
 	cFileUtil::CloseFile(file_ptr);
+	BuildTable();
 }
 
 bool cArgParser::ParseString(const std::string& key, std::string& out) const
 {
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeString);
+	if (entry != nullptr && entry->mValBeg < entry->mValEnd)
 	{
-		int val_idx = key_idx + 1;
-		const std::string& val = mArgs[val_idx];
-		if (!IsKey(val))
-		{
-			out = val;
-			return true;
-		}
+		out = mArgs[entry->mValBeg];
+		return true;
 	}
 
 	return false;
@@ -127,21 +143,10 @@ bool cArgParser::ParseString(const std::string& key, std::string& out) const
 bool cArgParser::ParseStringArray(const std::string& key, std::vector<std::string>& out) const
 {
 	out.clear();
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeStringArray);
+	if (entry != nullptr)
 	{
-		for (size_t i = key_idx + 1; i < mArgs.size(); ++i)
-		{
-			const std::string& val = mArgs[i];
-			if (!IsKey(val))
-			{
-				out.push_back(val);
-			}
-			else
-			{
-				break;
-			}
-		}
+		out.assign(mArgs.begin() + entry->mValBeg, mArgs.begin() + entry->mValEnd);
 		return true;
 	}
 
@@ -150,16 +155,11 @@ bool cArgParser::ParseStringArray(const std::string& key, std::vector<std::strin
 
 bool cArgParser::ParseInt(const std::string& key, int& out) const
 {
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeInt);
+	if (entry != nullptr && entry->mValBeg < entry->mValEnd)
 	{
-		int val_idx = key_idx + 1;
-		const std::string& val = mArgs[val_idx];
-		if (!IsKey(val))
-		{
-			out = std::atoi(val.c_str());
-			return true;
-		}
+		out = mTable->mIntVals[entry->mValBeg];
+		return true;
 	}
 
 	return false;
@@ -168,21 +168,11 @@ bool cArgParser::ParseInt(const std::string& key, int& out) const
 bool cArgParser::ParseIntArray(const std::string& key, std::vector<int>& out) const
 {
 	out.clear();
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeIntArray);
+	if (entry != nullptr)
 	{
-		for (size_t i = key_idx + 1; i < mArgs.size(); ++i)
-		{
-			const std::string& val = mArgs[i];
-			if (!IsKey(val))
-			{
-				out.push_back(std::atoi(val.c_str()));
-			}
-			else
-			{
-				break;
-			}
-		}
+		const auto& vals = mTable->mIntVals;
+		out.assign(vals.begin() + entry->mValBeg, vals.begin() + entry->mValEnd);
 		return true;
 	}
 
@@ -191,16 +181,11 @@ bool cArgParser::ParseIntArray(const std::string& key, std::vector<int>& out) co
 
 bool cArgParser::ParseDouble(const std::string& key, double& out) const
 {
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeDouble);
+	if (entry != nullptr && entry->mValBeg < entry->mValEnd)
 	{
-		int val_idx = key_idx + 1;
-		const std::string& val = mArgs[val_idx];
-		if (!IsKey(val))
-		{
-			out = static_cast<double>(std::atof(val.c_str()));
-			return true;
-		}
+		out = mTable->mDoubleVals[entry->mValBeg];
+		return true;
 	}
 
 	return false;
@@ -209,21 +194,11 @@ bool cArgParser::ParseDouble(const std::string& key, double& out) const
 bool cArgParser::ParseDoubleArray(const std::string& key, std::vector<double>& out) const
 {
 	out.clear();
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeDoubleArray);
+	if (entry != nullptr)
 	{
-		for (size_t i = key_idx + 1; i < mArgs.size(); ++i)
-		{
-			const std::string& val = mArgs[i];
-			if (!IsKey(val))
-			{
-				out.push_back(static_cast<double>(std::atof(val.c_str())));
-			}
-			else
-			{
-				break;
-			}
-		}
+		const auto& vals = mTable->mDoubleVals;
+		out.assign(vals.begin() + entry->mValBeg, vals.begin() + entry->mValEnd);
 		return true;
 	}
 
@@ -232,31 +207,14 @@ bool cArgParser::ParseDoubleArray(const std::string& key, std::vector<double>& o
 
 bool cArgParser::ParseBool(const std::string& key, bool& out) const
 {
-	int key_idx = FindKeyIndex(key);
-	if (IsValidKeyIndex(key_idx))
+	const tArgEntry* entry = FindEntry(key, eArgTypeBool);
+	if (entry != nullptr && entry->mValBeg < entry->mValEnd)
 	{
-		int val_idx = key_idx + 1;
-		const std::string& val = mArgs[val_idx];
-		if (!IsKey(val))
+		int val_idx = entry->mValBeg;
+		if ((mTable->mValFlags[val_idx] & eValueFlagBool) != 0)
 		{
-			if (val == "true" || val == "1"
-				|| val == "True" || val == "T"
-				|| val == "t")
-			{
-				out = true;
-				return true;
-			}
-			else if (val == "false" || val == "0"
-				|| val == "False" || val == "F"
-				|| val == "f")
-			{
-				out = false;
-				return true;
-			}
-			else
-			{
-				return false;
-			}
+			out = mTable->mBoolVals[val_idx] != 0;
+			return true;
 		}
 	}
 
@@ -318,17 +276,204 @@ bool cArgParser::IsValidKeyIndex(int idx) const
 
 int cArgParser::FindKeyIndex(const std::string& key) const
 {
-	std::string format_key = FormatKey(key);
-	for (int i = 0; i < GetNumArgs(); ++i)
+	const tArgEntry* entry = FindEntry(key, eArgTypeMax);
+	return (entry != nullptr) ? entry->mKeyIdx : gInvalidIndex;
+}
+
+bool cArgParser::CheckArgs() const
+{
+	bool succ = true;
+	if (mTable != nullptr)
+	{
+		// report in the order the keys appear in the args
+		std::vector<const tArgEntry*> entries;
+		for (auto it = mTable->mEntries.begin(); it != mTable->mEntries.end(); ++it)
+		{
+			entries.push_back(&it->second);
+		}
+		std::sort(entries.begin(), entries.end(),
+			[](const tArgEntry* a, const tArgEntry* b)
+			{
+				return a->mKeyIdx < b->mKeyIdx;
+			});
+
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			const tArgEntry& entry = *entries[i];
+			const std::string& key = mArgs[entry.mKeyIdx];
+
+			unsigned int types = mTable->mParsedTypes[entry.mID].load(std::memory_order_relaxed);
+			if (types == 0)
+			{
+				printf("Unrecognized arg %s\n", key.c_str());
+				succ = false;
+			}
+
+			for (int t = 0; t < eArgTypeMax; ++t)
+			{
+				eArgType type = static_cast<eArgType>(t);
+				if ((types & (1u << t)) != 0 && !CheckValues(entry, type))
+				{
+					printf("Invalid %s value for arg %s\n", GetArgTypeName(type), key.c_str());
+					succ = false;
+				}
+			}
+		}
+	}
+	return succ;
+}
+
+void cArgParser::BuildTable()
+{
+	std::shared_ptr<tArgTable> table = std::shared_ptr<tArgTable>(new tArgTable());
+	int num_args = GetNumArgs();
+	table->mIntVals.resize(num_args, 0);
+	table->mDoubleVals.resize(num_args, 0);
+	table->mBoolVals.resize(num_args, 0);
+	table->mValFlags.resize(num_args, 0);
+
+	tArgEntry* curr_entry = nullptr;
+	for (int i = 0; i < num_args; ++i)
 	{
-		const std::string& curr_str = mArgs[i];
-		bool found = curr_str == format_key;
-		if (found)
+		const std::string& arg = mArgs[i];
+		if (IsKey(arg))
 		{
-			return i;
+			// the first occurrence of a key wins, which lets the commandline args
+			// override the ones appended from the arg file
+			tArgEntry entry;
+			entry.mID = static_cast<int>(table->mEntries.size());
+			entry.mKeyIdx = i;
+			entry.mValBeg = i + 1;
+			entry.mValEnd = i + 1;
+
+			auto result = table->mEntries.insert(std::make_pair(GetBareKey(arg), entry));
+			curr_entry = (result.second) ? &result.first->second : nullptr;
 		}
+		else
+		{
+			// atoi and atof are kept for the values to match what the parser has always returned,
+			// the flags record whether the whole string was consumed as that type
+			const char* str = arg.c_str();
+			char* end = nullptr;
+			unsigned char flags = 0;
+
+			table->mIntVals[i] = std::atoi(str);
+			std::strtol(str, &end, 10);
+			flags |= (end != str && *end == '\0') ? eValueFlagInt : 0;
+
+			table->mDoubleVals[i] = std::atof(str);
+			std::strtod(str, &end);
+			flags |= (end != str && *end == '\0') ? eValueFlagDouble : 0;
+
+			if (arg == "true" || arg == "1"
+				|| arg == "True" || arg == "T"
+				|| arg == "t")
+			{
+				table->mBoolVals[i] = 1;
+				flags |= eValueFlagBool;
+			}
+			else if (arg == "false" || arg == "0"
+				|| arg == "False" || arg == "F"
+				|| arg == "f")
+			{
+				table->mBoolVals[i] = 0;
+				flags |= eValueFlagBool;
+			}
+
+			table->mValFlags[i] = flags;
+			if (curr_entry != nullptr)
+			{
+				curr_entry->mValEnd = i + 1;
+			}
+		}
+	}
+
+	// keys parsed before more args were appended, eg. arg_file, stay recorded
+	size_t num_entries = table->mEntries.size();
+	table->mParsedTypes = std::unique_ptr<std::atomic<unsigned int>[]>(new std::atomic<unsigned int>[num_entries]);
+	for (auto it = table->mEntries.begin(); it != table->mEntries.end(); ++it)
+	{
+		unsigned int types = 0;
+		if (mTable != nullptr)
+		{
+			auto old_it = mTable->mEntries.find(it->first);
+			if (old_it != mTable->mEntries.end())
+			{
+				types = mTable->mParsedTypes[old_it->second.mID].load(std::memory_order_relaxed);
+			}
+		}
+		table->mParsedTypes[it->second.mID].store(types, std::memory_order_relaxed);
 	}
-	return gInvalidIndex;
+
+	mTable = table;
+}
+
+const cArgParser::tArgEntry* cArgParser::FindEntry(const std::string& key, eArgType type) const
+{
+	const tArgEntry* entry = nullptr;
+	if (mTable != nullptr)
+	{
+		// keys are usually passed bare, so the formatted key is only built when needed
+		const auto& entries = mTable->mEntries;
+		size_t key_size = key.size();
+		bool bare = key_size > 0 && key[0] != gKeyStart && key[key_size - 1] != gKeyEnd;
+		auto it = (bare) ? entries.find(key) : entries.find(GetBareKey(key));
+
+		if (it != entries.end())
+		{
+			entry = &it->second;
+			if (type != eArgTypeMax)
+			{
+				mTable->mParsedTypes[entry->mID].fetch_or(1u << type, std::memory_order_relaxed);
+			}
+		}
+	}
+	return entry;
+}
+
+std::string cArgParser::GetBareKey(const std::string& key) const
+{
+	size_t beg = 0;
+	size_t end = key.size();
+	if (end > 0 && key[0] == gKeyStart)
+	{
+		++beg;
+	}
+	if (end > beg && key[end - 1] == gKeyEnd)
+	{
+		--end;
+	}
+	return key.substr(beg, end - beg);
+}
+
+bool cArgParser::CheckValues(const tArgEntry& entry, eArgType type) const
+{
+	int num_vals = entry.mValEnd - entry.mValBeg;
+	bool is_array = type == eArgTypeStringArray || type == eArgTypeIntArray || type == eArgTypeDoubleArray;
+	bool valid = is_array || num_vals == 1;
+
+	unsigned char flag = 0;
+	if (type == eArgTypeInt || type == eArgTypeIntArray)
+	{
+		flag = eValueFlagInt;
+	}
+	else if (type == eArgTypeDouble || type == eArgTypeDoubleArray)
+	{
+		flag = eValueFlagDouble;
+	}
+	else if (type == eArgTypeBool)
+	{
+		flag = eValueFlagBool;
+	}
+
+	if (flag != 0)
+	{
+		for (int i = entry.mValBeg; i < entry.mValEnd; ++i)
+		{
+			valid &= (mTable->mValFlags[i] & flag) != 0;
+		}
+	}
+	return valid;
 }
 
 cArgParser::~cArgParser()
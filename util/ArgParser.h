@@ -2,10 +2,31 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
 
+// args are indexed by key into a hash table whenever they are appended and every value
+// is converted once to the types it can be read as, so each lookup takes constant time,
+// copies of a parser share the index and the record of which types each key was read as,
+// which CheckArgs uses to report keys nobody reads and values that don't fit their type
 class cArgParser
 {
 public:
+	enum eArgType
+	{
+		eArgTypeString,
+		eArgTypeStringArray,
+		eArgTypeInt,
+		eArgTypeIntArray,
+		eArgTypeDouble,
+		eArgTypeDoubleArray,
+		eArgTypeBool,
+		eArgTypeMax
+	};
+
+	static const char* GetArgTypeName(eArgType type);
+
 	cArgParser();
 	cArgParser(char **args, int num_args);
 	cArgParser(const std::string& file);
@@ -26,9 +47,49 @@ public:
 	virtual std::string FormatKey(const std::string& key) const;
 	virtual bool IsKey(const std::string& str) const;
 
+	// prints the keys that were never parsed and the values that don't
+	// convert to their key's type, returns false if anything was reported
+	virtual bool CheckArgs() const;
+
 protected:
+	enum eValueFlag
+	{
+		eValueFlagInt = 1 << 0,
+		eValueFlagDouble = 1 << 1,
+		eValueFlagBool = 1 << 2
+	};
+
+	struct tArgEntry
+	{
+		int mID;
+		int mKeyIdx;
+		// values are the args in [mValBeg, mValEnd)
+		int mValBeg;
+		int mValEnd;
+	};
+
+	// typed values are stored parallel to the args so that
+	// array values are contiguous slices of each buffer
+	struct tArgTable
+	{
+		std::unordered_map<std::string, tArgEntry> mEntries;
+		std::vector<int> mIntVals;
+		std::vector<double> mDoubleVals;
+		std::vector<char> mBoolVals;
+		std::vector<unsigned char> mValFlags;
+
+		// bit mask of the types each key has been parsed as
+		std::unique_ptr<std::atomic<unsigned int>[]> mParsedTypes;
+	};
+
 	std::vector<std::string> mArgs;
+	std::shared_ptr<tArgTable> mTable;
+
+	virtual void BuildTable();
+	virtual const tArgEntry* FindEntry(const std::string& key, eArgType type) const;
+	virtual std::string GetBareKey(const std::string& key) const;
+	virtual bool CheckValues(const tArgEntry& entry, eArgType type) const;
 
 	virtual bool IsValidKeyIndex(int idx) const;
 	virtual int FindKeyIndex(const std::string& key) const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,513 @@
+#include "AssetCache.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "util/FileUtil.h"
+#include "util/MappedFile.h"
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+// compiled file layout, all little-endian:
+// header: magic[8], uint32 version, uint32 reserved, uint64 source size, int64 source mod time in ns,
+//			uint64 source hash, uint64 payload size, uint64 payload hash
+// payload: one tagged value, strings are a uint32 length and bytes, arrays a uint32 count and values,
+//			objects a uint32 count and key value pairs
+const char gAssetCacheMagic[] = "TRLJSON1";
+const int gAssetCacheMagicLen = 8;
+const uint32_t gAssetCacheVersion = 2;
+const std::string gAssetCacheExt = ".jbin";
+
+enum eAssetTag
+{
+	eAssetTagNull,
+	eAssetTagFalse,
+	eAssetTagTrue,
+	eAssetTagInt,
+	eAssetTagUInt,
+	eAssetTagReal,
+	eAssetTagString,
+	eAssetTagArray,
+	eAssetTagObject,
+	eAssetTagMax
+};
+
+struct tAssetCacheHeader
+{
+	char mMagic[8];
+	uint32_t mVersion;
+	uint32_t mReserved;
+	uint64_t mSourceSize;
+	int64_t mSourceModTime;
+	uint64_t mSourceHash;
+	uint64_t mPayloadSize;
+	uint64_t mPayloadHash;
+};
+
+struct tAssetCacheEntry
+{
+	uint64_t mSize;
+	int64_t mModTime;
+	std::shared_ptr<const Json::Value> mRoot;
+};
+
+std::mutex gAssetCacheMutex;
+std::string gAssetCacheDir = "";
+std::map<std::string, tAssetCacheEntry> gAssetCacheEntries;
+cAssetCache::tStats gAssetCacheStats;
+
+cAssetCache::tStats::tStats()
+{
+	mMemHits = 0;
+	mDiskHits = 0;
+	mParses = 0;
+	mCompiles = 0;
+}
+
+void cAssetCache::SetCacheDir(const std::string& dir)
+{
+	std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+	gAssetCacheDir = dir;
+	if (gAssetCacheDir != "")
+	{
+		// only creates the last directory, an existing one is left alone
+#if defined(_WIN32)
+		_mkdir(gAssetCacheDir.c_str());
+#else
+		mkdir(gAssetCacheDir.c_str(), 0755);
+#endif
+	}
+}
+
+const std::string& cAssetCache::GetCacheDir()
+{
+	return gAssetCacheDir;
+}
+
+bool cAssetCache::LoadJson(const std::string& file, Json::Value& out_root)
+{
+	tSourceInfo info;
+	bool succ = GetSourceInfo(file, info);
+	if (!succ)
+	{
+		return false;
+	}
+
+	std::string cache_dir;
+	{
+		std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+		auto it = gAssetCacheEntries.find(file);
+		if (it != gAssetCacheEntries.end()
+			&& it->second.mSize == info.mSize && it->second.mModTime == info.mModTime)
+		{
+			out_root = *(it->second.mRoot);
+			++gAssetCacheStats.mMemHits;
+			return true;
+		}
+		cache_dir = gAssetCacheDir;
+	}
+
+	std::shared_ptr<Json::Value> root = std::shared_ptr<Json::Value>(new Json::Value());
+	bool from_disk = (cache_dir != "") && LoadCompiled(file, info, *root);
+	if (!from_disk)
+	{
+		uint64_t hash = 0;
+		succ = ParseSource(file, *root, hash);
+		if (succ && cache_dir != "")
+		{
+			WriteCompiled(file, info, hash, *root);
+		}
+	}
+
+	if (succ)
+	{
+		out_root = *root;
+
+		std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+		tAssetCacheEntry& entry = gAssetCacheEntries[file];
+		entry.mSize = info.mSize;
+		entry.mModTime = info.mModTime;
+		entry.mRoot = root;
+		if (from_disk)
+		{
+			++gAssetCacheStats.mDiskHits;
+		}
+		else
+		{
+			++gAssetCacheStats.mParses;
+		}
+	}
+	return succ;
+}
+
+bool cAssetCache::CompileJson(const std::string& file)
+{
+	tSourceInfo info;
+	Json::Value root;
+	uint64_t hash = 0;
+	bool succ = GetSourceInfo(file, info) && ParseSource(file, root, hash);
+	if (succ)
+	{
+		succ = WriteCompiled(file, info, hash, root);
+	}
+	else
+	{
+		printf("Failed to parse %s\n", file.c_str());
+	}
+	return succ;
+}
+
+void cAssetCache::ClearMem()
+{
+	std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+	gAssetCacheEntries.clear();
+}
+
+cAssetCache::tStats cAssetCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+	return gAssetCacheStats;
+}
+
+void cAssetCache::PrintStats()
+{
+	tStats stats = GetStats();
+	printf("Asset cache: %i memory hits, %i compiled loads, %i parses, %i compiles\n",
+			stats.mMemHits, stats.mDiskHits, stats.mParses, stats.mCompiles);
+}
+
+bool cAssetCache::GetSourceInfo(const std::string& file, tSourceInfo& out_info)
+{
+	struct stat file_stat;
+	bool succ = stat(file.c_str(), &file_stat) == 0;
+	if (succ)
+	{
+		out_info.mSize = static_cast<uint64_t>(file_stat.st_size);
+		// whole seconds would miss same size edits within a second, so the
+		// sub-second part is included where the platform reports it
+		int64_t mod_time = static_cast<int64_t>(file_stat.st_mtime) * 1000000000;
+#if defined(__linux__)
+		mod_time += static_cast<int64_t>(file_stat.st_mtim.tv_nsec);
+#elif defined(__APPLE__)
+		mod_time += static_cast<int64_t>(file_stat.st_mtimespec.tv_nsec);
+#endif
+		out_info.mModTime = mod_time;
+	}
+	return succ;
+}
+
+std::string cAssetCache::GetCachePath(const std::string& file)
+{
+	// the hash keeps files with the same name in different dirs apart,
+	// the name is only there to make the cache dir readable
+	uint64_t path_hash = CalcHash(file.data(), file.size());
+	size_t name_beg = file.find_last_of("/\\");
+	std::string name = (name_beg == std::string::npos) ? file : file.substr(name_beg + 1);
+
+	char hash_str[32];
+	sprintf(hash_str, "%016llx_", static_cast<unsigned long long>(path_hash));
+	return gAssetCacheDir + "/" + hash_str + name + gAssetCacheExt;
+}
+
+bool cAssetCache::ParseSource(const std::string& file, Json::Value& out_root, uint64_t& out_hash)
+{
+	cMappedFile source;
+	bool succ = source.Open(file);
+	if (succ)
+	{
+		const char* data = source.GetData();
+		size_t size = source.GetSize();
+		out_hash = CalcHash(data, size);
+
+		Json::Reader reader;
+		succ = reader.parse(data, data + size, out_root);
+	}
+	return succ;
+}
+
+bool cAssetCache::LoadCompiled(const std::string& file, const tSourceInfo& info, Json::Value& out_root)
+{
+	std::string cache_path = GetCachePath(file);
+	cMappedFile compiled;
+	bool succ = compiled.Open(cache_path);
+
+	tAssetCacheHeader header;
+	succ = succ && compiled.GetSize() >= sizeof(header);
+	if (succ)
+	{
+		memcpy(&header, compiled.GetData(), sizeof(header));
+		succ = memcmp(header.mMagic, gAssetCacheMagic, gAssetCacheMagicLen) == 0
+				&& header.mVersion == gAssetCacheVersion
+				&& header.mPayloadSize == compiled.GetSize() - sizeof(header);
+	}
+
+	bool stale_stamp = succ && (header.mSourceSize != info.mSize || header.mSourceModTime != info.mModTime);
+	if (stale_stamp)
+	{
+		// touched but possibly unchanged, e.g. after a checkout, so compare contents before recompiling
+		cMappedFile source;
+		succ = source.Open(file) && CalcHash(source.GetData(), source.GetSize()) == header.mSourceHash;
+	}
+
+	if (succ)
+	{
+		const char* payload = compiled.GetData() + sizeof(header);
+		size_t payload_size = static_cast<size_t>(header.mPayloadSize);
+		succ = CalcHash(payload, payload_size) == header.mPayloadHash;
+
+		size_t pos = 0;
+		succ = succ && DecodeValue(payload, payload_size, pos, out_root) && pos == payload_size;
+		if (!succ)
+		{
+			printf("Corrupt asset cache entry %s, recompiling\n", cache_path.c_str());
+		}
+	}
+
+	if (succ && stale_stamp)
+	{
+		// restamp so the next run can skip hashing the source
+		compiled.Close();
+		WriteCompiled(file, info, header.mSourceHash, out_root);
+	}
+	return succ;
+}
+
+bool cAssetCache::WriteCompiled(const std::string& file, const tSourceInfo& info, uint64_t hash, const Json::Value& root)
+{
+	std::vector<char> payload;
+	EncodeValue(root, payload);
+
+	tAssetCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.mMagic, gAssetCacheMagic, gAssetCacheMagicLen);
+	header.mVersion = gAssetCacheVersion;
+	header.mSourceSize = info.mSize;
+	header.mSourceModTime = info.mModTime;
+	header.mSourceHash = hash;
+	header.mPayloadSize = payload.size();
+	header.mPayloadHash = CalcHash(payload.data(), payload.size());
+
+	// written to a temporary file first so runs sharing the cache never map a partial file
+	std::string cache_path = GetCachePath(file);
+	long long stamp = static_cast<long long>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	std::string tmp_path = cache_path + "." + std::to_string(stamp) + ".tmp";
+
+	FILE* f = cFileUtil::OpenFile(tmp_path, "wb");
+	bool succ = f != nullptr;
+	if (succ)
+	{
+		succ = fwrite(&header, sizeof(header), 1, f) == 1;
+		succ &= fwrite(payload.data(), 1, payload.size(), f) == payload.size();
+		cFileUtil::CloseFile(f);
+
+#if defined(_WIN32)
+		std::remove(cache_path.c_str());
+#endif
+		succ = succ && std::rename(tmp_path.c_str(), cache_path.c_str()) == 0;
+		if (!succ)
+		{
+			std::remove(tmp_path.c_str());
+		}
+	}
+
+	if (succ)
+	{
+		std::lock_guard<std::mutex> lock(gAssetCacheMutex);
+		++gAssetCacheStats.mCompiles;
+	}
+	else
+	{
+		printf("Failed to write asset cache entry %s\n", cache_path.c_str());
+	}
+	return succ;
+}
+
+uint64_t cAssetCache::CalcHash(const char* data, size_t size)
+{
+	// 64 bit fnv-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= static_cast<uint8_t>(data[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void cAssetCache::EncodeValue(const Json::Value& val, std::vector<char>& out_data)
+{
+	auto write_raw = [&out_data](const void* src, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(src);
+		out_data.insert(out_data.end(), bytes, bytes + size);
+	};
+
+	auto write_str = [&write_raw](const char* str, size_t len)
+	{
+		uint32_t len32 = static_cast<uint32_t>(len);
+		write_raw(&len32, sizeof(len32));
+		write_raw(str, len);
+	};
+
+	Json::ValueType type = val.type();
+	if (type == Json::nullValue)
+	{
+		out_data.push_back(static_cast<char>(eAssetTagNull));
+	}
+	else if (type == Json::booleanValue)
+	{
+		out_data.push_back(static_cast<char>(val.asBool() ? eAssetTagTrue : eAssetTagFalse));
+	}
+	else if (type == Json::intValue)
+	{
+		int64_t int_val = val.asLargestInt();
+		out_data.push_back(static_cast<char>(eAssetTagInt));
+		write_raw(&int_val, sizeof(int_val));
+	}
+	else if (type == Json::uintValue)
+	{
+		uint64_t uint_val = val.asLargestUInt();
+		out_data.push_back(static_cast<char>(eAssetTagUInt));
+		write_raw(&uint_val, sizeof(uint_val));
+	}
+	else if (type == Json::realValue)
+	{
+		double real_val = val.asDouble();
+		out_data.push_back(static_cast<char>(eAssetTagReal));
+		write_raw(&real_val, sizeof(real_val));
+	}
+	else if (type == Json::stringValue)
+	{
+		std::string str = val.asString();
+		out_data.push_back(static_cast<char>(eAssetTagString));
+		write_str(str.data(), str.size());
+	}
+	else if (type == Json::arrayValue)
+	{
+		uint32_t num = static_cast<uint32_t>(val.size());
+		out_data.push_back(static_cast<char>(eAssetTagArray));
+		write_raw(&num, sizeof(num));
+		for (uint32_t i = 0; i < num; ++i)
+		{
+			EncodeValue(val[i], out_data);
+		}
+	}
+	else if (type == Json::objectValue)
+	{
+		uint32_t num = static_cast<uint32_t>(val.size());
+		out_data.push_back(static_cast<char>(eAssetTagObject));
+		write_raw(&num, sizeof(num));
+		for (auto it = val.begin(); it != val.end(); ++it)
+		{
+			std::string key = it.name();
+			write_str(key.data(), key.size());
+			EncodeValue(*it, out_data);
+		}
+	}
+	else
+	{
+		assert(false); // unsupported json type
+	}
+}
+
+bool cAssetCache::DecodeValue(const char* data, size_t size, size_t& pos, Json::Value& out_val)
+{
+	auto read_raw = [data, size, &pos](void* dst, size_t len)
+	{
+		bool succ = pos + len <= size;
+		if (succ)
+		{
+			memcpy(dst, data + pos, len);
+			pos += len;
+		}
+		return succ;
+	};
+
+	uint8_t tag = eAssetTagMax;
+	bool succ = read_raw(&tag, sizeof(tag));
+	if (!succ)
+	{
+		return false;
+	}
+
+	if (tag == eAssetTagNull)
+	{
+		out_val = Json::Value();
+	}
+	else if (tag == eAssetTagFalse || tag == eAssetTagTrue)
+	{
+		out_val = Json::Value(tag == eAssetTagTrue);
+	}
+	else if (tag == eAssetTagInt)
+	{
+		int64_t int_val = 0;
+		succ = read_raw(&int_val, sizeof(int_val));
+		out_val = Json::Value(static_cast<Json::Value::LargestInt>(int_val));
+	}
+	else if (tag == eAssetTagUInt)
+	{
+		uint64_t uint_val = 0;
+		succ = read_raw(&uint_val, sizeof(uint_val));
+		out_val = Json::Value(static_cast<Json::Value::LargestUInt>(uint_val));
+	}
+	else if (tag == eAssetTagReal)
+	{
+		double real_val = 0;
+		succ = read_raw(&real_val, sizeof(real_val));
+		out_val = Json::Value(real_val);
+	}
+	else if (tag == eAssetTagString)
+	{
+		uint32_t len = 0;
+		succ = read_raw(&len, sizeof(len)) && pos + len <= size;
+		if (succ)
+		{
+			out_val = Json::Value(data + pos, data + pos + len);
+			pos += len;
+		}
+	}
+	else if (tag == eAssetTagArray)
+	{
+		uint32_t num = 0;
+		succ = read_raw(&num, sizeof(num)) && num <= size - pos;
+		if (succ)
+		{
+			out_val = Json::Value(Json::arrayValue);
+			out_val.resize(num);
+			for (uint32_t i = 0; succ && i < num; ++i)
+			{
+				succ = DecodeValue(data, size, pos, out_val[i]);
+			}
+		}
+	}
+	else if (tag == eAssetTagObject)
+	{
+		uint32_t num = 0;
+		succ = read_raw(&num, sizeof(num)) && num <= size - pos;
+		out_val = Json::Value(Json::objectValue);
+		for (uint32_t i = 0; succ && i < num; ++i)
+		{
+			uint32_t len = 0;
+			succ = read_raw(&len, sizeof(len)) && pos + len <= size;
+			if (succ)
+			{
+				std::string key(data + pos, len);
+				pos += len;
+				succ = DecodeValue(data, size, pos, out_val[key]);
+			}
+		}
+	}
+	else
+	{
+		succ = false;
+	}
+
+	return succ;
+}
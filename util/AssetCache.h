@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <json/json.h>
+
+// loads json assets (characters, motions, controllers, scale files, ...) through two caches,
+// parsed documents are kept in memory so every scene built from the same file shares one parse,
+// and with a cache dir set each document is also compiled to a checksummed binary file
+// that later runs map and decode instead of parsing the text,
+// compiled files are rebuilt when the size and modification time of the source change
+// and its contents hash differently than the one the file was compiled from
+class cAssetCache
+{
+public:
+	struct tStats
+	{
+		int mMemHits;
+		int mDiskHits;
+		int mParses;
+		int mCompiles;
+
+		tStats();
+	};
+
+	// an empty dir disables the on-disk cache
+	static void SetCacheDir(const std::string& dir);
+	static const std::string& GetCacheDir();
+
+	static bool LoadJson(const std::string& file, Json::Value& out_root);
+	// parses the file and writes its compiled form regardless of what is cached
+	static bool CompileJson(const std::string& file);
+	static void ClearMem();
+
+	static tStats GetStats();
+	static void PrintStats();
+
+protected:
+	struct tSourceInfo
+	{
+		uint64_t mSize;
+		int64_t mModTime; // ns
+	};
+
+	static bool GetSourceInfo(const std::string& file, tSourceInfo& out_info);
+	static std::string GetCachePath(const std::string& file);
+	static bool ParseSource(const std::string& file, Json::Value& out_root, uint64_t& out_hash);
+	static bool LoadCompiled(const std::string& file, const tSourceInfo& info, Json::Value& out_root);
+	static bool WriteCompiled(const std::string& file, const tSourceInfo& info, uint64_t hash, const Json::Value& root);
+
+	static uint64_t CalcHash(const char* data, size_t size);
+	static void EncodeValue(const Json::Value& val, std::vector<char>& out_data);
+	static bool DecodeValue(const char* data, size_t size, size_t& pos, Json::Value& out_val);
+};
@@ -1,116 +1,383 @@
 #pragma once
 #include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
 
+// ring buffers that index with a mask instead of a modulo, the storage is rounded up
+// to a power of two while the capacity stays exactly what was requested,
+// elements are addressed oldest first and the slots are tracked with running counters
+
+// storage size for a compile time capacity, rounded up to a power of two
+template<size_t tCapacity>
+struct tCircularBufferStorageSize
+{
+	static const size_t gSize = tCircularBufferStorageSize<(tCapacity + 1) / 2>::gSize * 2;
+};
+
+template<>
+struct tCircularBufferStorageSize<1>
+{
+	static const size_t gSize = 1;
+};
+
+template<>
+struct tCircularBufferStorageSize<0>
+{
+	static const size_t gSize = 1;
+};
+
+// shared implementation, tStorage is the underlying array type
+template<typename tVal, typename tStorage>
+class cCircularBufferBase
+{
+public:
+	// contiguous run of elements, the whole contents are at most two of these
+	template<typename tSpanVal>
+	struct tSpanBase
+	{
+		tSpanVal* mData;
+		size_t mSize;
+	};
+
+	typedef tSpanBase<const tVal> tConstSpan;
+	typedef tSpanBase<tVal> tSpan;
+
+	void Clear();
+	size_t GetSize() const;
+	size_t GetCapacity() const;
+	bool IsEmpty() const;
+	bool IsFull() const;
+
+	void Add(const tVal& val);
+	void Add(const tVal* vals, size_t num_vals);
+	const tVal& operator[](size_t i) const;
+	tVal& operator[](size_t i);
+	const tVal& GetFront() const;
+	const tVal& GetBack() const;
+
+	// oldest to newest, the second span is empty unless the contents wrap around the storage
+	void GetSpans(tConstSpan& out_first, tConstSpan& out_second) const;
+	void GetSpans(tSpan& out_first, tSpan& out_second);
+
+protected:
+	size_t mBegin;
+	size_t mEnd;
+	size_t mCapacity;
+	size_t mMask;
+	tStorage mData;
+
+	static size_t CalcStorageSize(size_t capacity);
+
+	cCircularBufferBase();
+
+	size_t CalcIdx(size_t i) const;
+	size_t GetStorageSize() const;
+};
+
+// capacity chosen at runtime
 template<typename tVal, typename tAlloc = std::allocator<tVal>>
-class cCircularBuffer
+class cCircularBuffer : public cCircularBufferBase<tVal, std::vector<tVal, tAlloc>>
 {
 public:
 	cCircularBuffer();
 	cCircularBuffer(size_t capacity);
-	virtual ~cCircularBuffer();
 
-	virtual void Reserve(size_t capacity);
-	virtual void Clear();
-	virtual size_t GetSize() const;
-	virtual size_t GetCapacity() const;
+	// keeps the newest elements that fit into the new capacity
+	void Reserve(size_t capacity);
+};
 
-	virtual void Add(const tVal& val);
-	virtual const tVal& operator[](size_t i) const;
-	virtual tVal& operator[](size_t i);
+// capacity fixed at compile time
+template<typename tVal, size_t tCapacity>
+class cStaticCircularBuffer : public cCircularBufferBase<tVal, std::array<tVal, tCircularBufferStorageSize<tCapacity>::gSize>>
+{
+public:
+	cStaticCircularBuffer();
+};
+
+// single producer single consumer queue for passing samples between two threads,
+// pushes fail instead of overwriting once the consumer falls a full buffer behind
+template<typename tVal, size_t tCapacity>
+class cSPSCCircularBuffer
+{
+public:
+	cSPSCCircularBuffer();
+
+	size_t GetCapacity() const;
+	// only exact when called from the producer or consumer while the other is idle
+	size_t GetSize() const;
+
+	// producer
+	bool TryPush(const tVal& val);
+	// consumer
+	bool TryPop(tVal& out_val);
+	size_t Pop(tVal* out_vals, size_t max_vals);
 
 protected:
-	size_t mHead;
-	size_t mSize;
-	std::vector<tVal, tAlloc> mData;
+	static const size_t gStorageSize = tCircularBufferStorageSize<tCapacity>::gSize;
+	static const size_t gMask = gStorageSize - 1;
+	static const size_t gCacheLineSize = 64;
 
-	virtual size_t CalcIdx(size_t i) const;
+	alignas(gCacheLineSize) std::atomic<size_t> mBegin;
+	alignas(gCacheLineSize) std::atomic<size_t> mEnd;
+	alignas(gCacheLineSize) std::array<tVal, gStorageSize> mData;
 };
 
-template<typename tVal, typename tAlloc>
-cCircularBuffer<tVal, tAlloc>::cCircularBuffer() :
-		cCircularBuffer(0)
+
+template<typename tVal, typename tStorage>
+cCircularBufferBase<tVal, tStorage>::cCircularBufferBase()
 {
+	mBegin = 0;
+	mEnd = 0;
+	mCapacity = 0;
+	mMask = 0;
 }
 
-template<typename tVal, typename tAlloc>
-cCircularBuffer<tVal, tAlloc>::cCircularBuffer(size_t capacity)
+template<typename tVal, typename tStorage>
+void cCircularBufferBase<tVal, tStorage>::Clear()
 {
-	mHead = 0;
-	mSize = 0;
-	Reserve(capacity);
+	mBegin = 0;
+	mEnd = 0;
 }
 
-template<typename tVal, typename tAlloc>
-cCircularBuffer<tVal, tAlloc>::~cCircularBuffer()
+template<typename tVal, typename tStorage>
+size_t cCircularBufferBase<tVal, tStorage>::GetSize() const
 {
+	return mEnd - mBegin;
 }
 
-template<typename tVal, typename tAlloc>
-void cCircularBuffer<tVal, tAlloc>::Reserve(size_t capacity)
+template<typename tVal, typename tStorage>
+size_t cCircularBufferBase<tVal, tStorage>::GetCapacity() const
+{
+	return mCapacity;
+}
+
+template<typename tVal, typename tStorage>
+bool cCircularBufferBase<tVal, tStorage>::IsEmpty() const
 {
-	size_t prev_size = mData.size();
-	mData.resize(capacity);
+	return mEnd == mBegin;
+}
+
+template<typename tVal, typename tStorage>
+bool cCircularBufferBase<tVal, tStorage>::IsFull() const
+{
+	return GetSize() == mCapacity;
+}
 
-	if (prev_size > 0)
+template<typename tVal, typename tStorage>
+void cCircularBufferBase<tVal, tStorage>::Add(const tVal& val)
+{
+	if (mCapacity > 0)
 	{
-		for (size_t i = prev_size - 1; i >= mHead; --i)
+		mData[mEnd & mMask] = val;
+		++mEnd;
+		if (mEnd - mBegin > mCapacity)
 		{
-			size_t new_idx = capacity - (prev_size - i);
-			mData[new_idx] = mData[i];
+			++mBegin;
 		}
 	}
+}
+
+template<typename tVal, typename tStorage>
+void cCircularBufferBase<tVal, tStorage>::Add(const tVal* vals, size_t num_vals)
+{
+	// only the newest capacity values can survive, so the rest are skipped,
+	// the remainder is written with at most two contiguous copies
+	size_t num_skip = (num_vals > mCapacity) ? (num_vals - mCapacity) : 0;
+	vals += num_skip;
+	mEnd += num_skip;
+	num_vals -= num_skip;
 
-	if (prev_size != mHead)
+	size_t storage_size = GetStorageSize();
+	size_t beg_idx = mEnd & mMask;
+	size_t num_first = std::min(num_vals, storage_size - beg_idx);
+	std::copy(vals, vals + num_first, &mData[0] + beg_idx);
+	std::copy(vals + num_first, vals + num_vals, &mData[0]);
+
+	mEnd += num_vals;
+	if (mEnd - mBegin > mCapacity)
 	{
-		mSize = capacity;
+		mBegin = mEnd - mCapacity;
 	}
 }
 
-template<typename tVal, typename tAlloc>
-void cCircularBuffer<tVal, tAlloc>::Clear()
+template<typename tVal, typename tStorage>
+const tVal& cCircularBufferBase<tVal, tStorage>::operator[](size_t i) const
 {
-	mHead = 0;
-	mSize = 0;
+	return mData[CalcIdx(i)];
 }
 
-template<typename tVal, typename tAlloc>
-size_t cCircularBuffer<tVal, tAlloc>::GetSize() const
+template<typename tVal, typename tStorage>
+tVal& cCircularBufferBase<tVal, tStorage>::operator[](size_t i)
 {
-	return mSize;
+	return mData[CalcIdx(i)];
 }
 
-template<typename tVal, typename tAlloc>
-size_t cCircularBuffer<tVal, tAlloc>::GetCapacity() const
+template<typename tVal, typename tStorage>
+const tVal& cCircularBufferBase<tVal, tStorage>::GetFront() const
 {
-	return mData.size();
+	return mData[mBegin & mMask];
 }
 
-template<typename tVal, typename tAlloc>
-void cCircularBuffer<tVal, tAlloc>::Add(const tVal& val)
+template<typename tVal, typename tStorage>
+const tVal& cCircularBufferBase<tVal, tStorage>::GetBack() const
+{
+	return mData[(mEnd - 1) & mMask];
+}
+
+template<typename tVal, typename tStorage>
+void cCircularBufferBase<tVal, tStorage>::GetSpans(tConstSpan& out_first, tConstSpan& out_second) const
+{
+	size_t size = GetSize();
+	size_t beg_idx = mBegin & mMask;
+	size_t num_first = std::min(size, GetStorageSize() - beg_idx);
+
+	out_first.mData = (size > 0) ? &mData[beg_idx] : nullptr;
+	out_first.mSize = num_first;
+	out_second.mData = (size > num_first) ? &mData[0] : nullptr;
+	out_second.mSize = size - num_first;
+}
+
+template<typename tVal, typename tStorage>
+void cCircularBufferBase<tVal, tStorage>::GetSpans(tSpan& out_first, tSpan& out_second)
+{
+	tConstSpan first;
+	tConstSpan second;
+	static_cast<const cCircularBufferBase*>(this)->GetSpans(first, second);
+
+	out_first.mData = const_cast<tVal*>(first.mData);
+	out_first.mSize = first.mSize;
+	out_second.mData = const_cast<tVal*>(second.mData);
+	out_second.mSize = second.mSize;
+}
+
+template<typename tVal, typename tStorage>
+size_t cCircularBufferBase<tVal, tStorage>::CalcIdx(size_t i) const
+{
+	return (mBegin + i) & mMask;
+}
+
+template<typename tVal, typename tStorage>
+size_t cCircularBufferBase<tVal, tStorage>::GetStorageSize() const
 {
-	mData[mHead] = val;
-	size_t capacity = GetCapacity();
-	mHead = (mHead + 1) % capacity;
-	mSize = std::min((mSize + 1), capacity);
+	return mMask + 1;
 }
 
+template<typename tVal, typename tStorage>
+size_t cCircularBufferBase<tVal, tStorage>::CalcStorageSize(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+
 template<typename tVal, typename tAlloc>
-const tVal& cCircularBuffer<tVal, tAlloc>::operator[](size_t i) const
+cCircularBuffer<tVal, tAlloc>::cCircularBuffer() :
+		cCircularBuffer(0)
 {
-	size_t idx = CalcIdx(i);
-	return mData[idx];
 }
 
 template<typename tVal, typename tAlloc>
-tVal& cCircularBuffer<tVal, tAlloc>::operator[](size_t i)
+cCircularBuffer<tVal, tAlloc>::cCircularBuffer(size_t capacity)
 {
-	size_t idx = CalcIdx(i);
-	return mData[idx];
+	Reserve(capacity);
 }
 
 template<typename tVal, typename tAlloc>
-size_t cCircularBuffer<tVal, tAlloc>::CalcIdx(size_t i) const
+void cCircularBuffer<tVal, tAlloc>::Reserve(size_t capacity)
+{
+	size_t num_kept = std::min(this->GetSize(), capacity);
+	size_t storage_size = this->CalcStorageSize(capacity);
+
+	std::vector<tVal, tAlloc> data(storage_size);
+	size_t beg = this->GetSize() - num_kept;
+	for (size_t i = 0; i < num_kept; ++i)
+	{
+		data[i] = (*this)[beg + i];
+	}
+
+	this->mData.swap(data);
+	this->mCapacity = capacity;
+	this->mMask = storage_size - 1;
+	this->mBegin = 0;
+	this->mEnd = num_kept;
+}
+
+
+template<typename tVal, size_t tCapacity>
+cStaticCircularBuffer<tVal, tCapacity>::cStaticCircularBuffer()
 {
-	size_t idx = (mHead + i) % GetSize();
-	return idx;
-}
\ No newline at end of file
+	this->mCapacity = tCapacity;
+	this->mMask = tCircularBufferStorageSize<tCapacity>::gSize - 1;
+}
+
+
+template<typename tVal, size_t tCapacity>
+cSPSCCircularBuffer<tVal, tCapacity>::cSPSCCircularBuffer()
+{
+	mBegin = 0;
+	mEnd = 0;
+}
+
+template<typename tVal, size_t tCapacity>
+size_t cSPSCCircularBuffer<tVal, tCapacity>::GetCapacity() const
+{
+	return tCapacity;
+}
+
+template<typename tVal, size_t tCapacity>
+size_t cSPSCCircularBuffer<tVal, tCapacity>::GetSize() const
+{
+	return mEnd.load(std::memory_order_acquire) - mBegin.load(std::memory_order_acquire);
+}
+
+template<typename tVal, size_t tCapacity>
+bool cSPSCCircularBuffer<tVal, tCapacity>::TryPush(const tVal& val)
+{
+	size_t end = mEnd.load(std::memory_order_relaxed);
+	size_t begin = mBegin.load(std::memory_order_acquire);
+	if (end - begin >= tCapacity)
+	{
+		return false;
+	}
+
+	mData[end & gMask] = val;
+	mEnd.store(end + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename tVal, size_t tCapacity>
+bool cSPSCCircularBuffer<tVal, tCapacity>::TryPop(tVal& out_val)
+{
+	size_t begin = mBegin.load(std::memory_order_relaxed);
+	size_t end = mEnd.load(std::memory_order_acquire);
+	if (begin == end)
+	{
+		return false;
+	}
+
+	out_val = mData[begin & gMask];
+	mBegin.store(begin + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename tVal, size_t tCapacity>
+size_t cSPSCCircularBuffer<tVal, tCapacity>::Pop(tVal* out_vals, size_t max_vals)
+{
+	size_t begin = mBegin.load(std::memory_order_relaxed);
+	size_t end = mEnd.load(std::memory_order_acquire);
+	size_t num_vals = std::min(end - begin, max_vals);
+
+	for (size_t i = 0; i < num_vals; ++i)
+	{
+		out_vals[i] = mData[(begin + i) & gMask];
+	}
+
+	mBegin.store(begin + num_vals, std::memory_order_release);
+	return num_vals;
+}
@@ -1,5 +1,7 @@
 #include "IndexManager.h"
 #include <assert.h>
+#include <algorithm>
+#include <thread>
 
 const int cIndexManager::gInvalidIndex = -1;
 
@@ -122,50 +124,216 @@ bool cIndexManager::IsFull() const
 // Multi-Threaded
 ////////////////////////////
 
+const uint32_t cIndexManagerMT::gNullNode = 0xffffffff;
+
 cIndexManagerMT::cIndexManagerMT()
 	: cIndexManager()
 {
+	mSize = 0;
+	mWaitPolicy = eWaitSpinPark;
+	mSpinCount = 64;
+	mHead = PackHead(gNullNode, 0);
+	mNumWaiters = 0;
 }
 
 cIndexManagerMT::cIndexManagerMT(int size)
-	: cIndexManager(size)
+	: cIndexManagerMT()
 {
+	Resize(size);
 }
 
 cIndexManagerMT::~cIndexManagerMT()
 {
 }
 
+int cIndexManagerMT::GetSize() const
+{
+	return mSize;
+}
+
+void cIndexManagerMT::Reset()
+{
+	std::vector<bool> in_use(mSize, false);
+	BuildFreeList(in_use);
+}
+
+void cIndexManagerMT::Clear()
+{
+	mSize = 0;
+	mNext.reset();
+	mInUse.reset();
+	mHead = PackHead(gNullNode, 0);
+}
+
+void cIndexManagerMT::Resize(int size)
+{
+	// indices that are still in use and fit in the new size stay allocated
+	std::vector<bool> in_use(size, false);
+	int num_kept = std::min(size, mSize);
+	for (int i = 0; i < num_kept; ++i)
+	{
+		in_use[i] = mInUse[i].load();
+	}
+
+	mSize = size;
+	mNext.reset(new std::atomic<uint32_t>[size]);
+	mInUse.reset(new std::atomic<bool>[size]);
+	BuildFreeList(in_use);
+}
+
+void cIndexManagerMT::SetWaitPolicy(eWaitPolicy policy, int spin_count)
+{
+	mWaitPolicy = policy;
+	mSpinCount = spin_count;
+}
+
+cIndexManagerMT::eWaitPolicy cIndexManagerMT::GetWaitPolicy() const
+{
+	return mWaitPolicy;
+}
+
 int cIndexManagerMT::RequestIndex()
 {
-	int idx = gInvalidIndex;
-	
-	while(true)
+	int idx = TryRequestIndex();
+	if (idx == gInvalidIndex)
+	{
+		idx = WaitRequestIndex();
+	}
+	return idx;
+}
+
+int cIndexManagerMT::TryRequestIndex()
+{
+	int idx = Pop();
+	if (idx != gInvalidIndex)
+	{
+		mInUse[idx].store(true, std::memory_order_relaxed);
+	}
+	return idx;
+}
+
+void cIndexManagerMT::FreeIndex(int idx)
+{
+	assert(idx >= 0 && idx < mSize);
+	bool was_used = mInUse[idx].exchange(false, std::memory_order_relaxed);
+	if (was_used)
 	{
+		Push(idx);
+
+		// the push and the waiter count are both sequentially consistent, so either
+		// a waiter sees the freed index before parking or the count is seen here
+		if (mNumWaiters.load() > 0)
 		{
-			std::lock_guard<std::mutex> lock_idx(mIndexMutex);
-			idx = cIndexManager::RequestIndex();
+			{
+				std::lock_guard<std::mutex> lock(mWaitMutex);
+			}
+			mCond.notify_one();
 		}
+	}
+	else
+	{
+		assert(false); // trying to free an unused index
+	}
+}
+
+bool cIndexManagerMT::IsFree(int idx) const
+{
+	return !mInUse[idx].load(std::memory_order_relaxed);
+}
+
+bool cIndexManagerMT::IsFull() const
+{
+	return GetHeadIdx(mHead.load()) == gNullNode;
+}
+
+uint64_t cIndexManagerMT::PackHead(uint32_t idx, uint32_t tag)
+{
+	return (static_cast<uint64_t>(tag) << 32) | idx;
+}
 
-		if (idx != gInvalidIndex)
+uint32_t cIndexManagerMT::GetHeadIdx(uint64_t head)
+{
+	return static_cast<uint32_t>(head & 0xffffffff);
+}
+
+uint32_t cIndexManagerMT::GetHeadTag(uint64_t head)
+{
+	return static_cast<uint32_t>(head >> 32);
+}
+
+void cIndexManagerMT::BuildFreeList(const std::vector<bool>& in_use)
+{
+	// free indices are linked in increasing order so requests
+	// are handed out in the same order as the single threaded manager
+	uint32_t head = gNullNode;
+	for (int i = mSize - 1; i >= 0; --i)
+	{
+		mInUse[i].store(in_use[i]);
+		mNext[i].store(gNullNode);
+		if (!in_use[i])
 		{
-			break;
+			mNext[i].store(head);
+			head = static_cast<uint32_t>(i);
 		}
-		else
+	}
+	mHead = PackHead(head, 0);
+}
+
+int cIndexManagerMT::Pop()
+{
+	uint64_t head = mHead.load(std::memory_order_acquire);
+	while (true)
+	{
+		uint32_t idx = GetHeadIdx(head);
+		if (idx == gNullNode)
+		{
+			return gInvalidIndex;
+		}
+
+		// the next link may be stale if another thread popped idx in the meantime,
+		// but then the tag has moved on and the exchange fails
+		uint32_t next = mNext[idx].load(std::memory_order_relaxed);
+		uint64_t new_head = PackHead(next, GetHeadTag(head) + 1);
+		if (mHead.compare_exchange_weak(head, new_head, std::memory_order_acq_rel, std::memory_order_acquire))
 		{
-			std::unique_lock<std::mutex> lock_idx(mWaitMutex);
-			mCond.wait(lock_idx);
+			return static_cast<int>(idx);
 		}
 	}
+}
 
-	return idx;
+void cIndexManagerMT::Push(int idx)
+{
+	uint64_t head = mHead.load(std::memory_order_relaxed);
+	uint64_t new_head = 0;
+	do
+	{
+		mNext[idx].store(GetHeadIdx(head), std::memory_order_relaxed);
+		new_head = PackHead(static_cast<uint32_t>(idx), GetHeadTag(head) + 1);
+	} while (!mHead.compare_exchange_weak(head, new_head, std::memory_order_seq_cst, std::memory_order_relaxed));
 }
 
-void cIndexManagerMT::FreeIndex(int idx)
+int cIndexManagerMT::WaitRequestIndex()
 {
+	int idx = gInvalidIndex;
+	if (mWaitPolicy == eWaitSpinPark)
 	{
-		std::lock_guard<std::mutex> lock_idx(mIndexMutex);
-		cIndexManager::FreeIndex(idx);
+		for (int i = 0; i < mSpinCount && idx == gInvalidIndex; ++i)
+		{
+			std::this_thread::yield();
+			idx = TryRequestIndex();
+		}
+	}
+
+	while (idx == gInvalidIndex)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mWaitMutex);
+			++mNumWaiters;
+			mCond.wait(lock, [this]() { return !IsFull(); });
+			--mNumWaiters;
+		}
+		idx = TryRequestIndex();
 	}
-	mCond.notify_one();
-}
\ No newline at end of file
+
+	return idx;
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <condition_variable>
 
@@ -28,18 +31,60 @@ protected:
 	std::vector<int> mPos;
 };
 
+// lock-free version for indices shared between threads, the free indices are kept
+// in a treiber stack whose head is tagged with a counter to avoid aba on concurrent pops,
+// Reset, Clear and Resize must not run concurrently with requests
 class cIndexManagerMT : public cIndexManager
 {
 public:
+	enum eWaitPolicy
+	{
+		eWaitPark,
+		eWaitSpinPark,
+		eWaitPolicyMax
+	};
+
 	cIndexManagerMT();
 	cIndexManagerMT(int size);
 	virtual ~cIndexManagerMT();
 
+	virtual int GetSize() const;
+	virtual void Reset();
+	virtual void Clear();
+	virtual void Resize(int size);
+
+	virtual void SetWaitPolicy(eWaitPolicy policy, int spin_count);
+	virtual eWaitPolicy GetWaitPolicy() const;
+
+	// blocks until an index is available
 	virtual int RequestIndex();
+	// returns gInvalidIndex if all indices are in use
+	virtual int TryRequestIndex();
 	virtual void FreeIndex(int idx);
+	virtual bool IsFree(int idx) const;
+	virtual bool IsFull() const;
 
 protected:
-	std::mutex mIndexMutex;
+	static const uint32_t gNullNode;
+
+	int mSize;
+	eWaitPolicy mWaitPolicy;
+	int mSpinCount;
+
+	std::atomic<uint64_t> mHead;
+	std::unique_ptr<std::atomic<uint32_t>[]> mNext;
+	std::unique_ptr<std::atomic<bool>[]> mInUse;
+
+	std::atomic<int> mNumWaiters;
 	std::mutex mWaitMutex;
 	std::condition_variable mCond;
+
+	static uint64_t PackHead(uint32_t idx, uint32_t tag);
+	static uint32_t GetHeadIdx(uint64_t head);
+	static uint32_t GetHeadTag(uint64_t head);
+
+	virtual void BuildFreeList(const std::vector<bool>& in_use);
+	virtual int Pop();
+	virtual void Push(int idx);
+	virtual int WaitRequestIndex();
 };
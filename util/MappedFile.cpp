@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+#include "util/FileUtil.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+cMappedFile::cMappedFile()
+{
+	mData = nullptr;
+	mSize = 0;
+}
+
+cMappedFile::~cMappedFile()
+{
+	Close();
+}
+
+bool cMappedFile::Open(const std::string& file)
+{
+	Close();
+
+#if defined(_WIN32)
+	long int file_size = cFileUtil::GetFileSize(file);
+	FILE* f = cFileUtil::OpenFile(file, "rb");
+	bool succ = (f != nullptr) && (file_size > 0);
+	if (succ)
+	{
+		mBuffer.resize(file_size);
+		succ = fread(mBuffer.data(), 1, file_size, f) == static_cast<size_t>(file_size);
+		mData = mBuffer.data();
+		mSize = mBuffer.size();
+	}
+	if (f != nullptr)
+	{
+		cFileUtil::CloseFile(f);
+	}
+#else
+	bool succ = false;
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+		{
+			void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				mData = data;
+				mSize = static_cast<size_t>(file_stat.st_size);
+				succ = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	if (!succ)
+	{
+		Close();
+	}
+	return succ;
+}
+
+void cMappedFile::Close()
+{
+#if defined(_WIN32)
+	mBuffer.clear();
+	mBuffer.shrink_to_fit();
+#else
+	if (mData != nullptr)
+	{
+		munmap(mData, mSize);
+	}
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+bool cMappedFile::IsOpen() const
+{
+	return mData != nullptr;
+}
+
+const char* cMappedFile::GetData() const
+{
+	return static_cast<const char*>(mData);
+}
+
+size_t cMappedFile::GetSize() const
+{
+	return mSize;
+}
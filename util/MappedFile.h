@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// read-only view of a whole file, memory mapped where the platform supports it
+// and read into memory otherwise
+class cMappedFile
+{
+public:
+	cMappedFile();
+	virtual ~cMappedFile();
+
+	virtual bool Open(const std::string& file);
+	virtual void Close();
+	virtual bool IsOpen() const;
+
+	virtual const char* GetData() const;
+	virtual size_t GetSize() const;
+
+protected:
+	void* mData;
+	size_t mSize;
+	std::vector<char> mBuffer;
+
+private:
+	cMappedFile(const cMappedFile& other);
+	cMappedFile& operator=(const cMappedFile& other);
+};
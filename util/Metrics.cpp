@@ -0,0 +1,531 @@
+#include "Metrics.h"
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <limits>
+#include "util/FileUtil.h"
+
+// binary layout, all little-endian:
+// header: magic[8], int32 version, double start time in seconds since the unix epoch
+// def record: uint8 0, uint8 type, uint16 name len, int32 id, double min, double max, int32 num bins, name
+// value record: uint8 1, int32 id, int64 step, double time, double value
+// hist record: uint8 2, int32 id, int64 step, double time, uint64 count, double sum, double min, double max,
+//				int32 num bins, uint64 bins[num bins]
+// record times are in seconds since the start time
+const char gMetricsMagic[] = "TRLMETR1";
+const int gMetricsMagicLen = 8;
+const int gMetricsVersion = 1;
+
+const uint8_t gRecordDef = 0;
+const uint8_t gRecordValue = 1;
+const uint8_t gRecordHist = 2;
+
+const char* gMetricsTypeNames[cMetrics::eTypeMax] =
+{
+	"counter",
+	"gauge",
+	"hist"
+};
+
+struct tMetricsEvent
+{
+	int mID;
+	int64_t mStep;
+	double mTime;
+	double mVal;
+};
+
+// single producer single consumer ring, the owning thread pushes and the flush thread pops
+struct tMetricsBuffer
+{
+	static const uint32_t gSize = 1 << 14;
+	static const uint32_t gMask = gSize - 1;
+
+	tMetricsEvent mEvents[gSize];
+	std::atomic<uint32_t> mHead;
+	std::atomic<uint32_t> mTail;
+
+	tMetricsBuffer()
+	{
+		mHead = 0;
+		mTail = 0;
+	}
+
+	bool Push(const tMetricsEvent& evt)
+	{
+		uint32_t head = mHead.load(std::memory_order_relaxed);
+		uint32_t tail = mTail.load(std::memory_order_acquire);
+		bool succ = (head - tail) < gSize;
+		if (succ)
+		{
+			mEvents[head & gMask] = evt;
+			mHead.store(head + 1, std::memory_order_release);
+		}
+		return succ;
+	}
+
+	void Pop(std::vector<tMetricsEvent>& out_events)
+	{
+		uint32_t tail = mTail.load(std::memory_order_relaxed);
+		uint32_t head = mHead.load(std::memory_order_acquire);
+		for (uint32_t i = tail; i != head; ++i)
+		{
+			out_events.push_back(mEvents[i & gMask]);
+		}
+		mTail.store(head, std::memory_order_release);
+	}
+
+	bool IsEmpty() const
+	{
+		return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+	}
+};
+
+struct tMetricDef
+{
+	std::string mName;
+	cMetrics::eType mType;
+	double mMin;
+	double mMax;
+	int mNumBins;
+};
+
+struct tHistAccum
+{
+	uint64_t mCount;
+	double mSum;
+	double mMin;
+	double mMax;
+	int64_t mStep;
+	std::vector<uint64_t> mBins;
+};
+
+std::mutex gMetricsDefMutex;
+std::vector<tMetricDef> gMetricsDefs;
+std::map<std::string, int> gMetricsIDs;
+
+std::mutex gMetricsBufferMutex;
+std::vector<std::shared_ptr<tMetricsBuffer>> gMetricsBuffers;
+
+std::atomic<bool> gMetricsOpen(false);
+std::atomic<uint64_t> gMetricsNumDropped(0);
+std::chrono::steady_clock::time_point gMetricsStartTime;
+
+// owned by the flush thread while the stream is open
+std::mutex gMetricsFlushMutex;
+std::condition_variable gMetricsFlushCond;
+bool gMetricsStop = false;
+std::thread gMetricsFlushThread;
+FILE* gMetricsFile = nullptr;
+cMetrics::eFormat gMetricsFormat = cMetrics::eFormatBinary;
+double gMetricsFlushPeriod = 1;
+size_t gMetricsNumDefsWritten = 0;
+std::vector<double> gMetricsCounterTotals;
+std::vector<tHistAccum> gMetricsHists;
+
+tMetricsBuffer* GetMetricsBuffer()
+{
+	thread_local std::shared_ptr<tMetricsBuffer> buffer;
+	if (buffer == nullptr)
+	{
+		buffer = std::shared_ptr<tMetricsBuffer>(new tMetricsBuffer());
+		std::lock_guard<std::mutex> lock(gMetricsBufferMutex);
+		gMetricsBuffers.push_back(buffer);
+	}
+	return buffer.get();
+}
+
+template<typename tVal>
+void WriteMetricsVal(const tVal& val)
+{
+	fwrite(&val, sizeof(val), 1, gMetricsFile);
+}
+
+void WriteMetricsName(const std::string& name)
+{
+	fputc('"', gMetricsFile);
+	for (size_t i = 0; i < name.size(); ++i)
+	{
+		char c = name[i];
+		if (c == '"' || c == '\\')
+		{
+			fputc('\\', gMetricsFile);
+		}
+		fputc(c, gMetricsFile);
+	}
+	fputc('"', gMetricsFile);
+}
+
+void WriteMetricsDef(int id, const tMetricDef& def)
+{
+	if (gMetricsFormat == cMetrics::eFormatBinary)
+	{
+		WriteMetricsVal(gRecordDef);
+		WriteMetricsVal(static_cast<uint8_t>(def.mType));
+		WriteMetricsVal(static_cast<uint16_t>(def.mName.size()));
+		WriteMetricsVal(static_cast<int32_t>(id));
+		WriteMetricsVal(def.mMin);
+		WriteMetricsVal(def.mMax);
+		WriteMetricsVal(static_cast<int32_t>(def.mNumBins));
+		fwrite(def.mName.data(), 1, def.mName.size(), gMetricsFile);
+	}
+	else
+	{
+		fprintf(gMetricsFile, "{\"def\": %i, \"name\": ", id);
+		WriteMetricsName(def.mName);
+		fprintf(gMetricsFile, ", \"type\": \"%s\"", gMetricsTypeNames[def.mType]);
+		if (def.mType == cMetrics::eTypeHist)
+		{
+			fprintf(gMetricsFile, ", \"min\": %.17g, \"max\": %.17g, \"bins\": %i", def.mMin, def.mMax, def.mNumBins);
+		}
+		fprintf(gMetricsFile, "}\n");
+	}
+}
+
+void WriteMetricsValue(const tMetricDef& def, const tMetricsEvent& evt, double val)
+{
+	if (gMetricsFormat == cMetrics::eFormatBinary)
+	{
+		WriteMetricsVal(gRecordValue);
+		WriteMetricsVal(static_cast<int32_t>(evt.mID));
+		WriteMetricsVal(evt.mStep);
+		WriteMetricsVal(evt.mTime);
+		WriteMetricsVal(val);
+	}
+	else
+	{
+		fprintf(gMetricsFile, "{\"t\": %.9f, \"id\": %i, \"name\": ", evt.mTime, evt.mID);
+		WriteMetricsName(def.mName);
+		fprintf(gMetricsFile, ", \"step\": %lli, \"value\": %.17g}\n", static_cast<long long>(evt.mStep), val);
+	}
+}
+
+void WriteMetricsHist(int id, const tMetricDef& def, double time, const tHistAccum& hist)
+{
+	if (gMetricsFormat == cMetrics::eFormatBinary)
+	{
+		WriteMetricsVal(gRecordHist);
+		WriteMetricsVal(static_cast<int32_t>(id));
+		WriteMetricsVal(hist.mStep);
+		WriteMetricsVal(time);
+		WriteMetricsVal(hist.mCount);
+		WriteMetricsVal(hist.mSum);
+		WriteMetricsVal(hist.mMin);
+		WriteMetricsVal(hist.mMax);
+		WriteMetricsVal(static_cast<int32_t>(hist.mBins.size()));
+		fwrite(hist.mBins.data(), sizeof(uint64_t), hist.mBins.size(), gMetricsFile);
+	}
+	else
+	{
+		fprintf(gMetricsFile, "{\"t\": %.9f, \"id\": %i, \"name\": ", time, id);
+		WriteMetricsName(def.mName);
+		fprintf(gMetricsFile, ", \"step\": %lli, \"count\": %llu, \"sum\": %.17g, \"min\": %.17g, \"max\": %.17g, \"bins\": [",
+				static_cast<long long>(hist.mStep), static_cast<unsigned long long>(hist.mCount), hist.mSum, hist.mMin, hist.mMax);
+		for (size_t b = 0; b < hist.mBins.size(); ++b)
+		{
+			fprintf(gMetricsFile, (b == 0) ? "%llu" : ", %llu", static_cast<unsigned long long>(hist.mBins[b]));
+		}
+		fprintf(gMetricsFile, "]}\n");
+	}
+}
+
+double GetMetricsTime()
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - gMetricsStartTime;
+	return elapsed.count();
+}
+
+void FlushMetrics(std::vector<tMetricsEvent>& events)
+{
+	events.clear();
+	{
+		std::lock_guard<std::mutex> lock(gMetricsBufferMutex);
+		for (size_t b = 0; b < gMetricsBuffers.size(); ++b)
+		{
+			gMetricsBuffers[b]->Pop(events);
+		}
+
+		// buffers of threads that have exited are only referenced from here
+		auto end = std::remove_if(gMetricsBuffers.begin(), gMetricsBuffers.end(),
+			[](const std::shared_ptr<tMetricsBuffer>& buffer) { return buffer.use_count() == 1 && buffer->IsEmpty(); });
+		gMetricsBuffers.erase(end, gMetricsBuffers.end());
+	}
+
+	// ids are registered before they are logged, so reading the defs after
+	// draining the buffers covers every event that was drained
+	std::vector<tMetricDef> defs;
+	{
+		std::lock_guard<std::mutex> lock(gMetricsDefMutex);
+		defs = gMetricsDefs;
+	}
+
+	int num_defs = static_cast<int>(defs.size());
+	for (int i = static_cast<int>(gMetricsNumDefsWritten); i < num_defs; ++i)
+	{
+		WriteMetricsDef(i, defs[i]);
+	}
+	gMetricsNumDefsWritten = defs.size();
+	gMetricsCounterTotals.resize(defs.size(), 0);
+	gMetricsHists.resize(defs.size());
+
+	// each buffer is in order, merging them keeps the file in order within a flush
+	std::stable_sort(events.begin(), events.end(),
+		[](const tMetricsEvent& a, const tMetricsEvent& b) { return a.mTime < b.mTime; });
+
+	for (size_t e = 0; e < events.size(); ++e)
+	{
+		const tMetricsEvent& evt = events[e];
+		assert(evt.mID >= 0 && evt.mID < num_defs);
+		const tMetricDef& def = defs[evt.mID];
+
+		if (def.mType == cMetrics::eTypeCounter)
+		{
+			double& total = gMetricsCounterTotals[evt.mID];
+			total += evt.mVal;
+			WriteMetricsValue(def, evt, total);
+		}
+		else if (def.mType == cMetrics::eTypeGauge)
+		{
+			WriteMetricsValue(def, evt, evt.mVal);
+		}
+		else if (def.mType == cMetrics::eTypeHist)
+		{
+			tHistAccum& hist = gMetricsHists[evt.mID];
+			if (hist.mBins.size() != static_cast<size_t>(def.mNumBins))
+			{
+				hist.mBins.assign(def.mNumBins, 0);
+				hist.mCount = 0;
+			}
+			if (hist.mCount == 0)
+			{
+				hist.mSum = 0;
+				hist.mMin = std::numeric_limits<double>::infinity();
+				hist.mMax = -std::numeric_limits<double>::infinity();
+			}
+
+			double norm_val = (evt.mVal - def.mMin) / (def.mMax - def.mMin);
+			int bin = static_cast<int>(norm_val * def.mNumBins);
+			bin = std::max(0, std::min(def.mNumBins - 1, bin));
+			++hist.mBins[bin];
+			++hist.mCount;
+			hist.mSum += evt.mVal;
+			hist.mMin = std::min(hist.mMin, evt.mVal);
+			hist.mMax = std::max(hist.mMax, evt.mVal);
+			hist.mStep = evt.mStep;
+		}
+	}
+
+	double time = GetMetricsTime();
+	for (int i = 0; i < num_defs; ++i)
+	{
+		tHistAccum& hist = gMetricsHists[i];
+		if (defs[i].mType == cMetrics::eTypeHist && hist.mCount > 0)
+		{
+			WriteMetricsHist(i, defs[i], time, hist);
+			std::fill(hist.mBins.begin(), hist.mBins.end(), 0);
+			hist.mCount = 0;
+		}
+	}
+
+	fflush(gMetricsFile);
+}
+
+void MetricsFlushLoop()
+{
+	std::vector<tMetricsEvent> events;
+	std::unique_lock<std::mutex> lock(gMetricsFlushMutex);
+	bool stop = false;
+	while (!stop)
+	{
+		gMetricsFlushCond.wait_for(lock, std::chrono::duration<double>(gMetricsFlushPeriod),
+								[]() { return gMetricsStop; });
+		stop = gMetricsStop;
+		FlushMetrics(events);
+	}
+}
+
+int RegisterMetric(const std::string& name, cMetrics::eType type, double min_val, double max_val, int num_bins)
+{
+	std::lock_guard<std::mutex> lock(gMetricsDefMutex);
+	auto it = gMetricsIDs.find(name);
+	if (it != gMetricsIDs.end())
+	{
+		int id = it->second;
+		if (gMetricsDefs[id].mType != type)
+		{
+			printf("Metric %s was already registered as a %s\n", name.c_str(), gMetricsTypeNames[gMetricsDefs[id].mType]);
+			assert(false);
+		}
+		return id;
+	}
+
+	tMetricDef def;
+	def.mName = name;
+	def.mType = type;
+	def.mMin = min_val;
+	def.mMax = max_val;
+	def.mNumBins = num_bins;
+
+	int id = static_cast<int>(gMetricsDefs.size());
+	gMetricsDefs.push_back(def);
+	gMetricsIDs[name] = id;
+	return id;
+}
+
+bool cMetrics::ParseFormat(const std::string& str, eFormat& out_format)
+{
+	bool succ = true;
+	if (str == "binary" || str == "")
+	{
+		out_format = eFormatBinary;
+	}
+	else if (str == "ndjson")
+	{
+		out_format = eFormatNDJSON;
+	}
+	else
+	{
+		printf("Unsupported metrics format %s\n", str.c_str());
+		succ = false;
+	}
+	return succ;
+}
+
+bool cMetrics::Open(const std::string& file, eFormat format, double flush_period)
+{
+	Close();
+
+	gMetricsFile = cFileUtil::OpenFile(file, (format == eFormatBinary) ? "wb" : "w");
+	if (gMetricsFile == nullptr)
+	{
+		printf("Failed to open metrics file %s\n", file.c_str());
+		return false;
+	}
+
+	gMetricsFormat = format;
+	gMetricsFlushPeriod = flush_period;
+	gMetricsNumDefsWritten = 0;
+	gMetricsCounterTotals.clear();
+	gMetricsHists.clear();
+	gMetricsStop = false;
+
+	double start_time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	gMetricsStartTime = std::chrono::steady_clock::now();
+
+	if (format == eFormatBinary)
+	{
+		fwrite(gMetricsMagic, 1, gMetricsMagicLen, gMetricsFile);
+		WriteMetricsVal(static_cast<int32_t>(gMetricsVersion));
+		WriteMetricsVal(start_time);
+	}
+	else
+	{
+		fprintf(gMetricsFile, "{\"format\": \"trl_metrics\", \"version\": %i, \"start_time\": %.6f}\n", gMetricsVersion, start_time);
+	}
+
+	{
+		// anything left over from an earlier stream is stale
+		std::lock_guard<std::mutex> lock(gMetricsBufferMutex);
+		std::vector<tMetricsEvent> stale;
+		for (size_t b = 0; b < gMetricsBuffers.size(); ++b)
+		{
+			gMetricsBuffers[b]->Pop(stale);
+		}
+	}
+
+	gMetricsFlushThread = std::thread(MetricsFlushLoop);
+	gMetricsOpen.store(true, std::memory_order_release);
+	return true;
+}
+
+void cMetrics::Close()
+{
+	if (gMetricsFile != nullptr)
+	{
+		gMetricsOpen.store(false, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(gMetricsFlushMutex);
+			gMetricsStop = true;
+		}
+		gMetricsFlushCond.notify_all();
+		gMetricsFlushThread.join();
+
+		cFileUtil::CloseFile(gMetricsFile);
+		gMetricsFile = nullptr;
+
+		uint64_t num_dropped = GetNumDropped();
+		if (num_dropped > 0)
+		{
+			printf("Metrics dropped %llu events\n", static_cast<unsigned long long>(num_dropped));
+		}
+	}
+}
+
+bool cMetrics::IsOpen()
+{
+	return gMetricsOpen.load(std::memory_order_acquire);
+}
+
+int cMetrics::RegisterCounter(const std::string& name)
+{
+	return RegisterMetric(name, eTypeCounter, 0, 0, 0);
+}
+
+int cMetrics::RegisterGauge(const std::string& name)
+{
+	return RegisterMetric(name, eTypeGauge, 0, 0, 0);
+}
+
+int cMetrics::RegisterHist(const std::string& name, double min_val, double max_val, int num_bins)
+{
+	assert(max_val > min_val);
+	assert(num_bins > 0);
+	return RegisterMetric(name, eTypeHist, min_val, max_val, num_bins);
+}
+
+void cMetrics::Add(int id, double delta, int64_t step)
+{
+	Log(id, delta, step);
+}
+
+void cMetrics::Set(int id, double val, int64_t step)
+{
+	Log(id, val, step);
+}
+
+void cMetrics::Observe(int id, double val, int64_t step)
+{
+	Log(id, val, step);
+}
+
+uint64_t cMetrics::GetNumDropped()
+{
+	return gMetricsNumDropped.load(std::memory_order_relaxed);
+}
+
+void cMetrics::Log(int id, double val, int64_t step)
+{
+	if (IsOpen() && id != gInvalidID)
+	{
+		tMetricsEvent evt;
+		evt.mID = id;
+		evt.mStep = step;
+		evt.mTime = GetMetricsTime();
+		evt.mVal = val;
+
+		// never wait on the flush thread, a full buffer means the event is lost
+		bool succ = GetMetricsBuffer()->Push(evt);
+		if (!succ)
+		{
+			gMetricsNumDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
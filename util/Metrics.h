@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// process wide metrics stream, metrics are registered once by name and then logged by id,
+// events go into a lock-free buffer owned by the calling thread and a background thread
+// drains the buffers every flush period into an append-only binary or ndjson file,
+// events logged while no file is open are dropped, see experiments/metrics.py for a reader
+class cMetrics
+{
+public:
+	enum eType
+	{
+		// running total of everything added
+		eTypeCounter,
+		// last value set
+		eTypeGauge,
+		// binned distribution of the values observed since the previous flush
+		eTypeHist,
+		eTypeMax
+	};
+
+	enum eFormat
+	{
+		eFormatBinary,
+		eFormatNDJSON,
+		eFormatMax
+	};
+
+	static const int gInvalidID = -1;
+
+	static bool ParseFormat(const std::string& str, eFormat& out_format);
+
+	static bool Open(const std::string& file, eFormat format, double flush_period);
+	static void Close();
+	static bool IsOpen();
+
+	// registering an existing name returns its id
+	static int RegisterCounter(const std::string& name);
+	static int RegisterGauge(const std::string& name);
+	// values outside [min_val, max_val) go into the first or last bin
+	static int RegisterHist(const std::string& name, double min_val, double max_val, int num_bins);
+
+	// step is an optional caller defined index, e.g. the training iteration
+	static void Add(int id, double delta = 1, int64_t step = -1);
+	static void Set(int id, double val, int64_t step = -1);
+	static void Observe(int id, double val, int64_t step = -1);
+
+	// events dropped because a thread buffer was full
+	static uint64_t GetNumDropped();
+
+protected:
+	static void Log(int id, double val, int64_t step);
+};
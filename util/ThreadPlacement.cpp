@@ -0,0 +1,416 @@
+#include "ThreadPlacement.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include "util/MathUtil.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const std::string gSysCPUDir = "/sys/devices/system/cpu/";
+const std::string gSysNodeDir = "/sys/devices/system/node/";
+
+cThreadPlacement::tCPU::tCPU()
+{
+	mID = gInvalidIdx;
+	mNode = 0;
+	mPackage = 0;
+	mCore = 0;
+}
+
+bool cThreadPlacement::ParsePolicy(const std::string& str, ePolicy& out_policy)
+{
+	bool succ = true;
+	if (str == "none" || str == "")
+	{
+		out_policy = ePolicyNone;
+	}
+	else if (str == "compact")
+	{
+		out_policy = ePolicyCompact;
+	}
+	else if (str == "scatter")
+	{
+		out_policy = ePolicyScatter;
+	}
+	else if (str == "explicit")
+	{
+		out_policy = ePolicyExplicit;
+	}
+	else
+	{
+		printf("Unsupported thread placement %s\n", str.c_str());
+		succ = false;
+	}
+	return succ;
+}
+
+const std::vector<cThreadPlacement::tCPU>& cThreadPlacement::GetTopology()
+{
+	static std::mutex topology_lock;
+	static bool built = false;
+	static std::vector<tCPU> cpus;
+
+	std::lock_guard<std::mutex> lock(topology_lock);
+	if (!built)
+	{
+		bool succ = BuildTopology(cpus);
+		if (!succ)
+		{
+			// no topology to go on, treat every cpu as its own core on a single node
+			int num_cpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+			cpus.resize(num_cpus);
+			for (int i = 0; i < num_cpus; ++i)
+			{
+				cpus[i].mID = i;
+				cpus[i].mCore = i;
+			}
+		}
+		built = true;
+	}
+	return cpus;
+}
+
+int cThreadPlacement::GetNumNodes()
+{
+	const auto& cpus = GetTopology();
+	int num_nodes = 0;
+	for (size_t i = 0; i < cpus.size(); ++i)
+	{
+		num_nodes = std::max(num_nodes, cpus[i].mNode + 1);
+	}
+	return num_nodes;
+}
+
+cThreadPlacement::cThreadPlacement()
+{
+	mPolicy = ePolicyNone;
+}
+
+cThreadPlacement::~cThreadPlacement()
+{
+}
+
+void cThreadPlacement::Init(ePolicy policy, const std::vector<int>& cpus)
+{
+	mPolicy = policy;
+	mOrder.clear();
+
+	if (mPolicy == ePolicyCompact)
+	{
+		BuildCompactOrder(mOrder);
+	}
+	else if (mPolicy == ePolicyScatter)
+	{
+		BuildScatterOrder(mOrder);
+	}
+	else if (mPolicy == ePolicyExplicit)
+	{
+		BuildExplicitOrder(cpus, mOrder);
+	}
+
+	if (mOrder.empty())
+	{
+		mPolicy = ePolicyNone;
+	}
+}
+
+bool cThreadPlacement::IsEnabled() const
+{
+	return mPolicy != ePolicyNone;
+}
+
+cThreadPlacement::ePolicy cThreadPlacement::GetPolicy() const
+{
+	return mPolicy;
+}
+
+int cThreadPlacement::GetCPU(int thread_id) const
+{
+	int cpu = gInvalidIdx;
+	if (IsEnabled())
+	{
+		int idx = mOrder[thread_id % mOrder.size()];
+		cpu = GetTopology()[idx].mID;
+	}
+	return cpu;
+}
+
+int cThreadPlacement::GetNode(int thread_id) const
+{
+	int node = gInvalidIdx;
+	if (IsEnabled())
+	{
+		int idx = mOrder[thread_id % mOrder.size()];
+		node = GetTopology()[idx].mNode;
+	}
+	return node;
+}
+
+bool cThreadPlacement::PinThread(int thread_id) const
+{
+	bool succ = false;
+	int cpu = GetCPU(thread_id);
+	if (cpu != gInvalidIdx)
+	{
+#if defined(__linux__)
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu, &cpu_set);
+		succ = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#endif
+		if (!succ)
+		{
+			printf("Failed to pin thread %i to cpu %i\n", thread_id, cpu);
+		}
+	}
+	return succ;
+}
+
+void cThreadPlacement::RunPinned(int thread_id, const std::function<void()>& func) const
+{
+	if (IsEnabled())
+	{
+		std::thread pinned_thread([this, thread_id, &func]()
+		{
+			PinThread(thread_id);
+			func();
+		});
+		pinned_thread.join();
+	}
+	else
+	{
+		func();
+	}
+}
+
+void cThreadPlacement::PrintPlacement(int num_threads) const
+{
+	if (IsEnabled())
+	{
+		printf("Thread placement across %i node(s):", GetNumNodes());
+		for (int i = 0; i < num_threads; ++i)
+		{
+			printf(" %i:cpu%i/node%i", i, GetCPU(i), GetNode(i));
+		}
+		printf("\n");
+	}
+}
+
+bool cThreadPlacement::BuildTopology(std::vector<tCPU>& out_cpus)
+{
+	out_cpus.clear();
+
+	std::vector<int> cpu_ids;
+	bool succ = ReadCPUList(gSysCPUDir + "online", cpu_ids);
+	if (!succ)
+	{
+		return false;
+	}
+
+#if defined(__linux__)
+	// skip the cpus outside of the process affinity mask, eg. when running under taskset or in a container
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+	{
+		auto removed = std::remove_if(cpu_ids.begin(), cpu_ids.end(),
+			[&allowed](int id) { return id < CPU_SETSIZE && !CPU_ISSET(id, &allowed); });
+		cpu_ids.erase(removed, cpu_ids.end());
+	}
+#endif
+
+	out_cpus.resize(cpu_ids.size());
+	for (size_t i = 0; i < cpu_ids.size(); ++i)
+	{
+		tCPU& cpu = out_cpus[i];
+		cpu.mID = cpu_ids[i];
+		cpu.mCore = cpu.mID;
+
+		std::string topology_dir = gSysCPUDir + "cpu" + std::to_string(cpu.mID) + "/topology/";
+		ReadInt(topology_dir + "physical_package_id", cpu.mPackage);
+		ReadInt(topology_dir + "core_id", cpu.mCore);
+	}
+
+	std::vector<int> node_ids;
+	if (ReadCPUList(gSysNodeDir + "online", node_ids))
+	{
+		// nodes are renumbered densely so they can be used as indices
+		for (size_t n = 0; n < node_ids.size(); ++n)
+		{
+			std::vector<int> node_cpus;
+			ReadCPUList(gSysNodeDir + "node" + std::to_string(node_ids[n]) + "/cpulist", node_cpus);
+			for (size_t i = 0; i < out_cpus.size(); ++i)
+			{
+				if (std::find(node_cpus.begin(), node_cpus.end(), out_cpus[i].mID) != node_cpus.end())
+				{
+					out_cpus[i].mNode = static_cast<int>(n);
+				}
+			}
+		}
+	}
+
+	return !out_cpus.empty();
+}
+
+bool cThreadPlacement::ReadInt(const std::string& file, int& out_val)
+{
+	std::ifstream f_stream(file);
+	int val = 0;
+	bool succ = static_cast<bool>(f_stream >> val);
+	if (succ)
+	{
+		out_val = val;
+	}
+	return succ;
+}
+
+bool cThreadPlacement::ReadCPUList(const std::string& file, std::vector<int>& out_list)
+{
+	std::ifstream f_stream(file);
+	std::string str;
+	bool succ = static_cast<bool>(std::getline(f_stream, str));
+	if (succ)
+	{
+		succ = ParseCPUList(str, out_list);
+	}
+	return succ;
+}
+
+bool cThreadPlacement::ParseCPUList(const std::string& str, std::vector<int>& out_list)
+{
+	// ranges in the kernel's list format, eg. 0-3,8-11
+	out_list.clear();
+	std::stringstream str_stream(str);
+	std::string range;
+	while (std::getline(str_stream, range, ','))
+	{
+		int beg = 0;
+		int end = 0;
+		int num_read = sscanf(range.c_str(), "%i-%i", &beg, &end);
+		if (num_read == 1)
+		{
+			end = beg;
+		}
+		else if (num_read != 2)
+		{
+			continue;
+		}
+
+		for (int i = beg; i <= end; ++i)
+		{
+			out_list.push_back(i);
+		}
+	}
+	return !out_list.empty();
+}
+
+void cThreadPlacement::BuildCompactOrder(std::vector<int>& out_order) const
+{
+	// hyperthread siblings end up next to each other
+	const auto& cpus = GetTopology();
+	out_order.resize(cpus.size());
+	for (size_t i = 0; i < cpus.size(); ++i)
+	{
+		out_order[i] = static_cast<int>(i);
+	}
+
+	std::stable_sort(out_order.begin(), out_order.end(), [&cpus](int a, int b)
+	{
+		const tCPU& cpu_a = cpus[a];
+		const tCPU& cpu_b = cpus[b];
+		if (cpu_a.mNode != cpu_b.mNode)
+		{
+			return cpu_a.mNode < cpu_b.mNode;
+		}
+		else if (cpu_a.mPackage != cpu_b.mPackage)
+		{
+			return cpu_a.mPackage < cpu_b.mPackage;
+		}
+		else if (cpu_a.mCore != cpu_b.mCore)
+		{
+			return cpu_a.mCore < cpu_b.mCore;
+		}
+		return cpu_a.mID < cpu_b.mID;
+	});
+}
+
+void cThreadPlacement::BuildScatterOrder(std::vector<int>& out_order) const
+{
+	// every physical core of every node gets a thread before any of them gets a second one
+	const auto& cpus = GetTopology();
+	int num_cpus = static_cast<int>(cpus.size());
+	int num_nodes = GetNumNodes();
+
+	std::vector<int> compact_order;
+	BuildCompactOrder(compact_order);
+
+	std::vector<int> sibling_rank(num_cpus, 0);
+	for (int i = 1; i < num_cpus; ++i)
+	{
+		const tCPU& prev = cpus[compact_order[i - 1]];
+		const tCPU& curr = cpus[compact_order[i]];
+		if (prev.mNode == curr.mNode && prev.mPackage == curr.mPackage && prev.mCore == curr.mCore)
+		{
+			sibling_rank[compact_order[i]] = sibling_rank[compact_order[i - 1]] + 1;
+		}
+	}
+
+	std::vector<std::vector<int>> node_cpus(num_nodes);
+	for (int i = 0; i < num_cpus; ++i)
+	{
+		int idx = compact_order[i];
+		node_cpus[cpus[idx].mNode].push_back(idx);
+	}
+
+	for (int n = 0; n < num_nodes; ++n)
+	{
+		std::stable_sort(node_cpus[n].begin(), node_cpus[n].end(), [&sibling_rank](int a, int b)
+		{
+			return sibling_rank[a] < sibling_rank[b];
+		});
+	}
+
+	out_order.clear();
+	for (int r = 0; static_cast<int>(out_order.size()) < num_cpus; ++r)
+	{
+		for (int n = 0; n < num_nodes; ++n)
+		{
+			if (r < static_cast<int>(node_cpus[n].size()))
+			{
+				out_order.push_back(node_cpus[n][r]);
+			}
+		}
+	}
+}
+
+void cThreadPlacement::BuildExplicitOrder(const std::vector<int>& cpus, std::vector<int>& out_order) const
+{
+	const auto& topology = GetTopology();
+	out_order.clear();
+	for (size_t i = 0; i < cpus.size(); ++i)
+	{
+		int idx = gInvalidIdx;
+		for (size_t j = 0; j < topology.size(); ++j)
+		{
+			if (topology[j].mID == cpus[i])
+			{
+				idx = static_cast<int>(j);
+				break;
+			}
+		}
+
+		if (idx != gInvalidIdx)
+		{
+			out_order.push_back(idx);
+		}
+		else
+		{
+			printf("Ignoring cpu %i for thread placement, it is not available to this process\n", cpus[i]);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// places worker threads on cpus, the cpu topology (nodes, packages, cores) is read once from /sys,
+// compact fills the cores of one node before moving on to the next, scatter deals threads
+// out across the nodes and cores in turn, and explicit takes a list of cpus,
+// threads past the number of cpus wrap around, pinning is only supported on linux
+class cThreadPlacement
+{
+public:
+	enum ePolicy
+	{
+		ePolicyNone,
+		ePolicyCompact,
+		ePolicyScatter,
+		ePolicyExplicit,
+		ePolicyMax
+	};
+
+	struct tCPU
+	{
+		int mID;
+		int mNode;
+		int mPackage;
+		int mCore;
+
+		tCPU();
+	};
+
+	static bool ParsePolicy(const std::string& str, ePolicy& out_policy);
+	// the cpus this process is allowed to run on
+	static const std::vector<tCPU>& GetTopology();
+	static int GetNumNodes();
+
+	cThreadPlacement();
+	virtual ~cThreadPlacement();
+
+	virtual void Init(ePolicy policy, const std::vector<int>& cpus);
+	virtual bool IsEnabled() const;
+	virtual ePolicy GetPolicy() const;
+
+	// cpu and node of a thread, gInvalidIdx if the thread is not placed
+	virtual int GetCPU(int thread_id) const;
+	virtual int GetNode(int thread_id) const;
+
+	// pins the calling thread to the cpu of the given thread
+	virtual bool PinThread(int thread_id) const;
+	// runs the function to completion on a thread pinned like the given thread,
+	// memory first touched by the function is allocated on that thread's node
+	virtual void RunPinned(int thread_id, const std::function<void()>& func) const;
+	virtual void PrintPlacement(int num_threads) const;
+
+protected:
+	ePolicy mPolicy;
+	std::vector<int> mOrder; // indices into the topology in the order threads are placed
+
+	static bool BuildTopology(std::vector<tCPU>& out_cpus);
+	static bool ReadInt(const std::string& file, int& out_val);
+	static bool ReadCPUList(const std::string& file, std::vector<int>& out_list);
+	static bool ParseCPUList(const std::string& str, std::vector<int>& out_list);
+
+	virtual void BuildCompactOrder(std::vector<int>& out_order) const;
+	virtual void BuildScatterOrder(std::vector<int>& out_order) const;
+	virtual void BuildExplicitOrder(const std::vector<int>& cpus, std::vector<int>& out_order) const;
+};
@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+cThreadPool::cThreadPool()
+{
+	mJobs = nullptr;
+	mNextJob = 0;
+	mNumActive = 0;
+	mBatchID = 0;
+	mDone = false;
+}
+
+cThreadPool::~cThreadPool()
+{
+	Clear();
+}
+
+void cThreadPool::Init(int num_threads)
+{
+	Clear();
+	mDone = false;
+
+	int num_workers = std::max(0, num_threads - 1);
+	for (int i = 0; i < num_workers; ++i)
+	{
+		mWorkers.push_back(std::thread(&cThreadPool::WorkerLoop, this, mBatchID));
+	}
+}
+
+void cThreadPool::Clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mDone = true;
+	}
+	mStartCond.notify_all();
+
+	for (size_t i = 0; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i].join();
+	}
+	mWorkers.clear();
+}
+
+int cThreadPool::GetNumThreads() const
+{
+	return static_cast<int>(mWorkers.size()) + 1;
+}
+
+void cThreadPool::Run(const std::vector<tJob>& jobs)
+{
+	int num_jobs = static_cast<int>(jobs.size());
+	if (mWorkers.empty() || num_jobs <= 1)
+	{
+		for (int j = 0; j < num_jobs; ++j)
+		{
+			jobs[j]();
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs = &jobs;
+		mNextJob = 0;
+		mNumActive = static_cast<int>(mWorkers.size());
+		++mBatchID;
+	}
+	mStartCond.notify_all();
+
+	RunJobs();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCond.wait(lock, [this]() { return mNumActive == 0; });
+	mJobs = nullptr;
+}
+
+void cThreadPool::WorkerLoop(int batch_id)
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mStartCond.wait(lock, [this, batch_id]() { return mDone || mBatchID != batch_id; });
+			if (mDone)
+			{
+				return;
+			}
+			batch_id = mBatchID;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mNumActive;
+		}
+		mDoneCond.notify_one();
+	}
+}
+
+void cThreadPool::RunJobs()
+{
+	const std::vector<tJob>& jobs = *mJobs;
+	int num_jobs = static_cast<int>(jobs.size());
+	int j = mNextJob++;
+	while (j < num_jobs)
+	{
+		jobs[j]();
+		j = mNextJob++;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+// small fork-join pool, Run hands a batch of jobs to the workers and the calling
+// thread and returns once every job has finished, the workers persist between batches
+class cThreadPool
+{
+public:
+	typedef std::function<void()> tJob;
+
+	cThreadPool();
+	virtual ~cThreadPool();
+
+	// the calling thread counts as one of the threads
+	virtual void Init(int num_threads);
+	virtual void Clear();
+	virtual int GetNumThreads() const;
+
+	virtual void Run(const std::vector<tJob>& jobs);
+
+protected:
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mStartCond;
+	std::condition_variable mDoneCond;
+
+	const std::vector<tJob>* mJobs;
+	std::atomic<int> mNextJob;
+	int mNumActive;
+	int mBatchID;
+	bool mDone;
+
+	virtual void WorkerLoop(int batch_id);
+	virtual void RunJobs();
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+// hands the latest value from one producer thread to one consumer thread without locking,
+// the producer fills the back slot and publishes it by swapping it with the middle slot,
+// the consumer swaps the middle slot into the front whenever something new was published,
+// so neither side ever waits on the other and stale values are simply dropped
+template<typename tVal>
+class cTripleBuffer
+{
+public:
+	cTripleBuffer();
+
+	// producer
+	tVal& GetBack();
+	void Publish();
+
+	// consumer
+	bool HasUpdate() const;
+	// returns true if the front now holds a newer value
+	bool Acquire();
+	const tVal& GetFront() const;
+	tVal& GetFront();
+
+protected:
+	static const int gIdxMask = 0x3;
+	static const int gUpdateFlag = 0x4;
+
+	tVal mSlots[3];
+	int mBack;
+	int mFront;
+	std::atomic<int> mMiddle;
+};
+
+
+template<typename tVal>
+cTripleBuffer<tVal>::cTripleBuffer()
+{
+	mFront = 0;
+	mMiddle = 1;
+	mBack = 2;
+}
+
+template<typename tVal>
+tVal& cTripleBuffer<tVal>::GetBack()
+{
+	return mSlots[mBack];
+}
+
+template<typename tVal>
+void cTripleBuffer<tVal>::Publish()
+{
+	int prev = mMiddle.exchange(mBack | gUpdateFlag, std::memory_order_acq_rel);
+	mBack = prev & gIdxMask;
+}
+
+template<typename tVal>
+bool cTripleBuffer<tVal>::HasUpdate() const
+{
+	return (mMiddle.load(std::memory_order_acquire) & gUpdateFlag) != 0;
+}
+
+template<typename tVal>
+bool cTripleBuffer<tVal>::Acquire()
+{
+	bool updated = false;
+	if (HasUpdate())
+	{
+		// only the consumer clears the flag, so the middle slot cannot go stale in between
+		int prev = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+		mFront = prev & gIdxMask;
+		updated = true;
+	}
+	return updated;
+}
+
+template<typename tVal>
+const tVal& cTripleBuffer<tVal>::GetFront() const
+{
+	return mSlots[mFront];
+}
+
+template<typename tVal>
+tVal& cTripleBuffer<tVal>::GetFront()
+{
+	return mSlots[mFront];
+}